@@ -0,0 +1,66 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+#include "kernel.h"
+
+/**
+ * プラットフォーム検出（ACPI MADT / Intel MP テーブル）
+ * 【目的】CPU（Local APIC）の数とID、I/O APIC の位置、ISA IRQ の割り当てを
+ * ファームウェアのテーブルから取得する
+ * 【方針】ACPI の MADT を優先し、見つからなければ MP フローティングポインタを探す
+ */
+
+// RSDP / MPフローティングポインタの探索範囲
+#define BDA_EBDA_SEGMENT_ADDR 0x40E   // BDA内のEBDAセグメント位置
+#define EBDA_SEARCH_SIZE 1024         // EBDA先頭から探索するバイト数
+#define BIOS_ROM_START 0xE0000        // BIOS ROM 領域の開始
+#define BIOS_ROM_END 0x100000         // BIOS ROM 領域の終端
+#define FIRMWARE_TABLE_ALIGN 16       // RSDP/MPポインタは16バイト境界
+
+// ACPI テーブル定数
+#define ACPI_RSDP_CHECKSUM_LEN 20     // ACPI 1.0 部分のチェックサム長
+#define ACPI_HEADER_SIZE 36           // 標準テーブルヘッダ長
+#define ACPI_MADT_ENTRIES_OFFSET 44   // MADT: ヘッダ + LAPICアドレス + フラグ
+#define ACPI_MADT_LAPIC 0             // Processor Local APIC
+#define ACPI_MADT_IOAPIC 1            // I/O APIC
+#define ACPI_MADT_ISO 2               // Interrupt Source Override
+#define ACPI_MADT_LAPIC_ENABLED 0x01  // プロセッサ有効フラグ
+
+// MP テーブル定数
+#define MP_CONFIG_ENTRIES_OFFSET 44   // 設定テーブルヘッダ長
+#define MP_ENTRY_PROCESSOR 0
+#define MP_ENTRY_IOAPIC 2
+#define MP_PROCESSOR_ENTRY_SIZE 20
+#define MP_OTHER_ENTRY_SIZE 8
+#define MP_PROCESSOR_ENABLED 0x01
+#define MP_IOAPIC_ENABLED 0x01
+
+// ISA IRQ 数（Interrupt Source Override の対象）
+#define ISA_IRQ_COUNT 16
+
+/*
+ * 検出結果
+ * 【備考】irq_to_gsi は上書きがなければ恒等写像（IRQn → GSI n）
+ */
+typedef struct {
+    const char* source;                    // "ACPI MADT" / "MP table"
+    uint32_t lapic_base;                   // Local APIC の物理アドレス
+    uint32_t cpu_count;                    // 有効なCPU数
+    uint8_t lapic_ids[MAX_CPUS];           // 各CPUの Local APIC ID
+    bool has_ioapic;                       // I/O APIC を検出したか
+    uint8_t ioapic_id;
+    uint32_t ioapic_base;                  // I/O APIC の物理アドレス
+    uint32_t ioapic_gsi_base;              // この I/O APIC の先頭GSI
+    uint32_t irq_to_gsi[ISA_IRQ_COUNT];    // ISA IRQ → GSI
+    uint16_t irq_flags[ISA_IRQ_COUNT];     // MPS INTI フラグ（極性/トリガ）
+} platform_info_t;
+
+// ファームウェアテーブルを探索して platform_info_t を埋める
+os_result_t acpi_detect_platform(void);
+const platform_info_t* acpi_get_platform(void);
+
+#endif  // ACPI_H
@@ -0,0 +1,32 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "error_types.h"
+
+/**
+ * カーネル内ベンチマーク登録・実行
+ * 【目的】各サブシステムが提供する計測関数を一括で実行する
+ * 【備考】結果はdebug_print経由でシリアルに出力される
+ */
+
+// ベンチマーク登録エントリ
+typedef struct {
+    const char* name;   // ベンチマーク名
+    void (*run)(void);  // 計測関数（スレッドコンテキストで呼ばれる）
+} benchmark_entry_t;
+
+// 全ベンチマーク実行
+void benchmark_run_all(void);
+
+// 名前を指定して1つ実行（シリアルシェルから）・名前の一覧表示
+os_result_t benchmark_run(const char* name);
+void benchmark_print_names(void);
+
+// ブート時自動実行用スレッド（BENCHMARK_ON_BOOTビルド時のみ作成）
+void benchmark_thread(void);
+
+// IRQ 入口〜EOI ベンチマークの計測用ハンドラ
+void irq_bench_handler_c(void);
+extern void irq_bench_interrupt_handler(void);  // interrupt.sで定義
+
+#endif  // BENCHMARK_H
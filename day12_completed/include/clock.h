@@ -0,0 +1,46 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * TSC ベースのシステム時刻
+ * 【目的】PIT のティック（10ms）より細かいナノ秒単位の時刻を、
+ * ポートI/Oなしの rdtsc だけで得る
+ * 【方針】起動時に PIT のティックを基準に TSC 周波数を較正し、
+ * 較正時点のティック数を起点にして以後の時刻を TSC から求める
+ * （get_system_ticks() の値は較正の前後で連続する）
+ */
+
+#define NSEC_PER_USEC 1000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_SEC 1000000000ULL
+#define TICK_US (1000000 / TIMER_FREQUENCY)  // 1ティックのマイクロ秒数
+#define TICK_NS (TICK_US * NSEC_PER_USEC)    // 1ティックのナノ秒数
+#define CLOCK_CALIBRATE_TICKS 10             // 較正時間（100ms）
+#define CLOCK_TIME_NEVER 0xFFFFFFFFFFFFFFFFULL  // 期限なし
+
+// CPUID.01H:EDX
+#define CPUID_FEATURE_TSC (1 << 4)
+
+// 初期化（PIT の割り込みが有効な状態で BSP から呼ぶ）
+void clock_init(void);
+bool clock_is_calibrated(void);
+
+// 時刻
+uint64_t clock_get_time_ns(void);
+uint64_t clock_get_time_us(void);
+uint32_t clock_get_ticks(void);
+uint32_t clock_get_tsc_khz(void);
+
+// 時刻（ns）と TSC 値の相互変換（絶対時刻）
+uint64_t clock_ns_to_tsc(uint64_t time_ns);
+uint64_t clock_tsc_to_ns(uint64_t tsc);
+
+// TSC のサイクル数（2つの rdtsc の差）→ 時間（ns）。未較正なら 0
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+#endif  // CLOCK_H
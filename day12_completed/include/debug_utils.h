@@ -214,12 +214,18 @@ void debug_command_scheduler(void);
 void debug_command_keyboard(void);
 void debug_command_serial(void);
 void debug_command_timer(void);
+void debug_command_sched_tuning(uint32_t tick_us, uint32_t quantum_us);
 void debug_command_dump(uint32_t address, uint32_t length);
+void debug_command_binlog(const char* mode);
 void debug_command_trace(void);
 void debug_command_benchmark(void);
+void debug_command_locks(void);
 void debug_command_stress_test(void);
 
-// インタラクティブデバッグモード
+// インタラクティブデバッグモード（シリアルシェル）
+// debug_enter_interactive_mode はシェルスレッドの本体（戻らない）
+#define DEBUG_SHELL_PROMPT "mini-os> "
+#define DEBUG_SHELL_WORD_MAX 24  // コマンド名・引数1つの最大長
 void debug_enter_interactive_mode(void);
 void debug_process_command(const char* command);
 
@@ -0,0 +1,54 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// FXSAVE/FXRSTOR 定数
+#define FXSAVE_AREA_SIZE 512    // FXSAVE領域サイズ（x87 + MMX + SSE）
+#define FXSAVE_ALIGNMENT 16     // FXSAVE領域に必要なアライメント
+#define MXCSR_DEFAULT 0x1F80    // MXCSR初期値（全SIMD例外マスク）
+#define FPU_NM_VECTOR 7         // #NM（Device Not Available）例外ベクタ
+
+// 制御レジスタのビット定数
+#define CR0_TS 0x00000008       // Task Switched（FPU命令で#NMを発生）
+#define CR4_OSFXSR 0x00000200   // OSがFXSAVE/FXRSTORをサポート
+
+// ベンチマーク定数
+#define FPU_BENCH_ITERATIONS 1000  // 計測ループ回数
+
+/*
+ * スレッドごとのFPU/SSE保存領域
+ * 【役割】FXSAVEが書き出す512バイトのレジスタイメージ
+ */
+typedef struct {
+    uint8_t bytes[FXSAVE_AREA_SIZE];
+} __attribute__((aligned(FXSAVE_ALIGNMENT))) fpu_state_t;
+
+struct thread;
+
+// 初期化と状態
+void fpu_init(void);
+void fpu_init_cpu(void);
+bool fpu_is_available(void);
+uint32_t fpu_get_trap_count(void);
+
+// スレッド連携（スケジューラから呼ばれる）
+void fpu_thread_init(struct thread* thread);
+void fpu_switch_to(struct thread* next);
+void fpu_release_thread(struct thread* thread);
+
+// #NM例外ハンドラ（C言語部分）
+void device_not_available_handler_c(void);
+
+// カーネル内でSIMDを使う区間の保護
+uint32_t kernel_fpu_begin(void);
+void kernel_fpu_end(uint32_t flags);
+
+// ベンチマーク
+void fpu_benchmark_switch_cost(void);
+
+// 例外ハンドラ（interrupt.sで定義）
+extern void device_not_available_handler(void);
+
+#endif  // FPU_H
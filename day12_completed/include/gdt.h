@@ -0,0 +1,63 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include <stdint.h>
+
+/**
+ * CPUごとのGDTとTSS
+ * 【目的】ブートローダの共有GDT（コード/データのみ）を各CPU専用のGDTに置き換え、
+ * GSセグメントで自CPUの kernel_context_t を引けるようにする
+ * 【レイアウト】0x00 NULL / 0x08 コード / 0x10 データ / 0x18 per-CPU(GS) / 0x20 TSS
+ */
+
+// GDTエントリ数とインデックス
+#define GDT_ENTRY_COUNT 5
+#define GDT_INDEX_CODE 1
+#define GDT_INDEX_DATA 2
+#define GDT_INDEX_PERCPU 3
+#define GDT_INDEX_TSS 4
+
+// アクセスバイト・フラグ
+#define GDT_ACCESS_CODE 0x9A      // Present, DPL0, 実行/読み取り
+#define GDT_ACCESS_DATA 0x92      // Present, DPL0, 読み書き
+#define GDT_ACCESS_TSS 0x89       // Present, DPL0, 32bit TSS（Available）
+#define GDT_FLAGS_4KB_32BIT 0xC0  // G=1（4KB単位）, D/B=1（32bit）
+#define GDT_FLAGS_BYTE_32BIT 0x40 // G=0（バイト単位）, D/B=1（32bit）
+#define GDT_FLAT_LIMIT 0xFFFFF    // 4GB（4KB単位）
+
+/*
+ * セグメントディスクリプタ（8バイト）
+ */
+typedef struct {
+    uint16_t limit_low;
+    uint16_t base_low;
+    uint8_t base_mid;
+    uint8_t access;
+    uint8_t granularity;  // 上位4bit: フラグ, 下位4bit: limit[19:16]
+    uint8_t base_high;
+} __attribute__((packed)) gdt_entry_t;
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) gdt_ptr_t;
+
+/*
+ * 32bit TSS
+ * 【備考】リング0のみの現状では特権レベル遷移がないため esp0/ss0 は使われないが、
+ * 将来のユーザーモードに備えて CPU ごとに用意して ltr しておく
+ */
+typedef struct {
+    uint32_t prev_tss;
+    uint32_t esp0;
+    uint32_t ss0;
+    uint32_t unused[22];  // esp1〜ldt（使用しない）
+    uint16_t trap;
+    uint16_t iomap_base;
+} __attribute__((packed)) tss_t;
+
+// CPUごとのGDT/TSSを構築してロードし、GSをper-CPUセグメントに設定する
+void gdt_init_cpu(uint32_t cpu, void* percpu_base, uint32_t percpu_size,
+                  uint32_t kernel_stack_top);
+
+#endif  // GDT_H
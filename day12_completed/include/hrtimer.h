@@ -0,0 +1,53 @@
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * 高分解能タイマー（hrtimer）
+ * 【目的】ナノ秒単位の絶対時刻に1回だけコールバックを呼ぶ。
+ * sleep 系関数と周期処理の起床はすべてこれで実現する
+ * 【方針】CPUごとに期限の最小ヒープを持ち、先頭の期限を Local APIC タイマーの
+ * 次の割り込み時刻に反映する（PIT のみの構成ではティックごとに確認する）
+ * 【重要】コールバックは開始したCPUのタイマー割り込み内（割り込み禁止）で呼ばれる。
+ * ブロックする処理は行わないこと
+ */
+
+#define HRTIMER_MAX_PER_CPU 32  // CPUあたりの同時に有効なタイマー数
+#define HRTIMER_INACTIVE (-1)   // heap_index: キューに入っていない
+
+// hrtimer ベンチマーク定数
+#define HRTIMER_BENCH_SLEEP_NS 100000ULL  // 100µs スリープ
+#define HRTIMER_BENCH_ITERATIONS 100
+
+typedef struct hrtimer hrtimer_t;
+typedef void (*hrtimer_callback_t)(hrtimer_t* timer);
+
+struct hrtimer {
+    uint64_t expires_ns;          // 期限（clock_get_time_ns() の絶対時刻）
+    hrtimer_callback_t callback;  // 期限到達時に呼ぶ関数
+    void* data;                   // コールバック用の任意データ
+    int32_t heap_index;           // ヒープ内の位置（HRTIMER_INACTIVE なら停止中）
+    uint32_t cpu;                 // キューに入れたCPU
+};
+
+// 初期化
+void hrtimer_init(hrtimer_t* timer, hrtimer_callback_t callback, void* data);
+
+// 開始・停止（開始済みのタイマーを再度開始すると期限を付け替える）
+os_result_t hrtimer_start(hrtimer_t* timer, uint64_t delay_ns);
+os_result_t hrtimer_start_abs(hrtimer_t* timer, uint64_t expires_ns);
+bool hrtimer_cancel(hrtimer_t* timer);
+bool hrtimer_is_active(const hrtimer_t* timer);
+
+// タイマー割り込みからの呼び出し（実行中CPUのキューが対象）
+uint64_t hrtimer_next_expiry_ns(void);
+void hrtimer_run_expired(void);
+
+// ベンチマーク（100µs スリープの起床遅れ）
+void hrtimer_benchmark(void);
+
+#endif  // HRTIMER_H
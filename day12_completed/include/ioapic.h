@@ -0,0 +1,45 @@
+#ifndef IOAPIC_H
+#define IOAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * I/O APIC
+ * 【目的】ISA デバイスの IRQ を 8259 PIC を経由せず Local APIC へ配送する
+ * 【備考】ISA IRQ → GSI の対応と極性・トリガは ACPI MADT の
+ * Interrupt Source Override（acpi_get_platform()->irq_to_gsi / irq_flags）に従う
+ */
+
+// MMIO レジスタ（IOREGSEL にインデックスを書き、IOWIN で読み書きする）
+#define IOAPIC_REG_SELECT 0x00
+#define IOAPIC_REG_WINDOW 0x10
+
+// 間接レジスタ
+#define IOAPIC_REG_VERSION 0x01
+#define IOAPIC_REG_REDIRECTION 0x10  // エントリ n は 0x10 + 2n（下位）/ +1（上位）
+#define IOAPIC_VERSION_MAX_ENTRY_SHIFT 16
+
+// リダイレクションエントリのビット定数（固定配送・物理宛先）
+#define IOAPIC_REDIR_ACTIVE_LOW 0x2000
+#define IOAPIC_REDIR_LEVEL 0x8000
+#define IOAPIC_REDIR_MASKED 0x10000
+#define IOAPIC_REDIR_DEST_SHIFT 24
+
+// MPS INTI フラグ（MADT Interrupt Source Override）
+#define MPS_INTI_POLARITY_MASK 0x03
+#define MPS_INTI_ACTIVE_LOW 0x03
+#define MPS_INTI_TRIGGER_MASK 0x0C
+#define MPS_INTI_LEVEL 0x0C
+
+// 初期化（全エントリをマスクする）
+os_result_t ioapic_init(void);
+
+// ISA IRQ の配送先設定（マスクした状態で書き込む）
+os_result_t ioapic_route_irq(uint8_t irq, uint8_t vector, uint8_t lapic_id);
+void ioapic_mask_irq(uint8_t irq);
+void ioapic_unmask_irq(uint8_t irq);
+
+#endif  // IOAPIC_H
@@ -0,0 +1,130 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * 割り込みの振り分け
+ * 【目的】全256ベクタを共通の入口（interrupt.s の isr_stub_N → interrupt_dispatch_c）
+ * で受け、デバイスの追加をアセンブリの変更なしに irq_register() だけで行えるようにする
+ * 【方針】
+ * - ベクタ 0〜31（CPU例外）: 例外名とレジスタを表示して停止する（トリプルフォルト防止）
+ * - ベクタ 32〜47（ISA IRQ0〜15）: 登録されたハンドラを順に呼ぶ（共有IRQ）。
+ *   EOI・後半処理（irq_exit）・再スケジュールは振り分け側で行う
+ * - それ以外: 未登録のベクタとして数えるだけ
+ * 【備考】Local APIC タイマー・再スケジュールIPI・#NM など頻度の高いベクタは、
+ * 専用の入口（IRQ_ENTRY）で IDT を上書きしたまま使う
+ */
+
+#define IDT_VECTORS 256        // IDT のエントリ数
+#define EXCEPTION_VECTORS 32   // ベクタ 0〜31 は CPU 例外
+#define IRQ_LINES 16           // ISA IRQ0〜15（PIC / I/O APIC のピン）
+#define IRQ_MAX_ACTIONS 32     // 登録できるハンドラの総数（全IRQ合計）
+#define IRQ_CASCADE 2          // スレーブPICが接続されたマスターのIRQ
+
+// 例外のうち停止せずに戻るもの・追加情報を表示するもの
+#define EXCEPTION_NMI 2
+#define EXCEPTION_BREAKPOINT 3
+#define EXCEPTION_PAGE_FAULT 14  // CR2 に違反アドレスが入る
+
+/*
+ * 割り込みレイテンシ計測（make IRQTRACE=1 でビルドした場合のみ有効）
+ * 【目的】「タイマー割り込みは予定からどれだけ遅れて入るか」
+ * 「割り込み禁止区間はどこがどれだけ長いか」に実測で答える
+ * - ベクタごとに入口〜出口の時間のヒストグラムを取る
+ * - Local APIC タイマーは設定した期限から入口までの遅れを別に記録する
+ * - 呼び出し箇所を指定した割り込み禁止区間の最長・平均を記録する
+ */
+#define IRQ_HIST_BUCKETS 10  // [0,1) [1,2) [2,4) ... [128,256) [256,∞) µs
+
+/*
+ * 割り込み禁止区間の呼び出し箇所
+ * 【備考】区間はCPUごとに「割り込みが有効だった状態から禁止にした箇所」で始まり、
+ * 再び有効にする箇所で終わる。スレッドを切り替えた場合は切り替え先で終わる
+ */
+typedef enum {
+    IRQOFF_SITE_IRQ,       // 割り込みハンドラ（入口から後半処理の sti まで）
+    IRQOFF_SITE_SCHEDULE,  // schedule() / thread_exit()（acquire_scheduler_lock の区間）
+    IRQOFF_SITE_YIELD,     // thread_yield() / thread_yield_to()
+    IRQOFF_SITE_BLOCK,     // block_current_thread()
+    IRQOFF_SITE_WAKEUP,    // 起床処理（タイマー待ち・同期・キーボード待ち）
+    IRQOFF_SITE_HRTIMER,   // hrtimer_start_abs()（期限の登録と再設定）
+    IRQOFF_SITE_KEYBOARD,  // keyboard_deliver_char()（入力バッファへの格納）
+    IRQOFF_SITE_COUNT
+} irqoff_site_t;
+
+/*
+ * IRQ ハンドラ
+ * 【戻り値】自分のデバイスが割り込みを上げていれば true（共有IRQで他を区別する）
+ * 【前提】割り込み禁止で呼ばれる。EOI は送らないこと
+ */
+typedef bool (*irq_handler_t)(void* ctx);
+
+/*
+ * 共通入口が積むスタックフレーム（interrupt.s の interrupt_common_entry と一致させる）
+ */
+typedef struct {
+    uint32_t edx;
+    uint32_t ecx;
+    uint32_t eax;
+    uint32_t vector;      // isr_stub_N が積むベクタ番号
+    uint32_t error_code;  // CPU が積むエラーコード（ない例外・IRQ は 0）
+    uint32_t eip;         // 以下 CPU が自動で積む
+    uint32_t cs;
+    uint32_t eflags;
+} interrupt_frame_t;
+
+/*
+ * ベクタごとの受信回数と処理時間（TSC サイクル）
+ */
+typedef struct {
+    uint32_t count;
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+} irq_vector_stats_t;
+
+// 初期化（全ベクタの IDT エントリを共通入口に向ける）
+void irq_init(void);
+
+// ハンドラの登録（最初の登録で IRQ ラインのマスクを解除する）
+os_result_t irq_register(uint8_t irq, irq_handler_t handler, void* ctx);
+
+// I/O APIC への切り替え（init_apic_interrupts から）
+os_result_t irq_route_to_ioapic(uint8_t lapic_id, bool route_timer);
+void irq_unmask_registered(void);
+
+// 共通入口から呼ばれる振り分け本体
+void interrupt_dispatch_c(interrupt_frame_t* frame);
+
+// 統計（irq_account は専用入口のハンドラからも irq_exit 経由で呼ばれる）
+void irq_account(uint8_t vector, uint64_t enter_tsc);
+void irq_get_vector_stats(uint8_t vector, irq_vector_stats_t* out);
+void irq_print_stats(void);
+
+#ifdef IRQ_LATENCY_TRACE
+// flags は irq_save() の戻り値（IF が立っていた＝ここで禁止にした場合だけ記録する）
+void irqoff_trace_begin(irqoff_site_t site, uint32_t flags);
+void irqoff_trace_end(uint32_t flags);
+void irq_trace_timer_late(uint64_t enter_tsc, uint64_t deadline_tsc);
+#else
+static inline void irqoff_trace_begin(irqoff_site_t site, uint32_t flags) {
+    (void)site;
+    (void)flags;
+}
+static inline void irqoff_trace_end(uint32_t flags) {
+    (void)flags;
+}
+static inline void irq_trace_timer_late(uint64_t enter_tsc,
+                                        uint64_t deadline_tsc) {
+    (void)enter_tsc;
+    (void)deadline_tsc;
+}
+#endif
+
+// interrupt.s で生成する入口のアドレス表
+extern const uint32_t isr_stub_table[IDT_VECTORS];
+
+#endif  // IRQ_H
@@ -7,6 +7,8 @@
 #include <stdint.h>
 
 #include "error_types.h"
+#include "fpu.h"
+#include "hrtimer.h"
 
 // VGAテキストモード定数
 #define VGA_WIDTH 80
@@ -31,8 +33,10 @@
 #define DEBUG_MARKER_N 0x074e  // 'N' - kernel_main から戻り
 
 // セグメントセレクタ定数
-#define CODE_SEGMENT_SELECTOR 0x08  // コードセグメントセレクタ
-#define DATA_SEGMENT_SELECTOR 0x10  // データセグメントセレクタ
+#define CODE_SEGMENT_SELECTOR 0x08    // コードセグメントセレクタ
+#define DATA_SEGMENT_SELECTOR 0x10    // データセグメントセレクタ
+#define PERCPU_SEGMENT_SELECTOR 0x18  // CPUごとのGSセグメント（kernel_context_t）
+#define TSS_SEGMENT_SELECTOR 0x20     // CPUごとのTSS
 
 // Error types are now defined in error_types.h
 
@@ -45,22 +49,40 @@
 #define PIT_COMMAND 0x43         // PITコマンドポート
 #define PIC_MASTER_COMMAND 0x20  // マスターPICコマンドポート
 #define PIC_MASTER_DATA 0x21     // マスターPICデータポート
+#define PIC_SLAVE_COMMAND 0xA0   // スレーブPICコマンドポート
+#define PIC_SLAVE_DATA 0xA1      // スレーブPICデータポート
 
 // PIC初期化コマンド定数 (ICW1-ICW4)
 #define PIC_ICW1_INIT \
     0x11  // ICW1: 初期化コマンド（エッジトリガー、カスケード、ICW4必要）
 #define PIC_ICW2_MASTER_BASE \
     0x20  // ICW2: マスターPIC割り込みベース（IRQ0-7 → INT32-39）
+#define PIC_ICW2_SLAVE_BASE \
+    0x28  // ICW2: スレーブPIC割り込みベース（IRQ8-15 → INT40-47）
 #define PIC_ICW3_SLAVE_IRQ2 0x04  // ICW3: スレーブPICはIRQ2に接続
+#define PIC_ICW3_SLAVE_ID 0x02    // ICW3: スレーブ側のカスケードID（=2）
 #define PIC_ICW4_8086_MODE 0x01   // ICW4: 8086/8088モード
 
 // PIC割り込みマスク定数
 #define PIC_MASK_ALL_DISABLED 0xFF    // 全割り込み無効化
-#define PIC_MASK_TIMER_KEYBOARD 0xFC  // 11111100b = IRQ0とIRQ1のみ有効
+#define PIC_MASK_TIMER 0x01           // IRQ0（PIT）のマスクビット
 
 // PIC終了コマンド定数
 #define PIC_EOI 0x20  // End of Interrupt - 割り込み処理終了通知
 
+// PIC の ISR/IRR 読み出し（OCW3。コマンドポートに書いた後の inb で読める）
+#define PIC_OCW3_READ_IRR 0x0A
+#define PIC_OCW3_READ_ISR 0x0B
+
+// ISA IRQ 番号とベクタ（PIC・I/O APIC のどちらでも同じベクタを使う）
+#define IRQ_VECTOR_BASE 0x20   // IRQn → 割り込み 32+n
+#define IRQ_TIMER 0            // PIT
+#define IRQ_KEYBOARD 1         // PS/2 キーボード
+#define IRQ_COM1 4             // シリアルポート COM1
+#define IRQ_SLAVE_PIC_BASE 8   // IRQ8 以降はスレーブPIC
+#define IRQ_PIC_SPURIOUS_MASTER 7   // PIC がスプリアス割り込みに使う番号
+#define IRQ_PIC_SPURIOUS_SLAVE 15
+
 // PIT制御コマンド定数
 #define PIT_MODE_SQUARE_WAVE \
     0x36  // チャンネル0、Lo/Hi byte、モード3（矩形波）、バイナリ
@@ -70,26 +92,68 @@
 #define IDT_FLAG_PRESENT_DPL0_32BIT \
     0x8E  // プレゼント、DPL=0、32bit割り込みゲート
 
+// SMP定数
+#define MAX_CPUS 8                   // サポートする最大CPU数
+#define KERNEL_STACK_TOP 0x00300000  // BSPのブートスタック（kernel_entry.s）
+
 // Thread management constants
-#define MAX_THREADS 4            // 最大スレッド数
+#define MAX_THREADS 24           // 最大スレッド数（CPUごとのアイドルスレッドを含む）
 #define THREAD_STACK_SIZE 1024   // スレッドスタックサイズ
 #define MAX_COUNTER_VALUE 65535  // スレッドカウンター最大値
 #define DISPLAY_LINE_LENGTH 25   // 表示行の長さ
 #define MAX_THREAD_NAME_LEN 15   // スレッド名最大長
 
-// Serial port constants
+// デモスレッドの周期（periodic_task_create() で周期境界に起動する）
+#define THREAD_A_PERIOD_NS 1000000000ULL  // 1.0秒
+#define THREAD_B_PERIOD_NS 1500000000ULL  // 1.5秒
+
+// スレッド優先度（値が大きいほど優先。同じ優先度の間はラウンドロビン）
+#define THREAD_PRIORITY_IDLE 0    // アイドルスレッド専用
+#define THREAD_PRIORITY_LOW 1     // バックグラウンド処理
+#define THREAD_PRIORITY_NORMAL 2  // 既定値
+#define THREAD_PRIORITY_HIGH 3    // 入力処理など応答性が必要なスレッド
+#define THREAD_PRIORITY_MAX 31    // 設定可能な最大値
+
+// スケジューリングクラス（実行順は EDF > 通常 > 公平 > アイドル優先度の通常）
+#define SCHED_CLASS_NORMAL 0  // 優先度 + 同一優先度内ラウンドロビン
+#define SCHED_CLASS_EDF 1     // 最早デッドライン優先（実行時間・周期を宣言）
+#define SCHED_CLASS_FAIR 2    // 仮想実行時間の最小を選ぶ公平配分（CFS 方式）
+#define SCHED_CLASS_MLFQ 3    // 多段フィードバックキュー（通常クラスと同じ順位）
+#define SCHED_CLASS_COUNT 4
+
+// クォンタム（同じ順位のスレッドへ切り替えるまでの実行時間、クラスごと）
+// 満了はスケジューラティックごとに判定する（ティック周期とは独立に設定できる）
+#define SCHED_QUANTUM_DEFAULT_US 10000
+#define SCHED_QUANTUM_MIN_US 100
+#define SCHED_QUANTUM_MAX_US 1000000
+
+// 多段フィードバックキュー（MLFQ）
+// 段ごとの持ち時間を使い切ったスレッドは1段下がり、一定間隔で全員が最上段に戻る
+#define MLFQ_LEVELS 3
+#define MLFQ_TOP_PRIORITY THREAD_PRIORITY_HIGH  // 最上段の優先度（1段ごとに -1）
+#define MLFQ_ALLOTMENT_BASE_US 10000           // 最上段の持ち時間（段ごとに2倍）
+#define MLFQ_BOOST_INTERVAL_NS 1000000000ULL   // 全員を最上段に戻す間隔 1秒
+
+// 公平クラスの重み（実行時間の配分比。既定値の2倍の重みなら2倍の CPU 時間）
+#define FAIR_WEIGHT_DEFAULT 1024
+#define FAIR_WEIGHT_MIN 15
+#define FAIR_WEIGHT_MAX 88761
+#define FAIR_MIN_GRANULARITY_US 1000  // 公平クラス同士で切り替える最小の差
+#define FAIR_WAKEUP_CREDIT_US 5000    // 起床したスレッドへの仮想時間の前借り
+
+// EDF クラスの受け入れ制御（帯域 = 実行時間 / 周期、ppm 単位）
+// 周期の上限は予算の比較（予算 × 周期）が64bitに収まる範囲
+#define EDF_BANDWIDTH_UNIT 1000000ULL    // 帯域 100%
+#define EDF_MAX_BANDWIDTH_PPM 900000     // CPUあたりの上限（残りは通常クラス）
+#define EDF_MIN_PERIOD_NS 100000ULL      // 100µs
+#define EDF_MAX_PERIOD_NS 4000000000ULL  // 4秒
+
+// スレッド A/B が EDF クラスに宣言する周期あたりの実行時間（1ms）
+#define THREAD_PERIODIC_RUNTIME_NS 1000000ULL
+
+// Serial port constants（レジスタ・設定値は serial.h）
 #define SERIAL_PORT_COM1 0x3F8  // COM1ポートベースアドレス
 
-// Serial port configuration constants
-#define SERIAL_INT_DISABLE 0x00      // 割り込み無効化
-#define SERIAL_DLAB_ENABLE 0x80      // DLAB有効化（ボーレート設定モード）
-#define SERIAL_BAUD_38400_LOW 0x03   // ボーレート下位: 38400 bps
-#define SERIAL_BAUD_38400_HIGH 0x00  // ボーレート上位: 38400 bps
-#define SERIAL_8N1_CONFIG 0x03       // 8bit, パリティなし, 1ストップビット
-#define SERIAL_FIFO_ENABLE 0xC7      // FIFO有効化、クリア、14バイト閾値
-#define SERIAL_MODEM_READY 0x0B      // IRQ有効化、RTS/DSR設定
-#define SERIAL_TRANSMIT_READY 0x20   // 送信準備完了ビット
-
 // VGA表示色定数
 #define VGA_COLOR_WHITE 0x0F    // 白文字
 #define VGA_COLOR_YELLOW 0x0E   // 黄色文字
@@ -107,15 +171,17 @@
 
 // EFLAGS定数
 #define EFLAGS_INTERRUPT_ENABLE 0x202  // IF=1（割り込み有効）, reserved bit=1
+#define EFLAGS_IF 0x200                // IF ビット（irq_save() の戻り値の判定用）
 
 /*
  * スレッド状態の定義
- * 【説明】各スレッドは以下の3つの状態のいずれかを持つ
+ * 【説明】各スレッドは以下の4つの状態のいずれかを持つ
  */
 typedef enum {
-    THREAD_READY,    // 実行可能（CPUを待っている状態）
-    THREAD_RUNNING,  // 現在実行中
-    THREAD_BLOCKED   // I/Oやタイマー待ちでブロック中
+    THREAD_READY,      // 実行可能（CPUを待っている状態）
+    THREAD_RUNNING,    // 現在実行中
+    THREAD_BLOCKED,    // I/Oやタイマー待ちでブロック中
+    THREAD_TERMINATED  // 終了済み（スロット再利用可能）
 } thread_state_t;
 
 /*
@@ -123,11 +189,55 @@ typedef enum {
  */
 typedef enum {
     BLOCK_REASON_NONE,
-    BLOCK_REASON_TIMER,     // sleep()によるタイマー待ち
+    BLOCK_REASON_TIMER,     // sleep系関数によるタイマー待ち（sleep_timer）
     BLOCK_REASON_KEYBOARD,  // getchar()によるキーボード入力待ち
+    BLOCK_REASON_SYNC,      // mutex/semaphore/condvar の待ち（wait_object参照）
     // 将来的にディスクI/O、ネットワークI/Oなどを追加可能
 } block_reason_t;
 
+/*
+ * EDF クラスのスレッドごとの状態
+ * 【備考】周期ごとに runtime_ns の予算を持ち、使い切ると次のデッドラインまで
+ * 実行されない（throttled）。デッドラインは周期の境界で更新される
+ */
+typedef struct {
+    uint64_t runtime_ns;        // 周期あたりの実行時間（宣言値）
+    uint64_t period_ns;         // 周期（= 相対デッドライン）
+    uint64_t deadline_ns;       // 現在のジョブの絶対デッドライン
+    int64_t budget_ns;          // 現在の周期の残り予算
+    uint64_t last_update_ns;    // 実行時間を最後に計上した時刻
+    uint32_t bandwidth_ppm;     // runtime_ns / period_ns（受け入れ制御用）
+    uint32_t deadline_misses;   // デッドラインまでにジョブが終わらなかった回数
+    uint32_t throttle_count;    // 予算を使い切って止められた回数
+    bool throttled;             // 予算切れで次のデッドラインまで実行不可
+    hrtimer_t replenish_timer;  // 予算の補充（デッドライン時刻に発火）
+} edf_state_t;
+
+/*
+ * 公平クラスのスレッドごとの状態
+ * 【備考】vruntime は実行した TSC サイクル数を重みで割り戻した仮想時間。
+ * 常に vruntime の最も小さいスレッドを選ぶことで、重みに比例した配分になる
+ */
+typedef struct {
+    uint64_t vruntime;        // 仮想実行時間（TSC サイクル × 既定重み / 重み）
+    uint64_t exec_start_tsc;  // 実行を開始（または最後に計上）した TSC
+    uint64_t sum_exec_tsc;    // 実際に実行した TSC サイクルの合計
+    uint32_t weight;          // 重み（FAIR_WEIGHT_MIN〜FAIR_WEIGHT_MAX）
+    int32_t heap_index;       // 実行キュー内の位置（-1 なら入っていない）
+} fair_state_t;
+
+/*
+ * MLFQ クラスのスレッドごとの状態
+ * 【備考】持ち時間はブロックをまたいで積算する（スライスの直前に譲って
+ * 最上段に居座ることはできない）。リセットは段が変わった時だけ
+ */
+typedef struct {
+    uint8_t level;            // 現在の段（0 が最上段）
+    uint64_t used_tsc;        // 現在の段で使った TSC サイクル
+    uint64_t exec_start_tsc;  // 実行を開始（または最後に計上）した TSC
+    uint32_t demotions;       // 持ち時間を使い切って下がった回数
+} mlfq_state_t;
+
 /*
  * スレッド制御ブロック（TCB: Thread Control Block）
  * 【重要】各スレッドの全ての情報を保持する構造体
@@ -140,24 +250,59 @@ typedef struct thread {
     uint32_t delay_ticks;         // カウンター更新間隔（ティック数）
     uint32_t last_tick;           // 最後に更新した時刻
     block_reason_t block_reason;  // スレッドがブロックされている理由
-    uint32_t wake_up_tick;        // スリープからの起床予定時刻（ティック数）
+    hrtimer_t sleep_timer;        // スリープからの起床用タイマー
+    const void* wait_object;      // BLOCK_REASON_SYNC時の待ち対象
+    uint8_t base_priority;        // 設定された優先度
+    uint8_t priority;             // 実効優先度（優先度継承で一時的に上がる）
+    struct kmutex* blocked_on;    // 取得待ちのミューテックス（継承チェーン用）
+    struct kmutex* held_mutexes;  // 保持中ミューテックスのリスト
+    uint8_t sched_class;          // SCHED_CLASS_*
+    edf_state_t edf;              // EDF クラスの予算とデッドライン
+    fair_state_t fair;            // 公平クラスの仮想実行時間
+    mlfq_state_t mlfq;            // MLFQ クラスの段と使用時間
     int display_row;              // 画面表示行
+    uint8_t console;              // 画面出力を書く仮想コンソール（vga.h）
+    uint32_t cpu;                 // 所属CPU（このCPUのREADYリングに入る）
     struct thread* next_ready;    // READY リスト用（循環リスト）
     struct thread* next_blocked;  // BLOCKED リスト用ポインタ
+    fpu_state_t fpu_state;        // FXSAVE領域（遅延FPU切り替え用）
+    bool fpu_used;                // FPU/SSEを一度でも使用したか
     uint32_t
         esp;  // スタックポインタ（最後に配置してスタックオーバーフローから保護）
 } thread_t;
 
 /*
- * カーネルコンテキスト構造体
- * 【役割】カーネルの主要な状態を単一の構造体に集約
+ * 公平クラスの実行キュー（CPUごと）
+ * 【構造】vruntime の最小ヒープ。実行中のスレッドも入ったままにし、
+ * 計上で vruntime が増えたら位置を直す。先頭の参照は O(1)、出入りは O(log n)
  */
 typedef struct {
-    thread_t* current_thread;           // 現在実行中のスレッド
-    thread_t* ready_thread_list;        // READYスレッドリストの先頭
-    thread_t* blocked_thread_list;      // ブロックされたスレッドのリスト
-    uint32_t system_ticks;              // システム起動からの経過ティック数
+    thread_t* heap[MAX_THREADS];
+    uint32_t count;
+    uint64_t min_vruntime;  // キューの最小 vruntime（単調増加。起床時の基準）
+} fair_rq_t;
+
+/*
+ * カーネルコンテキスト構造体（CPUごと）
+ * 【役割】各CPUのスケジューリング状態を集約する
+ * 【重要】GSセグメントのベースがこの構造体を指し、get_kernel_context() は
+ * %gs:0 の self を読むだけで自CPUのコンテキストを得る（self は先頭固定）
+ * 【備考】ブロックリストとシステムティックは全CPU共通のため kernel.c 内に持つ
+ */
+typedef struct kernel_context {
+    struct kernel_context* self;        // 自分自身（GS:0 から参照）
+    thread_t* current_thread;           // このCPUで実行中のスレッド
+    thread_t* ready_thread_list;        // READYリングの先頭（公平クラス以外）
+    thread_t* idle_thread;              // このCPUのアイドルスレッド
+    uint32_t cpu_id;                    // 論理CPU番号（0 = BSP）
+    uint32_t lapic_id;                  // Local APIC ID（IPIの宛先）
+    volatile bool online;               // スケジューラが稼働しているか
     volatile int scheduler_lock_count;  // スケジューラのリエントラントロック
+    uint32_t edf_bandwidth_ppm;         // 受け入れ済み EDF スレッドの帯域合計
+    hrtimer_t edf_budget_timer;         // 実行中 EDF スレッドの予算切れ時刻
+    fair_rq_t fair_rq;                  // 公平クラスの実行キュー
+    uint64_t quantum_end_tsc;           // 実行中スレッドのクォンタム満了（TSC）
+    uint32_t context_switches;          // このCPUでのスレッド切り替え回数
 } kernel_context_t;
 
 /*
@@ -194,14 +339,58 @@ static inline uint8_t inb(uint16_t port) {
     asm volatile("inb %1, %0" : "=a"(ret) : "Nd"(port));
     return ret;
 }
+static inline void outw(uint16_t port, uint16_t val) {
+    asm volatile("outw %0, %1" : : "a"(val), "Nd"(port));
+}
+static inline uint16_t inw(uint16_t port) {
+    uint16_t ret;
+    asm volatile("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+static inline void outl(uint16_t port, uint32_t val) {
+    asm volatile("outl %0, %1" : : "a"(val), "Nd"(port));
+}
+static inline uint32_t inl(uint16_t port) {
+    uint32_t ret;
+    asm volatile("inl %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
 
-// Serial Port (for debugging)
+// CPU Utilities
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx,
+                         uint32_t* ecx, uint32_t* edx) {
+    asm volatile("cpuid"
+                 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                 : "a"(leaf), "c"(0));
+}
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr"
+                 :
+                 : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+// 割り込み状態を保存して無効化し、後で元の状態に戻す
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    asm volatile("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+static inline void irq_restore(uint32_t flags) {
+    asm volatile("pushl %0; popfl" : : "r"(flags) : "memory", "cc");
+}
+
+// Serial Port (for debugging, serial.c)
 void init_serial(void);
 void serial_write_char(char c);
 void serial_write_string(const char* str);
 
 // General Utilities
 void itoa(uint32_t value, char* buffer, int base);
+bool str_equal(const char* a, const char* b);
 
 /*
  * =================================================================================
@@ -254,14 +443,16 @@ void display_system_info(void);
 
 // 3.1 IDT Management
 void set_idt_gate(int n, uint32_t handler);
+void load_idt(void);
 void setup_idt_structure(void);
 void register_interrupt_handlers(void);
 
 // 3.2 PIC (Programmable Interrupt Controller)
 void remap_pic(void);
 void configure_interrupt_masks(void);
-void enable_timer_interrupt(void);
 void init_pic(void);
+void disable_pic(void);
+void irq_send_eoi(uint8_t irq);
 
 // 3.3 PIT (Programmable Interval Timer)
 void init_timer(uint32_t frequency);
@@ -270,6 +461,11 @@ void init_timer(uint32_t frequency);
 void init_interrupts(void);
 void enable_cpu_interrupts(void);
 
+// 3.5 APIC Interrupt Delivery（Local APIC タイマー + I/O APIC）
+void init_apic_interrupts(void);
+bool apic_interrupts_enabled(void);
+void timer_tick(void);
+
 /*
  * =================================================================================
  * 4. Thread Management & Scheduling
@@ -288,20 +484,51 @@ os_result_t create_thread(void (*func)(void), uint32_t delay_ticks,
 
 // 4.2 Thread State & Sleep Management (Split Functions)
 void sleep(uint32_t ticks);
+void sleep_us(uint32_t us);
+void sleep_ns(uint64_t ns);
+void sleep_until(uint64_t wake_up_ns);
 
 // 4.3 Blocked Thread Management
 void block_current_thread(block_reason_t reason, uint32_t data);
+void cancel_block_current_thread(void);
 void unblock_keyboard_threads(void);
+thread_t* wake_one_waiter(const void* wait_object);
+uint8_t highest_waiter_priority(const void* wait_object);
+uint32_t wake_all_waiters(const void* wait_object);
 
 // 4.4 Scheduler & Core Logic
 void schedule(void);
-
-// 4.5 Thread Helpers
+os_result_t sched_set_quantum_us(uint8_t sched_class, uint32_t us);
+uint32_t sched_get_quantum_us(uint8_t sched_class);
+
+// 4.5 Voluntary Switching & Exit
+bool thread_yield(void);
+os_result_t thread_yield_to(thread_t* target);
+void thread_exit(void);
+os_result_t thread_set_priority(thread_t* thread, uint8_t priority);
+void thread_refresh_priority(thread_t* thread);
+os_result_t thread_set_cpu(thread_t* thread, uint32_t cpu);
+void schedule_tail(void);
+
+// 4.6 EDF Scheduling Class
+os_result_t thread_set_edf(thread_t* thread, uint64_t runtime_ns,
+                           uint64_t period_ns);
+void edf_print_stats(void);
+
+// 4.7 Fair Scheduling Class
+os_result_t thread_set_fair(thread_t* thread, uint32_t weight);
+
+// 4.8 Multi-Level Feedback Queue Class
+os_result_t thread_set_mlfq(thread_t* thread, bool enable);
+
+// 4.9 Thread Helpers
 kernel_context_t* get_kernel_context(void);
+kernel_context_t* get_cpu_context(uint32_t cpu);
 thread_t* get_current_thread(void);
 uint32_t get_system_ticks(void);
 int update_thread_counter(uint32_t* last_tick_ptr, uint32_t interval_ticks,
                           const char* thread_name, int display_row);
+void increment_thread_counter(const char* thread_name, int display_row);
 
 /*
  * =================================================================================
@@ -310,6 +537,7 @@ int update_thread_counter(uint32_t* last_tick_ptr, uint32_t interval_ticks,
  */
 
 // Thread Functions (Application Layer)
+void idle_thread(void);
 void kernel_thread_function(void);
 void thread_function_1(void);
 void thread_function_2(void);
@@ -324,12 +552,9 @@ void kernel_main(void);
  * =================================================================================
  */
 
-// Interrupt Handlers
-extern void timer_interrupt_handler(void);
-extern void keyboard_interrupt_handler(void);
-
 // Context Switching
 extern void context_switch(uint32_t* old_esp, uint32_t new_esp);
 extern void initial_context_switch(uint32_t new_esp);
+extern void thread_entry_trampoline(void);
 
 #endif  // KERNEL_H
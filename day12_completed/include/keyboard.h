@@ -8,6 +8,8 @@
 #define KEYBOARD_DATA_PORT 0x60    // PS/2キーボードデータポート
 #define KEYBOARD_STATUS_PORT 0x64  // PS/2キーボードステータス/コマンドポート
 #define KEYBOARD_BUFFER_SIZE 256   // キーボード入力バッファサイズ
+#define KEYBOARD_SCANCODE_RING_SIZE 32  // トップハーフが積むスキャンコード
+#define KEYBOARD_KEY_LOG_SIZE 32        // デバッグ出力待ちのキー
 
 // Keyboard status register bits
 #define KEYBOARD_STATUS_OUTPUT_FULL \
@@ -20,6 +22,11 @@
 #define SCANCODE_BACKSPACE 0x0E     // Backspaceキーのスキャンコード
 #define SCANCODE_LEFT_SHIFT 0x2A    // 左Shiftキーのスキャンコード
 #define SCANCODE_RIGHT_SHIFT 0x36   // 右Shiftキーのスキャンコード
+#define SCANCODE_EXTENDED 0xE0      // 拡張キーの前置コード
+#define SCANCODE_PAGE_UP 0x49       // PageUp（0xE0 の後）
+#define SCANCODE_PAGE_DOWN 0x51     // PageDown（0xE0 の後）
+#define SCANCODE_ALT 0x38           // 左Alt（右Alt は 0xE0 の後）
+#define SCANCODE_F1 0x3B            // F1（F2〜F4 は 0x3C〜0x3E）
 
 /*
  * キーボード入力バッファ構造体
@@ -33,12 +40,29 @@ typedef struct {
     // (head+1)%N==tail
 } keyboard_buffer_t;
 
+/*
+ * キー入力からエコーまでの遅延の統計
+ * 【役割】割り込みでバッファに入った時刻から、読み取ったスレッドが画面に
+ * 表示し終えるまで（keyboard_record_echo()）の時間を集計する
+ */
+typedef struct {
+    uint32_t count;     // 計測したキー数
+    uint64_t total_ns;  // 遅延の合計
+    uint64_t max_ns;    // 遅延の最大
+} keyboard_latency_t;
+
 // Keyboard buffer management functions
 void init_keyboard_buffer(void);
 void keyboard_buffer_put(char c);
 char keyboard_buffer_get(void);
 bool keyboard_buffer_is_empty(void);
 bool keyboard_buffer_is_full(void);
+void keyboard_deliver_char(char c);
+
+// Keypress-to-echo latency
+void keyboard_record_echo(void);
+void keyboard_latency_reset(void);
+void keyboard_get_latency(keyboard_latency_t* out);
 
 // Keyboard controller functions (split function pattern)
 void init_keyboard_controller(void);
@@ -46,9 +70,8 @@ uint8_t read_keyboard_status(void);
 uint8_t read_keyboard_data(void);
 char convert_scancode_to_ascii(uint8_t scancode, bool shift_pressed);
 
-// Keyboard initialization and interrupt handling
+// Keyboard initialization (registers the IRQ1 handler)
 void init_keyboard(void);
-void keyboard_handler_c(void);
 
 // High-level input functions
 char getchar(void);
@@ -0,0 +1,93 @@
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * Local APIC
+ * 【目的】CPU間割り込み（IPI）の送信と AP の起動（INIT-SIPI-SIPI）、
+ * MMIO による EOI、CPU ごとのスケジューラティック（Local APIC タイマー）
+ * 【前提】ページングなしのため MMIO レジスタは物理アドレスで直接アクセスする
+ */
+
+#define LAPIC_DEFAULT_BASE 0xFEE00000
+
+// レジスタオフセット
+#define LAPIC_REG_ID 0x020
+#define LAPIC_REG_TPR 0x080
+#define LAPIC_REG_EOI 0x0B0
+#define LAPIC_REG_SVR 0x0F0
+#define LAPIC_REG_ICR_LOW 0x300
+#define LAPIC_REG_ICR_HIGH 0x310
+#define LAPIC_REG_LVT_TIMER 0x320
+#define LAPIC_REG_LVT_LINT0 0x350
+#define LAPIC_REG_LVT_LINT1 0x360
+#define LAPIC_REG_TIMER_INITIAL 0x380
+#define LAPIC_REG_TIMER_CURRENT 0x390
+#define LAPIC_REG_TIMER_DIVIDE 0x3E0
+
+// レジスタのビット定数
+#define LAPIC_ID_SHIFT 24
+#define LAPIC_SVR_ENABLE 0x100
+#define LAPIC_LVT_MASKED 0x10000
+#define LAPIC_ICR_FIXED 0x000
+#define LAPIC_ICR_INIT 0x500
+#define LAPIC_ICR_STARTUP 0x600
+#define LAPIC_ICR_PENDING 0x1000
+#define LAPIC_ICR_ASSERT 0x4000
+#define LAPIC_ICR_LEVEL 0x8000
+#define LAPIC_ICR_DEST_SHIFT 24
+#define LAPIC_TIMER_ONESHOT 0x00000
+#define LAPIC_TIMER_TSC_DEADLINE 0x40000
+#define LAPIC_TIMER_DIVIDE_16 0x03
+
+// TSC-deadline モード（CPUID.01H:ECX[24]、期限は MSR に TSC の絶対値で書く）
+#define CPUID_FEATURE_TSC_DEADLINE (1 << 24)
+#define MSR_IA32_TSC_DEADLINE 0x6E0
+
+// タイマー較正（TSC を基準にバスクロックを数える）
+#define LAPIC_TIMER_CALIBRATE_MS 10
+#define LAPIC_TIMER_MAX_COUNT 0xFFFFFFFF
+
+// スケジューラティックの周期（µs、実行中に lapic_timer_set_tick_us() で変更可）
+#define LAPIC_TIMER_TICK_US 10000
+#define LAPIC_TIMER_TICK_MIN_US 100
+#define LAPIC_TIMER_TICK_MAX_US 100000
+
+// 割り込みベクタ
+#define LAPIC_SPURIOUS_VECTOR 0xFF  // スプリアス割り込み（EOI不要）
+#define RESCHEDULE_IPI_VECTOR 0xF0  // 他CPUへの再スケジュール要求
+#define LAPIC_TIMER_VECTOR 0xEF     // CPUごとのスケジューラティック
+
+// 初期化
+void lapic_init(uint32_t base);
+void lapic_enable_cpu(bool mask_lint);
+bool lapic_is_available(void);
+
+// レジスタ操作
+uint32_t lapic_get_id(void);
+void lapic_eoi(void);
+
+// タイマー（BSPで較正し、全CPUで同じ較正値を使う）
+void lapic_timer_calibrate(void);
+os_result_t lapic_timer_start(void);
+void lapic_timer_update_event(void);
+os_result_t lapic_timer_set_tick_us(uint32_t us);
+uint32_t lapic_timer_get_tick_us(void);
+bool lapic_timer_is_running(void);  // 実行中CPUのティックが Local APIC タイマーか
+bool lapic_timer_uses_tsc_deadline(void);
+void lapic_timer_handler_c(void);
+
+// IPI送信
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+void lapic_send_init(uint8_t apic_id);
+void lapic_send_startup(uint8_t apic_id, uint8_t vector_page);
+
+// 割り込みハンドラ（interrupt.sで定義）
+extern void spurious_interrupt_handler(void);
+extern void lapic_timer_interrupt_handler(void);
+
+#endif  // LAPIC_H
@@ -0,0 +1,47 @@
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * 周期タスク
+ * 【目的】指定周期の境界（作成時刻 + n × 周期）ちょうどにジョブを起動し、
+ * 空振りの起床や相対スリープによる周期のずれをなくす
+ * 【方針】各タスクは専用スレッドで sleep_until(次のリリース時刻) を繰り返す。
+ * デッドラインは次のリリース時刻（暗黙デッドライン）
+ * 【統計】リリースからジョブ開始までの遅れ（ジッタ）の平均・最大と、
+ * デッドラインまでに終わらなかったジョブの数を記録する
+ */
+
+#define PERIODIC_MAX_TASKS 8  // 同時に存在できる周期タスク数
+
+typedef void (*periodic_job_t)(void);
+
+typedef struct {
+    bool used;                 // スロット使用中
+    thread_t* thread;          // ジョブを実行するスレッド
+    periodic_job_t job;        // 周期ごとに呼ぶ関数
+    uint64_t period_ns;        // 周期
+    uint64_t next_release_ns;  // 次のリリース時刻（絶対時刻）
+    // 統計（タスク自身のスレッドだけが更新する）
+    uint32_t releases;         // 起動したジョブ数
+    uint32_t deadline_misses;  // デッドライン超過（飛ばした周期を含む）
+    uint64_t jitter_total_ns;  // リリース遅れの合計
+    uint64_t jitter_max_ns;    // リリース遅れの最大
+} periodic_task_t;
+
+// 作成（display_row は create_thread() に渡す表示行）
+os_result_t periodic_task_create(uint64_t period_ns, periodic_job_t job,
+                                 int display_row, periodic_task_t** out_task);
+
+// EDF クラスへの登録（周期あたりの実行時間を宣言する。0 なら通常クラスに戻す）
+os_result_t periodic_task_set_runtime(periodic_task_t* task,
+                                      uint64_t runtime_ns);
+
+// 統計の表示（全タスク）
+void periodic_print_stats(void);
+
+#endif  // PERIODIC_H
@@ -0,0 +1,112 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * シリアルポート（COM1）の 16550 UART ドライバ
+ * 【目的】デバッグ出力の送信を速くし、キーボードのない環境（make run-nogui・
+ * ホストのスクリプトからの -serial stdio やパイプ）でもコマンドを入力できるようにする
+ * 【送信】起動時に UART の種類を調べ、16550A なら送信 FIFO（16バイト）を使う。
+ * THRE（送信保持レジスタ空）を1回確認するごとに FIFO の深さまで続けて書き込み、
+ * 1バイトごとのポーリングをしない
+ * 【受信】キーボードと同じ2段構成にする
+ * - トップハーフ（IRQ4）: UART の受信 FIFO を空になるまで読み、リングに積む
+ * - タスクレット: 受信待ちのスレッドを起床させる
+ */
+
+#define SERIAL_RX_RING_SIZE 256  // トップハーフが積む受信バイト
+#define SERIAL_LINE_MAX 80       // serial_read_line() の既定の最大長
+
+// ボーレート（分周比 = SERIAL_BASE_BAUD / ボーレート、1〜65535）
+#define SERIAL_BASE_BAUD 115200     // 1.8432MHz クロックで分周比 1 の速度
+#define SERIAL_BAUD_DEFAULT 115200  // 起動時の速度
+#define SERIAL_DIVISOR_MAX 0xFFFF
+
+// UART のレジスタ（SERIAL_PORT_COM1 からのオフセット）
+#define SERIAL_REG_DATA 0     // 受信・送信データ（DLAB=0）
+#define SERIAL_REG_IER 1      // 割り込み許可（DLAB=0）
+#define SERIAL_REG_DLL 0      // 分周比 下位（DLAB=1）
+#define SERIAL_REG_DLM 1      // 分周比 上位（DLAB=1）
+#define SERIAL_REG_IIR 2      // 割り込み識別（読み出し）
+#define SERIAL_REG_FCR 2      // FIFO 制御（書き込み）
+#define SERIAL_REG_LCR 3      // ライン制御
+#define SERIAL_REG_MCR 4      // モデム制御
+#define SERIAL_REG_LSR 5      // ラインステータス
+#define SERIAL_REG_SCRATCH 7  // スクラッチ（8250 以降の有無の確認に使う）
+
+#define SERIAL_IER_NONE 0x00
+#define SERIAL_IER_RX_AVAILABLE 0x01  // 受信データあり（FIFO 閾値・タイムアウト）
+#define SERIAL_LCR_DLAB 0x80          // 分周比レジスタを選択
+#define SERIAL_LCR_8N1 0x03           // 8bit, パリティなし, 1ストップビット
+#define SERIAL_FCR_ENABLE 0xC7        // FIFO 有効・送受信クリア・受信閾値 14 バイト
+#define SERIAL_IIR_FIFO_MASK 0xC0     // FIFO の状態（11=有効, 10=16550 の不具合版）
+#define SERIAL_IIR_FIFO_OK 0xC0
+#define SERIAL_IIR_FIFO_BROKEN 0x80
+#define SERIAL_MCR_OUT2_RTS_DTR 0x0B  // OUT2（IRQ 線を有効化）・RTS・DTR
+#define SERIAL_LSR_DATA_READY 0x01    // 受信 FIFO にデータあり
+#define SERIAL_LSR_ERRORS 0x1E        // オーバーラン・パリティ・フレーミング・ブレーク
+#define SERIAL_LSR_THR_EMPTY 0x20     // 送信保持レジスタ（FIFO 有効時は送信 FIFO）が空
+#define SERIAL_LSR_TX_IDLE 0x40       // 送信シフトレジスタも空（全ビット送信済み）
+
+#define SERIAL_FIFO_DEPTH_16550A 16  // 送信 FIFO のバイト数
+
+// ベンチマーク（SERIAL_BENCH_LINES 行 × 64 文字の debug_print）
+#define SERIAL_BENCH_LINES 256
+#define SERIAL_BENCH_LINE_CHARS 64
+
+/*
+ * UART の種類（init_serial() が判定する）
+ */
+typedef enum {
+    SERIAL_UART_NONE,    // スクラッチレジスタが応答しない（ポートなし）
+    SERIAL_UART_8250,    // FIFO なし（8250 / 16450）
+    SERIAL_UART_16550,   // FIFO に不具合のある初期版（FIFO を使わない）
+    SERIAL_UART_16550A,  // 16 バイト FIFO
+} serial_uart_type_t;
+
+/*
+ * 送信の統計
+ */
+typedef struct {
+    uint32_t bytes;       // 送信したバイト数
+    uint32_t thre_waits;  // THRE を確認した回数（FIFO 1杯ごとに1回）
+} serial_tx_stats_t;
+
+/*
+ * 受信の統計
+ */
+typedef struct {
+    uint32_t received;  // リングに積んだバイト数
+    uint32_t dropped;   // リングが満杯で捨てたバイト数
+    uint32_t errors;    // LSR がエラーを報告した回数
+} serial_rx_stats_t;
+
+// 送信（init_serial / serial_write_char / serial_write_string は kernel.h）
+void serial_write_buffer(const char* data, uint32_t length);
+bool serial_output_begin(void);  // 出力単位（行・フレーム）の排他。割り込みは禁止しない
+void serial_output_end(bool locked);
+os_result_t serial_set_baud(uint32_t baud);
+uint32_t serial_get_baud(void);
+serial_uart_type_t serial_get_uart_type(void);
+const char* serial_get_uart_name(void);
+uint32_t serial_get_fifo_depth(void);
+
+// 受信の初期化（IRQ4 を登録し、受信割り込みを有効にする。init_serial() の後に呼ぶ）
+void serial_rx_init(void);
+
+// 受信（ブロッキング・スレッドから呼ぶ）
+char serial_getchar(void);
+void serial_read_line(char* buffer, int max_length);
+
+// 統計
+void serial_get_tx_stats(serial_tx_stats_t* out);
+void serial_get_rx_stats(serial_rx_stats_t* out);
+
+// 送信スループットのベンチマーク（benchmark.c の一覧から呼ばれる）
+void serial_benchmark_throughput(void);
+
+#endif  // SERIAL_H
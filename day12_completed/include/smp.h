@@ -0,0 +1,57 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * SMP（マルチプロセッサ）起動
+ * 【目的】ファームウェアテーブルで見つけた AP（Application Processor）を
+ * INIT-SIPI-SIPI で起動し、各CPUで独立したスケジューラを動かす
+ * 【方針】スレッドは作成したCPUのREADYリングに入り、thread_set_cpu で移動する。
+ * 他CPUのスレッドを起床させた場合は再スケジュールIPIで知らせる
+ */
+
+// AP 起動トランポリン（リアルモードで実行されるため 1MB 未満・4KB境界）
+#define AP_TRAMPOLINE_ADDR 0x8000
+#define AP_TRAMPOLINE_PAGE (AP_TRAMPOLINE_ADDR >> 12)  // SIPI ベクタ
+#define AP_BOOT_STACK_SIZE 1024  // ap_main 用スタック（32bitワード数）
+
+// 起動シーケンスの待ち時間（タイマーティック単位, 1 tick = 10ms）
+#define AP_INIT_DELAY_TICKS 1     // INIT 後に 10ms 待つ
+#define AP_SIPI_DELAY_TICKS 1     // SIPI 間の待ち（仕様は 200us 以上）
+#define AP_STARTUP_TIMEOUT_TICKS 20  // AP が online になるまでの上限
+
+// スループットベンチマーク定数
+#define SMP_BENCH_MEASURE_TICKS 100  // 1回の計測時間（1秒）
+#define SMP_BENCH_COUNTER_STRIDE 16  // カウンタ間隔（64バイト = キャッシュライン）
+
+// 初期化（BSP、スレッド作成前に呼ぶ）
+void smp_init(void);
+
+// AP の C エントリ（ap_trampoline.s から呼ばれる）
+void ap_main(uint32_t cpu);
+
+// 状態
+uint32_t smp_get_online_count(void);
+
+// 他CPUへの再スケジュール要求（自CPUや未起動CPUなら何もしない）
+void smp_kick_cpu(uint32_t cpu);
+
+// 再スケジュールIPIハンドラ（C言語部分）
+void reschedule_ipi_handler_c(void);
+
+// ベンチマーク（1/2/4 CPU での集計カウンタスループット）
+void smp_benchmark_throughput(void);
+
+// トランポリン（ap_trampoline.sで定義）
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+extern uint8_t ap_trampoline_stack[];
+extern uint8_t ap_trampoline_cpu[];
+extern uint8_t ap_trampoline_entry[];
+extern void reschedule_ipi_handler(void);
+
+#endif  // SMP_H
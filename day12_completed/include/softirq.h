@@ -0,0 +1,66 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+
+/**
+ * 割り込みの後半処理（ボトムハーフ）
+ * 【目的】割り込みハンドラ（トップハーフ）はハードウェアの読み出しと登録だけを
+ * 行い、重い処理を割り込み許可の状態へ先送りして、割り込み禁止区間を短くする
+ * 【方針】2段階の先送りを用意する
+ * - タスクレット: irq_exit() で割り込みを許可してから実行する。
+ *   ブロックはできないが、スレッドへの切り替えを待たずに動く
+ * - ワークキュー: 専用のカーネルスレッド（kworker）で実行する。
+ *   シリアル出力など時間のかかる処理や、ブロックする処理に使う
+ * 【計測】irq_enter() から irq_exit() までをトップハーフの時間としてベクタごとに
+ * 記録し（irq_account()）、debug_command_interrupts() で表示する
+ */
+
+#define SOFTIRQ_MAX_RESTART 4  // irq_exit() 1回でタスクレットを処理し直す上限
+
+/*
+ * タスクレット
+ * 【備考】同じタスクレットは同時に1つのCPUでしか実行されない。
+ * 実行中に再登録すると、実行後にもう一度呼ばれる
+ */
+typedef struct tasklet {
+    struct tasklet* next;         // CPUごとの待ちリスト
+    void (*func)(void* data);     // 割り込み許可・切り替え禁止で呼ばれる
+    void* data;
+    volatile uint32_t scheduled;  // 待ちリストに入っている
+    volatile uint32_t running;    // 実行中（他CPUでの同時実行を防ぐ）
+} tasklet_t;
+
+/*
+ * ワークキューの作業項目
+ */
+typedef struct work {
+    struct work* next;
+    void (*func)(void* data);  // kworker スレッドで呼ばれる（ブロック可）
+    void* data;
+    volatile bool pending;     // キューに入っている（取り出した時点で下ろす）
+} work_t;
+
+// 割り込みハンドラの入口・出口（出口で待ちのタスクレットを実行する）
+uint64_t irq_enter(void);
+void irq_exit(uint8_t vector, uint64_t enter_tsc);
+
+// タスクレット
+void tasklet_init(tasklet_t* tasklet, void (*func)(void* data), void* data);
+void tasklet_schedule(tasklet_t* tasklet);
+
+// ワークキュー
+void work_init(work_t* work, void (*func)(void* data), void* data);
+bool queue_work(work_t* work);
+
+// 初期化（softirq_init は割り込み有効化前、workqueue_start はスレッド作成時）
+void softirq_init(void);
+os_result_t workqueue_start(void);
+
+// 統計
+void softirq_print_stats(void);
+
+#endif  // SOFTIRQ_H
@@ -0,0 +1,161 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "kernel.h"
+
+/**
+ * カーネル同期プリミティブ（mutex / semaphore / condition variable）
+ * 【目的】スレッドが資源を待つ間、割り込みを止めずにブロックできるようにする
+ * 【方針】待ちスレッドはスケジューラのブロックリストに BLOCK_REASON_SYNC で入り、
+ * wait_object（同期オブジェクトのアドレス）で識別される
+ */
+
+// 統計表示用の登録上限
+#define SYNC_MAX_TRACKED 16  // debug_command_locks で表示できるオブジェクト数
+
+// ベンチマーク定数
+#define SYNC_BENCH_ITERATIONS 1000  // 計測ループ回数
+
+// 優先度継承テスト定数（3スレッド: 低優先度L / 中優先度M / 高優先度H）
+#define PI_TEST_HOLD_TICKS 5   // L がロックを保持する長さ
+#define PI_TEST_HOG_TICKS 30   // M がCPUを占有する長さ
+
+/*
+ * ロック競合統計
+ * 【役割】オブジェクトごとの取得回数・競合回数・待ち時間（TSCサイクル）
+ * 【備考】condvarでは acquire_count = wait回数、contended_count = ブロック回数
+ */
+typedef struct {
+    uint32_t acquire_count;    // 取得（wait完了）回数
+    uint32_t contended_count;  // ブロックを伴った取得回数
+    uint64_t wait_cycles;      // ブロック待ちの累計サイクル
+    uint32_t max_wait_cycles;  // 最長の待ちサイクル
+} sync_stats_t;
+
+/*
+ * カーネルミューテックス（優先度継承付き）
+ * 【高速パス】競合がなければ lock cmpxchg 1回で取得（割り込み禁止なし）
+ * 【低速パス】ブロックリストで待ち、unlock時に最高優先度の1スレッドを起床させる
+ * 【優先度継承】待ちスレッドの優先度を保持スレッドへ（ブロックチェーンに沿って）
+ * 一時的に引き継ぎ、unlock時に元へ戻す
+ */
+typedef struct kmutex {
+    volatile uint32_t locked;   // 0=空き, 1=保持中
+    thread_t* owner;            // 保持スレッド
+    volatile uint32_t waiters;  // ブロック中の待ちスレッド数
+    bool priority_inherit;      // 優先度継承を行うか（既定: true）
+    struct kmutex* next_held;   // 保持スレッドの held_mutexes リスト
+    const char* name;           // 統計表示用の名前
+    sync_stats_t stats;
+} kmutex_t;
+
+/*
+ * 計数セマフォ
+ * 【高速パス】count > 0 なら lock cmpxchg で減算するだけ
+ * 【備考】ksem_post は割り込みハンドラからも呼べる
+ */
+typedef struct {
+    volatile uint32_t count;    // 残り資源数
+    volatile uint32_t waiters;  // ブロック中の待ちスレッド数
+    const char* name;
+    sync_stats_t stats;
+} ksemaphore_t;
+
+/*
+ * 条件変数
+ * 【使い方】kmutex を保持した状態で kcond_wait を呼び、条件はループで再確認する
+ */
+typedef struct {
+    volatile uint32_t waiters;  // ブロック中の待ちスレッド数
+    const char* name;
+    sync_stats_t stats;
+} kcondvar_t;
+
+/*
+ * アトミック操作（x86 lock プレフィックス命令）
+ */
+static inline uint32_t atomic_cmpxchg(volatile uint32_t* ptr, uint32_t expected,
+                                      uint32_t desired) {
+    uint32_t prev;
+    asm volatile("lock cmpxchgl %2, %1"
+                 : "=a"(prev), "+m"(*ptr)
+                 : "r"(desired), "0"(expected)
+                 : "memory");
+    return prev;
+}
+
+static inline uint32_t atomic_xchg(volatile uint32_t* ptr, uint32_t value) {
+    asm volatile("xchgl %0, %1" : "+r"(value), "+m"(*ptr) : : "memory");
+    return value;
+}
+
+static inline void atomic_inc(volatile uint32_t* ptr) {
+    asm volatile("lock incl %0" : "+m"(*ptr) : : "memory");
+}
+
+static inline void atomic_dec(volatile uint32_t* ptr) {
+    asm volatile("lock decl %0" : "+m"(*ptr) : : "memory");
+}
+
+/*
+ * スピンロック（CPU間の排他）
+ * 【重要】保持中に同じCPUの割り込みハンドラが同じロックを取るとデッドロックするため、
+ * 割り込みと共有するデータには spin_lock_irqsave を使う
+ */
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+static inline void spin_lock(spinlock_t* lock) {
+    while (atomic_xchg(&lock->locked, 1) != 0) {
+        // 解放されるまでキャッシュ上で待つ（バスロックを繰り返さない）
+        while (lock->locked) {
+            asm volatile("pause");
+        }
+    }
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    asm volatile("" : : : "memory");
+    lock->locked = 0;  // x86 ではストアの順序が保証される
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+// ミューテックス
+void kmutex_init(kmutex_t* mutex, const char* name);
+os_result_t kmutex_lock(kmutex_t* mutex);
+bool kmutex_trylock(kmutex_t* mutex);
+os_result_t kmutex_unlock(kmutex_t* mutex);
+void kmutex_refresh_priority(thread_t* thread);
+
+// セマフォ
+void ksem_init(ksemaphore_t* sem, uint32_t initial_count, const char* name);
+os_result_t ksem_wait(ksemaphore_t* sem);
+bool ksem_trywait(ksemaphore_t* sem);
+os_result_t ksem_post(ksemaphore_t* sem);
+
+// 条件変数
+void kcond_init(kcondvar_t* cond, const char* name);
+os_result_t kcond_wait(kcondvar_t* cond, kmutex_t* mutex);
+os_result_t kcond_signal(kcondvar_t* cond);
+os_result_t kcond_broadcast(kcondvar_t* cond);
+
+// 統計・ベンチマーク
+void sync_print_stats(void);
+void sync_benchmark(void);
+void sync_priority_inheritance_test(void);
+
+#endif  // SYNC_H
@@ -0,0 +1,142 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * バイナリのトレース・ログ形式（シリアル出力）
+ * 【目的】テキストの整形と UART の転送量を減らし、同じボーレートでより多くの
+ * 診断情報（ログ・メトリクス・スレッド情報・メモリダンプ・トレースイベント）を流す
+ * 【形式】1レコード = 1フレーム（リトルエンディアン）
+ *   A5 5A | type | length | cpu | seq | tsc(8) | payload(length) | checksum(2)
+ * checksum は type から payload の末尾までの Fletcher-16
+ * 【備考】このヘッダは tools/trace_decode.c（ホスト側のデコーダ）も読むため、
+ * 標準ヘッダ以外に依存しない。フレームの外のバイト（シェルのプロンプト・
+ * エコー）はデコーダがそのままテキストとして表示する
+ */
+
+#define TRACE_PROTOCOL_VERSION 1
+
+#define TRACE_SYNC0 0xA5
+#define TRACE_SYNC1 0x5A
+#define TRACE_HEADER_SIZE 14
+#define TRACE_PAYLOAD_MAX 240
+#define TRACE_CHECKSUM_SIZE 2
+#define TRACE_FRAME_MAX \
+    (TRACE_HEADER_SIZE + TRACE_PAYLOAD_MAX + TRACE_CHECKSUM_SIZE)
+
+#define TRACE_HEXDUMP_CHUNK 128            // HEXDUMP レコード1つのバイト数
+#define TRACE_EVENT_RING_SIZE 256          // CPUごとのイベントバッファ
+#define TRACE_FLUSH_INTERVAL_NS 20000000ULL  // イベントの送出間隔（20ms）
+
+/*
+ * レコードの種類
+ */
+typedef enum {
+    TRACE_REC_HELLO = 1,    // trace_hello_t（バイナリ出力の開始）
+    TRACE_REC_TEXT = 2,     // debug_print の1行（終端・改行なし）
+    TRACE_REC_METRICS = 3,  // trace_metrics_t
+    TRACE_REC_THREAD = 4,   // trace_thread_t
+    TRACE_REC_HEXDUMP = 5,  // trace_hexdump_t + データ
+    TRACE_REC_EVENT = 6,    // trace_event_t
+    TRACE_REC_DROPPED = 7,  // uint32_t（バッファ溢れで捨てたイベント数）
+} trace_record_type_t;
+
+/*
+ * トレースイベントの種類
+ */
+typedef enum {
+    TRACE_EV_SWITCH = 1,  // スレッド切り替え（arg0=切り替え元, arg1=切り替え先）
+    TRACE_EV_IRQ = 2,     // 割り込み（arg0=ベクタ, arg1=入口〜出口の TSC サイクル）
+} trace_event_id_t;
+
+/*
+ * フレームの先頭
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t sync[2];  // TRACE_SYNC0, TRACE_SYNC1
+    uint8_t type;     // trace_record_type_t
+    uint8_t length;   // payload のバイト数（TRACE_PAYLOAD_MAX 以下）
+    uint8_t cpu;      // 記録したCPU
+    uint8_t seq;      // フレームの通し番号（抜けの検出用）
+    uint64_t tsc;     // 記録した時刻（rdtsc）
+} trace_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t version;  // TRACE_PROTOCOL_VERSION
+    uint16_t cpus;     // 起動しているCPU数
+    uint32_t tsc_khz;  // TSC 周波数（デコーダが時刻に換算する）
+} trace_hello_t;
+
+// system_metrics_t と同じ並び
+typedef struct __attribute__((packed)) {
+    uint32_t total_interrupts;
+    uint32_t context_switches;
+    uint32_t threads_created;
+    uint32_t memory_usage_bytes;
+    uint32_t system_uptime_ticks;
+    uint32_t keyboard_inputs;
+    uint32_t serial_writes;
+    uint32_t timer_interrupts;
+    uint32_t scheduler_calls;
+} trace_metrics_t;
+
+// thread_diagnostics_t と同じ並び
+typedef struct __attribute__((packed)) {
+    uint32_t thread_id;
+    uint32_t state;
+    uint32_t stack_usage;
+    uint32_t execution_time;
+    uint32_t sleep_count;
+    uint32_t context_switch_count;
+    uint32_t priority;
+    uint32_t cpu_usage_percent;
+} trace_thread_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t address;  // 続くデータの先頭アドレス
+} trace_hexdump_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t id;  // trace_event_id_t
+    uint32_t arg0;
+    uint32_t arg1;
+} trace_event_t;
+
+/*
+ * Fletcher-16（カーネルとデコーダで共通）
+ * 【最適化】1フレーム（TRACE_FRAME_MAX バイト以下）なら 32bit の和が溢れないため、
+ * 剰余は最後に1回だけ取る（バイトごとに取る場合と同じ値になる）
+ */
+static inline uint16_t trace_checksum(const uint8_t* data, uint32_t length) {
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum1 += data[i];
+        sum2 += sum1;
+    }
+    return (uint16_t)(((sum2 % 255) << 8) | (sum1 % 255));
+}
+
+#ifndef TRACE_HOST
+#include "error_types.h"
+
+// 出力形式の切り替え（有効にすると debug_print もフレームで送る）
+void trace_set_binary(bool enable);
+bool trace_binary_enabled(void);
+
+// レコードの送出
+void trace_emit(uint8_t type, const void* payload, uint32_t length);
+void trace_emit_text(const char* text);
+
+// トレースイベント（CPUごとのバッファに記録し、送出スレッドがまとめて送る）
+void trace_event(uint16_t id, uint32_t arg0, uint32_t arg1);
+void trace_flush_events(void);
+
+// 送出スレッドの作成（スレッド作成時）・統計
+os_result_t trace_start(void);
+void trace_print_stats(void);
+#endif
+
+#endif  // TRACE_H
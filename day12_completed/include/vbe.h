@@ -0,0 +1,113 @@
+#ifndef VBE_H
+#define VBE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+#include "vga.h"
+
+/**
+ * Bochs/QEMU VBE（DISPI）のリニアフレームバッファ
+ * 【目的】1024x768x32 のグラフィックスモードで画面を描き、グラフィカルな
+ * 状態表示にかかるコスト（塗りつぶし・転送・文字描画）を計測する
+ * 【構造】
+ * - モードの設定は DISPI のポート（0x1CE/0x1CF）、フレームバッファの物理アドレスは
+ *   PCI の BAR0 から得る（ページングを使っていないため、そのままポインタにする）
+ * - 描画は行（スパン）単位のカーネルで行う。rep stosd/movsd と、SSE の
+ *   ノンテンポラルストア（movntps）の2種類
+ * - 文字は VGA のフォント（8x16。テキストモードのプレーン2から写す）を使い、
+ *   文字・前景色・背景色ごとに展開したピクセルをキャッシュする
+ * 【前提】グラフィックスモードの間、テキストモードの画面は止まる（vga_text_suspend）。
+ * モードの切り替えは1つのスレッドからだけ行う（描画はどのCPUからでもよい）
+ */
+
+// DISPI レジスタ
+#define VBE_DISPI_IOPORT_INDEX 0x01CE
+#define VBE_DISPI_IOPORT_DATA 0x01CF
+#define VBE_DISPI_INDEX_ID 0x0
+#define VBE_DISPI_INDEX_XRES 0x1
+#define VBE_DISPI_INDEX_YRES 0x2
+#define VBE_DISPI_INDEX_BPP 0x3
+#define VBE_DISPI_INDEX_ENABLE 0x4
+#define VBE_DISPI_INDEX_VIRT_WIDTH 0x6
+#define VBE_DISPI_INDEX_X_OFFSET 0x8
+#define VBE_DISPI_INDEX_Y_OFFSET 0x9
+#define VBE_DISPI_ID0 0xB0C0  // 版（0xB0C0〜0xB0C5）
+#define VBE_DISPI_ID_MASK 0xFFF0
+#define VBE_DISPI_ID2 0xB0C2  // 32bpp とリニアフレームバッファに対応した版
+#define VBE_DISPI_DISABLED 0x00
+#define VBE_DISPI_ENABLED 0x01
+#define VBE_DISPI_LFB_ENABLED 0x40
+
+// PCI 構成空間（Configuration Mechanism #1）
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define PCI_CONFIG_ENABLE 0x80000000
+#define PCI_DEVICES_PER_BUS 32
+#define PCI_REG_ID 0x00    // ベンダーID（下位16bit）・デバイスID（上位16bit）
+#define PCI_REG_BAR0 0x10
+#define PCI_BAR_IO 0x01            // bit0 が立っていれば I/O 空間
+#define PCI_BAR_MEM_MASK 0xFFFFFFF0
+#define VBE_PCI_VENDOR 0x1234  // QEMU/Bochs の標準 VGA
+#define VBE_PCI_DEVICE 0x1111
+
+// モード
+#define VBE_WIDTH 1024
+#define VBE_HEIGHT 768
+#define VBE_BPP 32
+
+// 文字（VGA のフォント）
+#define VBE_GLYPH_WIDTH 8
+#define VBE_GLYPH_HEIGHT VGA_FONT_HEIGHT
+#define VBE_TEXT_COLS (VBE_WIDTH / VBE_GLYPH_WIDTH)    // 128 文字
+#define VBE_TEXT_ROWS (VBE_HEIGHT / VBE_GLYPH_HEIGHT)  // 48 行
+#define VBE_GLYPH_CACHE_SIZE 128  // 展開済みの文字（1つ 8x16x4 = 512 バイト。2の累乗）
+
+// ベンチマーク
+#define VBE_BENCH_FILLS 32         // 全画面の塗りつぶし・転送の回数
+#define VBE_BENCH_TEXT_SCREENS 8   // 全画面（128x48 文字）の文字描画の回数
+#define VBE_TILE_SIZE 128          // 転送元（RAM 上の 128x128 のタイル）
+
+/*
+ * 描画カーネル
+ */
+typedef enum {
+    VBE_BLIT_REP = 0,  // rep stosd / rep movsd
+    VBE_BLIT_SSE = 1,  // movups + movntps（16バイト境界から。端は rep）
+} vbe_blit_kernel_t;
+
+/*
+ * 文字描画の統計
+ */
+typedef struct {
+    uint32_t glyphs_drawn;
+    uint32_t cache_hits;
+    uint32_t cache_misses;  // ビットマップから展開した回数
+} vbe_stats_t;
+
+// 検出（起動時。モードは変えない）
+os_result_t vbe_init(void);
+bool vbe_is_available(void);
+
+// グラフィックスモードへの切り替えと復帰（テキストモードの画面は止まる）
+os_result_t vbe_enter(void);
+void vbe_leave(void);
+
+// 描画（座標はピクセル。画面外にはみ出す分は切り詰める）
+void vbe_set_blit_kernel(vbe_blit_kernel_t kernel);
+void vbe_fill_rect(int x, int y, int width, int height, uint32_t color);
+void vbe_blit(int x, int y, const uint32_t* src, uint32_t src_pitch, int width,
+              int height);
+void vbe_draw_text(int column, int row, const char* text, uint32_t fg,
+                   uint32_t bg);
+
+// ベンチマーク（benchmark.c の一覧から呼ばれる）
+void vbe_benchmark_fill(void);
+void vbe_benchmark_text(void);
+
+// 統計
+void vbe_get_stats(vbe_stats_t* out);
+void vbe_print_info(void);
+
+#endif  // VBE_H
@@ -0,0 +1,136 @@
+#ifndef VGA_H
+#define VGA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "error_types.h"
+#include "kernel.h"
+
+/**
+ * VGA テキスト画面のコンポジタ（ダブルバッファ）
+ * 【目的】print_at() などの画面出力を RAM 上の裏バッファに書き、変わったセルだけを
+ * 一定周期で VGA メモリ（0xB8000、キャッシュされない MMIO）へ転送する。
+ * 同じ内容の書き直し（カウンター行の25セルのうち数字以外など）は MMIO に届かない
+ * 【構造】
+ * - 裏バッファは VGA テキストメモリ全体（32KB = 204 行）の写しで、行ごとの
+ *   変更ビットマップ（1セル1ビット）を持つ。裏バッファの行 n は常に
+ *   テキストメモリの行 n に転送される
+ * - 変更のある行の集合（1行1ビット）で、変更のない行は見ずに飛ばす
+ * - 転送はコンポジタ（周期タスク）1か所だけが行う。書き込みは vga_lock の中で
+ *   まとめて行うため、文字列の途中の状態が画面に出ることはない
+ * 【スクロール】画面の行0 をテキストメモリのどの行に置くか（origin）を1行進め、
+ * CRTC のスタートアドレス（0x0C/0x0D）を書き換える。1回のスクロールは
+ * 新しい最下行の消去とレジスタ書き込みだけで、画面全体をコピーしない。
+ * origin より上の行はそのまま残り、スクロールバック（Shift+PageUp/PageDown）で
+ * スタートアドレスを戻して見られる。テキストメモリの末尾に達したら、直前の
+ * VGA_SCROLLBACK_KEEP_ROWS 行と画面を先頭へ移す（約130回のスクロールに1回）
+ * 【仮想コンソール】VGA_CONSOLES 個のコンソールがそれぞれ RAM 上に同じ大きさの
+ * 内容・カーソル・スクロールバックを持ち、スレッドは自分のコンソール
+ * （thread_t の console）に書く。VGA メモリに転送されるのは表示中の
+ * コンソールだけで、裏のコンソールへの出力は RAM に書くだけ。
+ * Alt+F1〜F4 で切り替えると、前のコンソールと違うセルだけを転送する
+ * 【カーソル】vga_move_cursor()・文字出力は cx/cy を変えるだけで、CRTC の
+ * カーソル（0x0E/0x0F）は転送時に1回、変わったバイトだけ書く
+ * 【備考】コンポジタの開始前（起動直後）は、書き込みのたびにその場で転送する
+ * （画面出力の API は kernel.h）
+ */
+
+#define VGA_REFRESH_HZ 30  // 画面の更新頻度
+#define VGA_REFRESH_PERIOD_NS (1000000000ULL / VGA_REFRESH_HZ)
+#define VGA_DIRTY_WORDS 3  // 1行分の変更ビットマップ（80セル → 32bit × 3）
+
+// テキストメモリ（0xB8000〜0xBFFFF）
+#define VGA_TEXT_MEMORY_SIZE 0x8000
+#define VGA_TEXT_ROWS (VGA_TEXT_MEMORY_SIZE / (VGA_WIDTH * 2))  // 204 行
+#define VGA_DIRTY_ROW_WORDS ((VGA_TEXT_ROWS + 31) / 32)  // 変更のある行の集合
+#define VGA_SCROLLBACK_KEEP_ROWS 50  // 先頭へ移す時に残す履歴の行数
+#define VGA_SCROLLBACK_STEP 12       // Shift+PageUp/PageDown で動かす行数
+
+// 仮想コンソール（Alt+F1〜F4）
+#define VGA_CONSOLES 4
+#define VGA_CONSOLE_MAIN 0      // システム情報とスレッド A/B（起動時の表示）
+#define VGA_CONSOLE_KEYBOARD 1  // スレッド C（キーボード入力のデモ）
+#define VGA_CONSOLE_LOG 2       // debug_print のログ
+                                // 3 は空き
+
+// ベンチマーク（最下行に VGA_BENCH_LINES 行 × 64 文字）
+#define VGA_BENCH_LINES 200
+#define VGA_BENCH_LINE_CHARS 64
+
+// CRTC（0x3D4 で番号を選び 0x3D5 で読み書きする）
+#define VGA_CRTC_INDEX 0x3D4
+#define VGA_CRTC_DATA 0x3D5
+#define VGA_CRTC_START_HIGH 0x0C   // 表示開始アドレス（セル単位）
+#define VGA_CRTC_START_LOW 0x0D
+#define VGA_CRTC_CURSOR_HIGH 0x0E  // カーソル位置（セル単位・テキストメモリ先頭から）
+#define VGA_CRTC_CURSOR_LOW 0x0F
+#define VGA_CRTC_VSYNC_END 0x11    // bit7 で 0x00〜0x07 を書き込み禁止
+#define VGA_CRTC_PROTECT 0x80
+#define VGA_CRTC_REGS 0x19
+
+// シーケンサ・グラフィックスコントローラ（フォントの読み書き用）
+#define VGA_SEQ_INDEX 0x3C4
+#define VGA_SEQ_DATA 0x3C5
+#define VGA_SEQ_REGS 5
+#define VGA_SEQ_MAP_MASK 0x02  // 書き込むプレーン
+#define VGA_SEQ_MEMORY_MODE 0x04
+#define VGA_GC_INDEX 0x3CE
+#define VGA_GC_DATA 0x3CF
+#define VGA_GC_REGS 9
+#define VGA_GC_READ_MAP 0x04  // 読み出すプレーン
+#define VGA_GC_MODE 0x05
+#define VGA_GC_MISC 0x06
+
+// フォント（プレーン2。1文字 32 バイトの枠の先頭 16 行）
+#define VGA_FONT_PLANE_WINDOW 0xA0000
+#define VGA_FONT_GLYPHS 256
+#define VGA_FONT_HEIGHT 16
+#define VGA_FONT_STRIDE 32
+
+/*
+ * 画面出力の統計
+ */
+typedef struct {
+    uint32_t cells_written;     // 裏バッファへの書き込み要求（セル数）
+    uint32_t cells_changed;     // そのうち内容が変わったセル
+    uint32_t cells_flushed;     // VGA メモリへ転送したセル
+    uint32_t flushes;           // 転送の回数（変更のなかった回を除く）
+    uint32_t flush_max_cycles;  // 1回の転送にかかった最大サイクル数
+    uint32_t scrolls;           // スクロールした行数
+    uint32_t rebases;           // テキストメモリの先頭へ移した回数
+    uint32_t cursor_port_writes;  // カーソル位置のポート書き込み（outb の回数）
+    uint32_t switches;          // コンソールを切り替えた回数
+    uint32_t background_cells;  // 裏のコンソールで変わったセル（転送されない）
+} vga_stats_t;
+
+// 変更のあったセルを VGA メモリへ転送する（コンポジタから。他の転送中なら何もしない）
+void vga_flush(void);
+
+// コンポジタ（VGA_REFRESH_HZ の周期タスク）の開始（スレッド作成時）
+os_result_t vga_compositor_start(void);
+
+// 仮想コンソール（切り替え・スレッドの出力先・debug_print のログ）
+os_result_t vga_console_switch(uint32_t console);
+os_result_t vga_console_bind(thread_t* thread, uint32_t console);
+uint32_t vga_console_active(void);
+void vga_console_log(const char* line);
+
+// スクロールバック（表示中のコンソール。rows > 0 で過去へ、< 0 で最新へ。残っている履歴の範囲に収める）
+void vga_scroll_view(int rows);
+void vga_scroll_view_reset(void);
+
+// 文字出力のベンチマーク（benchmark.c の一覧から呼ばれる）
+void vga_benchmark_puts(void);
+
+// テキストモードの一時停止（グラフィックスモードの間。vbe.c から）
+// suspend はレジスタを保存してフォントを写し、転送を止める。resume で元に戻し、
+// 表示中のコンソールを全て描き直す
+void vga_text_suspend(uint8_t font[VGA_FONT_GLYPHS][VGA_FONT_HEIGHT]);
+void vga_text_resume(void);
+
+// 統計
+void vga_get_stats(vga_stats_t* out);
+void vga_print_stats(void);
+
+#endif  // VGA_H
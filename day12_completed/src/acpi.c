@@ -0,0 +1,231 @@
+#include "acpi.h"
+
+/*
+ * プラットフォーム検出
+ * 【前提】ページングなし・フラットセグメントのため、ファームウェアテーブルの
+ * 物理アドレスをそのままポインタとして読める
+ */
+
+static platform_info_t platform;
+
+static inline uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/*
+ * 物理アドレスをポインタへ変換
+ * 【備考】BDA のような 4KB 未満の定数アドレスを直接参照すると、
+ * GCC が NULL 近傍へのアクセスとして警告するため値を不透明にする
+ */
+static inline const uint8_t* phys_to_ptr(uint32_t addr) {
+    asm("" : "+r"(addr));
+    return (const uint8_t*)addr;
+}
+
+static bool signature_matches(const uint8_t* p, const char* sig, int len) {
+    for (int i = 0; i < len; i++) {
+        if (p[i] != (uint8_t)sig[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * バイト列の合計が0（mod 256）かを確認
+ */
+static bool checksum_ok(const uint8_t* p, uint32_t len) {
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        sum += p[i];
+    }
+    return sum == 0;
+}
+
+/*
+ * 16バイト境界ごとにシグネチャを探す
+ * 【戻り値】見つからなければNULL
+ */
+static const uint8_t* scan_for_signature(uint32_t start, uint32_t end,
+                                         const char* sig, int sig_len,
+                                         uint32_t checksum_len) {
+    for (uint32_t addr = start; addr + checksum_len <= end;
+         addr += FIRMWARE_TABLE_ALIGN) {
+        const uint8_t* p = (const uint8_t*)addr;
+        if (signature_matches(p, sig, sig_len) && checksum_ok(p, checksum_len)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * EBDA先頭1KB → BIOS ROM（0xE0000-0xFFFFF）の順に探す
+ */
+static const uint8_t* find_firmware_pointer(const char* sig, int sig_len,
+                                            uint32_t checksum_len) {
+    uint32_t ebda = (uint32_t)read_u16(phys_to_ptr(BDA_EBDA_SEGMENT_ADDR)) << 4;
+    const uint8_t* p = NULL;
+    if (ebda) {
+        p = scan_for_signature(ebda, ebda + EBDA_SEARCH_SIZE, sig, sig_len,
+                               checksum_len);
+    }
+    if (!p) {
+        p = scan_for_signature(BIOS_ROM_START, BIOS_ROM_END, sig, sig_len,
+                               checksum_len);
+    }
+    return p;
+}
+
+static void platform_add_cpu(uint8_t lapic_id) {
+    if (platform.cpu_count < MAX_CPUS) {
+        platform.lapic_ids[platform.cpu_count++] = lapic_id;
+    }
+}
+
+/*
+ * MADT のエントリを解析
+ */
+static void parse_madt(const uint8_t* madt) {
+    uint32_t length = read_u32(madt + 4);
+    platform.lapic_base = read_u32(madt + ACPI_HEADER_SIZE);
+
+    const uint8_t* entry = madt + ACPI_MADT_ENTRIES_OFFSET;
+    const uint8_t* end = madt + length;
+    while (entry + 2 <= end && entry[1] >= 2) {
+        switch (entry[0]) {
+        case ACPI_MADT_LAPIC:
+            if (read_u32(entry + 4) & ACPI_MADT_LAPIC_ENABLED) {
+                platform_add_cpu(entry[3]);
+            }
+            break;
+        case ACPI_MADT_IOAPIC:
+            if (!platform.has_ioapic) {  // 最初の I/O APIC のみ使う
+                platform.has_ioapic = true;
+                platform.ioapic_id = entry[2];
+                platform.ioapic_base = read_u32(entry + 4);
+                platform.ioapic_gsi_base = read_u32(entry + 8);
+            }
+            break;
+        case ACPI_MADT_ISO:
+            if (entry[3] < ISA_IRQ_COUNT) {
+                platform.irq_to_gsi[entry[3]] = read_u32(entry + 4);
+                platform.irq_flags[entry[3]] = read_u16(entry + 8);
+            }
+            break;
+        }
+        entry += entry[1];
+    }
+}
+
+/*
+ * RSDP → RSDT → MADT（"APIC"）
+ */
+static bool detect_from_acpi(void) {
+    const uint8_t* rsdp =
+        find_firmware_pointer("RSD PTR ", 8, ACPI_RSDP_CHECKSUM_LEN);
+    if (!rsdp) {
+        return false;
+    }
+
+    const uint8_t* rsdt = (const uint8_t*)read_u32(rsdp + 16);
+    if (!signature_matches(rsdt, "RSDT", 4) ||
+        !checksum_ok(rsdt, read_u32(rsdt + 4))) {
+        return false;
+    }
+
+    uint32_t entries = (read_u32(rsdt + 4) - ACPI_HEADER_SIZE) / 4;
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t* table =
+            (const uint8_t*)read_u32(rsdt + ACPI_HEADER_SIZE + i * 4);
+        if (signature_matches(table, "APIC", 4) &&
+            checksum_ok(table, read_u32(table + 4))) {
+            parse_madt(table);
+            platform.source = "ACPI MADT";
+            return platform.cpu_count > 0;
+        }
+    }
+    return false;
+}
+
+/*
+ * "_MP_" フローティングポインタ → "PCMP" 設定テーブル
+ * 【備考】割り込み割り当てエントリは読まず、ISA IRQ は恒等写像とみなす
+ */
+static bool detect_from_mp_table(void) {
+    const uint8_t* mpfp = find_firmware_pointer("_MP_", 4, 16);
+    if (!mpfp || read_u32(mpfp + 4) == 0) {
+        return false;  // 既定構成（テーブルなし）は扱わない
+    }
+
+    const uint8_t* config = (const uint8_t*)read_u32(mpfp + 4);
+    uint16_t base_length = read_u16(config + 4);
+    if (!signature_matches(config, "PCMP", 4) ||
+        !checksum_ok(config, base_length)) {
+        return false;
+    }
+
+    platform.lapic_base = read_u32(config + 36);
+    uint16_t count = read_u16(config + 34);
+    const uint8_t* entry = config + MP_CONFIG_ENTRIES_OFFSET;
+    for (uint16_t i = 0; i < count; i++) {
+        if (entry[0] == MP_ENTRY_PROCESSOR) {
+            if (entry[3] & MP_PROCESSOR_ENABLED) {
+                platform_add_cpu(entry[1]);
+            }
+            entry += MP_PROCESSOR_ENTRY_SIZE;
+            continue;
+        }
+        if (entry[0] == MP_ENTRY_IOAPIC && !platform.has_ioapic &&
+            (entry[3] & MP_IOAPIC_ENABLED)) {
+            platform.has_ioapic = true;
+            platform.ioapic_id = entry[1];
+            platform.ioapic_base = read_u32(entry + 4);
+            platform.ioapic_gsi_base = 0;
+        }
+        entry += MP_OTHER_ENTRY_SIZE;
+    }
+    platform.source = "MP table";
+    return platform.cpu_count > 0;
+}
+
+/*
+ * プラットフォーム検出
+ * 【戻り値】どちらのテーブルも見つからなければ OS_ERROR_NOT_FOUND
+ * （その場合は単一CPU + PIC 構成として動作を続ける）
+ */
+os_result_t acpi_detect_platform(void) {
+    platform.cpu_count = 0;
+    platform.has_ioapic = false;
+    for (uint32_t irq = 0; irq < ISA_IRQ_COUNT; irq++) {
+        platform.irq_to_gsi[irq] = irq;
+        platform.irq_flags[irq] = 0;
+    }
+
+    if (!detect_from_acpi()) {
+        platform.cpu_count = 0;
+        platform.has_ioapic = false;
+        if (!detect_from_mp_table()) {
+            debug_print("ACPI: no MADT or MP table found (uniprocessor)");
+            return OS_ERROR_NOT_FOUND;
+        }
+    }
+
+    debug_print("ACPI: %s: %u CPUs, LAPIC at 0x%x", platform.source,
+                platform.cpu_count, platform.lapic_base);
+    if (platform.has_ioapic) {
+        debug_print("ACPI: I/O APIC id %u at 0x%x (GSI base %u)",
+                    platform.ioapic_id, platform.ioapic_base,
+                    platform.ioapic_gsi_base);
+    }
+    return OS_SUCCESS;
+}
+
+const platform_info_t* acpi_get_platform(void) {
+    return &platform;
+}
@@ -0,0 +1,589 @@
+#include "benchmark.h"
+
+#include "clock.h"
+#include "fpu.h"
+#include "hrtimer.h"
+#include "kernel.h"
+#include "keyboard.h"
+#include "lapic.h"
+#include "serial.h"
+#include "smp.h"
+#include "sync.h"
+#include "vbe.h"
+#include "vga.h"
+
+// コンテキストスイッチ往復ベンチマーク定数
+#define PINGPONG_ITERATIONS 10000  // 往復回数
+#define PINGPONG_STACK_WORDS 256   // 相手側コンテキストのスタック（1KB）
+
+static uint32_t pingpong_stack[PINGPONG_STACK_WORDS];
+static uint32_t pingpong_main_esp;  // 計測側コンテキストのESP
+static uint32_t pingpong_peer_esp;  // 相手側コンテキストのESP
+
+/*
+ * 往復ベンチマークの相手側コンテキスト
+ * 【役割】切り替えられたら即座に計測側へ切り替え返す
+ */
+static void pingpong_peer(void) {
+    while (1) {
+        context_switch(&pingpong_peer_esp, pingpong_main_esp);
+    }
+}
+
+/*
+ * context_switch 往復ベンチマーク（rdtsc ping-pong）
+ * 【役割】スレッド→スレッド→元スレッドの往復にかかるサイクル数を計測
+ * 【備考】スケジューラを介さない純粋なスイッチ経路のコスト。
+ * 相手側スタックは initialize_thread_stack と同じ形式で組み立てる
+ */
+static void benchmark_context_switch_pingpong(void) {
+    uint32_t* sp = &pingpong_stack[PINGPONG_STACK_WORDS];
+    *--sp = (uint32_t)pingpong_peer;  // ret の戻り先
+    *--sp = 0;                        // EBP
+    *--sp = 0;                        // EBX
+    *--sp = 0;                        // ESI
+    *--sp = 0;                        // EDI
+    pingpong_peer_esp = (uint32_t)sp;
+
+    // context_switch は割り込み禁止で呼ぶ前提
+    uint32_t flags = irq_save();
+    context_switch(&pingpong_main_esp, pingpong_peer_esp);  // ウォームアップ
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < PINGPONG_ITERATIONS; i++) {
+        context_switch(&pingpong_main_esp, pingpong_peer_esp);
+    }
+    uint32_t cycles = (uint32_t)(rdtsc() - start);
+    irq_restore(flags);
+
+    debug_print("SWITCH BENCH: round trip %u cycles (%u iterations)",
+                cycles / PINGPONG_ITERATIONS, PINGPONG_ITERATIONS);
+    debug_print("SWITCH BENCH: one-way switch %u cycles",
+                cycles / (PINGPONG_ITERATIONS * 2));
+}
+
+// yield ベンチマーク定数
+#define YIELD_BENCH_ITERATIONS 5000  // 譲渡回数
+
+static thread_t* yield_bench_main;       // 計測側スレッド
+static volatile bool yield_bench_stop;   // 相手側スレッドの終了要求
+
+/*
+ * yield ベンチマークの相手側スレッド
+ * 【役割】実行されたら即座に計測側へ直接ハンドオフし、終了要求で戻る
+ */
+static void yield_bench_peer(void) {
+    while (!yield_bench_stop) {
+        thread_yield_to(yield_bench_main);
+    }
+}
+
+/*
+ * 自発的切り替えベンチマーク
+ * 【役割】thread_yield_to（直接ハンドオフ）と thread_yield（リング上の次へ）の
+ * 1回あたりのサイクル数を比較する
+ * 【備考】thread_yield は他のREADYスレッド（idle等）も経由するため、
+ * 実際のスケジューリング経路を含んだ値になる
+ */
+static void benchmark_thread_yield(void) {
+    thread_t* peer = NULL;
+    yield_bench_main = get_current_thread();
+    yield_bench_stop = false;
+
+    if (OS_FAILURE_CHECK(create_thread(yield_bench_peer, 1, 0, &peer))) {
+        debug_print("YIELD BENCH: skipped (cannot create peer thread)");
+        return;
+    }
+    thread_yield_to(peer);  // ウォームアップ（相手側の初回起動）
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < YIELD_BENCH_ITERATIONS; i++) {
+        thread_yield_to(peer);
+    }
+    uint32_t handoff_cycles = (uint32_t)(rdtsc() - start);
+
+    start = rdtsc();
+    for (int i = 0; i < YIELD_BENCH_ITERATIONS; i++) {
+        thread_yield();
+    }
+    uint32_t yield_cycles = (uint32_t)(rdtsc() - start);
+
+    // 相手側スレッドを終了させる
+    yield_bench_stop = true;
+    while (peer->state != THREAD_TERMINATED) {
+        thread_yield();
+    }
+
+    debug_print("YIELD BENCH: thread_yield_to round trip %u cycles",
+                handoff_cycles / YIELD_BENCH_ITERATIONS);
+    debug_print("YIELD BENCH: thread_yield %u cycles/call",
+                yield_cycles / YIELD_BENCH_ITERATIONS);
+}
+
+// IRQ 入口〜EOI ベンチマーク定数
+#define IRQ_BENCH_VECTOR 0xEE       // 計測専用ベクタ（ソフトウェア割り込み）
+#define IRQ_BENCH_ITERATIONS 10000  // 1経路あたりの割り込み回数
+
+static volatile bool irq_bench_use_lapic;  // true: LAPIC MMIO, false: PIC outb
+static volatile uint64_t irq_bench_eoi_tsc;  // EOI 完了時刻
+
+/*
+ * 計測用割り込みハンドラ（C言語部分）
+ * 【役割】選択された経路で EOI を送り、その完了時刻を記録する
+ * 【備考】割り込み中の IRQ はないため、どちらの EOI も実際には何も解除しない
+ * （PIC は非特定 EOI を、Local APIC は ISR が空の EOI を無視する）
+ */
+void irq_bench_handler_c(void) {
+    if (irq_bench_use_lapic) {
+        lapic_eoi();
+    } else {
+        outb(PIC_MASTER_COMMAND, PIC_EOI);
+    }
+    irq_bench_eoi_tsc = rdtsc();
+}
+
+/*
+ * 1経路分の計測
+ * 【戻り値】int 命令から EOI 完了までの平均サイクル数
+ */
+static uint32_t irq_bench_measure(bool use_lapic) {
+    uint64_t total = 0;
+    irq_bench_use_lapic = use_lapic;
+
+    uint32_t flags = irq_save();
+    for (int i = 0; i < IRQ_BENCH_ITERATIONS; i++) {
+        uint64_t start = rdtsc();
+        asm volatile("int %0" : : "i"(IRQ_BENCH_VECTOR) : "memory");
+        total += irq_bench_eoi_tsc - start;
+    }
+    irq_restore(flags);
+    return (uint32_t)(total / IRQ_BENCH_ITERATIONS);
+}
+
+/*
+ * IRQ 入口〜EOI ベンチマーク
+ * 【役割】IRQ_ENTRY を通る割り込みの入口から EOI 完了までを、
+ * PIC（ポートI/O）と Local APIC（MMIO）の両経路で比較する
+ * 【備考】入口部分は共通なので、差はほぼ EOI のコストそのもの
+ */
+static void benchmark_irq_eoi(void) {
+    set_idt_gate(IRQ_BENCH_VECTOR, (uint32_t)irq_bench_interrupt_handler);
+
+    debug_print("IRQ BENCH: PIC path %u cycles (entry to EOI, port I/O)",
+                irq_bench_measure(false));
+    if (!lapic_is_available()) {
+        debug_print("IRQ BENCH: LAPIC path skipped (no Local APIC)");
+        return;
+    }
+    debug_print("IRQ BENCH: LAPIC path %u cycles (entry to EOI, MMIO)",
+                irq_bench_measure(true));
+    debug_print("IRQ BENCH: active path: %s",
+                apic_interrupts_enabled() ? "LAPIC" : "PIC");
+}
+
+// 負荷スレッドの定数
+#define BENCH_SPIN_MAX 8  // 1回の計測で作る負荷スレッドの上限
+
+static volatile bool bench_spin_stop;        // 負荷スレッドの終了要求
+static volatile uint32_t bench_spin_exited;  // 終了要求を受けて抜けたスレッド数
+
+/*
+ * 負荷スレッド（譲らずに CPU を使い続ける）
+ * 【役割】作業量として自分の thread->counter を増やし続ける。終了要求を見たら
+ * bench_spin_exited を増やして戻る
+ */
+static void bench_spin_worker(void) {
+    volatile uint32_t* work = &get_current_thread()->counter;
+    while (!bench_spin_stop) {
+        (*work)++;
+    }
+    atomic_inc(&bench_spin_exited);
+}
+
+/*
+ * 負荷スレッドの作成
+ * 【役割】count 本まで作成し、作れたものを threads の先頭から詰めて返す
+ * （スレッドは作成したCPU＝計測側と同じCPUで動く）
+ * 【戻り値】作成できた本数
+ */
+static int bench_spin_start(thread_t** threads, int count) {
+    int created = 0;
+    bench_spin_stop = false;
+    bench_spin_exited = 0;
+    for (int i = 0; i < count && i < BENCH_SPIN_MAX; i++) {
+        if (OS_SUCCESS_CHECK(
+                create_thread(bench_spin_worker, 1, 0, &threads[created]))) {
+            created++;
+        }
+    }
+    return created;
+}
+
+/*
+ * 負荷スレッドの停止と合流
+ * 【重要】終了を thread->state ではなく抜けた本数で待つ。終了したスレッドの
+ * 枠は create_thread() が再利用するため、state は別スレッドのものになりうる
+ */
+static void bench_spin_stop_join(int count) {
+    bench_spin_stop = true;
+    while (bench_spin_exited < (uint32_t)count) {
+        sleep(1);
+    }
+}
+
+// EDF ベンチマーク定数
+#define EDF_BENCH_HOGS 3                 // CPU を占有する通常クラスのスレッド数
+#define EDF_BENCH_PERIOD_NS 10000000ULL  // 周期 10ms
+#define EDF_BENCH_RUNTIME_NS 2000000ULL  // 宣言する実行時間 2ms
+#define EDF_BENCH_WORK_NS 1000000ULL     // 各周期の実際の処理 1ms
+#define EDF_BENCH_ITERATIONS 50          // 1回の計測の周期数
+
+/*
+ * 周期処理を1回分計測する
+ * 【役割】周期境界で起床して EDF_BENCH_WORK_NS だけ CPU を使い、
+ * 次の周期境界までに終わらなかった回数を数える
+ */
+static uint32_t edf_bench_run_periods(void) {
+    uint32_t misses = 0;
+    uint64_t release = clock_get_time_ns();
+
+    for (int i = 0; i < EDF_BENCH_ITERATIONS; i++) {
+        release += EDF_BENCH_PERIOD_NS;
+        sleep_until(release);
+        uint64_t work_end = clock_get_time_ns() + EDF_BENCH_WORK_NS;
+        while (clock_get_time_ns() < work_end) {
+            asm volatile("pause");
+        }
+        if (clock_get_time_ns() > release + EDF_BENCH_PERIOD_NS) {
+            misses++;
+        }
+    }
+    return misses;
+}
+
+/*
+ * EDF ベンチマーク
+ * 【役割】同じCPUで負荷スレッドが動く中、同じ周期処理を通常クラスと
+ * EDF クラスで実行し、デッドライン超過の回数を比較する
+ * 【備考】負荷スレッドは作成したCPU（このスレッドと同じCPU）で動く
+ */
+static void benchmark_edf(void) {
+    thread_t* self = get_current_thread();
+    thread_t* hogs[EDF_BENCH_HOGS];
+    int hog_count = bench_spin_start(hogs, EDF_BENCH_HOGS);
+
+    uint32_t normal_misses = edf_bench_run_periods();
+    uint32_t edf_misses = 0;
+    bool admitted = OS_SUCCESS_CHECK(
+        thread_set_edf(self, EDF_BENCH_RUNTIME_NS, EDF_BENCH_PERIOD_NS));
+    if (admitted) {
+        edf_misses = edf_bench_run_periods();
+        thread_set_edf(self, 0, 0);
+    }
+
+    bench_spin_stop_join(hog_count);
+
+    debug_print("EDF BENCH: %u hogs, %u periods of %u us work every %u us",
+                hog_count, EDF_BENCH_ITERATIONS,
+                (uint32_t)(EDF_BENCH_WORK_NS / NSEC_PER_USEC),
+                (uint32_t)(EDF_BENCH_PERIOD_NS / NSEC_PER_USEC));
+    debug_print("EDF BENCH: normal class %u deadline misses", normal_misses);
+    if (admitted) {
+        debug_print("EDF BENCH: EDF class %u deadline misses", edf_misses);
+    } else {
+        debug_print("EDF BENCH: EDF class skipped (admission rejected)");
+    }
+}
+
+// 公平スケジューリングベンチマーク定数
+#define FAIR_BENCH_WORKERS 3                  // CPU を使い続ける公平クラスのスレッド数
+#define FAIR_BENCH_DURATION_NS 1000000000ULL  // 計測時間 1秒
+
+static const uint32_t fair_bench_weights[FAIR_BENCH_WORKERS] = {
+    FAIR_WEIGHT_DEFAULT, FAIR_WEIGHT_DEFAULT, FAIR_WEIGHT_DEFAULT * 2};
+
+/*
+ * 公平スケジューリングベンチマーク
+ * 【役割】重みの違う公平クラスのスレッドを同じCPUで1秒間競わせ、
+ * 実際に得た CPU 時間の割合を重みから期待される割合と並べて表示する
+ * 【備考】計測側は通常クラスで眠っているため、この間は公平クラスだけが動く
+ */
+static void benchmark_fair_share(void) {
+    thread_t* workers[FAIR_BENCH_WORKERS];
+    uint32_t weights[FAIR_BENCH_WORKERS];
+    uint64_t exec[FAIR_BENCH_WORKERS];
+    uint32_t total_weight = 0;
+
+    int count = bench_spin_start(workers, FAIR_BENCH_WORKERS);
+    for (int i = 0; i < count; i++) {
+        thread_set_fair(workers[i], fair_bench_weights[i]);
+        weights[i] = fair_bench_weights[i];
+        exec[i] = workers[i]->fair.sum_exec_tsc;
+        total_weight += weights[i];
+    }
+
+    sleep_ns(FAIR_BENCH_DURATION_NS);
+
+    // 計測側が動いている間は全 worker が切り替え済み（実行時間は計上済み）
+    uint64_t total_exec = 0;
+    for (int i = 0; i < count; i++) {
+        exec[i] = workers[i]->fair.sum_exec_tsc - exec[i];
+        total_exec += exec[i];
+    }
+
+    bench_spin_stop_join(count);
+
+    if (total_exec == 0) {
+        debug_print("FAIR BENCH: skipped (workers did not run)");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        debug_print("FAIR BENCH: weight %u got %u.%u%% (expected %u.%u%%)",
+                    weights[i], (uint32_t)(exec[i] * 1000 / total_exec) / 10,
+                    (uint32_t)(exec[i] * 1000 / total_exec) % 10,
+                    weights[i] * 1000 / total_weight / 10,
+                    weights[i] * 1000 / total_weight % 10);
+    }
+}
+
+// MLFQ 応答性ベンチマーク定数
+#define MLFQ_BENCH_HOGS 8                        // CPU を使い続けるスレッド数
+#define MLFQ_BENCH_KEYS 20                       // 1フェーズで模擬するキー入力数
+#define MLFQ_BENCH_KEY_INTERVAL_NS 100000000ULL  // キー入力の間隔 100ms
+#define MLFQ_BENCH_KEY '.'                       // スレッドC がそのまま表示する文字
+
+static volatile uint32_t mlfq_bench_keys;  // 模擬したキー数
+static hrtimer_t mlfq_bench_key_timer;
+
+/*
+ * キー入力の模擬（hrtimer コールバック）
+ * 【役割】キーボード割り込みと同じ経路でバッファに入れ、入力待ちを起こす。
+ * 割り込み内から起床させるため、実際のキー入力と同じ遅延が測れる
+ */
+static void mlfq_bench_key_expired(hrtimer_t* timer) {
+    keyboard_deliver_char(MLFQ_BENCH_KEY);
+    if (++mlfq_bench_keys < MLFQ_BENCH_KEYS) {
+        hrtimer_start_abs(timer,
+                          timer->expires_ns + MLFQ_BENCH_KEY_INTERVAL_NS);
+    }
+}
+
+/*
+ * 1フェーズ分のキー入力を模擬し、スレッドC のエコー遅延を取得する
+ */
+static void mlfq_bench_run_keys(keyboard_latency_t* out) {
+    keyboard_latency_reset();
+    mlfq_bench_keys = 0;
+    hrtimer_start(&mlfq_bench_key_timer, MLFQ_BENCH_KEY_INTERVAL_NS);
+    sleep_ns((MLFQ_BENCH_KEYS + 1) * MLFQ_BENCH_KEY_INTERVAL_NS);
+    hrtimer_cancel(&mlfq_bench_key_timer);
+    keyboard_get_latency(out);
+}
+
+static void mlfq_bench_print(const char* label,
+                             const keyboard_latency_t* latency) {
+    if (latency->count == 0) {
+        debug_print("MLFQ BENCH: %s no echoes (thread C not waiting?)", label);
+        return;
+    }
+    debug_print("MLFQ BENCH: %s echo latency avg %u us, max %u us (%u keys)",
+                label,
+                (uint32_t)(latency->total_ns / latency->count / NSEC_PER_USEC),
+                (uint32_t)(latency->max_ns / NSEC_PER_USEC), latency->count);
+}
+
+/*
+ * MLFQ 応答性ベンチマーク
+ * 【役割】CPU を使い続けるスレッドが8本動く中でキー入力を模擬し、
+ * 入力からスレッドC（MLFQ クラス）の表示までの遅延を比べる。
+ * 1回目は負荷スレッドを最上段と同じ優先度の通常クラスで（ラウンドロビンの
+ * 順番待ちになる）、2回目は負荷スレッドも MLFQ クラスで動かす
+ * （持ち時間を使い切って下の段に沈み、スレッドC が先に動く）
+ * 【前提】スレッドC と同じCPU（BSP）で実行すること。
+ * 計測中は計測側が負荷スレッドに埋もれないよう最高優先度にする
+ */
+static void benchmark_mlfq_latency(void) {
+    thread_t* self = get_current_thread();
+    uint8_t saved_priority = self->base_priority;
+    thread_t* hogs[MLFQ_BENCH_HOGS];
+
+    hrtimer_init(&mlfq_bench_key_timer, mlfq_bench_key_expired, NULL);
+    thread_set_priority(self, THREAD_PRIORITY_MAX);
+    int hog_count = bench_spin_start(hogs, MLFQ_BENCH_HOGS);
+    for (int i = 0; i < hog_count; i++) {
+        thread_set_priority(hogs[i], MLFQ_TOP_PRIORITY);
+    }
+
+    keyboard_latency_t normal;
+    mlfq_bench_run_keys(&normal);
+
+    for (int i = 0; i < hog_count; i++) {
+        thread_set_mlfq(hogs[i], true);
+    }
+    keyboard_latency_t mlfq;
+    mlfq_bench_run_keys(&mlfq);
+
+    bench_spin_stop_join(hog_count);
+    thread_set_priority(self, saved_priority);
+
+    debug_print("MLFQ BENCH: %u hogs, %u keys every %u ms", hog_count,
+                MLFQ_BENCH_KEYS,
+                (uint32_t)(MLFQ_BENCH_KEY_INTERVAL_NS / NSEC_PER_MSEC));
+    mlfq_bench_print("normal-class hogs:", &normal);
+    mlfq_bench_print("MLFQ hogs:", &mlfq);
+}
+
+// クォンタムベンチマーク定数
+#define QUANTUM_BENCH_WORKERS 3                   // CPU を使い続けるスレッド数
+#define QUANTUM_BENCH_DURATION_NS 1000000000ULL  // 設定ごとの計測時間 1秒
+
+typedef struct {
+    uint32_t tick_us;     // スケジューラティックの周期
+    uint32_t quantum_us;  // 全クラスのクォンタム
+} quantum_bench_setting_t;
+
+static const quantum_bench_setting_t quantum_bench_settings[] = {
+    {10000, 10000},  // 既定（100Hz ティック、10ms クォンタム）
+    {1000, 1000},    // 1kHz ティック、1ms クォンタム
+    {1000, 20000},   // 1kHz ティック、20ms クォンタム
+};
+
+#define QUANTUM_BENCH_SETTINGS \
+    (sizeof(quantum_bench_settings) / sizeof(quantum_bench_settings[0]))
+
+static uint32_t quantum_bench_total_work(thread_t** workers, int count) {
+    uint32_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += ((volatile thread_t*)workers[i])->counter;
+    }
+    return total;
+}
+
+static void quantum_bench_set_quantum(uint32_t quantum_us) {
+    for (uint8_t cls = 0; cls < SCHED_CLASS_COUNT; cls++) {
+        sched_set_quantum_us(cls, quantum_us);
+    }
+}
+
+/*
+ * クォンタムベンチマーク
+ * 【役割】同じCPUで CPU を使い続けるスレッドを競わせ、ティック周期と
+ * クォンタムの組み合わせごとに1秒あたりのスレッド切り替え回数と
+ * 作業量（全スレッドのカウンタの合計）を表示する
+ * 【備考】計測側は最高優先度で眠り、起床時はクォンタムを待たずに割り込む。
+ * PIT のみの構成ではティック周期の設定は効かない
+ */
+static void benchmark_quantum(void) {
+    kernel_context_t* ctx = get_kernel_context();
+    thread_t* self = get_current_thread();
+    uint8_t saved_priority = self->base_priority;
+    uint32_t saved_tick_us = lapic_timer_get_tick_us();
+    uint32_t saved_quantum_us[SCHED_CLASS_COUNT];
+    thread_t* workers[QUANTUM_BENCH_WORKERS];
+
+    for (uint8_t cls = 0; cls < SCHED_CLASS_COUNT; cls++) {
+        saved_quantum_us[cls] = sched_get_quantum_us(cls);
+    }
+    thread_set_priority(self, THREAD_PRIORITY_MAX);
+
+    int count = bench_spin_start(workers, QUANTUM_BENCH_WORKERS);
+
+    for (uint32_t i = 0; i < QUANTUM_BENCH_SETTINGS; i++) {
+        const quantum_bench_setting_t* setting = &quantum_bench_settings[i];
+        lapic_timer_set_tick_us(setting->tick_us);
+        quantum_bench_set_quantum(setting->quantum_us);
+
+        uint32_t work_start = quantum_bench_total_work(workers, count);
+        uint32_t switches_start = ctx->context_switches;
+        sleep_ns(QUANTUM_BENCH_DURATION_NS);
+        uint32_t switches = ctx->context_switches - switches_start;
+        uint32_t work = quantum_bench_total_work(workers, count) - work_start;
+
+        debug_print("QUANTUM BENCH: tick %u us, quantum %u us: "
+                    "%u switches/s, work %u k/s",
+                    setting->tick_us, setting->quantum_us, switches,
+                    work / 1000);
+    }
+
+    bench_spin_stop_join(count);
+    lapic_timer_set_tick_us(saved_tick_us);
+    for (uint8_t cls = 0; cls < SCHED_CLASS_COUNT; cls++) {
+        sched_set_quantum_us(cls, saved_quantum_us[cls]);
+    }
+    thread_set_priority(self, saved_priority);
+}
+
+/*
+ * ベンチマーク一覧
+ * 【役割】新しい計測を追加する場合はここに1行追加する
+ */
+static const benchmark_entry_t benchmarks[] = {
+    {"fpu_switch", fpu_benchmark_switch_cost},
+    {"context_switch", benchmark_context_switch_pingpong},
+    {"thread_yield", benchmark_thread_yield},
+    {"sync", sync_benchmark},
+    {"priority_inheritance", sync_priority_inheritance_test},
+    {"smp_throughput", smp_benchmark_throughput},
+    {"irq_eoi", benchmark_irq_eoi},
+    {"hrtimer", hrtimer_benchmark},
+    {"edf", benchmark_edf},
+    {"fair_share", benchmark_fair_share},
+    {"mlfq_latency", benchmark_mlfq_latency},
+    {"quantum", benchmark_quantum},
+    {"serial_throughput", serial_benchmark_throughput},
+    {"vga_puts", vga_benchmark_puts},
+    {"vbe_fill", vbe_benchmark_fill},
+    {"vbe_text", vbe_benchmark_text},
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/*
+ * 全ベンチマーク実行関数
+ * 【役割】登録された計測を順番に実行し、結果をシリアルに出力する
+ */
+void benchmark_run_all(void) {
+    debug_print("=== BENCHMARK: start (%u entries) ===", BENCHMARK_COUNT);
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        debug_print("--- BENCHMARK: %s ---", benchmarks[i].name);
+        benchmarks[i].run();
+    }
+    debug_print("=== BENCHMARK: done ===");
+}
+
+/*
+ * 名前を指定したベンチマークの実行（シリアルシェルの "benchmark <名前>"）
+ * 【戻り値】登録されていない名前なら OS_ERROR_INVALID_PARAMETER
+ */
+os_result_t benchmark_run(const char* name) {
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        if (str_equal(benchmarks[i].name, name)) {
+            debug_print("--- BENCHMARK: %s ---", benchmarks[i].name);
+            benchmarks[i].run();
+            debug_print("=== BENCHMARK: done ===");
+            return OS_SUCCESS;
+        }
+    }
+    return OS_ERROR_INVALID_PARAMETER;
+}
+
+/*
+ * 登録済みベンチマーク名の表示
+ */
+void benchmark_print_names(void) {
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        debug_print("  %s", benchmarks[i].name);
+    }
+}
+
+/*
+ * ベンチマークスレッド
+ * 【役割】起動直後に一度だけ全ベンチマークを実行し、以後は眠り続ける
+ */
+void benchmark_thread(void) {
+    benchmark_run_all();
+
+    while (1) {
+        sleep(MAX_COUNTER_VALUE);
+    }
+}
@@ -0,0 +1,89 @@
+; ap_trampoline.s - AP（Application Processor）起動トランポリン
+; 【役割】SIPI を受けた AP はリアルモードで AP_TRAMPOLINE_ADDR から実行を始める。
+; ここでプロテクトモードへ移行し、smp.c が書き込んだスタックで ap_main(cpu) を呼ぶ
+; 【重要】このコードは smp_copy_trampoline() で AP_TRAMPOLINE_ADDR にコピーされて
+; 実行されるため、ラベルは全て「コピー先アドレス + 先頭からのオフセット」で参照する
+
+%include "boot_constants.inc"
+%include "cpu_setup.inc"
+
+%define TRAMPOLINE_ADDR(label) (AP_TRAMPOLINE_ADDR + (label) - ap_trampoline_start)
+
+	section .text
+
+	global ap_trampoline_start
+	global ap_trampoline_end
+	global ap_trampoline_stack
+	global ap_trampoline_cpu
+	global ap_trampoline_entry
+
+	[bits 16]
+
+ap_trampoline_start:
+	cli
+	cld
+
+	;   CS = AP_TRAMPOLINE_ADDR >> 4 で始まるため、DS を合わせてオフセットで参照する
+	mov ax, cs
+	mov ds, ax
+
+	lgdt [ap_gdt_descriptor - ap_trampoline_start]
+
+	mov eax, cr0
+	or  eax, PROTECTED_MODE_ENABLE
+	mov cr0, eax
+
+	jmp dword CODE_SEGMENT_SELECTOR:TRAMPOLINE_ADDR(ap_protected_mode)
+
+	[bits 32]
+
+ap_protected_mode:
+	mov ax, DATA_SEGMENT_SELECTOR
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+
+	mov esp, [TRAMPOLINE_ADDR(ap_trampoline_stack)]
+	xor ebp, ebp
+
+	;    CR0/CR4 は CPU ごとなので BSP と同じ SSE 設定を行う
+	ENABLE_SSE
+
+	;    ap_main(cpu) を呼ぶ（戻らない）
+	push dword [TRAMPOLINE_ADDR(ap_trampoline_cpu)]
+	call [TRAMPOLINE_ADDR(ap_trampoline_entry)]
+
+.halt:
+	cli
+	hlt
+	jmp .halt
+
+	;    トランポリン専用GDT（フラットなコード/データのみ。ap_main で CPU ごとの GDT に置き換える）
+	align 8
+
+ap_gdt:
+	dd 0x0, 0x0
+	dw 0xffff, 0x0
+	db 0x0, GDT_CODE_ACCESS, GDT_GRANULARITY_4KB, 0x0
+	dw 0xffff, 0x0
+	db 0x0, GDT_DATA_ACCESS, GDT_GRANULARITY_4KB, 0x0
+
+ap_gdt_descriptor:
+	dw ap_gdt_descriptor - ap_gdt - 1
+	dd TRAMPOLINE_ADDR(ap_gdt)
+
+	;    smp.c が AP ごとに書き込む変数
+	align 4
+
+ap_trampoline_stack:
+	dd 0; ap_main 用スタックの先頭
+
+ap_trampoline_cpu:
+	dd 0; 論理CPU番号
+
+ap_trampoline_entry:
+	dd 0; ap_main のアドレス
+
+ap_trampoline_end:
@@ -20,19 +20,40 @@ _start16:
 	mov  si, boot_msg
 	call print_string
 
-	;   カーネルをディスクから読み込み（1MB位置）
-	mov ah, BIOS_READ_FUNCTION; BIOS読み取り機能
-	mov al, KERNEL_SECTORS; 読み取るセクタ数
-	mov ch, BOOT_CYLINDER; シリンダ0
-	mov cl, BOOT_START_SECTOR; セクタ2から（セクタ1はブートセクタ）
-	mov dh, BOOT_HEAD; ヘッド0
+	;   カーネルをディスクから読み込み（一時的に0x10000へ）
+	;   【方針】1セクタずつ LBA→CHS 変換して読む。1回の int 13h が
+	;   トラック境界や64KB境界をまたがないため、カーネルサイズに制限されない
+	mov ax, KERNEL_TEMP_LOAD >> 4; 読み込み先（セグメント形式）
+	mov es, ax
+	mov si, BOOT_START_SECTOR - 1; LBA 1から（LBA 0はブートセクタ）
+	mov di, KERNEL_SECTORS; 残りセクタ数
+
+.read_sector:
+	mov ax, si
+	xor dx, dx
+	mov bx, FLOPPY_SECTORS_PER_TRACK
+	div bx; AX = トラック番号, DX = トラック内セクタ（0始まり）
+	mov cl, dl
+	inc cl; セクタ番号は1始まり
+	xor dx, dx
+	mov bx, FLOPPY_HEADS
+	div bx; AX = シリンダ, DX = ヘッド
+	mov ch, al
+	mov dh, dl
 	mov dl, BOOT_DRIVE; ドライブA（フロッピー）
-	mov bx, KERNEL_TEMP_LOAD >> 4; 一時的に0x10000に読み込み（セグメント形式）
-	mov es, bx
-	mov bx, 0
+	xor bx, bx
+	mov ah, BIOS_READ_FUNCTION; BIOS読み取り機能
+	mov al, 1; 1セクタ
 	int BIOS_DISK_INT; ディスク読み取り
 	jc  disk_error
 
+	mov ax, es
+	add ax, SECTOR_SIZE >> 4; 次の512バイトへ
+	mov es, ax
+	inc si
+	dec di
+	jnz .read_sector
+
 	;    A20ライン有効化
 	call enable_a20
 
@@ -112,7 +133,7 @@ start32:
 	;   カーネルを0x10000から0x100000に移動
 	mov esi, KERNEL_TEMP_LOAD; ソースアドレス
 	mov edi, KERNEL_FINAL_ADDRESS; デスティネーション（1MB）
-	mov ecx, KERNEL_COPY_SIZE; 32KB分コピー（DWORD単位）
+	mov ecx, KERNEL_COPY_SIZE; 読み込んだ全セクタ分コピー（DWORD単位）
 	cld
 	rep movsd
 
@@ -1,159 +1,220 @@
 ; interrupt.s - 割り込みハンドラのアセンブリ部分
 
+%include "boot_constants.inc"
+
 	section .text
 
 ;      外部関数の宣言
-	extern timer_handler_c
-	extern keyboard_handler_c
-
-;      タイマー割り込みハンドラ（アセンブリ部分）
-;      【重要】この関数は割り込みが発生すると自動的に呼ばれる
-	global timer_interrupt_handler
-
-timer_interrupt_handler:
-	; === 割り込み処理の開始 ===
-	; CPUは割り込み発生時に以下を自動で行う：
-	; 1. 現在のEFLAGS、CS、EIPをスタックにプッシュ
-	; 2. 割り込みを無効化（CLI相当）
-	; 3. IDTから該当エントリのアドレスにジャンプ
-
-	;     全汎用レジスタをスタックに保存
-	;     【なぜ必要？】コンテキストスイッチでは、現在実行中のスレッドの
-	;     全レジスタ状態を保存して、後で完全に復元する必要がある
-	pusha ; EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI を保存
-
-	;    セグメントレジスタも保存
+	extern interrupt_dispatch_c
+	extern device_not_available_handler_c
+	extern reschedule_ipi_handler_c
+	extern lapic_timer_handler_c
+	extern irq_bench_handler_c
+	extern schedule_tail
+	extern thread_exit
+
+;      割り込み入口の共通マクロ
+;      IRQ_ENTRY c_handler
+;      【方針】C呼び出し規約では EBX/ESI/EDI/EBP は呼び出し先が保存するため、
+;      割り込み入口で保存が必要なのは呼び出し元保存の EAX/ECX/EDX だけ
+;      （EFLAGS、CS、EIP はCPUが自動でプッシュする）
+;      【最適化】DS が既にカーネルデータセレクタなら（リング0のみの現状では常に）
+;      セグメントレジスタの保存・再ロード・復元を丸ごと省略する
+;      【重要】C ハンドラ内（schedule()）でスレッドが切り替わった場合、
+;      ここで復元されるレジスタは切り替え先スレッドのものになる
+%macro IRQ_ENTRY 1
+	push eax
+	push ecx
+	push edx
+
+	mov ax, ds
+	cmp ax, DATA_SEGMENT_SELECTOR
+	jne %%reload_segments
+
+	;    高速パス: セグメントはそのまま
+	call %1
+
+	pop edx
+	pop ecx
+	pop eax
+	iret
+
+%%reload_segments:
+	;    低速パス: カーネルのデータセグメントに切り替えて呼び出す
 	push ds
 	push es
 	push fs
 	push gs
 
-	;   カーネルのデータセグメントに切り替え
-	;   【理由】割り込みハンドラはカーネル空間で実行される
-	mov ax, 0x10; データセグメントセレクタ
+	mov ax, DATA_SEGMENT_SELECTOR
 	mov ds, ax
 	mov es, ax
 	mov fs, ax
+	mov ax, PERCPU_SEGMENT_SELECTOR; GS は CPU ごとのコンテキストを指す
 	mov gs, ax
 
-	;    C言語で書かれたタイマーハンドラを呼び出し
-	;    【重要】ここでスケジューラが動作し、current_threadが変更される可能性
-	call timer_handler_c
+	call %1
 
-	;   セグメントレジスタを復元
 	pop gs
 	pop fs
 	pop es
 	pop ds
 
-	; 汎用レジスタを復元
-	; 【重要】ここで復元されるレジスタは、timer_handler_c内で
-	; スレッドが切り替わった場合、別のスレッドのレジスタになる！
-	popa
-
-	; 割り込み終了（IRETで元の処理に戻る）
-	; CPUが自動で以下を行う：
-	; 1. スタックからEIP、CS、EFLAGSを復元
-	; 2. 割り込み有効化
-	; 3. 元の処理位置にジャンプ
+	pop edx
+	pop ecx
+	pop eax
+	iret
+%endmacro
+
+;      全ベクタ共通の入口
+;      【役割】isr_stub_N がベクタ番号（とエラーコードのない例外・IRQ では 0）を積んで
+;      ここへ飛び、interrupt_dispatch_c(interrupt_frame_t*) を呼ぶ
+;      【重要】積む順序は irq.h の interrupt_frame_t と一致させること
+;      （低位から EDX, ECX, EAX, ベクタ番号, エラーコード, EIP, CS, EFLAGS）
+;      【備考】セグメントの扱いは IRQ_ENTRY と同じ（DS が既にカーネルなら省略）
+interrupt_common_entry:
+	push eax
+	push ecx
+	push edx
+
+	mov ax, ds
+	cmp ax, DATA_SEGMENT_SELECTOR
+	jne .reload_segments
+
+	;    高速パス: フレームは現在の ESP
+	push esp
+	call interrupt_dispatch_c
+	add esp, 4
+
+	pop edx
+	pop ecx
+	pop eax
+	add esp, 8; ベクタ番号とエラーコードを捨てる
 	iret
 
-	;      キーボード割り込みハンドラ（アセンブリ部分）
-	;      【重要】IRQ1（キーボード）が発生すると自動的に呼ばれる
-	global keyboard_interrupt_handler
-
-keyboard_interrupt_handler:
-	; === キーボード割り込み処理の開始 ===
-	; CPUは割り込み発生時に以下を自動で行う：
-	; 1. 現在のEFLAGS、CS、EIPをスタックにプッシュ
-	; 2. 割り込みを無効化（CLI相当）
-	; 3. IDTから該当エントリのアドレスにジャンプ
-
-	;     全汎用レジスタをスタックに保存
-	;     【重要】キーボード割り込みでは通常コンテキストスイッチは発生しないが、
-	;     一貫性のためにすべてのレジスタを保存
-	pusha ; EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI を保存
-
-	;    セグメントレジスタも保存
+.reload_segments:
 	push ds
 	push es
 	push fs
 	push gs
 
-	;   カーネルのデータセグメントに切り替え
-	;   【理由】割り込みハンドラはカーネル空間で実行される
-	mov ax, 0x10; データセグメントセレクタ
+	mov ax, DATA_SEGMENT_SELECTOR
 	mov ds, ax
 	mov es, ax
 	mov fs, ax
+	mov ax, PERCPU_SEGMENT_SELECTOR
 	mov gs, ax
 
-	;    C言語で書かれたキーボードハンドラを呼び出し
-	;    【役割】スキャンコード読み取りとASCII変換、バッファ格納
-	call keyboard_handler_c
+	;   フレームはセグメントレジスタ4つ分の上
+	lea eax, [esp+16]
+	push eax
+	call interrupt_dispatch_c
+	add esp, 4
 
-	;   セグメントレジスタを復元
 	pop gs
 	pop fs
 	pop es
 	pop ds
 
-	; 汎用レジスタを復元
-	popa
+	pop edx
+	pop ecx
+	pop eax
+	add esp, 8
+	iret
 
-	; 割り込み終了
+;      ベクタごとの入口 isr_stub_0 〜 isr_stub_255
+;      【重要】CPU がエラーコードを積む例外（8, 10〜14, 17, 21, 29, 30）以外は
+;      ダミーの 0 を積み、全ベクタでフレームの形をそろえる
+%assign vector 0
+%rep 256
+isr_stub_%+vector:
+%if vector == 8 || (vector >= 10 && vector <= 14) || vector == 17 || vector == 21 || vector == 29 || vector == 30
+	push dword vector
+%else
+	push dword 0
+	push dword vector
+%endif
+	jmp interrupt_common_entry
+%assign vector vector+1
+%endrep
+
+	;      デバイス使用不可例外ハンドラ（#NM, ベクタ7）
+	;      【役割】CR0.TS がセットされた状態でFPU/SSE命令が実行されると呼ばれる
+	;      【重要】遅延FPU切り替えの入口。エラーコードは積まれない
+	global device_not_available_handler
+
+device_not_available_handler:
+	;         FXSAVE/FXRSTOR による状態の入れ替え（FPU命令は iret 後に再実行される）
+	IRQ_ENTRY device_not_available_handler_c
+
+	;      再スケジュールIPIハンドラ（RESCHEDULE_IPI_VECTOR）
+	;      【役割】他CPUがこのCPUのREADYリングにスレッドを入れた時に送られる
+	global reschedule_ipi_handler
+
+reschedule_ipi_handler:
+	IRQ_ENTRY reschedule_ipi_handler_c
+
+	;      Local APIC タイマー割り込みハンドラ（LAPIC_TIMER_VECTOR）
+	;      【役割】CPUごとのスケジューラティック（PIT の代わり）
+	global lapic_timer_interrupt_handler
+
+lapic_timer_interrupt_handler:
+	IRQ_ENTRY lapic_timer_handler_c
+
+	;      IRQ 入口〜EOI ベンチマーク用ハンドラ（benchmark.c の計測専用ベクタ）
+	global irq_bench_interrupt_handler
+
+irq_bench_interrupt_handler:
+	IRQ_ENTRY irq_bench_handler_c
+
+	;      Local APIC スプリアス割り込みハンドラ
+	;      【備考】スプリアス割り込みには EOI を送らない
+	global spurious_interrupt_handler
+
+spurious_interrupt_handler:
 	iret
 
 	;      コンテキストスイッチ関数
-	;      switch_context(old_esp_ptr, new_esp)
+	;      context_switch(old_esp_ptr, new_esp)
 	;      【役割】あるスレッドから別のスレッドに実行を切り替える
-	;      【備考】
-	;      今の設計だと「EAX に関数アドレスを pop して jmp eax」という流れになっていますが、
-	;      将来的に「ユーザーモードスレッド（ring3）」をやりたい場合は、初期スタックに CS / SS も積んで、iret 戻りを使う必要があります。
+	;      【前提】必ず割り込み禁止・スケジューラロック保持で呼ぶこと（schedule() が irq_save 済み）。
+	;      割り込み状態は各スレッドが自分の schedule() 内で irq_restore するため、
+	;      EFLAGS をここで保存する必要はない
+	;      【最適化】C呼び出し規約で呼び出し先保存の EBX/ESI/EDI/EBP だけを保存する。
+	;      EAX/ECX/EDX は呼び出し元（C コンパイラ）が既に保存済み
 	global context_switch
 
 context_switch:
 	; 関数の引数：
-	; [esp+8] = old_esp_ptr (現在のスレッドのESPを保存するアドレス)
-	; [esp+12] = new_esp (切り替え先スレッドのESP値)
-
-	;      現在の実行状態を保存（EFLAGS含む）
-	;      【重要】ここで保存される状態は、次回このスレッドが実行される時に
-	;      完全に復元される
-	pushfd ; EFLAGS保存（割り込み状態含む）
-	push   ebp; ベースポインタ保存
-	push   edi; 汎用レジスタ保存
-	push   esi
-	push   edx
-	push   ecx
-	push   ebx
-	push   eax
+	; [esp+4] = old_esp_ptr (現在のスレッドのESPを保存するアドレス)
+	; [esp+8] = new_esp (切り替え先スレッドのESP値)
+	mov eax, [esp+4]; old_esp_ptr
+	mov edx, [esp+8]; new_esp
+
+	;    呼び出し先保存レジスタを保存
+	push ebp
+	push ebx
+	push esi
+	push edi
 
 	;   現在のスタックポインタを old_esp_ptr に保存
-	;   これにより、現在のスレッドの実行状態が完全に保存される
-	mov eax, [esp+36]; old_esp_ptr のアドレスを取得 (8*4 + 4 = 36)
-	mov [eax], esp; 現在の ESP を保存
+	mov [eax], esp
 
 	;   新しいスレッドのスタックポインタに切り替え
 	;   【これがコンテキストスイッチの核心部分】
-	mov esp, [esp+40]; new_esp を ESP に設定 (8*4 + 8 = 40)
-
-	;     新しいスレッドの状態を復元
-	;     【重要】ここで復元される状態は、以前にこのスレッドが
-	;     switch_context で保存した状態、または初期化時に設定された状態
-	pop   eax; 汎用レジスタ復元
-	pop   ebx
-	pop   ecx
-	pop   edx
-	pop   esi
-	pop   edi
-	pop   ebp; ベースポインタ復元
-	popfd ; EFLAGS復元（割り込み状態含む）
-	;     EFLAGSの復帰で割り込みが有効化されているので、stiはここでは不要
+	mov esp, edx
+
+	;   新しいスレッドの状態を復元
+	;   【重要】ここで復元される状態は、以前にこのスレッドが
+	;   context_switch で保存した状態、または initialize_thread_stack で作った初期状態
+	pop edi
+	pop esi
+	pop ebx
+	pop ebp
 
 	; 関数から戻る（新しいスレッドの続きを実行）
 	; 【注意】この ret は元の呼び出し元ではなく、
-	; 新しいスレッドの呼び出し元に戻る！
+	; 新しいスレッドの呼び出し元（初回は thread_entry_trampoline）に戻る！
 	ret
 
 	;      初期コンテキストスイッチ関数（最初のスレッド専用）
@@ -163,25 +224,39 @@ context_switch:
 
 initial_context_switch:
 	; 引数: [esp+4] = new_esp (切り替え先スレッドのESP値)
+	mov esp, [esp+4]
+
+	;   スレッド作成時に初期化された呼び出し先保存レジスタを復元
+	pop edi
+	pop esi
+	pop ebx
+	pop ebp
+
+	; thread_entry_trampoline へ
+	ret
 
-	;   新しいスレッドのスタックポインタに直接切り替え
-	mov eax, [esp+4]; new_esp を EAX に取得
-	mov esp, eax; ESP を設定
-
-	;     新しいスレッドの状態を復元
-	;     （スレッド作成時に初期化された8つのレジスタ値：EAX, EBX, ECX, EDX, ESI, EDI, EBP）
-	pop   eax; 汎用レジスタ復元
-	pop   ebx
-	pop   ecx
-	pop   edx
-	pop   esi
-	pop   edi
-	pop   ebp; ベースポインタ復元
-	popfd ; EFLAGS復元（割り込み有効化含む）
-	;     EFLAGSの復帰で割り込みが有効化されているので、stiはここでは不要
-
-	;   スレッド関数を実行
-	;   【重要】retではなくjmpを使用（C呼び出し規約との整合性のため）
-	;   スタックトップには関数アドレスがある
-	pop eax; 関数アドレスをEAXに取得
-	jmp eax; 関数に直接ジャンプ（戻りアドレス不要）
+	;      スレッド開始トランポリン
+	;      【役割】新しいスレッドが最初に context_switch から ret で到達する場所
+	;      EBX = スレッド関数（initialize_thread_stack が設定）
+	;      【重要】切り替えは割り込み禁止・スケジューラロック保持で行われるため、
+	;      ここでロックを解放してから割り込みを有効化する
+	global thread_entry_trampoline
+
+thread_entry_trampoline:
+	call schedule_tail
+	sti
+	call ebx
+
+	;    スレッド関数から戻った場合はスレッドを終了（戻らない）
+	call thread_exit
+
+	;      入口のアドレス表（irq_init() が IDT に設定する）
+	section .rodata
+	global isr_stub_table
+
+isr_stub_table:
+%assign vector 0
+%rep 256
+	dd isr_stub_%+vector
+%assign vector vector+1
+%endrep
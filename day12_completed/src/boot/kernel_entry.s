@@ -1,6 +1,9 @@
 ; kernel_entry.s - カーネルエントリーポイント
 ; ブートローダーからカーネルへの制御移行を処理
 
+%include "boot_constants.inc"
+%include "cpu_setup.inc"
+
 [bits   32]
 	[global _start]; リンカのエントリーポイント
 	[extern kernel_main]; kernel.c のメイン関数
@@ -46,6 +49,9 @@ _start:
 	;   デバッグ: BSS クリア完了
 	mov dword [0xb802c], 0x074c; 'L' - BSS クリア完了
 
+	;    SSE/FXSR 有効化（cpu_setup.inc, AP も同じマクロを使う）
+	ENABLE_SSE
+
 	;   デバッグ: kernel_main 呼び出し前
 	mov dword [0xb8030], 0x074d; 'M' - kernel_main 呼び出し前
 
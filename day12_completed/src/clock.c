@@ -0,0 +1,116 @@
+#include "clock.h"
+
+#include "kernel.h"
+
+/*
+ * TSC 時刻
+ * 【前提】TSC の周波数は一定（QEMU・近年の CPU の invariant TSC）で、
+ * 全CPUの TSC は同期している
+ */
+
+static uint32_t tsc_khz = 0;  // 1ms あたりの TSC サイクル数（0 = 未較正）
+static uint64_t base_tsc;     // 較正完了時の TSC
+static uint32_t base_ticks;   // 較正完了時のティック数
+
+/*
+ * TSC 周波数の較正
+ * 【役割】PIT の CLOCK_CALIBRATE_TICKS ティック間の TSC の進みを数える
+ * 【備考】TSC がない CPU では何もせず、時刻は PIT のティックのままになる
+ */
+void clock_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_FEATURE_TSC)) {
+        debug_print("CLOCK: no TSC, using %ums PIT ticks", TICK_US / 1000);
+        return;
+    }
+
+    // ティックの境目から数え始める
+    uint32_t start = get_system_ticks();
+    while (get_system_ticks() == start) {
+        asm volatile("hlt");
+    }
+    start = get_system_ticks();
+    uint64_t tsc_start = rdtsc();
+    while (get_system_ticks() - start < CLOCK_CALIBRATE_TICKS) {
+        asm volatile("hlt");
+    }
+
+    uint32_t flags = irq_save();
+    uint64_t tsc_end = rdtsc();
+    base_ticks = start + CLOCK_CALIBRATE_TICKS;
+    base_tsc = tsc_end;
+    tsc_khz = (uint32_t)((tsc_end - tsc_start) /
+                         (CLOCK_CALIBRATE_TICKS * TICK_US / 1000));
+    irq_restore(flags);
+
+    debug_print("CLOCK: TSC %u kHz", tsc_khz);
+}
+
+bool clock_is_calibrated(void) {
+    return tsc_khz != 0;
+}
+
+/*
+ * TSC 値 → 時刻（ns）
+ * 【備考】ms 単位の商と余りに分けて掛け算の64bitオーバーフローを避ける
+ */
+uint64_t clock_tsc_to_ns(uint64_t tsc) {
+    uint64_t delta = tsc - base_tsc;
+    uint64_t ms = delta / tsc_khz;
+    uint64_t rem = delta % tsc_khz;
+    return (uint64_t)base_ticks * TICK_NS + ms * NSEC_PER_MSEC +
+           rem * NSEC_PER_MSEC / tsc_khz;
+}
+
+/*
+ * TSC のサイクル数 → 時間（ns）
+ * 【役割】計測区間の長さの換算。clock_tsc_to_ns() は絶対時刻用で、
+ * 較正時点の TSC を引いて起点の時刻を足すため、差分には使えない
+ * 【備考】ms 単位の商と余りに分けて掛け算の64bitオーバーフローを避ける
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+    if (!tsc_khz) {
+        return 0;
+    }
+    uint64_t ms = cycles / tsc_khz;
+    uint64_t rem = cycles % tsc_khz;
+    return ms * NSEC_PER_MSEC + rem * NSEC_PER_MSEC / tsc_khz;
+}
+
+/*
+ * 時刻（ns）→ TSC 値
+ */
+uint64_t clock_ns_to_tsc(uint64_t time_ns) {
+    uint64_t delta = time_ns - (uint64_t)base_ticks * TICK_NS;
+    uint64_t ms = delta / NSEC_PER_MSEC;
+    uint64_t rem = delta % NSEC_PER_MSEC;
+    return base_tsc + ms * tsc_khz + rem * tsc_khz / NSEC_PER_MSEC;
+}
+
+/*
+ * 起動からの経過時間（ns）
+ * 【備考】未較正の間は PIT のティック精度
+ */
+uint64_t clock_get_time_ns(void) {
+    if (!tsc_khz) {
+        return (uint64_t)get_system_ticks() * TICK_NS;
+    }
+    return clock_tsc_to_ns(rdtsc());
+}
+
+uint64_t clock_get_time_us(void) {
+    return clock_get_time_ns() / NSEC_PER_USEC;
+}
+
+/*
+ * TSC から求めたティック数（get_system_ticks() が較正後に使う）
+ */
+uint32_t clock_get_ticks(void) {
+    uint64_t tsc_per_tick = (uint64_t)tsc_khz * (TICK_US / 1000);
+    return base_ticks + (uint32_t)((rdtsc() - base_tsc) / tsc_per_tick);
+}
+
+uint32_t clock_get_tsc_khz(void) {
+    return tsc_khz;
+}
@@ -2,8 +2,20 @@
 
 #include <stdarg.h>
 
+#include "benchmark.h"
+#include "clock.h"
 #include "error_types.h"
+#include "irq.h"
 #include "keyboard.h"
+#include "lapic.h"
+#include "periodic.h"
+#include "serial.h"
+#include "smp.h"
+#include "softirq.h"
+#include "sync.h"
+#include "trace.h"
+#include "vbe.h"
+#include "vga.h"
 
 /*
  * デバッグ・診断システム実装
@@ -77,6 +89,24 @@ void debug_hexdump(const void* data, size_t length, const char* label) {
     const uint8_t* bytes = (const uint8_t*)data;
     debug_print("=== Hexdump: %s (%u bytes) ===", label, length);
 
+    // バイナリ出力: 生のバイト列を HEXDUMP レコードで送る（16進文字列の約1/3）
+    if (trace_binary_enabled()) {
+        uint8_t record[sizeof(trace_hexdump_t) + TRACE_HEXDUMP_CHUNK];
+        for (size_t i = 0; i < length; i += TRACE_HEXDUMP_CHUNK) {
+            size_t chunk = length - i;
+            if (chunk > TRACE_HEXDUMP_CHUNK) {
+                chunk = TRACE_HEXDUMP_CHUNK;
+            }
+            ((trace_hexdump_t*)record)->address = (uint32_t)(bytes + i);
+            for (size_t j = 0; j < chunk; j++) {
+                record[sizeof(trace_hexdump_t) + j] = bytes[i + j];
+            }
+            trace_emit(TRACE_REC_HEXDUMP, record,
+                       sizeof(trace_hexdump_t) + chunk);
+        }
+        return;
+    }
+
     for (size_t i = 0; i < length; i += 16) {
         // Print address
         char line[80];
@@ -197,6 +227,21 @@ system_metrics_t* metrics_get(void) {
 
 void metrics_print_summary(void) {
     metrics_update();
+    if (trace_binary_enabled()) {
+        trace_metrics_t record = {
+            .total_interrupts = system_metrics.total_interrupts,
+            .context_switches = system_metrics.context_switches,
+            .threads_created = system_metrics.threads_created,
+            .memory_usage_bytes = system_metrics.memory_usage_bytes,
+            .system_uptime_ticks = system_metrics.system_uptime_ticks,
+            .keyboard_inputs = system_metrics.keyboard_inputs,
+            .serial_writes = system_metrics.serial_writes,
+            .timer_interrupts = system_metrics.timer_interrupts,
+            .scheduler_calls = system_metrics.scheduler_calls,
+        };
+        trace_emit(TRACE_REC_METRICS, &record, sizeof(record));
+        return;
+    }
     debug_print("=== System Metrics Summary ===");
     debug_print("Uptime: %u ticks", system_metrics.system_uptime_ticks);
     debug_print("Total Interrupts: %u", system_metrics.total_interrupts);
@@ -277,6 +322,21 @@ void thread_diagnostics_print(const thread_diagnostics_t* diag) {
     if (!diag)
         return;
 
+    if (trace_binary_enabled()) {
+        trace_thread_t record = {
+            .thread_id = diag->thread_id,
+            .state = (uint32_t)diag->state,
+            .stack_usage = diag->stack_usage,
+            .execution_time = diag->execution_time,
+            .sleep_count = diag->sleep_count,
+            .context_switch_count = diag->context_switch_count,
+            .priority = diag->priority,
+            .cpu_usage_percent = diag->cpu_usage_percent,
+        };
+        trace_emit(TRACE_REC_THREAD, &record, sizeof(record));
+        return;
+    }
+
     debug_print("Thread ID: 0x%08x", diag->thread_id);
     debug_print("  State: %d", diag->state);
     debug_print("  Stack Usage: %u bytes", diag->stack_usage);
@@ -506,9 +566,17 @@ void debug_command_help(void) {
     debug_print("  scheduler  - スケジューラー情報を表示");
     debug_print("  keyboard   - キーボード状態を表示");
     debug_print("  serial     - シリアル通信状態を表示");
+    debug_print("  baud <rate> - シリアルの速度を変更（115200 を割り切れる値）");
     debug_print("  timer      - タイマー情報を表示");
+    debug_print("  vga        - 画面の転送統計を表示");
+    debug_print("  vbe        - VBE グラフィックスの状態と文字描画の統計を表示");
+    debug_print("  tune <tick_us> <quantum_us> - ティック周期とクォンタムを設定");
+    debug_print("  dump <addr> <len> - メモリを16進表示（0x で16進指定）");
     debug_print("  trace      - 実行トレースを表示");
-    debug_print("  benchmark  - 性能ベンチマークを実行");
+    debug_print("  binlog [on|off|flush] - バイナリ出力の切り替え（tools/trace_decode で解読）");
+    debug_print("  benchmark [名前] - 性能ベンチマークを実行（名前なしで全部）");
+    debug_print("  benchlist  - ベンチマーク名の一覧");
+    debug_print("  locks      - ロック競合統計を表示");
     debug_print("  stress     - ストレステストを実行");
 }
 
@@ -551,15 +619,18 @@ void debug_command_health(void) {
  */
 void debug_command_interrupts(void) {
     debug_print("=== 割り込み情報 ===");
-    debug_print("総割り込み回数: %u", system_metrics.total_interrupts);
-    debug_print("タイマー割り込み: %u", system_metrics.timer_interrupts);
-    debug_print("平均割り込み頻度: %u/秒", system_metrics.total_interrupts /
-                                               (get_system_ticks() / 100 + 1));
 
-    // PIC状態表示
-    debug_print("PIC状態:");
-    debug_print("  Master Mask: 0x%02x", inb(0x21));
-    debug_print("  Slave Mask:  0x%02x", inb(0xA1));
+    // 配送経路（PIC 経路ならマスクも表示）
+    if (apic_interrupts_enabled()) {
+        debug_print("配送: I/O APIC + Local APIC");
+    } else {
+        debug_print("配送: PIC (Master Mask 0x%x, Slave Mask 0x%x)",
+                    inb(PIC_MASTER_DATA), inb(PIC_SLAVE_DATA));
+    }
+
+    // ベクタ別の受信回数・処理時間（計測モードでは遅れと割り込み禁止区間も）
+    irq_print_stats();
+    softirq_print_stats();
 }
 
 /*
@@ -568,16 +639,34 @@ void debug_command_interrupts(void) {
  */
 void debug_command_scheduler(void) {
     debug_print("=== スケジューラー情報 ===");
-    debug_print("コンテキストスイッチ回数: %u",
-                system_metrics.context_switches);
+    uint32_t switches = 0;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        switches += get_cpu_context(cpu)->context_switches;
+    }
+    debug_print("コンテキストスイッチ回数: %u", switches);
     debug_print("現在のスレッド: 0x%08x", (uint32_t)get_current_thread());
     debug_print("システム稼働時間: %u ティック", get_system_ticks());
+    debug_print("オンラインCPU数: %u (このCPU: %u)", smp_get_online_count(),
+                get_kernel_context()->cpu_id);
+    debug_print("時刻: %u ms (TSC %u kHz)",
+                (uint32_t)(clock_get_time_us() / 1000), clock_get_tsc_khz());
+    debug_print("ティック周期: %u us (%s)", lapic_timer_get_tick_us(),
+                lapic_timer_uses_tsc_deadline() ? "TSC-deadline" : "one-shot");
+    debug_print("クォンタム: 通常 %u / EDF %u / 公平 %u / MLFQ %u us",
+                sched_get_quantum_us(SCHED_CLASS_NORMAL),
+                sched_get_quantum_us(SCHED_CLASS_EDF),
+                sched_get_quantum_us(SCHED_CLASS_FAIR),
+                sched_get_quantum_us(SCHED_CLASS_MLFQ));
+    periodic_print_stats();
+    edf_print_stats();
 
     if (get_current_thread()) {
         thread_t* current = get_current_thread();
         debug_print("現在スレッドの状態:");
         debug_print("  状態: %d", current->state);
         debug_print("  カウンタ: %u", current->counter);
+        debug_print("  優先度: %u (基本 %u)", current->priority,
+                    current->base_priority);
         debug_print("  表示行: %d", current->display_row);
     }
 }
@@ -594,6 +683,15 @@ void debug_command_keyboard(void) {
     debug_print("バッファフル状態: %s",
                 keyboard_buffer_is_full() ? "満杯" : "正常");
 
+    keyboard_latency_t latency;
+    keyboard_get_latency(&latency);
+    if (latency.count) {
+        uint64_t avg_ns = latency.total_ns / latency.count;
+        debug_print("エコー遅延: avg %u us / max %u us (%u キー)",
+                    (uint32_t)(avg_ns / NSEC_PER_USEC),
+                    (uint32_t)(latency.max_ns / NSEC_PER_USEC), latency.count);
+    }
+
     // キーボードコントローラー状態
     uint8_t kbd_status = read_keyboard_status();
     debug_print("コントローラー状態: 0x%02x", kbd_status);
@@ -609,31 +707,79 @@ void debug_command_keyboard(void) {
 void debug_command_serial(void) {
     debug_print("=== シリアル通信状態 ===");
     debug_print("出力回数: %u", system_metrics.serial_writes);
+    debug_print("UART: %s, 送信 FIFO %u バイト, %u baud",
+                serial_get_uart_name(), serial_get_fifo_depth(),
+                serial_get_baud());
 
     // COM1状態確認
-    uint8_t lsr = inb(0x3FD);  // Line Status Register
+    uint8_t lsr = inb(SERIAL_PORT_COM1 + SERIAL_REG_LSR);
     debug_print("COM1状態 (LSR: 0x%02x):", lsr);
-    debug_print("  送信準備: %s", (lsr & 0x20) ? "OK" : "待機中");
-    debug_print("  受信データ: %s", (lsr & 0x01) ? "あり" : "なし");
-    debug_print("  エラー状態: %s", (lsr & 0x1E) ? "エラー" : "正常");
+    debug_print("  送信準備: %s", (lsr & SERIAL_LSR_THR_EMPTY) ? "OK" : "待機中");
+    debug_print("  受信データ: %s",
+                (lsr & SERIAL_LSR_DATA_READY) ? "あり" : "なし");
+    debug_print("  エラー状態: %s", (lsr & SERIAL_LSR_ERRORS) ? "エラー" : "正常");
+
+    serial_tx_stats_t tx;
+    serial_get_tx_stats(&tx);
+    debug_print("送信: %u バイト, THRE 確認 %u 回", tx.bytes, tx.thre_waits);
+    serial_rx_stats_t rx;
+    serial_get_rx_stats(&rx);
+    debug_print("受信: %u バイト, 破棄 %u, エラー %u", rx.received, rx.dropped,
+                rx.errors);
 }
 
 /*
  * タイマー情報表示コマンド
  * 【役割】システムタイマーの動作状況を表示
+ * 【備考】ティック周期は Local APIC タイマーなら tune で変えた現在値、
+ * PIT のみの構成なら TICK_US 固定。稼働時間は TSC から求める
  */
 void debug_command_timer(void) {
+    bool lapic_tick = lapic_timer_is_running();
+    uint32_t tick_us = lapic_tick ? lapic_timer_get_tick_us() : TICK_US;
+    uint64_t uptime_us = clock_get_time_us();
+
     debug_print("=== タイマー情報 ===");
-    debug_print("システムティック: %u", get_system_ticks());
-    debug_print("稼働時間: %u.%02u 秒", get_system_ticks() / 100,
-                get_system_ticks() % 100);
-    debug_print("タイマー割り込み: %u", system_metrics.timer_interrupts);
-    debug_print("理論周波数: 100Hz (10ms間隔)");
+    debug_print("システムティック: %u（%u us 単位）", get_system_ticks(), TICK_US);
+    debug_print("稼働時間: %u 秒 %u ms", (uint32_t)(uptime_us / 1000000),
+                (uint32_t)(uptime_us / 1000 % 1000));
+    debug_print("ティックの発生源: %s",
+                lapic_tick ? (lapic_timer_uses_tsc_deadline()
+                                  ? "Local APIC タイマー（TSC-deadline）"
+                                  : "Local APIC タイマー（one-shot）")
+                           : "PIT");
+    debug_print("ティック周期: %u us（%u Hz）", tick_us, 1000000 / tick_us);
+    debug_print("クォンタム: 通常 %u / EDF %u / 公平 %u / MLFQ %u us",
+                sched_get_quantum_us(SCHED_CLASS_NORMAL),
+                sched_get_quantum_us(SCHED_CLASS_EDF),
+                sched_get_quantum_us(SCHED_CLASS_FAIR),
+                sched_get_quantum_us(SCHED_CLASS_MLFQ));
+}
 
-    // 実際の周波数計算
-    uint32_t actual_freq =
-        system_metrics.timer_interrupts * 100 / (get_system_ticks() + 1);
-    debug_print("実際の周波数: 約%uHz", actual_freq);
+/*
+ * スケジューラ調整コマンド
+ * 【役割】実行中にティック周期（Local APIC タイマー）と全クラスのクォンタムを
+ * 設定する。0 を渡した項目は変更しない
+ * 【備考】PIT のみの構成ではティックは TIMER_FREQUENCY 固定で、クォンタムだけ変わる
+ */
+void debug_command_sched_tuning(uint32_t tick_us, uint32_t quantum_us) {
+    debug_print("=== スケジューラ調整 ===");
+    if (tick_us && OS_FAILURE_CHECK(lapic_timer_set_tick_us(tick_us))) {
+        debug_print("ティック周期は %u〜%u us で指定してください",
+                    LAPIC_TIMER_TICK_MIN_US, LAPIC_TIMER_TICK_MAX_US);
+    }
+    if (quantum_us) {
+        for (uint8_t cls = 0; cls < SCHED_CLASS_COUNT; cls++) {
+            if (OS_FAILURE_CHECK(sched_set_quantum_us(cls, quantum_us))) {
+                debug_print("クォンタムは %u〜%u us で指定してください",
+                            SCHED_QUANTUM_MIN_US, SCHED_QUANTUM_MAX_US);
+                break;
+            }
+        }
+    }
+    debug_print("ティック周期: %u us, クォンタム: %u us",
+                lapic_timer_get_tick_us(),
+                sched_get_quantum_us(SCHED_CLASS_NORMAL));
 }
 
 /*
@@ -653,6 +799,28 @@ void debug_command_dump(uint32_t address, uint32_t length) {
     debug_hexdump((void*)address, length, "メモリダンプ");
 }
 
+/*
+ * バイナリ出力の切り替えコマンド
+ * 【役割】on / off で debug_print・メトリクス・ダンプ・トレースイベントの
+ * 出力形式を切り替える。flush は記録済みのイベントをすぐ送る。引数なしは統計
+ * 【備考】有効中もシェルのプロンプトとエコーはテキストのまま流れる
+ * （ホスト側の tools/trace_decode がフレームと区別して表示する）
+ */
+void debug_command_binlog(const char* mode) {
+    if (!mode[0]) {
+        trace_print_stats();
+    } else if (str_equal(mode, "on")) {
+        trace_set_binary(true);
+    } else if (str_equal(mode, "off")) {
+        trace_set_binary(false);
+        trace_print_stats();
+    } else if (str_equal(mode, "flush")) {
+        trace_flush_events();
+    } else {
+        debug_print("使い方: binlog [on|off|flush]");
+    }
+}
+
 /*
  * 実行トレース表示コマンド
  * 【役割】システムの実行履歴を表示
@@ -709,6 +877,17 @@ void debug_command_benchmark(void) {
     elapsed = end_tick - start_tick;
 
     debug_print("メモリテスト完了: %u ティック", elapsed);
+
+    // サブシステム別ベンチマーク
+    benchmark_run_all();
+}
+
+/*
+ * ロック統計表示コマンド
+ * 【役割】名前付き mutex/semaphore/condvar の取得・競合・待ち時間を表示
+ */
+void debug_command_locks(void) {
+    sync_print_stats();
 }
 
 /*
@@ -752,3 +931,168 @@ void debug_command_stress_test(void) {
     health_status_t health = system_health_check();
     debug_print("ヘルス状態: %d (0=正常, 1=警告, 2=エラー, 3=致命的)", health);
 }
+
+/*
+ * =================================================================================
+ * インタラクティブデバッグモード（シリアルシェル）
+ * =================================================================================
+ */
+
+// 引数を取らないコマンド
+typedef struct {
+    const char* name;
+    void (*run)(void);
+} debug_command_entry_t;
+
+static const debug_command_entry_t debug_commands[] = {
+    {"help", debug_command_help},
+    {"status", debug_command_status},
+    {"threads", debug_command_threads},
+    {"memory", debug_command_memory},
+    {"metrics", debug_command_metrics},
+    {"profile", debug_command_profile},
+    {"health", debug_command_health},
+    {"interrupts", debug_command_interrupts},
+    {"scheduler", debug_command_scheduler},
+    {"keyboard", debug_command_keyboard},
+    {"serial", debug_command_serial},
+    {"timer", debug_command_timer},
+    {"vga", vga_print_stats},
+    {"vbe", vbe_print_info},
+    {"trace", debug_command_trace},
+    {"benchlist", benchmark_print_names},
+    {"locks", debug_command_locks},
+    {"stress", debug_command_stress_test},
+};
+
+#define DEBUG_COMMAND_COUNT (sizeof(debug_commands) / sizeof(debug_commands[0]))
+
+/*
+ * 次の単語の切り出し
+ * 【役割】空白を飛ばして次の空白までを out に写す（長すぎる分は切り捨て）
+ */
+static void debug_next_word(const char** cursor, char* out, int max_length) {
+    const char* p = *cursor;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    int len = 0;
+    while (*p && *p != ' ' && *p != '\t') {
+        if (len < max_length - 1) {
+            out[len++] = *p;
+        }
+        p++;
+    }
+    out[len] = 0;
+    *cursor = p;
+}
+
+/*
+ * 数値引数の解釈（10進、または 0x 付きの16進）
+ * 【戻り値】数字以外が含まれていれば false
+ */
+static bool debug_parse_uint(const char* str, uint32_t* out) {
+    uint32_t base = 10;
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        base = 16;
+        str += 2;
+    }
+    if (!*str) {
+        return false;
+    }
+
+    uint32_t value = 0;
+    for (; *str; str++) {
+        uint32_t digit;
+        if (*str >= '0' && *str <= '9') {
+            digit = *str - '0';
+        } else if (base == 16 && *str >= 'a' && *str <= 'f') {
+            digit = *str - 'a' + 10;
+        } else if (base == 16 && *str >= 'A' && *str <= 'F') {
+            digit = *str - 'A' + 10;
+        } else {
+            return false;
+        }
+        value = value * base + digit;
+    }
+    *out = value;
+    return true;
+}
+
+/*
+ * コマンド1行の実行
+ * 【役割】先頭の単語でコマンドを選び、tune・dump・baud・binlog・benchmark には
+ * 引数を渡す
+ * 【備考】空行は何もしない。不明なコマンドはエラーを表示するだけ
+ */
+void debug_process_command(const char* command) {
+    char name[DEBUG_SHELL_WORD_MAX];
+    char arg1[DEBUG_SHELL_WORD_MAX];
+    char arg2[DEBUG_SHELL_WORD_MAX];
+    const char* cursor = command;
+    debug_next_word(&cursor, name, sizeof(name));
+    debug_next_word(&cursor, arg1, sizeof(arg1));
+    debug_next_word(&cursor, arg2, sizeof(arg2));
+    if (!name[0]) {
+        return;
+    }
+
+    uint32_t value1 = 0;
+    uint32_t value2 = 0;
+    bool args_ok = (!arg1[0] || debug_parse_uint(arg1, &value1)) &&
+                   (!arg2[0] || debug_parse_uint(arg2, &value2));
+
+    if (str_equal(name, "tune")) {
+        if (!args_ok) {
+            debug_print("使い方: tune <tick_us> <quantum_us>（0 は変更なし）");
+            return;
+        }
+        debug_command_sched_tuning(value1, value2);
+    } else if (str_equal(name, "dump")) {
+        if (!args_ok || !arg1[0] || !arg2[0]) {
+            debug_print("使い方: dump <addr> <len>");
+            return;
+        }
+        debug_command_dump(value1, value2);
+    } else if (str_equal(name, "baud")) {
+        if (!args_ok || !arg1[0] ||
+            OS_FAILURE_CHECK(serial_set_baud(value1))) {
+            debug_print("使い方: baud <rate>（%u を割り切れる値）",
+                        SERIAL_BASE_BAUD);
+            return;
+        }
+        debug_print("シリアル: %u baud", serial_get_baud());
+    } else if (str_equal(name, "binlog")) {
+        debug_command_binlog(arg1);
+    } else if (str_equal(name, "benchmark")) {
+        if (!arg1[0]) {
+            debug_command_benchmark();
+        } else if (OS_FAILURE_CHECK(benchmark_run(arg1))) {
+            debug_print("不明なベンチマーク: %s（benchlist で一覧）", arg1);
+        }
+    } else {
+        for (uint32_t i = 0; i < DEBUG_COMMAND_COUNT; i++) {
+            if (str_equal(debug_commands[i].name, name)) {
+                debug_commands[i].run();
+                return;
+            }
+        }
+        debug_print("不明なコマンド: %s（help で一覧）", name);
+    }
+}
+
+/*
+ * シリアルシェル本体（専用スレッドで実行し、戻らない）
+ * 【役割】プロンプトを出して1行読み、debug_process_command() で実行する
+ * 【備考】プロンプトはコマンドの出力が終わってから出るため、ホスト側の
+ * スクリプトはプロンプトを待てば次のコマンドを送ってよい
+ */
+void debug_enter_interactive_mode(void) {
+    char line[SERIAL_LINE_MAX];
+    debug_print("SHELL: Serial console ready (type 'help')");
+    while (1) {
+        serial_write_string(DEBUG_SHELL_PROMPT);
+        serial_read_line(line, sizeof(line));
+        debug_process_command(line);
+    }
+}
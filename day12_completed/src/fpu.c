@@ -0,0 +1,296 @@
+#include "fpu.h"
+
+#include "kernel.h"
+#include "sync.h"
+
+/*
+ * 遅延FPU切り替え（Lazy FPU switching）
+ * 【方針】コンテキストスイッチではFPU/SSEレジスタを保存しない。
+ * 切り替え先がFPU所有者でなければCR0.TSをセットしておき、
+ * そのスレッドが実際にSIMD命令を使った時だけ#NM例外で入れ替える。
+ * 【効果】SIMDを使わないスレッドはFXSAVE/FXRSTORのコストを一切払わない
+ * 【SMP】FPUレジスタとCR0.TSはCPUごとに存在するため、所有者もCPUごとに持つ。
+ * スレッドは所属CPUでしか走らないので、状態が他CPUのレジスタに残ることはない
+ */
+
+/*
+ * CPUごとのFPU所有状態
+ */
+typedef struct {
+    thread_t* owner;  // このCPUのFPUレジスタに状態が載っているスレッド
+    bool ts_set;      // このCPUのCR0.TSの現在値（CR0読み出しの省略用）
+} fpu_cpu_state_t;
+
+// FPU管理の静的変数
+static bool fpu_available = false;          // SSE/FXSRが有効化されているか
+static fpu_cpu_state_t fpu_cpus[MAX_CPUS];  // CPUごとの所有者とTS
+static volatile uint32_t fpu_nm_traps = 0;  // #NM例外の発生回数（全CPUの合計）
+static thread_t fpu_bench_peer;             // ベンチマーク用: 他のFPU所有者を模擬
+static fpu_state_t fpu_bench_scratch;       // ベンチマーク用: 初期状態のイメージ
+
+static inline fpu_cpu_state_t* fpu_this_cpu(void) {
+    return &fpu_cpus[get_kernel_context()->cpu_id];
+}
+
+/*
+ * 制御レジスタ・FPU命令のラッパー
+ */
+static inline uint32_t read_cr0(void) {
+    uint32_t value;
+    asm volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr0(uint32_t value) {
+    asm volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t value;
+    asm volatile("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void fpu_clear_ts(fpu_cpu_state_t* cpu) {
+    asm volatile("clts");
+    cpu->ts_set = false;
+}
+
+static inline void fpu_set_ts(fpu_cpu_state_t* cpu) {
+    write_cr0(read_cr0() | CR0_TS);
+    cpu->ts_set = true;
+}
+
+static inline void fpu_fxsave(fpu_state_t* state) {
+    asm volatile("fxsave %0" : "=m"(*state));
+}
+
+static inline void fpu_fxrstor(const fpu_state_t* state) {
+    asm volatile("fxrstor %0" : : "m"(*state));
+}
+
+/*
+ * FPU/SSEの初期状態をロード
+ * 【役割】初めてSIMDを使うスレッドにクリーンなレジスタを与える
+ */
+static void fpu_load_initial_state(void) {
+    uint32_t mxcsr = MXCSR_DEFAULT;
+    asm volatile("fninit");
+    asm volatile("ldmxcsr %0" : : "m"(mxcsr));
+}
+
+/*
+ * FPUサブシステム初期化
+ * 【役割】kernel_entry.sでSSEが有効化されたか確認し、#NMハンドラを登録する
+ */
+void fpu_init(void) {
+    fpu_available = (read_cr4() & CR4_OSFXSR) != 0;
+    if (!fpu_available) {
+        debug_print("FPU: SSE/FXSR not supported, lazy switching disabled");
+        return;
+    }
+
+    set_idt_gate(FPU_NM_VECTOR, (uint32_t)device_not_available_handler);
+
+    fpu_init_cpu();
+
+    debug_print("FPU: SSE enabled, lazy FPU switching via CR0.TS");
+}
+
+/*
+ * CPUごとのFPU初期化
+ * 【役割】BSPは fpu_init から、AP は ap_main から呼ぶ
+ */
+void fpu_init_cpu(void) {
+    if (!fpu_available) {
+        return;
+    }
+
+    // 最初にSIMDを使ったスレッドで#NMを発生させる
+    fpu_cpu_state_t* cpu = fpu_this_cpu();
+    cpu->owner = NULL;
+    fpu_set_ts(cpu);
+}
+
+bool fpu_is_available(void) {
+    return fpu_available;
+}
+
+uint32_t fpu_get_trap_count(void) {
+    return fpu_nm_traps;
+}
+
+/*
+ * スレッドのFPU状態初期化
+ * 【役割】新規スレッドは未使用状態から開始する
+ */
+void fpu_thread_init(thread_t* thread) {
+    thread->fpu_used = false;
+}
+
+/*
+ * コンテキストスイッチ直前のFPUフック
+ * 【役割】切り替え先がFPU所有者ならTSを解除、そうでなければTSをセット
+ * 【重要】TSが既にセットされていればCR0に触れないため、
+ * SIMDを使わないスレッド間の切り替えは比較1回で済む
+ */
+void fpu_switch_to(thread_t* next) {
+    if (!fpu_available) {
+        return;
+    }
+
+    fpu_cpu_state_t* cpu = fpu_this_cpu();
+    if (next == cpu->owner) {
+        if (cpu->ts_set) {
+            fpu_clear_ts(cpu);
+        }
+    } else if (!cpu->ts_set) {
+        fpu_set_ts(cpu);
+    }
+}
+
+/*
+ * スレッド終了時のFPU解放
+ * 【役割】終了したスレッドが所有者のままにならないようにする
+ * （次の切り替えでTSがセットされ、次の使用者が#NMで初期化される）
+ */
+void fpu_release_thread(thread_t* thread) {
+    fpu_cpu_state_t* cpu = &fpu_cpus[thread->cpu];
+    if (cpu->owner == thread) {
+        cpu->owner = NULL;
+    }
+}
+
+/*
+ * #NM例外ハンドラ（C言語部分）
+ * 【役割】前の所有者の状態をFXSAVEし、現在スレッドの状態をFXRSTORする
+ */
+void device_not_available_handler_c(void) {
+    thread_t* current = get_current_thread();
+    fpu_cpu_state_t* cpu = fpu_this_cpu();
+
+    fpu_clear_ts(cpu);
+    atomic_inc(&fpu_nm_traps);  // 全CPUの#NMから更新される
+
+    if (cpu->owner == current) {
+        return;  // 状態は既にレジスタ上にある
+    }
+
+    if (cpu->owner) {
+        fpu_fxsave(&cpu->owner->fpu_state);
+    }
+
+    if (current && current->fpu_used) {
+        fpu_fxrstor(&current->fpu_state);
+    } else {
+        fpu_load_initial_state();
+        if (current) {
+            current->fpu_used = true;
+        }
+    }
+    cpu->owner = current;
+}
+
+/*
+ * カーネル内SIMD区間の開始
+ * 【役割】所有者の状態を退避してFPUをカーネルが使えるようにする
+ * 【重要】区間中は割り込みを禁止する（戻り値をkernel_fpu_endに渡す）
+ */
+uint32_t kernel_fpu_begin(void) {
+    uint32_t flags = irq_save();
+    if (!fpu_available) {
+        return flags;
+    }
+
+    fpu_cpu_state_t* cpu = fpu_this_cpu();
+    if (cpu->ts_set) {
+        fpu_clear_ts(cpu);
+    }
+    if (cpu->owner) {
+        fpu_fxsave(&cpu->owner->fpu_state);
+        cpu->owner = NULL;
+    }
+    return flags;
+}
+
+/*
+ * カーネル内SIMD区間の終了
+ * 【役割】TSを再セットし、次にSIMDを使うスレッドに状態を復元させる
+ */
+void kernel_fpu_end(uint32_t flags) {
+    if (fpu_available) {
+        fpu_set_ts(fpu_this_cpu());
+    }
+    irq_restore(flags);
+}
+
+/*
+ * FPU切り替えコストのベンチマーク
+ * 【役割】非FPUスレッドと FPU使用スレッドの切り替えコストをサイクル単位で比較
+ * 1. 非FPUスレッド: fpu_switch_to() のみ（TSは既にセット済み）
+ * 2. FPU使用スレッド: fpu_switch_to() + #NM例外 + FXSAVE/FXRSTOR
+ * 3. 参考: 毎回保存する方式（eager）のFXSAVE+FXRSTORコスト
+ */
+void fpu_benchmark_switch_cost(void) {
+    thread_t* self = get_current_thread();
+    if (!fpu_available || !self) {
+        debug_print("FPU BENCH: skipped (SSE unavailable or no thread)");
+        return;
+    }
+
+    uint32_t hook_cycles = 0;
+    uint32_t lazy_cycles = 0;
+    uint32_t eager_cycles = 0;
+
+    /*
+     * 計測中に所有者が入れ替わらないよう割り込みを禁止し、kernel_fpu_begin() と
+     * 同じ手順で現在の所有者の状態を退避する
+     * 【重要】ループ中にレジスタへ載るのは初期状態（FNINIT + MXCSR_DEFAULT）の
+     * イメージだけで、self->fpu_state は読むだけ。終了後は所有者なしにして
+     * TSをセットするため、各スレッドは次の使用時に退避した状態を#NMで復元する
+     */
+    uint32_t flags = kernel_fpu_begin();
+    fpu_cpu_state_t* cpu = fpu_this_cpu();
+    fpu_load_initial_state();
+    fpu_fxsave(&fpu_bench_scratch);
+    fpu_bench_peer.fpu_state = fpu_bench_scratch;
+
+    // SIMD未使用のスレッドでは#NMが初期状態を読むよう一時的に使用済みにする
+    bool self_used = self->fpu_used;
+    if (!self_used) {
+        self->fpu_state = fpu_bench_scratch;
+        self->fpu_used = true;
+    }
+
+    for (int i = 0; i < FPU_BENCH_ITERATIONS; i++) {
+        // 1. 他スレッドがFPUを所有している状態で非FPUスレッドへ切り替え
+        cpu->owner = &fpu_bench_peer;
+        fpu_set_ts(cpu);
+        uint64_t start = rdtsc();
+        fpu_switch_to(self);
+        hook_cycles += (uint32_t)(rdtsc() - start);
+
+        // 2. 同じ状態からSSE命令を実行して#NMによる遅延復元を発生させる
+        start = rdtsc();
+        fpu_switch_to(self);
+        asm volatile("xorps %xmm0, %xmm0");
+        lazy_cycles += (uint32_t)(rdtsc() - start);
+
+        // 3. eager方式なら毎回必要になる保存と復元
+        start = rdtsc();
+        fpu_fxsave(&fpu_bench_peer.fpu_state);
+        fpu_fxrstor(&fpu_bench_scratch);
+        eager_cycles += (uint32_t)(rdtsc() - start);
+    }
+
+    self->fpu_used = self_used;
+    cpu->owner = NULL;
+    kernel_fpu_end(flags);
+
+    debug_print("FPU BENCH: non-FPU thread switch: %u cycles/switch",
+                hook_cycles / FPU_BENCH_ITERATIONS);
+    debug_print("FPU BENCH: FPU thread switch (#NM + restore): %u cycles/switch",
+                lazy_cycles / FPU_BENCH_ITERATIONS);
+    debug_print("FPU BENCH: eager FXSAVE+FXRSTOR: %u cycles/switch",
+                eager_cycles / FPU_BENCH_ITERATIONS);
+}
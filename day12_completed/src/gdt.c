@@ -0,0 +1,81 @@
+#include "gdt.h"
+
+#include "kernel.h"
+
+/*
+ * CPUごとのGDT/TSS
+ * 【方針】各CPUは同じフラットなコード/データセグメントを持ち、違いは
+ * per-CPU セグメント（GS）のベースと TSS だけ。GSのベースを自CPUの
+ * kernel_context_t に向けることで、LAPIC ID の読み出しなしに
+ * 1命令（mov %gs:0）で自CPUのコンテキストを得られる
+ */
+
+static gdt_entry_t cpu_gdt[MAX_CPUS][GDT_ENTRY_COUNT];
+static tss_t cpu_tss[MAX_CPUS];
+
+/*
+ * ディスクリプタ1つを設定
+ */
+static void gdt_set_entry(gdt_entry_t* entry, uint32_t base, uint32_t limit,
+                          uint8_t access, uint8_t flags) {
+    entry->limit_low = limit & MASK_LOW_WORD;
+    entry->base_low = base & MASK_LOW_WORD;
+    entry->base_mid = (base >> SHIFT_HIGH_WORD) & MASK_LOW_BYTE;
+    entry->access = access;
+    entry->granularity = flags | ((limit >> SHIFT_HIGH_WORD) & 0x0F);
+    entry->base_high = (base >> 24) & MASK_LOW_BYTE;
+}
+
+/*
+ * GDTをロードしてセグメントレジスタを再設定
+ * 【重要】CSは far jump でしか再ロードできない
+ */
+static void gdt_load(const gdt_ptr_t* ptr) {
+    asm volatile(
+        "lgdt %0\n\t"
+        "ljmp %1, $1f\n\t"
+        "1:\n\t"
+        "mov %2, %%ax\n\t"
+        "mov %%ax, %%ds\n\t"
+        "mov %%ax, %%es\n\t"
+        "mov %%ax, %%fs\n\t"
+        "mov %%ax, %%ss\n\t"
+        "mov %3, %%ax\n\t"
+        "mov %%ax, %%gs\n\t"
+        "mov %4, %%ax\n\t"
+        "ltr %%ax"
+        :
+        : "m"(*ptr), "i"(CODE_SEGMENT_SELECTOR), "i"(DATA_SEGMENT_SELECTOR),
+          "i"(PERCPU_SEGMENT_SELECTOR), "i"(TSS_SEGMENT_SELECTOR)
+        : "eax", "memory");
+}
+
+/*
+ * CPUごとのGDT/TSS初期化
+ * 【役割】BSP は kernel_main の最初に、AP は ap_main の最初に呼ぶ
+ * 【前提】percpu_base の先頭には自分自身へのポインタ（self）があること
+ */
+void gdt_init_cpu(uint32_t cpu, void* percpu_base, uint32_t percpu_size,
+                  uint32_t kernel_stack_top) {
+    gdt_entry_t* gdt = cpu_gdt[cpu];
+    tss_t* tss = &cpu_tss[cpu];
+
+    tss->ss0 = DATA_SEGMENT_SELECTOR;
+    tss->esp0 = kernel_stack_top;
+    tss->iomap_base = sizeof(tss_t);  // I/O許可ビットマップなし
+
+    gdt_set_entry(&gdt[0], 0, 0, 0, 0);
+    gdt_set_entry(&gdt[GDT_INDEX_CODE], 0, GDT_FLAT_LIMIT, GDT_ACCESS_CODE,
+                  GDT_FLAGS_4KB_32BIT);
+    gdt_set_entry(&gdt[GDT_INDEX_DATA], 0, GDT_FLAT_LIMIT, GDT_ACCESS_DATA,
+                  GDT_FLAGS_4KB_32BIT);
+    gdt_set_entry(&gdt[GDT_INDEX_PERCPU], (uint32_t)percpu_base,
+                  percpu_size - 1, GDT_ACCESS_DATA, GDT_FLAGS_BYTE_32BIT);
+    gdt_set_entry(&gdt[GDT_INDEX_TSS], (uint32_t)tss, sizeof(tss_t) - 1,
+                  GDT_ACCESS_TSS, 0);
+
+    gdt_ptr_t ptr;
+    ptr.limit = sizeof(cpu_gdt[cpu]) - 1;
+    ptr.base = (uint32_t)gdt;
+    gdt_load(&ptr);
+}
@@ -0,0 +1,227 @@
+#include "hrtimer.h"
+
+#include "clock.h"
+#include "irq.h"
+#include "kernel.h"
+#include "lapic.h"
+#include "sync.h"
+
+/*
+ * 高分解能タイマー
+ * 【構造】CPUごとの最小ヒープ（期限の早い順）。追加・削除は O(log n)、
+ * 次の期限の参照は O(1)
+ */
+
+typedef struct {
+    spinlock_t lock;
+    hrtimer_t* heap[HRTIMER_MAX_PER_CPU];
+    uint32_t count;
+} hrtimer_base_t;
+
+static hrtimer_base_t hrtimer_bases[MAX_CPUS];
+
+static inline hrtimer_base_t* hrtimer_this_base(void) {
+    return &hrtimer_bases[get_kernel_context()->cpu_id];
+}
+
+/*
+ * =================================================================================
+ * 最小ヒープ操作（base->lock 保持で呼ぶ）
+ * =================================================================================
+ */
+
+static inline void heap_set(hrtimer_base_t* base, uint32_t index,
+                            hrtimer_t* timer) {
+    base->heap[index] = timer;
+    timer->heap_index = (int32_t)index;
+}
+
+static void heap_sift_up(hrtimer_base_t* base, uint32_t index) {
+    hrtimer_t* timer = base->heap[index];
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (base->heap[parent]->expires_ns <= timer->expires_ns) {
+            break;
+        }
+        heap_set(base, index, base->heap[parent]);
+        index = parent;
+    }
+    heap_set(base, index, timer);
+}
+
+static void heap_sift_down(hrtimer_base_t* base, uint32_t index) {
+    hrtimer_t* timer = base->heap[index];
+    while (1) {
+        uint32_t child = index * 2 + 1;
+        if (child >= base->count) {
+            break;
+        }
+        if (child + 1 < base->count &&
+            base->heap[child + 1]->expires_ns < base->heap[child]->expires_ns) {
+            child++;
+        }
+        if (timer->expires_ns <= base->heap[child]->expires_ns) {
+            break;
+        }
+        heap_set(base, index, base->heap[child]);
+        index = child;
+    }
+    heap_set(base, index, timer);
+}
+
+static void heap_remove(hrtimer_base_t* base, hrtimer_t* timer) {
+    uint32_t index = (uint32_t)timer->heap_index;
+    hrtimer_t* last = base->heap[--base->count];
+    timer->heap_index = HRTIMER_INACTIVE;
+
+    if (index < base->count) {
+        // 末尾の要素を空いた位置へ移し、上下どちらかへ整える
+        heap_set(base, index, last);
+        heap_sift_up(base, index);
+        heap_sift_down(base, (uint32_t)last->heap_index);
+    }
+}
+
+/*
+ * =================================================================================
+ * 公開API
+ * =================================================================================
+ */
+
+void hrtimer_init(hrtimer_t* timer, hrtimer_callback_t callback, void* data) {
+    timer->expires_ns = 0;
+    timer->callback = callback;
+    timer->data = data;
+    timer->heap_index = HRTIMER_INACTIVE;
+    timer->cpu = 0;
+}
+
+bool hrtimer_is_active(const hrtimer_t* timer) {
+    return timer->heap_index != HRTIMER_INACTIVE;
+}
+
+/*
+ * タイマーの停止
+ * 【戻り値】キューから外した場合はtrue（既に発火済み・停止中ならfalse）
+ * 【備考】他CPUで開始したタイマーも停止できる。発火中のコールバックは待たない
+ */
+bool hrtimer_cancel(hrtimer_t* timer) {
+    hrtimer_base_t* base = &hrtimer_bases[timer->cpu];
+    uint32_t flags = spin_lock_irqsave(&base->lock);
+
+    bool active = hrtimer_is_active(timer) &&
+                  base->heap[timer->heap_index] == timer;
+    if (active) {
+        heap_remove(base, timer);
+    }
+
+    spin_unlock_irqrestore(&base->lock, flags);
+    return active;
+}
+
+/*
+ * 絶対時刻でタイマーを開始
+ * 【役割】実行中CPUのヒープに入れ、先頭になったらハードウェアタイマーを設定し直す
+ * 【戻り値】ヒープが満杯なら OS_ERROR_BUFFER_OVERFLOW
+ */
+os_result_t hrtimer_start_abs(hrtimer_t* timer, uint64_t expires_ns) {
+    if (!timer || !timer->callback) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    hrtimer_cancel(timer);
+
+    uint32_t flags = irq_save();
+    irqoff_trace_begin(IRQOFF_SITE_HRTIMER, flags);
+    hrtimer_base_t* base = hrtimer_this_base();
+    spin_lock(&base->lock);
+    if (base->count >= HRTIMER_MAX_PER_CPU) {
+        spin_unlock(&base->lock);
+        irqoff_trace_end(flags);
+        irq_restore(flags);
+        return OS_ERROR_BUFFER_OVERFLOW;
+    }
+
+    timer->expires_ns = expires_ns;
+    timer->cpu = get_kernel_context()->cpu_id;
+    base->heap[base->count] = timer;
+    heap_sift_up(base, base->count++);
+    bool earliest = base->heap[0] == timer;
+    spin_unlock(&base->lock);
+
+    if (earliest) {
+        lapic_timer_update_event();
+    }
+    irqoff_trace_end(flags);
+    irq_restore(flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * 相対時間でタイマーを開始
+ */
+os_result_t hrtimer_start(hrtimer_t* timer, uint64_t delay_ns) {
+    return hrtimer_start_abs(timer, clock_get_time_ns() + delay_ns);
+}
+
+/*
+ * 実行中CPUで最も早い期限
+ * 【戻り値】有効なタイマーがなければ CLOCK_TIME_NEVER
+ */
+uint64_t hrtimer_next_expiry_ns(void) {
+    hrtimer_base_t* base = hrtimer_this_base();
+    uint32_t flags = spin_lock_irqsave(&base->lock);
+    uint64_t next = base->count ? base->heap[0]->expires_ns : CLOCK_TIME_NEVER;
+    spin_unlock_irqrestore(&base->lock, flags);
+    return next;
+}
+
+/*
+ * 期限に達したタイマーのコールバックを呼ぶ
+ * 【前提】タイマー割り込みハンドラから（割り込み禁止で）呼ぶ
+ * 【備考】コールバック中は base->lock を解放しているため、
+ * コールバック内で自分自身を再開始（周期タイマー）できる
+ */
+void hrtimer_run_expired(void) {
+    hrtimer_base_t* base = hrtimer_this_base();
+    uint64_t now = clock_get_time_ns();
+
+    spin_lock(&base->lock);
+    while (base->count && base->heap[0]->expires_ns <= now) {
+        hrtimer_t* timer = base->heap[0];
+        heap_remove(base, timer);
+        spin_unlock(&base->lock);
+
+        timer->callback(timer);
+
+        spin_lock(&base->lock);
+    }
+    spin_unlock(&base->lock);
+}
+
+/*
+ * =================================================================================
+ * ベンチマーク
+ * =================================================================================
+ * sleep_ns(100µs) を繰り返し、要求時間に対する起床の遅れを計測する。
+ * PIT のみの構成では次のティック（最大10ms）まで遅れるため、差がそのまま見える
+ */
+void hrtimer_benchmark(void) {
+    uint64_t total_late = 0;
+    uint64_t max_late = 0;
+
+    for (int i = 0; i < HRTIMER_BENCH_ITERATIONS; i++) {
+        uint64_t start = clock_get_time_ns();
+        sleep_ns(HRTIMER_BENCH_SLEEP_NS);
+        uint64_t late = clock_get_time_ns() - start - HRTIMER_BENCH_SLEEP_NS;
+        total_late += late;
+        if (late > max_late) {
+            max_late = late;
+        }
+    }
+
+    debug_print("HRTIMER BENCH: sleep_ns(%u) late by avg %u ns, max %u ns",
+                (uint32_t)HRTIMER_BENCH_SLEEP_NS,
+                (uint32_t)(total_late / HRTIMER_BENCH_ITERATIONS),
+                (uint32_t)max_late);
+}
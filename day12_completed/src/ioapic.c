@@ -0,0 +1,110 @@
+#include "ioapic.h"
+
+#include "acpi.h"
+#include "kernel.h"
+
+/*
+ * I/O APIC ドライバ
+ * 【前提】acpi_detect_platform() が I/O APIC を見つけていること。
+ * 割り込みを配送するのは最初の1つだけで、GSI がその範囲外の IRQ は扱わない
+ */
+
+static volatile uint32_t* ioapic_base = NULL;
+static uint32_t ioapic_gsi_base = 0;
+static uint32_t ioapic_entry_count = 0;
+
+static inline uint32_t ioapic_read(uint32_t reg) {
+    ioapic_base[IOAPIC_REG_SELECT / sizeof(uint32_t)] = reg;
+    return ioapic_base[IOAPIC_REG_WINDOW / sizeof(uint32_t)];
+}
+
+static inline void ioapic_write(uint32_t reg, uint32_t value) {
+    ioapic_base[IOAPIC_REG_SELECT / sizeof(uint32_t)] = reg;
+    ioapic_base[IOAPIC_REG_WINDOW / sizeof(uint32_t)] = value;
+}
+
+/*
+ * ISA IRQ に対応するリダイレクションエントリ番号
+ * 【戻り値】この I/O APIC の範囲外なら -1
+ */
+static int ioapic_entry_for_irq(uint8_t irq) {
+    if (!ioapic_base || irq >= ISA_IRQ_COUNT) {
+        return -1;
+    }
+    uint32_t gsi = acpi_get_platform()->irq_to_gsi[irq];
+    if (gsi < ioapic_gsi_base || gsi - ioapic_gsi_base >= ioapic_entry_count) {
+        return -1;
+    }
+    return (int)(gsi - ioapic_gsi_base);
+}
+
+static inline uint32_t ioapic_redirection_low(int entry) {
+    return IOAPIC_REG_REDIRECTION + (uint32_t)entry * 2;
+}
+
+/*
+ * I/O APIC 初期化
+ * 【戻り値】I/O APIC がなければ OS_ERROR_NOT_FOUND（PIC を使い続ける）
+ */
+os_result_t ioapic_init(void) {
+    const platform_info_t* info = acpi_get_platform();
+    if (!info->has_ioapic) {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    ioapic_base = (volatile uint32_t*)info->ioapic_base;
+    ioapic_gsi_base = info->ioapic_gsi_base;
+    ioapic_entry_count =
+        ((ioapic_read(IOAPIC_REG_VERSION) >> IOAPIC_VERSION_MAX_ENTRY_SHIFT) &
+         MASK_LOW_BYTE) +
+        1;
+
+    for (uint32_t i = 0; i < ioapic_entry_count; i++) {
+        ioapic_write(ioapic_redirection_low((int)i), IOAPIC_REDIR_MASKED);
+    }
+    debug_print("IOAPIC: %u redirection entries, all masked",
+                ioapic_entry_count);
+    return OS_SUCCESS;
+}
+
+/*
+ * ISA IRQ を指定ベクタ・指定CPUへ配送するよう設定
+ * 【備考】極性・トリガは MADT の上書きに従い、指定がなければ ISA 既定
+ * （アクティブハイ・エッジ）。有効化は ioapic_unmask_irq() で行う
+ */
+os_result_t ioapic_route_irq(uint8_t irq, uint8_t vector, uint8_t lapic_id) {
+    int entry = ioapic_entry_for_irq(irq);
+    if (entry < 0) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint16_t flags = acpi_get_platform()->irq_flags[irq];
+    uint32_t low = IOAPIC_REDIR_MASKED | vector;
+    if ((flags & MPS_INTI_POLARITY_MASK) == MPS_INTI_ACTIVE_LOW) {
+        low |= IOAPIC_REDIR_ACTIVE_LOW;
+    }
+    if ((flags & MPS_INTI_TRIGGER_MASK) == MPS_INTI_LEVEL) {
+        low |= IOAPIC_REDIR_LEVEL;
+    }
+
+    ioapic_write(ioapic_redirection_low(entry) + 1,
+                 (uint32_t)lapic_id << IOAPIC_REDIR_DEST_SHIFT);
+    ioapic_write(ioapic_redirection_low(entry), low);
+    return OS_SUCCESS;
+}
+
+void ioapic_mask_irq(uint8_t irq) {
+    int entry = ioapic_entry_for_irq(irq);
+    if (entry >= 0) {
+        uint32_t reg = ioapic_redirection_low(entry);
+        ioapic_write(reg, ioapic_read(reg) | IOAPIC_REDIR_MASKED);
+    }
+}
+
+void ioapic_unmask_irq(uint8_t irq) {
+    int entry = ioapic_entry_for_irq(irq);
+    if (entry >= 0) {
+        uint32_t reg = ioapic_redirection_low(entry);
+        ioapic_write(reg, ioapic_read(reg) & ~IOAPIC_REDIR_MASKED);
+    }
+}
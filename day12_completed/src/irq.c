@@ -0,0 +1,555 @@
+#include "irq.h"
+
+#include "clock.h"
+#include "ioapic.h"
+#include "kernel.h"
+#include "lapic.h"
+#include "softirq.h"
+#include "sync.h"
+#include "trace.h"
+
+/*
+ * 割り込みの振り分け
+ * 【構造】IRQ ラインごとにハンドラの単方向リスト（登録順）を持つ。
+ * リストの節点は固定長のプールから確保し、解放はしない。
+ * 統計はベクタごと・CPUごとに持ち、表示時に合計する
+ */
+
+typedef struct irq_action {
+    struct irq_action* next;
+    irq_handler_t handler;
+    void* ctx;
+} irq_action_t;
+
+static irq_action_t irq_action_pool[IRQ_MAX_ACTIONS];
+static uint32_t irq_action_used;
+static irq_action_t* volatile irq_actions[IRQ_LINES];  // ラインごとの先頭
+static uint32_t irq_unhandled[IRQ_LINES];  // どのハンドラも処理しなかった回数
+static uint32_t irq_spurious[IRQ_LINES];   // PIC のスプリアス割り込み（IRQ7/15）
+static spinlock_t irq_lock;                // 登録とマスク操作の排他
+
+static uint16_t irq_ioapic_routed;  // I/O APIC に配送先を設定したライン
+
+static irq_vector_stats_t irq_stats[MAX_CPUS][IDT_VECTORS];
+
+#ifdef IRQ_LATENCY_TRACE
+/*
+ * 割り込み禁止区間の統計（CPUごと・呼び出し箇所ごと）
+ */
+typedef struct {
+    uint64_t start_tsc;  // 0 なら区間外
+    irqoff_site_t site;
+    irq_vector_stats_t sites[IRQOFF_SITE_COUNT];
+} irqoff_cpu_t;
+
+static irqoff_cpu_t irqoff_cpus[MAX_CPUS];
+
+// ヒストグラムは全CPU共通（複数CPUで受けるベクタがあるため atomic_inc で加算）
+static volatile uint32_t irq_hist[IDT_VECTORS][IRQ_HIST_BUCKETS];
+static volatile uint32_t timer_late_hist[IRQ_HIST_BUCKETS];
+static irq_vector_stats_t timer_late[MAX_CPUS];  // タイマーの遅れ（サイクル）
+
+static const char* const irqoff_site_names[IRQOFF_SITE_COUNT] = {
+    "割り込みハンドラ",     "schedule",
+    "thread_yield",         "block_current_thread",
+    "起床処理",             "hrtimer_start",
+    "keyboard_deliver_char",
+};
+#endif
+
+static const char* const exception_names[EXCEPTION_VECTORS] = {
+    "#DE Divide Error",
+    "#DB Debug",
+    "NMI",
+    "#BP Breakpoint",
+    "#OF Overflow",
+    "#BR BOUND Range Exceeded",
+    "#UD Invalid Opcode",
+    "#NM Device Not Available",
+    "#DF Double Fault",
+    "Coprocessor Segment Overrun",
+    "#TS Invalid TSS",
+    "#NP Segment Not Present",
+    "#SS Stack-Segment Fault",
+    "#GP General Protection",
+    "#PF Page Fault",
+    "Reserved",
+    "#MF x87 Floating-Point",
+    "#AC Alignment Check",
+    "#MC Machine Check",
+    "#XM SIMD Floating-Point",
+    "#VE Virtualization",
+    "#CP Control Protection",
+};
+
+/*
+ * =================================================================================
+ * 初期化と登録
+ * =================================================================================
+ */
+
+/*
+ * IDT の全エントリを共通入口に向ける
+ * 【備考】専用入口を使うベクタ（#NM、Local APIC タイマーなど）は、
+ * この後の各モジュールの初期化で set_idt_gate() により上書きされる
+ */
+void irq_init(void) {
+    for (int vector = 0; vector < IDT_VECTORS; vector++) {
+        set_idt_gate(vector, isr_stub_table[vector]);
+    }
+    debug_print("IRQ: %u vectors routed to common entry", IDT_VECTORS);
+}
+
+/*
+ * PIC のマスク解除
+ * 【備考】スレーブ側のラインはマスターのカスケード（IRQ2）も解除する
+ */
+static void irq_pic_unmask(uint8_t irq) {
+    if (irq >= IRQ_SLAVE_PIC_BASE) {
+        uint8_t bit = (uint8_t)(1u << (irq - IRQ_SLAVE_PIC_BASE));
+        outb(PIC_SLAVE_DATA, inb(PIC_SLAVE_DATA) & (uint8_t)~bit);
+        irq = IRQ_CASCADE;
+    }
+    outb(PIC_MASTER_DATA, inb(PIC_MASTER_DATA) & (uint8_t)~(1u << irq));
+}
+
+/*
+ * IRQ ラインのマスク解除（現在の配送経路に合わせる）
+ * 【前提】irq_lock 保持で呼ぶ
+ */
+static void irq_unmask_line(uint8_t irq) {
+    if (!apic_interrupts_enabled()) {
+        irq_pic_unmask(irq);
+    } else if (irq_ioapic_routed & (1u << irq)) {
+        ioapic_unmask_irq(irq);
+    }
+}
+
+/*
+ * IRQ ハンドラの登録
+ * 【役割】ラインのリストの末尾に追加する。同じラインに複数登録すると共有IRQになり、
+ * 割り込みのたびに登録順に全ハンドラが呼ばれる
+ * 【重要】節点を書き終えてからリストにつなぐため、他CPUが振り分け中でも安全
+ * 【戻り値】プールが尽きたら OS_ERROR_OUT_OF_MEMORY
+ */
+os_result_t irq_register(uint8_t irq, irq_handler_t handler, void* ctx) {
+    if (!handler) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (irq >= IRQ_LINES || irq == IRQ_CASCADE) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    if (irq_action_used >= IRQ_MAX_ACTIONS) {
+        spin_unlock_irqrestore(&irq_lock, flags);
+        debug_print("IRQ: Maximum number of handlers exceeded");
+        return OS_ERROR_OUT_OF_MEMORY;
+    }
+
+    irq_action_t* action = &irq_action_pool[irq_action_used++];
+    action->next = NULL;
+    action->handler = handler;
+    action->ctx = ctx;
+
+    irq_action_t* volatile* link = &irq_actions[irq];
+    while (*link) {
+        link = &(*link)->next;
+    }
+    bool first = link == &irq_actions[irq];
+    *link = action;
+
+    if (first) {
+        irq_unmask_line(irq);
+    }
+    spin_unlock_irqrestore(&irq_lock, flags);
+
+    debug_print("IRQ: handler registered for IRQ%u%s", irq,
+                first ? "" : " (shared)");
+    return OS_SUCCESS;
+}
+
+/*
+ * I/O APIC への配送先設定
+ * 【役割】ISA IRQ1〜15 をベクタ 32 + n で lapic_id へ配送するよう設定する（マスクしたまま）
+ * 【備考】IRQ0（PIT）は Local APIC タイマーに置き換えるため、route_timer
+ * （Local APIC タイマーを開始できなかった時）の場合だけ設定する
+ * 【戻り値】ハンドラ登録済みのラインの設定に失敗したらそのエラー
+ */
+os_result_t irq_route_to_ioapic(uint8_t lapic_id, bool route_timer) {
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    os_result_t result = OS_SUCCESS;
+    for (uint8_t irq = route_timer ? IRQ_TIMER : IRQ_TIMER + 1; irq < IRQ_LINES;
+         irq++) {
+        if (irq == IRQ_CASCADE) {
+            continue;
+        }
+        if (OS_SUCCESS_CHECK(
+                ioapic_route_irq(irq, IRQ_VECTOR_BASE + irq, lapic_id))) {
+            irq_ioapic_routed |= (uint16_t)(1u << irq);
+        } else if (irq_actions[irq]) {
+            result = OS_ERROR_INVALID_PARAMETER;
+        }
+    }
+    spin_unlock_irqrestore(&irq_lock, flags);
+    return result;
+}
+
+/*
+ * ハンドラ登録済みのラインをすべてマスク解除する（配送経路の切り替え後）
+ */
+void irq_unmask_registered(void) {
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    for (uint8_t irq = 0; irq < IRQ_LINES; irq++) {
+        if (irq_actions[irq]) {
+            irq_unmask_line(irq);
+        }
+    }
+    spin_unlock_irqrestore(&irq_lock, flags);
+}
+
+/*
+ * =================================================================================
+ * 振り分け
+ * =================================================================================
+ */
+
+/*
+ * CPU 例外
+ * 【役割】例外名とレジスタを表示する。#BP・NMI 以外は回復できないため、このCPUを止める
+ */
+static void exception_handler(interrupt_frame_t* frame) {
+    uint32_t vector = frame->vector;
+    const char* name =
+        exception_names[vector] ? exception_names[vector] : "Reserved";
+    debug_print("EXCEPTION: %s (vector %u) on CPU %u", name, vector,
+                get_kernel_context()->cpu_id);
+    debug_print("  error=0x%x eip=0x%x cs=0x%x eflags=0x%x", frame->error_code,
+                frame->eip, frame->cs, frame->eflags);
+    if (vector == EXCEPTION_PAGE_FAULT) {
+        uint32_t cr2;
+        asm volatile("mov %%cr2, %0" : "=r"(cr2));
+        debug_print("  cr2=0x%x", cr2);
+    }
+
+    if (vector == EXCEPTION_NMI || vector == EXCEPTION_BREAKPOINT) {
+        return;
+    }
+    debug_print("EXCEPTION: CPU halted");
+    while (1) {
+        asm volatile("cli; hlt");
+    }
+}
+
+/*
+ * PIC のスプリアス割り込みの判定
+ * 【役割】要求が消えた後に PIC が出す IRQ7/IRQ15 は、ISR の該当ビットが
+ * 立っていない（実際には処理中でない）ことで見分ける
+ * 【重要】スプリアスに EOI を送ると、処理中の優先度の低い別の IRQ を
+ * 誤って完了させてしまう。IRQ15 の場合、マスター側はカスケード（IRQ2）を
+ * 本当に受け付けているため、マスターにだけ EOI を送る
+ */
+static bool irq_pic_spurious(uint8_t irq) {
+    if (apic_interrupts_enabled() ||
+        (irq != IRQ_PIC_SPURIOUS_MASTER && irq != IRQ_PIC_SPURIOUS_SLAVE)) {
+        return false;
+    }
+    uint16_t port = irq >= IRQ_SLAVE_PIC_BASE ? PIC_SLAVE_COMMAND
+                                              : PIC_MASTER_COMMAND;
+    outb(port, PIC_OCW3_READ_ISR);
+    uint8_t isr = inb(port);
+    outb(port, PIC_OCW3_READ_IRR);  // 既定の読み出し先に戻す
+    return !(isr & (1u << (irq % IRQ_SLAVE_PIC_BASE)));
+}
+
+/*
+ * ISA IRQ の振り分け
+ * 【役割】登録順に全ハンドラを呼び、EOI を送り、後半処理を実行してから再スケジュールする
+ * 【備考】どのハンドラも処理しなかった割り込みは数えるだけ。PIC のスプリアス
+ * 割り込みはハンドラを呼ばず、EOI も送らない（irq_pic_spurious）
+ */
+static void irq_dispatch_line(uint8_t irq) {
+    if (irq_pic_spurious(irq)) {
+        irq_spurious[irq]++;
+        if (irq == IRQ_PIC_SPURIOUS_SLAVE) {
+            outb(PIC_MASTER_COMMAND, PIC_EOI);
+        }
+        return;
+    }
+
+    bool handled = false;
+    for (irq_action_t* action = irq_actions[irq]; action;
+         action = action->next) {
+        handled |= action->handler(action->ctx);
+    }
+    if (!handled) {
+        irq_unhandled[irq]++;
+    }
+    irq_send_eoi(irq);
+}
+
+/*
+ * 共通入口の振り分け本体（C言語部分）
+ * 【重要】interrupt.s の interrupt_common_entry から割り込み禁止で呼ばれる。
+ * schedule() で別スレッドへ切り替わった場合、このフレームは戻ってきた時に iret される
+ */
+void interrupt_dispatch_c(interrupt_frame_t* frame) {
+    uint64_t enter_tsc = irq_enter();
+    uint8_t vector = (uint8_t)frame->vector;
+
+    if (vector < EXCEPTION_VECTORS) {
+        irq_account(vector, enter_tsc);
+        exception_handler(frame);
+        return;
+    }
+
+    if (vector < IRQ_VECTOR_BASE + IRQ_LINES) {
+        irq_dispatch_line(vector - IRQ_VECTOR_BASE);
+        irq_exit(vector, enter_tsc);
+        schedule();
+        return;
+    }
+
+    // 専用入口のないベクタ（Local APIC から届いた場合に備えて EOI を送る）
+    if (lapic_is_available()) {
+        lapic_eoi();
+    }
+    irq_account(vector, enter_tsc);
+}
+
+/*
+ * =================================================================================
+ * 統計
+ * =================================================================================
+ */
+
+static void irq_stats_add(irq_vector_stats_t* stats, uint32_t cycles) {
+    stats->count++;
+    stats->total_cycles += cycles;
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+}
+
+#ifdef IRQ_LATENCY_TRACE
+/*
+ * サイクル数からヒストグラムの区間を求める（µs 単位の2のべき乗）
+ */
+static uint32_t irq_hist_bucket(uint32_t cycles) {
+    uint32_t cycles_per_us = clock_get_tsc_khz() / 1000;
+    uint32_t us = cycles_per_us ? cycles / cycles_per_us : 0;
+    if (us == 0) {
+        return 0;
+    }
+    uint32_t bucket = 32 - (uint32_t)__builtin_clz(us);  // 1 + floor(log2(us))
+    return bucket < IRQ_HIST_BUCKETS ? bucket : IRQ_HIST_BUCKETS - 1;
+}
+
+/*
+ * 割り込み禁止区間の開始
+ * 【役割】flags の IF が立っていれば（＝この箇所で禁止にした）開始時刻を記録する。
+ * 既に禁止だった場合は外側の区間の一部なので何もしない
+ */
+void irqoff_trace_begin(irqoff_site_t site, uint32_t flags) {
+    if (!(flags & EFLAGS_IF)) {
+        return;
+    }
+    irqoff_cpu_t* cpu = &irqoff_cpus[get_kernel_context()->cpu_id];
+    cpu->site = site;
+    cpu->start_tsc = rdtsc();
+}
+
+/*
+ * 割り込み禁止区間の終了
+ * 【役割】flags の IF が立っていれば（＝この後で有効に戻る）区間の長さを
+ * 開始した箇所の統計に加える
+ * 【備考】iret で有効に戻った区間は記録されずに残るが、次の開始で上書きされる
+ */
+void irqoff_trace_end(uint32_t flags) {
+    if (!(flags & EFLAGS_IF)) {
+        return;
+    }
+    irqoff_cpu_t* cpu = &irqoff_cpus[get_kernel_context()->cpu_id];
+    if (!cpu->start_tsc) {
+        return;
+    }
+    uint32_t cycles = (uint32_t)(rdtsc() - cpu->start_tsc);
+    cpu->start_tsc = 0;
+    irq_stats_add(&cpu->sites[cpu->site], cycles);
+}
+
+/*
+ * Local APIC タイマーの遅れの記録
+ * 【役割】設定した期限（TSC）から割り込みの入口までの時間を記録する
+ * （期限より前に入った場合は記録しない）
+ */
+void irq_trace_timer_late(uint64_t enter_tsc, uint64_t deadline_tsc) {
+    if (!deadline_tsc || enter_tsc < deadline_tsc) {
+        return;
+    }
+    uint32_t cycles = (uint32_t)(enter_tsc - deadline_tsc);
+    irq_stats_add(&timer_late[get_kernel_context()->cpu_id], cycles);
+    atomic_inc(&timer_late_hist[irq_hist_bucket(cycles)]);
+}
+#endif
+
+/*
+ * ベクタの受信回数と処理時間の記録
+ * 【前提】割り込み禁止で呼ぶ（CPUごとの統計を更新する）
+ */
+void irq_account(uint8_t vector, uint64_t enter_tsc) {
+    uint32_t cycles = (uint32_t)(rdtsc() - enter_tsc);
+    irq_stats_add(&irq_stats[get_kernel_context()->cpu_id][vector], cycles);
+#ifdef IRQ_LATENCY_TRACE
+    atomic_inc(&irq_hist[vector][irq_hist_bucket(cycles)]);
+#endif
+    trace_event(TRACE_EV_IRQ, vector, cycles);
+}
+
+/*
+ * ベクタの統計（全CPUの合計）
+ */
+void irq_get_vector_stats(uint8_t vector, irq_vector_stats_t* out) {
+    out->count = 0;
+    out->total_cycles = 0;
+    out->max_cycles = 0;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        const irq_vector_stats_t* stats = &irq_stats[cpu][vector];
+        out->count += stats->count;
+        out->total_cycles += stats->total_cycles;
+        if (stats->max_cycles > out->max_cycles) {
+            out->max_cycles = stats->max_cycles;
+        }
+    }
+}
+
+#ifdef IRQ_LATENCY_TRACE
+/*
+ * ヒストグラム1本の表示（0 の区間は省く）
+ * 例: "    hist: <1us 120, 1us 3, 4us 1"（各区間の下限）
+ */
+static void irq_print_hist(const volatile uint32_t* hist) {
+    char line[160] = "    hist:";
+    int len = 9;
+    for (uint32_t bucket = 0; bucket < IRQ_HIST_BUCKETS; bucket++) {
+        if (!hist[bucket] || len > (int)sizeof(line) - 24) {
+            continue;
+        }
+        char num[12];
+        line[len++] = ' ';
+        if (bucket == 0) {
+            line[len++] = '<';
+            num[0] = '1';
+            num[1] = 0;
+        } else {
+            itoa(1u << (bucket - 1), num, 10);
+        }
+        for (char* p = num; *p; p++) {
+            line[len++] = *p;
+        }
+        line[len++] = 'u';
+        line[len++] = 's';
+        if (bucket == IRQ_HIST_BUCKETS - 1) {
+            line[len++] = '+';
+        }
+        line[len++] = ' ';
+        itoa(hist[bucket], num, 10);
+        for (char* p = num; *p; p++) {
+            line[len++] = *p;
+        }
+        line[len++] = ',';
+    }
+    line[len - 1] = 0;  // 末尾の ',' を消す
+    debug_print("%s", line);
+}
+
+/*
+ * 計測モードの統計（タイマーの遅れと割り込み禁止区間）
+ */
+static void irq_print_trace(void) {
+    irq_vector_stats_t late = {0, 0, 0};
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        late.count += timer_late[cpu].count;
+        late.total_cycles += timer_late[cpu].total_cycles;
+        if (timer_late[cpu].max_cycles > late.max_cycles) {
+            late.max_cycles = timer_late[cpu].max_cycles;
+        }
+    }
+    if (late.count) {
+        debug_print("Local APIC タイマーの遅れ: %u 回, avg %u ns / max %u ns",
+                    late.count,
+                    (uint32_t)clock_cycles_to_ns(late.total_cycles / late.count),
+                    (uint32_t)clock_cycles_to_ns(late.max_cycles));
+        irq_print_hist(timer_late_hist);
+    }
+
+    debug_print("割り込み禁止区間（開始箇所別）:");
+    for (int site = 0; site < IRQOFF_SITE_COUNT; site++) {
+        irq_vector_stats_t sum = {0, 0, 0};
+        for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+            const irq_vector_stats_t* stats = &irqoff_cpus[cpu].sites[site];
+            sum.count += stats->count;
+            sum.total_cycles += stats->total_cycles;
+            if (stats->max_cycles > sum.max_cycles) {
+                sum.max_cycles = stats->max_cycles;
+            }
+        }
+        if (sum.count) {
+            debug_print("  %s: %u 回, avg %u ns / max %u ns",
+                        irqoff_site_names[site], sum.count,
+                        (uint32_t)clock_cycles_to_ns(sum.total_cycles / sum.count),
+                        (uint32_t)clock_cycles_to_ns(sum.max_cycles));
+        }
+    }
+}
+#endif
+
+/*
+ * 統計の表示（debug_command_interrupts から呼ばれる）
+ * 【備考】計測モード（IRQTRACE=1）ではベクタごとの時間のヒストグラム、
+ * タイマーの遅れ、割り込み禁止区間も表示する
+ */
+void irq_print_stats(void) {
+    uint32_t total = 0;
+    for (int vector = 0; vector < IDT_VECTORS; vector++) {
+        irq_vector_stats_t stats;
+        irq_get_vector_stats((uint8_t)vector, &stats);
+        total += stats.count;
+    }
+    uint32_t uptime_s = (uint32_t)(clock_get_time_us() / 1000000);
+    debug_print("総割り込み回数: %u（%u 回/秒）", total,
+                uptime_s ? total / uptime_s : total);
+
+    debug_print("ベクタ別（入口〜出口, TSC サイクル）:");
+    for (int vector = 0; vector < IDT_VECTORS; vector++) {
+        irq_vector_stats_t stats;
+        irq_get_vector_stats((uint8_t)vector, &stats);
+        if (!stats.count) {
+            continue;
+        }
+        debug_print("  vec %u: %u 回, avg %u / max %u", vector, stats.count,
+                    (uint32_t)(stats.total_cycles / stats.count),
+                    stats.max_cycles);
+#ifdef IRQ_LATENCY_TRACE
+        irq_print_hist(irq_hist[vector]);
+#endif
+    }
+
+    for (uint8_t irq = 0; irq < IRQ_LINES; irq++) {
+        uint32_t handlers = 0;
+        for (irq_action_t* action = irq_actions[irq]; action;
+             action = action->next) {
+            handlers++;
+        }
+        if (handlers || irq_unhandled[irq] || irq_spurious[irq]) {
+            debug_print("  IRQ%u: ハンドラ %u, 未処理 %u, スプリアス %u", irq,
+                        handlers, irq_unhandled[irq], irq_spurious[irq]);
+        }
+    }
+
+#ifdef IRQ_LATENCY_TRACE
+    irq_print_trace();
+#else
+    debug_print("（遅れ・割り込み禁止区間の計測は make IRQTRACE=1 で有効）");
+#endif
+}
@@ -2,18 +2,48 @@
 
 #include <stdarg.h>
 
+#include "benchmark.h"
+#include "clock.h"
+#include "debug_utils.h"
 #include "error_types.h"
+#include "gdt.h"
+#include "ioapic.h"
+#include "irq.h"
 #include "keyboard.h"
+#include "lapic.h"
+#include "periodic.h"
+#include "serial.h"
+#include "smp.h"
+#include "softirq.h"
+#include "sync.h"
+#include "trace.h"
+#include "vbe.h"
+#include "vga.h"
+
+// CPUごとのカーネルコンテキスト（GSセグメントのベース）
+static kernel_context_t cpu_contexts[MAX_CPUS];
 
-// 新しい静的コンテキストインスタンス
-static kernel_context_t k_context;
+/*
+ * 全CPU共通のスケジューラ状態
+ * 【重要】sched_lock は全CPUのREADYリング・ブロックリスト・スレッドプールを守る。
+ * context_switch はこのロックを保持したまま呼び、切り替え先（再開したスレッド、
+ * または新規スレッドの schedule_tail）が解放する
+ */
+static spinlock_t sched_lock;
+static thread_t* blocked_thread_list;    // ブロックされたスレッドのリスト
+static volatile uint32_t system_ticks;   // システム起動からの経過ティック数
 
-// その他の静的グローバル変数
-static uint16_t* vga_buffer = (uint16_t*)VGA_MEMORY;
+// スケジューリングクラスごとのクォンタム（µs、全CPU共通）
+static volatile uint32_t sched_quantum_us[SCHED_CLASS_COUNT] = {
+    SCHED_QUANTUM_DEFAULT_US, SCHED_QUANTUM_DEFAULT_US,
+    SCHED_QUANTUM_DEFAULT_US, SCHED_QUANTUM_DEFAULT_US};
 
-// VGAテキストモード表示管理（Day12互換）
-static uint16_t cx, cy;
-static uint8_t col = 0x0F;
+// 割り込み配送: true なら I/O APIC + Local APIC（EOI は MMIO）、false なら 8259 PIC
+static bool apic_irq_routing = false;
+
+// スレッドプール（TCBの静的確保領域）
+static thread_t thread_pool[MAX_THREADS];
+static int thread_pool_used = 0;  // 一度でも使用したスロット数
 
 // IDT関連の静的変数
 static struct idt_entry idt[256];  // 256個の割り込みエントリ
@@ -30,123 +60,24 @@ static struct idt_ptr idtr;        // IDTレジスタ用構造体
  */
 
 /*
- * Serial Port (for debugging)
- * 【役割】COM1ポートを初期化してデバッグ出力を可能にする
+ * Serial Port (for debugging) は serial.c（16550 UART ドライバ）で定義
  */
-void init_serial(void) {
-    outb(SERIAL_PORT_COM1 + 1, SERIAL_INT_DISABLE);  // 割り込み無効化
-    outb(SERIAL_PORT_COM1 + 3,
-         SERIAL_DLAB_ENABLE);  // DLAB有効化（ボーレート設定モード）
-    outb(SERIAL_PORT_COM1 + 0,
-         SERIAL_BAUD_38400_LOW);  // ボーレート下位: 38400 bps
-    outb(SERIAL_PORT_COM1 + 1,
-         SERIAL_BAUD_38400_HIGH);  // ボーレート上位: 38400 bps
-    outb(SERIAL_PORT_COM1 + 3,
-         SERIAL_8N1_CONFIG);  // 8bit, パリティなし, 1ストップビット
-    outb(SERIAL_PORT_COM1 + 2,
-         SERIAL_FIFO_ENABLE);  // FIFO有効化、クリア、14バイト閾値
-    outb(SERIAL_PORT_COM1 + 4, SERIAL_MODEM_READY);  // IRQ有効化、RTS/DSR設定
-}
 
 /*
- * 1文字をシリアルポートに送信する関数
- * 【役割】送信バッファが空になるのを待ってから1文字送信する
+ * VGA テキストモード表示（vga_* / clear_screen / clear_line / print_at）は
+ * vga.c（裏バッファとコンポジタ）で定義
  */
-void serial_write_char(char c) {
-    // 送信可能まで待機
-    while ((inb(SERIAL_PORT_COM1 + 5) & SERIAL_TRANSMIT_READY) == 0);
-    outb(SERIAL_PORT_COM1, c);
-}
 
 /*
- * 文字列をシリアルポートに送信する関数
- * 【役割】NULL終端文字まで文字列を1文字ずつ送信する
+ * 文字列の一致判定
+ * 【役割】NULL終端の2つの文字列が同じなら true（コマンド名・ベンチマーク名の照合）
  */
-void serial_write_string(const char* str) {
-    while (*str) {
-        serial_write_char(*str);
-        str++;
-    }
-}
-
-// ━━━ VGA テキストモード表示管理（Day12互換） ━━━
-// VGAエントリ作成：文字と属性を16bitに合成
-static inline uint16_t ve(char c, uint8_t a) {
-    return (uint16_t)c | ((uint16_t)a << 8);
-}
-
-// VGA文字色設定：前景色と背景色を指定
-void vga_set_color(vga_color_t f, vga_color_t b) {
-    col = (uint8_t)f | ((uint8_t)b << 4);
-}
-
-// VGAカーソル移動：画面上の指定位置にカーソルを移動
-void vga_move_cursor(uint16_t x, uint16_t y) {
-    cx = x;
-    cy = y;
-    // 線形位置計算（Y * 幅 + X）
-    uint16_t p = y * VGA_WIDTH + x;
-    // VGAコントローラーレジスタに位置設定
-    outb(0x3D4, 14);  // カーソル位置上位バイト
-    outb(0x3D5, (p >> 8) & 0xFF);
-    outb(0x3D4, 15);  // カーソル位置下位バイト
-    outb(0x3D5, p & 0xFF);
-}
-
-// VGA画面クリア：全画面を空白文字で埋めカーソルを左上に
-void vga_clear(void) {
-    for (uint16_t y = 0; y < VGA_HEIGHT; y++)
-        for (uint16_t x = 0; x < VGA_WIDTH; x++)
-            vga_buffer[y * VGA_WIDTH + x] = ve(' ', col);
-    vga_move_cursor(0, 0);
-}
-
-// VGA文字出力：1文字を現在のカーソル位置に表示
-void vga_putc(char c) {
-    if (c == '\n') {
-        // 改行文字の場合、次の行の先頭に移動
-        cx = 0;
-        cy++;
-        vga_move_cursor(cx, cy);
-        return;
-    }
-    // 指定位置に文字を書き込み
-    vga_buffer[cy * VGA_WIDTH + cx] = ve(c, col);
-    // カーソルを次の位置に進める（行末で改行）
-    if (++cx >= VGA_WIDTH) {
-        cx = 0;
-        cy++;
-    }
-    vga_move_cursor(cx, cy);
-}
-
-// VGA文字列出力：NULL終端文字列を順次表示
-void vga_puts(const char* s) {
-    while (*s) vga_putc(*s++);
-}
-
-// VGA数値出力：32bit整数を十進数文字列で表示
-void vga_putnum(uint32_t n) {
-    int i = 0;
-    if (n == 0) {
-        vga_putc('0');
-        return;
+bool str_equal(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
     }
-    uint32_t x = n;
-    char r[10];  // 数字文字一時格納用配列
-    // 下位桁から分離して配列に格納
-    while (x) {
-        r[i++] = '0' + (x % 10);
-        x /= 10;
-    }
-    // 逆順で出力（上位桁から）
-    while (i--) vga_putc(r[i]);
-}
-
-// VGA初期化：白文字・黒背景で画面クリア
-void vga_init(void) {
-    vga_set_color(15, 0);  // VGA_WHITE, VGA_BLACK
-    vga_clear();
+    return *a == *b;
 }
 
 /*
@@ -191,45 +122,6 @@ void itoa(uint32_t value, char* buffer, int base) {
  * =================================================================================
  */
 
-/*
- * 画面クリア関数
- * 【役割】VGAテキストモードの画面を黒背景・白文字のスペースで埋める
- */
-void clear_screen(void) {
-    for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        vga_buffer[i] = VGA_WHITE_ON_BLACK;  // 黒背景、白文字、スペース
-    }
-}
-
-/*
- * 指定行クリア関数
- * 【役割】指定された行をスペースで埋めてクリアする
- */
-void clear_line(int row) {
-    if (row < 0 || row >= VGA_HEIGHT)
-        return;
-
-    for (int col = 0; col < VGA_WIDTH; col++) {
-        vga_buffer[row * VGA_WIDTH + col] = VGA_WHITE_ON_BLACK;
-    }
-}
-
-/*
- * 指定位置への文字列表示関数
- * 【役割】指定された行・列に指定色で文字列を表示する
- */
-void print_at(int row, int col, const char* str, uint8_t color) {
-    if (row < 0 || row >= VGA_HEIGHT || col < 0 || col >= VGA_WIDTH) {
-        return;  // 範囲外は無視
-    }
-
-    uint16_t* pos = vga_buffer + row * VGA_WIDTH + col;
-    while (*str && col < VGA_WIDTH) {
-        *pos++ = (*str++ | (color << 8));
-        col++;
-    }
-}
-
 /*
  * デバッグメッセージ表示関数
  * 【役割】シリアルポートとVGA画面の両方にデバッグメッセージを出力
@@ -300,14 +192,20 @@ void debug_vprint(const char* format, va_list args) {
     simple_vsprintf(buffer, sizeof(buffer), format, ap);
     va_end(ap);
 
-    // シリアルポートに出力
-    serial_write_string("[DEBUG] ");
-    serial_write_string(buffer);
-    serial_write_string("\r\n");
+    // シリアルポートに出力（他CPUの出力と行が混ざらないようにする。割り込みは
+    // 禁止しない）。バイナリ出力の有効時は TEXT レコード1つで送る（trace.h）
+    if (trace_binary_enabled()) {
+        trace_emit_text(buffer);
+    } else {
+        bool locked = serial_output_begin();
+        serial_write_string("[DEBUG] ");
+        serial_write_string(buffer);
+        serial_write_string("\r\n");
+        serial_output_end(locked);
+    }
 
-    // VGAにも出力（最下行に表示）
-    // static int debug_row = 24;
-    // print_at(debug_row, 0, buffer, VGA_COLOR_RED);
+    // VGA のログ用コンソール（Alt+F3）にも出力。表示していない間は RAM に書くだけ
+    vga_console_log(buffer);
 }
 
 void debug_print(const char* format, ...) {
@@ -325,24 +223,32 @@ void display_system_info(void) {
     print_at(0, 0, "Timer-based Multi-threaded OS with Context Switching",
              VGA_COLOR_WHITE);
     print_at(2, 0, "System Information:", VGA_COLOR_YELLOW);
-    print_at(3, 2, "Timer Frequency: 100Hz (10ms intervals)", VGA_COLOR_GRAY);
-    print_at(4, 2, "Scheduling: Preemptive Round-Robin", VGA_COLOR_GRAY);
+    print_at(3, 2, "Timer: Local APIC tick (default 10ms, PIT 100Hz fallback)",
+             VGA_COLOR_GRAY);
+    print_at(4, 2, "Scheduling: Preemptive, NORMAL/EDF/FAIR/MLFQ classes",
+             VGA_COLOR_GRAY);
     print_at(5, 2, "Context Switch: Hardware timer interrupt", VGA_COLOR_GRAY);
 
     print_at(7, 0, "Thread Information:", VGA_COLOR_YELLOW);
     print_at(8, 2,
-             "Thread 1: Counter updates every 1.0 second, checking the counter "
-             "every 10ms",
+             "Thread A: EDF periodic task, released every 1.0 s to update "
+             "its counter",
              VGA_COLOR_GRAY);
     print_at(9, 2,
-             "Thread 2: Counter updates every 1.5 seconds, checking the "
-             "counter every 10ms",
+             "Thread B: EDF periodic task, released every 1.5 s to update "
+             "its counter",
              VGA_COLOR_GRAY);
     print_at(10, 2,
-             "Thread 3: Keyboard input thread blocked by BLOCK_REASON_KEYBOARD",
+             "Thread C: Keyboard input thread blocked by BLOCK_REASON_KEYBOARD",
              VGA_COLOR_GRAY);
 
     print_at(12, 0, "Live Thread Status:", VGA_COLOR_RED);
+
+    print_at(16, 0, "Virtual Consoles:", VGA_COLOR_YELLOW);
+    print_at(17, 2,
+             "Alt+F1: this screen  Alt+F2: Thread 3 keyboard demo  "
+             "Alt+F3: debug log",
+             VGA_COLOR_GRAY);
 }
 
 /*
@@ -377,7 +283,7 @@ void init_timer(uint32_t frequency) {
     outb(PIT_CHANNEL0,
          (divisor >> SHIFT_HIGH_BYTE) & MASK_LOW_BYTE);  // 上位8bit
 
-    print_at(20, 0, "Timer initialized: 100Hz (10ms intervals)",
+    print_at(20, 0, "Timer initialized: PIT (until the Local APIC tick starts)",
              VGA_COLOR_GREEN);
 }
 
@@ -395,6 +301,14 @@ void set_idt_gate(int n, uint32_t handler) {
         IDT_FLAG_PRESENT_DPL0_32BIT;  // Present, DPL=0, 32bit Interrupt Gate
 }
 
+/*
+ * IDTをCPUにロード
+ * 【備考】IDTは全CPUで共有し、AP も ap_main からこれを呼ぶ
+ */
+void load_idt(void) {
+    asm volatile("lidt %0" : : "m"(idtr));
+}
+
 /*
  * IDT構造体設定とロード
  * 【役割】IDT構造体を設定してCPUにロードする
@@ -407,22 +321,20 @@ void setup_idt_structure(void) {
     idtr.base = (uint32_t)&idt;    // IDTのアドレス
 
     // IDTをCPUにロード
-    asm volatile("lidt %0" : : "m"(idtr));
+    load_idt();
 }
 
+static bool pit_timer_irq_handler(void* ctx);
+
 /*
  * 割り込みハンドラ登録
- * 【役割】タイマーとキーボードの割り込みハンドラを登録
+ * 【役割】全ベクタを共通入口に向け、PIT（IRQ0）のハンドラを登録する
+ * （キーボードなどのデバイスは各自の初期化で irq_register() する）
+ * 【前提】init_pic() で全IRQをマスクした後に呼ぶ（登録でマスクが解除される）
  */
 void register_interrupt_handlers(void) {
-    debug_print("IDT: Timer interrupt handler registered");
-    debug_print("IDT: Keyboard interrupt handler registered");
-
-    // タイマー割り込み（IRQ0 = 割り込み番号32）のハンドラ設定
-    set_idt_gate(32, (uint32_t)timer_interrupt_handler);
-
-    // キーボード割り込み（IRQ1 = 割り込み番号33）のハンドラ設定
-    set_idt_gate(33, (uint32_t)keyboard_interrupt_handler);
+    irq_init();
+    irq_register(IRQ_TIMER, pit_timer_irq_handler, NULL);
 }
 
 /*
@@ -432,8 +344,9 @@ void register_interrupt_handlers(void) {
 void remap_pic(void) {
     debug_print("PIC: Starting PIC remapping");
 
-    // PICを再マップ（IRQ0-7を割り込み32-39に移動）
+    // PICを再マップ（IRQ0-7を割り込み32-39、IRQ8-15を割り込み40-47に移動）
     // 【重要】デフォルトではIRQ0-7は割り込み8-15にマップされ、CPU例外と衝突する
+    // 【重要】スレーブも初期化しないと、BIOS の設定（割り込み0x70-0x77）のまま残る
 
     // マスター PIC 初期化
     outb(PIC_MASTER_COMMAND, PIC_ICW1_INIT);  // 初期化コマンド (ICW1)
@@ -443,7 +356,14 @@ void remap_pic(void) {
          PIC_ICW3_SLAVE_IRQ2);  // スレーブPICはIRQ2に接続 (ICW3)
     outb(PIC_MASTER_DATA, PIC_ICW4_8086_MODE);  // 8086モード (ICW4)
 
-    debug_print("PIC: Master PIC remapped to interrupts 32-39");
+    // スレーブ PIC 初期化
+    outb(PIC_SLAVE_COMMAND, PIC_ICW1_INIT);  // 初期化コマンド (ICW1)
+    outb(PIC_SLAVE_DATA,
+         PIC_ICW2_SLAVE_BASE);  // 割り込みベクター0x28(40)から開始 (ICW2)
+    outb(PIC_SLAVE_DATA, PIC_ICW3_SLAVE_ID);   // カスケードID=2 (ICW3)
+    outb(PIC_SLAVE_DATA, PIC_ICW4_8086_MODE);  // 8086モード (ICW4)
+
+    debug_print("PIC: Master/slave PIC remapped to interrupts 32-47");
 }
 
 /*
@@ -455,40 +375,49 @@ void configure_interrupt_masks(void) {
 
     // 全割り込みをマスク（無効化）
     outb(PIC_MASTER_DATA, PIC_MASK_ALL_DISABLED);  // 全割り込み無効化
+    outb(PIC_SLAVE_DATA, PIC_MASK_ALL_DISABLED);
 
     debug_print("PIC: All interrupts masked");
 }
 
 /*
- * タイマーとキーボード割り込み有効化
- * 【役割】タイマー（IRQ0）とキーボード（IRQ1）割り込みのみを有効化
+ * PIC初期化関数
+ * 【役割】マスター・スレーブの両PICを再マップし、全IRQをマスクした状態にする
+ * 【備考】各IRQは irq_register() でハンドラを登録した時にマスクが解除される
  */
-void enable_timer_interrupt(void) {
-    debug_print("PIC: Enabling timer and keyboard interrupts");
+void init_pic(void) {
+    debug_print("PIC: Starting PIC initialization");
 
-    // タイマー割り込み（IRQ0）とキーボード割り込み（IRQ1）を有効化
-    // bit 0 = 0: IRQ0（タイマー）有効
-    // bit 1 = 0: IRQ1（キーボード）有効
-    // bit 2-7 = 1: その他の割り込み無効
-    outb(PIC_MASTER_DATA,
-         PIC_MASK_TIMER_KEYBOARD);  // 11111100b = IRQ0とIRQ1のみ有効
+    remap_pic();                  // 1. PIC再マップ（IRQ0-15 → 割り込み32-47）
+    configure_interrupt_masks();  // 2. 割り込みマスク設定（全IRQ無効）
 
-    debug_print("PIC: Timer (IRQ0) and Keyboard (IRQ1) interrupts enabled");
+    debug_print("PIC: PIC configured: IRQs unmasked on registration");
 }
 
 /*
- * PIC初期化関数
- * 【役割】PICの設定を行い、タイマー割り込みを有効化
+ * PIC の無効化
+ * 【役割】I/O APIC へ切り替えた後、PIC から割り込みが届かないよう全IRQをマスクする
  */
-void init_pic(void) {
-    debug_print("PIC: Starting PIC initialization");
-
-    // PIC初期化を4つのステップに分割
-    remap_pic();                  // 1. PIC再マップ
-    configure_interrupt_masks();  // 2. 割り込みマスク設定
-    enable_timer_interrupt();     // 3. タイマー割り込み有効化
+void disable_pic(void) {
+    outb(PIC_MASTER_DATA, PIC_MASK_ALL_DISABLED);
+    outb(PIC_SLAVE_DATA, PIC_MASK_ALL_DISABLED);
+    debug_print("PIC: All IRQs masked (I/O APIC in use)");
+}
 
-    debug_print("PIC: PIC configured: Timer interrupt enabled");
+/*
+ * デバイスIRQの処理完了通知
+ * 【役割】現在の配送経路に応じて Local APIC（MMIO）か PIC（ポートI/O）へ EOI を送る
+ * 【重要】スレーブ側の IRQ はスレーブ・マスターの両方に EOI が必要
+ */
+void irq_send_eoi(uint8_t irq) {
+    if (apic_irq_routing) {
+        lapic_eoi();
+        return;
+    }
+    if (irq >= IRQ_SLAVE_PIC_BASE) {
+        outb(PIC_SLAVE_COMMAND, PIC_EOI);
+    }
+    outb(PIC_MASTER_COMMAND, PIC_EOI);
 }
 
 /*
@@ -499,10 +428,9 @@ void init_interrupts(void) {
 
     // 割り込みシステム初期化を3つのステップに分割
     setup_idt_structure();          // 1. IDT構造体設定とロード
-    register_interrupt_handlers();  // 2. 割り込みハンドラ登録
-
-    // PICとタイマーを初期化
-    init_pic();
+    init_pic();                     // 2. PIC初期化（全IRQマスク）
+    register_interrupt_handlers();  // 2a. 共通入口と PIT ハンドラ登録
+    fpu_init();                     // 2b. #NMハンドラ登録（遅延FPU切り替え）
     init_timer(TIMER_FREQUENCY);
 
     enable_cpu_interrupts();  // 3. CPU割り込み有効化
@@ -510,6 +438,47 @@ void init_interrupts(void) {
     debug_print("INTERRUPTS: Interrupt system initialized");
 }
 
+/*
+ * APIC 割り込み配送への切り替え
+ * 【役割】スケジューラティックを PIT から各CPUの Local APIC タイマーへ、
+ * デバイスの IRQ を PIC から I/O APIC（宛先は BSP）へ移す。
+ * どちらも使えない構成では PIC + PIT のまま動作する
+ * 【重要】PIT は Local APIC タイマーを開始できた後にだけ止める。較正できなかった
+ * （TSC がないなど）場合は PIT のティックを残し、I/O APIC へ移すなら IRQ0 も配送する
+ * 【前提】smp_init() が Local APIC を初期化し、タイマーを較正した後に BSP で呼ぶ
+ * 【備考】ISA IRQ1〜15 は全て配送先を設定し、ハンドラ登録済みのものだけマスクを
+ * 解除する（後から irq_register() したラインはその時に解除される）
+ */
+void init_apic_interrupts(void) {
+    if (!lapic_is_available()) {
+        debug_print("APIC: not available, keeping PIC + PIT");
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    uint8_t bsp = (uint8_t)get_kernel_context()->lapic_id;
+    bool lapic_tick = OS_SUCCESS_CHECK(lapic_timer_start());
+    if (OS_SUCCESS_CHECK(ioapic_init()) &&
+        OS_SUCCESS_CHECK(irq_route_to_ioapic(bsp, !lapic_tick))) {
+        disable_pic();
+        apic_irq_routing = true;
+        irq_unmask_registered();  // PIT を配送した場合は IRQ0 も解除される
+    } else if (lapic_tick) {
+        // PIC 経由のデバイスIRQは残し、PIT だけを止める（二重ティック防止）
+        outb(PIC_MASTER_DATA, inb(PIC_MASTER_DATA) | PIC_MASK_TIMER);
+    }
+    irq_restore(flags);
+
+    debug_print("APIC: device IRQs via %s, EOI via %s, tick from %s",
+                apic_irq_routing ? "I/O APIC" : "PIC",
+                apic_irq_routing ? "LAPIC MMIO" : "port I/O",
+                lapic_tick ? "LAPIC timer" : "PIT");
+}
+
+bool apic_interrupts_enabled(void) {
+    return apic_irq_routing;
+}
+
 /*
  * CPU割り込み有効化関数
  * 【役割】CPUレベルで割り込みを有効化
@@ -560,33 +529,26 @@ os_result_t validate_thread_params(void (*func)(void), int display_row,
 void initialize_thread_stack(thread_t* thread, void (*func)(void)) {
     /*
      * スタック初期化の詳細:
-     * timer_interrupt -> initial_context_switch -> thread_function の流れに対応
+     * context_switch / initial_context_switch -> thread_entry_trampoline
+     * -> thread_function の流れに対応
      *
-     * initial_context_switch のpop命令の順序に合わせてスタックを構築:
-     * 1. popa (eax, ecx, edx, ebx, esp, ebp, esi, edi)
-     * 2. popfd (EFLAGS)
-     * 3. pop eax; jmp eax (関数アドレス)
+     * context_switch のpop命令の順序に合わせてスタックを構築:
+     * 1. pop edi, esi, ebx, ebp（呼び出し先保存レジスタのみ）
+     * 2. ret → thread_entry_trampoline（sti 後に EBX の関数を呼ぶ）
      *
      * スタックレイアウト（下から上へ）:
-     * 1. 汎用レジスタ (EAX, EBX, ECX, EDX, ESI, EDI, EBP) - 最初にpopaで復元
-     * 2. EFLAGS - 次にpopfdで復元
-     * 3. 関数アドレス - 最後にpop eax; jmp eaxでジャンプ
+     * 1. EDI, ESI - 0
+     * 2. EBX - スレッド関数のアドレス
+     * 3. EBP - 0（スタックトレースの終端）
+     * 4. 戻りアドレス - thread_entry_trampoline
      */
-
-    // initial_context_switch で復元されるレジスタの初期値
     uint32_t* sp = &thread->stack[THREAD_STACK_SIZE];  // スタックトップから開始
 
-    *--sp = (uint32_t)func;  // 関数アドレス（最初に積む）
-    // 割り込み有効化のためのEFLAGS設定
-    *--sp = EFLAGS_INTERRUPT_ENABLE;  // EFLAGS, IF=1（割り込み有効）, reserved
-                                      // bit=1
-    *--sp = 0;                        // EBP
-    *--sp = 0;                        // EDI
-    *--sp = 0;                        // ESI
-    *--sp = 0;                        // EDX
-    *--sp = 0;                        // ECX
-    *--sp = 0;                        // EBX
-    *--sp = 0;                        // EAX
+    *--sp = (uint32_t)thread_entry_trampoline;  // ret の戻り先
+    *--sp = 0;                                  // EBP
+    *--sp = (uint32_t)func;                     // EBX（トランポリンが呼ぶ）
+    *--sp = 0;                                  // ESI
+    *--sp = 0;                                  // EDI
     // ESPを設定 （context_switch が期待するスタック位置）
     thread->esp = (uint32_t)sp;
 }
@@ -595,6 +557,23 @@ void initialize_thread_stack(thread_t* thread, void (*func)(void)) {
  * スレッド属性設定関数
  * 【役割】スレッドの基本属性（状態、カウンター、表示行など）を設定する
  */
+static void sleep_timer_expired(hrtimer_t* timer);
+static void edf_replenish_timer_expired(hrtimer_t* timer);
+static void fair_enqueue(thread_t* thread);
+static void fair_dequeue(thread_t* thread);
+
+static inline bool thread_is_edf(const thread_t* thread) {
+    return thread->sched_class == SCHED_CLASS_EDF;
+}
+
+static inline bool thread_is_fair(const thread_t* thread) {
+    return thread->sched_class == SCHED_CLASS_FAIR;
+}
+
+static inline bool thread_is_mlfq(const thread_t* thread) {
+    return thread->sched_class == SCHED_CLASS_MLFQ;
+}
+
 void configure_thread_attributes(thread_t* thread, uint32_t delay_ticks,
                                  int display_row) {
     thread->state = THREAD_READY;
@@ -602,15 +581,46 @@ void configure_thread_attributes(thread_t* thread, uint32_t delay_ticks,
     thread->delay_ticks = delay_ticks;
     thread->last_tick = 0;
     thread->display_row = display_row;
+    thread->console = VGA_CONSOLE_MAIN;  // vga_console_bind() で変える
+    thread->block_reason = BLOCK_REASON_NONE;
+    thread->wait_object = NULL;
+    thread->base_priority = THREAD_PRIORITY_NORMAL;
+    thread->priority = THREAD_PRIORITY_NORMAL;
+    thread->blocked_on = NULL;
+    thread->held_mutexes = NULL;
+    thread->sched_class = SCHED_CLASS_NORMAL;
+    thread->edf.bandwidth_ppm = 0;
+    thread->edf.deadline_misses = 0;
+    thread->edf.throttle_count = 0;
+    thread->edf.throttled = false;
+    hrtimer_init(&thread->edf.replenish_timer, edf_replenish_timer_expired,
+                 thread);
+    thread->fair.vruntime = 0;
+    thread->fair.sum_exec_tsc = 0;
+    thread->fair.weight = FAIR_WEIGHT_DEFAULT;
+    thread->fair.heap_index = -1;
+    thread->mlfq.level = 0;
+    thread->mlfq.used_tsc = 0;
+    thread->mlfq.demotions = 0;
+    thread->cpu = get_kernel_context()->cpu_id;  // 作成したCPUで動かす
     thread->next_ready = NULL;
+    hrtimer_init(&thread->sleep_timer, sleep_timer_expired, thread);
+    fpu_thread_init(thread);
 }
 
 /*
  * スレッドをREADYリストに追加する関数
- * 【役割】スレッドを実行可能（READY）リストの末尾に追加する（循環リスト）
+ * 【役割】スレッドを所属CPUの実行可能（READY）リストの末尾に追加する（循環リスト）。
+ * 公平クラスのスレッドはリングではなく所属CPUの公平実行キューに入れる
+ * 【前提】sched_lock を保持していること
  */
 os_result_t add_thread_to_ready_list(thread_t* thread) {
-    kernel_context_t* ctx = get_kernel_context();
+    if (thread_is_fair(thread)) {
+        fair_enqueue(thread);
+        return OS_SUCCESS;
+    }
+
+    kernel_context_t* ctx = get_cpu_context(thread->cpu);
 
     if (ctx->ready_thread_list == NULL) {
         ctx->ready_thread_list = thread;
@@ -640,15 +650,29 @@ os_result_t add_thread_to_ready_list(thread_t* thread) {
     return OS_SUCCESS;
 }
 
+/*
+ * スレッドスロット確保関数
+ * 【役割】終了済みスレッドのスロットを優先して再利用し、なければ未使用スロットを返す
+ */
+static thread_t* allocate_thread_slot(void) {
+    for (int i = 0; i < thread_pool_used; i++) {
+        if (thread_pool[i].state == THREAD_TERMINATED) {
+            return &thread_pool[i];
+        }
+    }
+
+    if (thread_pool_used >= MAX_THREADS) {
+        return NULL;
+    }
+    return &thread_pool[thread_pool_used++];
+}
+
 /*
  * スレッド作成関数
  * 【役割】新しいスレッドを作成し、初期化して実行可能リストに追加する
  */
 os_result_t create_thread(void (*func)(void), uint32_t delay_ticks,
                           int display_row, thread_t** out_thread) {
-    static thread_t threads[MAX_THREADS];  // 最大4スレッド
-    static int thread_count = 0;
-
     // 1. パラメータ検証
     if (!out_thread) {
         debug_print("ERROR: create_thread called with NULL out_thread pointer");
@@ -662,13 +686,16 @@ os_result_t create_thread(void (*func)(void), uint32_t delay_ticks,
         return validation_result;
     }
 
-    if (thread_count >= MAX_THREADS) {
+    // スレッドプールとREADYリングは全CPUで共有するためスケジューラロックで守る
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+
+    thread_t* thread = allocate_thread_slot();
+    if (!thread) {
+        spin_unlock_irqrestore(&sched_lock, flags);
         debug_print("ERROR: Maximum number of threads exceeded");
         return OS_ERROR_OUT_OF_MEMORY;
     }
 
-    thread_t* thread = &threads[thread_count++];
-
     // 2. スタック初期化
     initialize_thread_stack(thread, func);
 
@@ -678,9 +705,11 @@ os_result_t create_thread(void (*func)(void), uint32_t delay_ticks,
     // 4. READYリストに追加
     os_result_t add_result = add_thread_to_ready_list(thread);
     if (OS_FAILURE_CHECK(add_result)) {
-        thread_count--;  // スレッド数をロールバック
+        thread->state = THREAD_TERMINATED;  // スロットを解放
+        spin_unlock_irqrestore(&sched_lock, flags);
         return add_result;
     }
+    spin_unlock_irqrestore(&sched_lock, flags);
 
     debug_print("SUCCESS: Thread created successfully");
     *out_thread = thread;
@@ -689,10 +718,16 @@ os_result_t create_thread(void (*func)(void), uint32_t delay_ticks,
 
 /*
  * READYリストからスレッドを削除
- * 【役割】循環リストから現在のスレッドを安全に削除
+ * 【役割】所属CPUの循環リスト（公平クラスは公平実行キュー）から安全に削除
+ * 【前提】sched_lock を保持していること
  */
 static void remove_from_ready_list(thread_t* thread) {
-    kernel_context_t* ctx = get_kernel_context();
+    if (thread_is_fair(thread)) {
+        fair_dequeue(thread);
+        return;
+    }
+
+    kernel_context_t* ctx = get_cpu_context(thread->cpu);
 
     if (ctx->ready_thread_list == thread && thread->next_ready == thread) {
         // 自分ひとりしかいなかった場合 → 空リストに
@@ -712,234 +747,1092 @@ static void remove_from_ready_list(thread_t* thread) {
 }
 
 /*
- * スレッドをスリープ状態に遷移させる関数
- * 【役割】スレッドの状態と起床時刻を設定する
+ * =================================================================================
+ * EDF（最早デッドライン優先）スケジューリングクラス
+ * =================================================================================
+ * 【方針】EDF クラスのスレッドは周期ごとに宣言した実行時間（予算）を持ち、
+ * 通常クラスより常に優先して、デッドラインの早い順に実行される。
+ * 帯域の合計を受け入れ制御で抑え、予算を使い切ったスレッドは次のデッドラインまで
+ * 止める（throttled）ことで、他の EDF スレッドのデッドラインを守る。
+ * 関数はすべて sched_lock 保持・割り込み禁止で呼ぶ
  */
 
 /*
- * sleep() システムコール関数
- * 【役割】指定されたティック数だけ現在のスレッドをスリープさせる
+ * 新しいジョブの開始（デッドラインと予算の更新）
  */
-void sleep(uint32_t ticks) {
-    // パラメータ検証
-    if (ticks == 0) {
-        debug_print("SLEEP: Zero ticks - no sleep needed");
-        return;
+static void edf_renew(thread_t* thread, uint64_t now) {
+    thread->edf.deadline_ns = now + thread->edf.period_ns;
+    thread->edf.budget_ns = (int64_t)thread->edf.runtime_ns;
+}
+
+/*
+ * 予算切れのスレッドを次のデッドラインまで止める
+ * 【備考】補充タイマーは実行中CPUで開始し、補充時に所属CPUへ知らせる
+ */
+static void edf_throttle(thread_t* thread) {
+    thread->edf.throttled = true;
+    thread->edf.throttle_count++;
+    hrtimer_start_abs(&thread->edf.replenish_timer, thread->edf.deadline_ns);
+}
+
+/*
+ * デッドライン超過の検出
+ * 【役割】実行可能なままデッドラインを過ぎたジョブを数え、現在時刻から
+ * 新しい周期を始める（ソフトリアルタイム。ジョブは打ち切らない）
+ * 【戻り値】超過していた場合true
+ */
+static bool edf_check_deadline(thread_t* thread, uint64_t now) {
+    if (now <= thread->edf.deadline_ns) {
+        return false;
     }
+    thread->edf.deadline_misses++;
+    edf_renew(thread, now);
+    return true;
+}
 
-    if (ticks > MAX_COUNTER_VALUE) {
-        debug_print("SLEEP: Ticks too large, limiting");
-        ticks = MAX_COUNTER_VALUE;
+/*
+ * 実行時間の計上
+ * 【役割】前回の計上から now までの実行時間を予算から引き、
+ * 実行可能なまま予算を使い切っていれば止める
+ * （ブロック・終了したスレッドはジョブ完了として扱う）
+ */
+static void edf_account(thread_t* thread, uint64_t now) {
+    thread->edf.budget_ns -= (int64_t)(now - thread->edf.last_update_ns);
+    thread->edf.last_update_ns = now;
+
+    if (thread->state == THREAD_BLOCKED || thread->state == THREAD_TERMINATED ||
+        thread->edf.throttled) {
+        return;
     }
+    if (!edf_check_deadline(thread, now) && thread->edf.budget_ns <= 0) {
+        edf_throttle(thread);
+    }
+}
 
-    if (!get_current_thread()) {
-        debug_print("SLEEP: No current thread to sleep");
+/*
+ * 起床時のデッドライン決定（CBS の起床規則）
+ * 【役割】残り予算を残り時間で使い切っても宣言した帯域を超えない場合だけ
+ * 現在のデッドラインを引き継ぎ、超える場合は新しい周期を始める
+ * 【備考】予算を使い切ったまま眠ったスレッドは、起床してもデッドラインまで止める
+ */
+static void edf_wakeup(thread_t* thread) {
+    if (!thread_is_edf(thread)) {
         return;
     }
 
-    uint32_t wake_up_time = get_system_ticks() + ticks;
+    edf_state_t* edf = &thread->edf;
+    uint64_t now = clock_get_time_ns();
+    if (now >= edf->deadline_ns) {
+        edf_renew(thread, now);
+    } else if (edf->budget_ns <= 0) {
+        edf_throttle(thread);
+    } else if ((uint64_t)edf->budget_ns * edf->period_ns >
+               edf->runtime_ns * (edf->deadline_ns - now)) {
+        edf_renew(thread, now);
+    }
+}
 
-    // 汎用ブロック関数を呼び出す
-    block_current_thread(BLOCK_REASON_TIMER, wake_up_time);
+/*
+ * 予算補充タイマーのコールバック
+ * 【役割】止めていたスレッドに次の周期の予算を与え、所属CPUに再スケジュールさせる
+ */
+static void edf_replenish_timer_expired(hrtimer_t* timer) {
+    thread_t* thread = (thread_t*)timer->data;
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+
+    if (thread_is_edf(thread) && thread->edf.throttled) {
+        uint64_t now = clock_get_time_ns();
+        thread->edf.throttled = false;
+        thread->edf.deadline_ns += thread->edf.period_ns;
+        if (thread->edf.deadline_ns <= now) {
+            thread->edf.deadline_ns = now + thread->edf.period_ns;
+        }
+        thread->edf.budget_ns = (int64_t)thread->edf.runtime_ns;
+        smp_kick_cpu(thread->cpu);
+    }
 
-    // スケジューラへ
-    schedule();
+    spin_unlock_irqrestore(&sched_lock, flags);
 }
 
 /*
- * 現在のスレッドをブロックする汎用関数
- * 【役割】スレッドをブロックし、理由に応じてブロックリストに挿入する
+ * 予算切れタイマーのコールバック
+ * 【備考】何もしない。タイマー割り込みハンドラが続けて schedule() を呼び、
+ * schedule_locked() の計上で予算切れのスレッドが止められる
  */
-void block_current_thread(block_reason_t reason, uint32_t data) {
-    asm volatile("cli");
+static void edf_budget_timer_expired(hrtimer_t* timer) {
+    (void)timer;
+}
 
-    thread_t* thread = get_current_thread();
-    if (!thread) {
-        asm volatile("sti");
+/*
+ * スレッド切り替え時の計上
+ * 【役割】切り替え元の実行時間を予算から引き、切り替え先が EDF なら
+ * 予算が尽きる時刻にこのCPUの予算タイマーを設定する
+ * 【最適化】通常クラス同士の切り替えでは時刻も読まない
+ */
+static void edf_switch_accounting(thread_t* prev, thread_t* next) {
+    bool prev_edf = prev && thread_is_edf(prev);
+    if (!prev_edf && !thread_is_edf(next)) {
         return;
     }
 
-    // 1. READYリストから削除
-    remove_from_ready_list(thread);
-
-    // 2. ブロック状態と理由を設定
-    thread->state = THREAD_BLOCKED;
-    thread->block_reason = reason;
-    thread->next_blocked = NULL;
+    uint64_t now = clock_get_time_ns();
+    if (prev_edf) {
+        edf_account(prev, now);
+    }
 
-    // 3. ブロックリストに挿入
-    if (reason == BLOCK_REASON_TIMER) {
-        thread->wake_up_tick = data;
-        // 時刻順でソートして挿入
-        if (!get_kernel_context()->blocked_thread_list ||
-            thread->wake_up_tick <
-                get_kernel_context()->blocked_thread_list->wake_up_tick) {
-            thread->next_blocked = get_kernel_context()->blocked_thread_list;
-            get_kernel_context()->blocked_thread_list = thread;
-        } else {
-            thread_t* current = get_kernel_context()->blocked_thread_list;
-            while (current->next_blocked &&
-                   current->next_blocked->wake_up_tick <=
-                       thread->wake_up_tick) {
-                current = current->next_blocked;
-            }
-            thread->next_blocked = current->next_blocked;
-            current->next_blocked = thread;
-        }
-    } else {  // FIFOで末尾に追加 (キーボードなど)
-        if (!get_kernel_context()->blocked_thread_list) {
-            get_kernel_context()->blocked_thread_list = thread;
-        } else {
-            thread_t* current = get_kernel_context()->blocked_thread_list;
-            while (current->next_blocked) {
-                current = current->next_blocked;
-            }
-            current->next_blocked = thread;
-        }
+    hrtimer_t* budget_timer = &get_kernel_context()->edf_budget_timer;
+    if (thread_is_edf(next)) {
+        edf_check_deadline(next, now);
+        next->edf.last_update_ns = now;
+        hrtimer_start_abs(budget_timer, now + (uint64_t)next->edf.budget_ns);
+    } else {
+        hrtimer_cancel(budget_timer);
     }
+}
 
-    asm volatile("sti");
+/*
+ * EDF クラスからの離脱（帯域の返却と補充タイマーの停止）
+ */
+static void edf_leave_class(thread_t* thread) {
+    if (!thread_is_edf(thread)) {
+        return;
+    }
+    get_cpu_context(thread->cpu)->edf_bandwidth_ppm -= thread->edf.bandwidth_ppm;
+    thread->edf.bandwidth_ppm = 0;
+    thread->edf.throttled = false;
+    thread->sched_class = SCHED_CLASS_NORMAL;
+    hrtimer_cancel(&thread->edf.replenish_timer);
 }
 
 /*
- * キーボード入力待ちでブロックされた全スレッドを起床させる
- * 【役割】キーボード入力があった時に、ブロック状態の全スレッドをREADYに戻す
+ * スレッドを EDF クラスにする（runtime_ns = 0 なら通常クラスに戻す）
+ * 【役割】所属CPUの EDF 帯域の合計が EDF_MAX_BANDWIDTH_PPM 以下に収まる場合だけ
+ * 受け入れる。最初のデッドラインは現在時刻 + 周期
+ * 【戻り値】帯域が足りなければ OS_ERROR_RESOURCE_BUSY、公平クラス・MLFQ クラスの
+ * スレッドは OS_ERROR_INVALID_STATE（先に通常クラスへ戻すこと）
+ * 【備考】帯域は CPU ごとに管理するため、EDF スレッドは thread_set_cpu() で移動できない
  */
-static void unblock_and_requeue_thread(thread_t* thread, thread_t* prev) {
-    // blocked_listから削除
-    if (prev) {
-        prev->next_blocked = thread->next_blocked;
-    } else {
-        get_kernel_context()->blocked_thread_list = thread->next_blocked;
+os_result_t thread_set_edf(thread_t* thread, uint64_t runtime_ns,
+                           uint64_t period_ns) {
+    if (!thread) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (runtime_ns != 0 &&
+        (period_ns < EDF_MIN_PERIOD_NS || period_ns > EDF_MAX_PERIOD_NS ||
+         runtime_ns > period_ns)) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+    uint32_t bandwidth =
+        runtime_ns ? (uint32_t)(runtime_ns * EDF_BANDWIDTH_UNIT / period_ns)
+                   : 0;
+
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    if (thread_is_fair(thread) || thread_is_mlfq(thread)) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return OS_ERROR_INVALID_STATE;
+    }
+    kernel_context_t* ctx = get_cpu_context(thread->cpu);
+    uint32_t current = thread_is_edf(thread) ? thread->edf.bandwidth_ppm : 0;
+    if (ctx->edf_bandwidth_ppm - current + bandwidth > EDF_MAX_BANDWIDTH_PPM) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return OS_ERROR_RESOURCE_BUSY;
     }
 
-    // READYリストに追加
-    thread->state = THREAD_READY;
-    thread->block_reason = BLOCK_REASON_NONE;
-    thread->next_blocked = NULL;
-    add_thread_to_ready_list(thread);
+    edf_leave_class(thread);
+    if (runtime_ns) {
+        uint64_t now = clock_get_time_ns();
+        thread->edf.runtime_ns = runtime_ns;
+        thread->edf.period_ns = period_ns;
+        thread->edf.bandwidth_ppm = bandwidth;
+        thread->edf.last_update_ns = now;
+        edf_renew(thread, now);
+        thread->sched_class = SCHED_CLASS_EDF;
+        ctx->edf_bandwidth_ppm += bandwidth;
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return OS_SUCCESS;
 }
 
 /*
- * タイマーでブロックされたスレッドをチェックして起床させる
+ * EDF の統計表示（debug_command_scheduler から呼ばれる）
+ * 【備考】ロックを取らずに読むため表示は近似値
  */
-static void check_and_wake_timer_threads(void) {
-    asm volatile("cli");
-    thread_t* current = get_kernel_context()->blocked_thread_list;
-    thread_t* prev = NULL;
-    while (current) {
-        thread_t* next = current->next_blocked;
-        if (current->block_reason == BLOCK_REASON_TIMER &&
-            current->wake_up_tick <= get_kernel_context()->system_ticks) {
-            unblock_and_requeue_thread(current, prev);
-        } else {
-            prev = current;
+void edf_print_stats(void) {
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        kernel_context_t* ctx = get_cpu_context(cpu);
+        if (ctx->online && ctx->edf_bandwidth_ppm) {
+            debug_print("  EDF 帯域 CPU%u: %u / %u ppm", cpu,
+                        ctx->edf_bandwidth_ppm, EDF_MAX_BANDWIDTH_PPM);
         }
-        current = next;
     }
-    asm volatile("sti");
-}
 
-void unblock_keyboard_threads(void) {
-    asm volatile("cli");
-    thread_t* current = get_kernel_context()->blocked_thread_list;
-    thread_t* prev = NULL;
-    while (current) {
-        thread_t* next = current->next_blocked;
-        if (current->block_reason == BLOCK_REASON_KEYBOARD) {
-            unblock_and_requeue_thread(current, prev);
-        } else {
-            prev = current;
+    for (int i = 0; i < thread_pool_used; i++) {
+        thread_t* thread = &thread_pool[i];
+        if (thread->state == THREAD_TERMINATED || !thread_is_edf(thread)) {
+            continue;
         }
-        current = next;
+        debug_print(
+            "  EDF スレッド 0x%08x: %u us / %u us, デッドライン超過 %u, "
+            "予算切れ %u",
+            (uint32_t)thread, (uint32_t)(thread->edf.runtime_ns / NSEC_PER_USEC),
+            (uint32_t)(thread->edf.period_ns / NSEC_PER_USEC),
+            thread->edf.deadline_misses, thread->edf.throttle_count);
     }
 }
 
 /*
- * スケジューラ関数
- * 【役割】次に実行するスレッドを決定し、コンテキストスイッチを実行する
- * 【重要】タイマー割り込みから呼び出されるOSの心臓部
- */
-/*
- * スケジューラのロック状態を管理する関数群
+ * =================================================================================
+ * 公平（CFS 方式）スケジューリングクラス
+ * =================================================================================
+ * 【方針】実行した TSC サイクル数を重みで割り戻した仮想実行時間（vruntime）を
+ * スレッドごとに積算し、CPU ごとの最小ヒープの先頭（vruntime 最小）を実行する。
+ * スライスの途中でブロックしたスレッドは vruntime が進まないため、
+ * 起床後に優先して実行される。関数はすべて sched_lock 保持・割り込み禁止で呼ぶ
  */
-static inline void acquire_scheduler_lock(void) {
-    kernel_context_t* ctx = get_kernel_context();
-    asm volatile("cli");
-    ctx->scheduler_lock_count++;
-    asm volatile("sti");
+
+static inline fair_rq_t* fair_rq_of(const thread_t* thread) {
+    return &get_cpu_context(thread->cpu)->fair_rq;
 }
 
-static inline void release_scheduler_lock(void) {
-    kernel_context_t* ctx = get_kernel_context();
-    asm volatile("cli");
-    ctx->scheduler_lock_count--;
-    asm volatile("sti");
+static inline uint64_t fair_us_to_cycles(uint32_t us) {
+    return (uint64_t)us * clock_get_tsc_khz() / 1000;
 }
 
-static inline bool is_scheduler_locked(void) {
-    return get_kernel_context()->scheduler_lock_count > 0;
+static inline void fair_heap_set(fair_rq_t* rq, uint32_t index,
+                                 thread_t* thread) {
+    rq->heap[index] = thread;
+    thread->fair.heap_index = (int32_t)index;
 }
 
-/*
- * 初回スレッド選択とコンテキストスイッチ
- * 【役割】システム起動後の最初のスレッド実行を開始
- */
-static void handle_initial_thread_selection(void) {
-    kernel_context_t* ctx = get_kernel_context();
+static void fair_sift_up(fair_rq_t* rq, uint32_t index) {
+    thread_t* thread = rq->heap[index];
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (rq->heap[parent]->fair.vruntime <= thread->fair.vruntime) {
+            break;
+        }
+        fair_heap_set(rq, index, rq->heap[parent]);
+        index = parent;
+    }
+    fair_heap_set(rq, index, thread);
+}
 
-    asm volatile("cli");
-    ctx->current_thread = ctx->ready_thread_list;
-    ctx->current_thread->state = THREAD_RUNNING;
-    asm volatile("sti");
+static void fair_sift_down(fair_rq_t* rq, uint32_t index) {
+    thread_t* thread = rq->heap[index];
+    while (1) {
+        uint32_t child = index * 2 + 1;
+        if (child >= rq->count) {
+            break;
+        }
+        uint32_t right = child + 1;
+        if (right < rq->count &&
+            rq->heap[right]->fair.vruntime < rq->heap[child]->fair.vruntime) {
+            child = right;
+        }
+        if (thread->fair.vruntime <= rq->heap[child]->fair.vruntime) {
+            break;
+        }
+        fair_heap_set(rq, index, rq->heap[child]);
+        index = child;
+    }
+    fair_heap_set(rq, index, thread);
+}
+
+/*
+ * キューの最小 vruntime の更新（単調増加）
+ */
+static void fair_update_min_vruntime(fair_rq_t* rq) {
+    if (rq->count && rq->heap[0]->fair.vruntime > rq->min_vruntime) {
+        rq->min_vruntime = rq->heap[0]->fair.vruntime;
+    }
+}
+
+/*
+ * 公平実行キューへの追加
+ * 【役割】vruntime を「キューの最小 − 前借り分」以上にそろえてから入れる。
+ * 長く眠っていたスレッドが貯めた差で CPU を独占せず、
+ * 短いブロックからの起床は前借りの範囲で優先される
+ */
+static void fair_enqueue(thread_t* thread) {
+    fair_rq_t* rq = fair_rq_of(thread);
+    uint64_t credit = fair_us_to_cycles(FAIR_WAKEUP_CREDIT_US);
+    uint64_t floor = rq->min_vruntime > credit ? rq->min_vruntime - credit : 0;
+    if (thread->fair.vruntime < floor) {
+        thread->fair.vruntime = floor;
+    }
+
+    rq->heap[rq->count] = thread;
+    fair_sift_up(rq, rq->count++);
+}
+
+/*
+ * 公平実行キューからの削除
+ */
+static void fair_dequeue(thread_t* thread) {
+    if (thread->fair.heap_index < 0) {
+        return;
+    }
+
+    fair_rq_t* rq = fair_rq_of(thread);
+    uint32_t index = (uint32_t)thread->fair.heap_index;
+    thread_t* last = rq->heap[--rq->count];
+    thread->fair.heap_index = -1;
+
+    if (index < rq->count) {
+        // 末尾の要素を空いた位置へ移し、上下どちらかへ整える
+        fair_heap_set(rq, index, last);
+        fair_sift_up(rq, index);
+        fair_sift_down(rq, (uint32_t)last->fair.heap_index);
+    }
+}
+
+/*
+ * 実行時間の計上
+ * 【役割】前回の計上からの TSC サイクルを重みで割り戻して vruntime に加え、
+ * キュー内の位置を直す（vruntime は増えるだけなので下方向のみ）
+ */
+static void fair_update_curr(thread_t* thread) {
+    uint64_t now = rdtsc();
+    uint64_t delta = now - thread->fair.exec_start_tsc;
+    thread->fair.exec_start_tsc = now;
+    thread->fair.sum_exec_tsc += delta;
+    if (thread->fair.weight != FAIR_WEIGHT_DEFAULT) {
+        delta = delta * FAIR_WEIGHT_DEFAULT / thread->fair.weight;
+    }
+    thread->fair.vruntime += delta;
+
+    if (thread->fair.heap_index >= 0) {
+        fair_rq_t* rq = fair_rq_of(thread);
+        fair_sift_down(rq, (uint32_t)thread->fair.heap_index);
+        fair_update_min_vruntime(rq);
+    }
+}
+
+/*
+ * 公平クラスで次に実行すべきスレッド（vruntime 最小）
+ * 【戻り値】実行中のスレッド自身の場合もある。キューが空ならNULL
+ */
+static inline thread_t* fair_pick_first(kernel_context_t* ctx) {
+    return ctx->fair_rq.count ? ctx->fair_rq.heap[0] : NULL;
+}
+
+/*
+ * 公平クラス同士の切り替え判定
+ * 【役割】差が FAIR_MIN_GRANULARITY_US 未満なら切り替えない
+ * （vruntime がわずかに逆転するたびに切り替えるのを防ぐ）
+ */
+static bool fair_should_preempt(const thread_t* current, const thread_t* next) {
+    return current->fair.vruntime >
+           next->fair.vruntime + fair_us_to_cycles(FAIR_MIN_GRANULARITY_US);
+}
+
+/*
+ * スレッドを公平クラスにする（weight = 0 なら通常クラスに戻す）
+ * 【役割】初めて公平クラスに入るスレッドの vruntime はキューの最小から始める
+ * 【戻り値】EDF・MLFQ クラスのスレッドは OS_ERROR_INVALID_STATE
+ */
+os_result_t thread_set_fair(thread_t* thread, uint32_t weight) {
+    if (!thread) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (weight != 0 && (weight < FAIR_WEIGHT_MIN || weight > FAIR_WEIGHT_MAX)) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    if (thread_is_edf(thread) || thread_is_mlfq(thread) ||
+        thread->state == THREAD_TERMINATED) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    // ブロック中でなければキューを移し替える（ブロック中は起床時に入る）
+    bool queued = thread->state != THREAD_BLOCKED;
+    if (queued) {
+        remove_from_ready_list(thread);
+    }
+
+    if (thread_is_fair(thread)) {
+        if (thread->state == THREAD_RUNNING) {
+            fair_update_curr(thread);  // 変更前の重みで計上を締める
+        }
+    } else {
+        thread->fair.vruntime = fair_rq_of(thread)->min_vruntime;
+        thread->fair.exec_start_tsc = rdtsc();
+    }
+    if (weight) {
+        thread->fair.weight = weight;
+        thread->sched_class = SCHED_CLASS_FAIR;
+    } else {
+        thread->sched_class = SCHED_CLASS_NORMAL;
+    }
+
+    if (queued) {
+        add_thread_to_ready_list(thread);
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * =================================================================================
+ * 多段フィードバックキュー（MLFQ）スケジューリングクラス
+ * =================================================================================
+ * 【方針】段ごとに優先度を割り当て（最上段 = MLFQ_TOP_PRIORITY）、通常クラスと
+ * 同じ優先度 + ラウンドロビンで実行する。段の持ち時間を使い切ったスレッドは
+ * 1段下がるため、CPU を使い続けるスレッドは下の段へ沈み、持ち時間の前に
+ * ブロックする入力待ちのスレッドは上の段に残る。
+ * MLFQ_BOOST_INTERVAL_NS ごとに全員を最上段へ戻し、下の段の飢餓を防ぐ。
+ * 関数はすべて sched_lock 保持・割り込み禁止で呼ぶ
+ */
+
+static hrtimer_t mlfq_boost_timer;  // 全 MLFQ スレッドを最上段へ戻す周期タイマー
+
+/*
+ * 段の持ち時間（TSC サイクル）
+ * 【備考】最下段は下がり先がないため持ち時間を見ない
+ */
+static inline uint64_t mlfq_allotment_cycles(uint8_t level) {
+    return ((uint64_t)MLFQ_ALLOTMENT_BASE_US << level) * clock_get_tsc_khz() /
+           1000;
+}
+
+/*
+ * 段の設定（優先度の反映と使用時間のリセット）
+ * 【備考】ミューテックスで継承している優先度は kmutex_refresh_priority で保つ
+ */
+static void mlfq_set_level(thread_t* thread, uint8_t level) {
+    thread->mlfq.level = level;
+    thread->mlfq.used_tsc = 0;
+    thread->base_priority = (uint8_t)(MLFQ_TOP_PRIORITY - level);
+    kmutex_refresh_priority(thread);
+}
+
+/*
+ * 実行時間の計上
+ * 【役割】前回の計上からの TSC サイクルを現在の段の使用時間に加え、
+ * 持ち時間を使い切っていれば1段下げる
+ */
+static void mlfq_update_curr(thread_t* thread) {
+    uint64_t now = rdtsc();
+    thread->mlfq.used_tsc += now - thread->mlfq.exec_start_tsc;
+    thread->mlfq.exec_start_tsc = now;
+
+    uint8_t level = thread->mlfq.level;
+    if (level + 1 < MLFQ_LEVELS &&
+        thread->mlfq.used_tsc >= mlfq_allotment_cycles(level)) {
+        thread->mlfq.demotions++;
+        mlfq_set_level(thread, level + 1);
+    }
+}
+
+/*
+ * 優先度ブーストのタイマーコールバック
+ * 【役割】全 MLFQ スレッドを最上段へ戻し、次の周期でまた発火する
+ */
+static void mlfq_boost_timer_expired(hrtimer_t* timer) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    for (int i = 0; i < thread_pool_used; i++) {
+        thread_t* thread = &thread_pool[i];
+        if (thread_is_mlfq(thread) && thread->state != THREAD_TERMINATED) {
+            mlfq_set_level(thread, 0);
+        }
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+
+    hrtimer_start_abs(timer, timer->expires_ns + MLFQ_BOOST_INTERVAL_NS);
+}
+
+/*
+ * スレッドを MLFQ クラスにする（enable = false なら通常クラスに戻す）
+ * 【役割】最上段から始める。通常クラスに戻すと優先度は THREAD_PRIORITY_NORMAL
+ * 【戻り値】EDF・公平クラスのスレッドは OS_ERROR_INVALID_STATE
+ * 【備考】ブーストのタイマーは最初に MLFQ に入れたCPUで動く
+ */
+os_result_t thread_set_mlfq(thread_t* thread, bool enable) {
+    if (!thread) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    if (thread_is_edf(thread) || thread_is_fair(thread) ||
+        thread->state == THREAD_TERMINATED) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    if (enable) {
+        thread->sched_class = SCHED_CLASS_MLFQ;
+        thread->mlfq.exec_start_tsc = rdtsc();
+        mlfq_set_level(thread, 0);
+        if (!hrtimer_is_active(&mlfq_boost_timer)) {
+            hrtimer_start(&mlfq_boost_timer, MLFQ_BOOST_INTERVAL_NS);
+        }
+    } else if (thread_is_mlfq(thread)) {
+        thread->sched_class = SCHED_CLASS_NORMAL;
+        thread->base_priority = THREAD_PRIORITY_NORMAL;
+        kmutex_refresh_priority(thread);
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * =================================================================================
+ * クォンタム
+ * =================================================================================
+ * 【方針】切り替え先のクラスのクォンタムから満了時刻（TSC）を決め、
+ * スケジューラティックごとに判定する。満了前は同じ順位のスレッドへ切り替えず、
+ * 順位が上のスレッド（起床した高優先度・EDF など）にはすぐ切り替える。
+ * ティックの周期とは独立しているため、細かいティックで hrtimer 以外の
+ * 判定精度を上げつつ、長いクォンタムで切り替えの回数を減らせる
+ */
+
+/*
+ * 実行中スレッドのクォンタムを開始する
+ * 【備考】TSC 未較正の間は常に満了扱い（ティックごとに切り替える）
+ */
+static void quantum_start(kernel_context_t* ctx, const thread_t* thread) {
+    if (!clock_is_calibrated()) {
+        ctx->quantum_end_tsc = 0;
+        return;
+    }
+    uint64_t cycles = (uint64_t)sched_quantum_us[thread->sched_class] *
+                      clock_get_tsc_khz() / 1000;
+    ctx->quantum_end_tsc = rdtsc() + cycles;
+}
+
+static inline bool quantum_expired(const kernel_context_t* ctx) {
+    return !clock_is_calibrated() || rdtsc() >= ctx->quantum_end_tsc;
+}
+
+/*
+ * クォンタムの設定
+ * 【備考】次にそのクラスのスレッドへ切り替えた時から反映される
+ * 【戻り値】クラスまたは長さが範囲外なら OS_ERROR_INVALID_PARAMETER
+ */
+os_result_t sched_set_quantum_us(uint8_t sched_class, uint32_t us) {
+    if (sched_class >= SCHED_CLASS_COUNT || us < SCHED_QUANTUM_MIN_US ||
+        us > SCHED_QUANTUM_MAX_US) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+    sched_quantum_us[sched_class] = us;
+    return OS_SUCCESS;
+}
+
+uint32_t sched_get_quantum_us(uint8_t sched_class) {
+    return sched_class < SCHED_CLASS_COUNT ? sched_quantum_us[sched_class] : 0;
+}
+
+/*
+ * スレッド切り替え時の計上（全クラス共通の入口）
+ * 【役割】切り替え元の公平クラス・MLFQ クラスの実行時間を締め、
+ * 切り替え先の計上とクォンタムを始めてから EDF の予算を計上する
+ */
+static void account_thread_switch(thread_t* prev, thread_t* next) {
+    kernel_context_t* ctx = get_kernel_context();
+    ctx->context_switches++;
+    quantum_start(ctx, next);
+
+    if (prev && thread_is_fair(prev)) {
+        fair_update_curr(prev);
+    } else if (prev && thread_is_mlfq(prev)) {
+        mlfq_update_curr(prev);
+    }
+    if (thread_is_fair(next)) {
+        next->fair.exec_start_tsc = rdtsc();
+    } else if (thread_is_mlfq(next)) {
+        next->mlfq.exec_start_tsc = rdtsc();
+    }
+    edf_switch_accounting(prev, next);
+    trace_event(TRACE_EV_SWITCH, (uint32_t)prev, (uint32_t)next);
+}
+
+/*
+ * スレッドをスリープ状態に遷移させる関数
+ * 【役割】スレッドの状態と起床時刻を設定する
+ */
+
+/*
+ * 指定時刻（ns）まで現在のスレッドをスリープさせる
+ * 【役割】ブロックしてから自分の sleep_timer を起床時刻に設定する
+ * （タイマーが先頭になればハードウェアタイマーの期限も早まる）
+ * 【備考】絶対時刻で指定するため、周期処理で起床の遅れが積み重ならない
+ */
+void sleep_until(uint64_t wake_up_ns) {
+    thread_t* thread = get_current_thread();
+    if (!thread) {
+        debug_print("SLEEP: No current thread to sleep");
+        return;
+    }
+
+    // ブロックからスイッチまでの間にタイマー割り込みが入らないようにする
+    uint32_t flags = irq_save();
+    if (wake_up_ns <= clock_get_time_ns()) {
+        irq_restore(flags);
+        return;  // 既に過ぎている
+    }
+
+    // 汎用ブロック関数を呼び出す
+    block_current_thread(BLOCK_REASON_TIMER, 0);
+    if (OS_FAILURE_CHECK(hrtimer_start_abs(&thread->sleep_timer, wake_up_ns))) {
+        debug_print("SLEEP: No free hrtimer slot");
+        cancel_block_current_thread();
+        irq_restore(flags);
+        return;
+    }
+
+    // スケジューラへ
+    schedule();
+    irq_restore(flags);
+}
+
+void sleep_ns(uint64_t ns) {
+    if (ns == 0) {
+        return;
+    }
+    sleep_until(clock_get_time_ns() + ns);
+}
+
+/*
+ * sleep() システムコール関数
+ * 【役割】指定されたティック数だけ現在のスレッドをスリープさせる
+ */
+void sleep(uint32_t ticks) {
+    // パラメータ検証
+    if (ticks == 0) {
+        debug_print("SLEEP: Zero ticks - no sleep needed");
+        return;
+    }
+
+    if (ticks > MAX_COUNTER_VALUE) {
+        debug_print("SLEEP: Ticks too large, limiting");
+        ticks = MAX_COUNTER_VALUE;
+    }
+
+    sleep_ns((uint64_t)ticks * TICK_NS);
+}
+
+/*
+ * マイクロ秒単位のスリープ
+ * 【備考】Local APIC タイマー使用時は起床時刻ちょうどに割り込みが設定される。
+ * PIT のみの構成では次のティック（最大10ms）まで遅れる
+ */
+void sleep_us(uint32_t us) {
+    sleep_ns((uint64_t)us * NSEC_PER_USEC);
+}
+
+/*
+ * 現在のスレッドをブロックする汎用関数
+ * 【役割】スレッドをブロックし、理由に応じてブロックリストに挿入する
+ * 【引数】data: SYNCなら待ち対象オブジェクトのアドレス
+ * （TIMERの場合は呼び出し元がブロック後に thread->sleep_timer を開始する）
+ * 【重要】SMPでは割り込み禁止だけでは他CPUからの起床と競合するため、
+ * 待ち条件を持つ呼び出し元は「ブロック → 条件の再確認 → schedule()」の順にし、
+ * 条件が既に満たされていれば cancel_block_current_thread() で取り消すこと。
+ * schedule() 前に起床された場合は RUNNING に戻っているため切り替えは起きない
+ */
+void block_current_thread(block_reason_t reason, uint32_t data) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    irqoff_trace_begin(IRQOFF_SITE_BLOCK, flags);
+
+    thread_t* thread = get_current_thread();
+    if (!thread) {
+        irqoff_trace_end(flags);
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return;
+    }
+
+    // 1. READYリストから削除
+    remove_from_ready_list(thread);
+
+    // 2. ブロック状態と理由を設定
+    thread->state = THREAD_BLOCKED;
+    thread->block_reason = reason;
+    thread->wait_object = (reason == BLOCK_REASON_SYNC) ? (const void*)data : NULL;
+    thread->next_blocked = NULL;
+
+    // 3. ブロックリストの末尾に追加（FIFO）
+    // タイマー待ちの起床順は hrtimer のヒープが管理するため、ここでは並べない
+    if (!blocked_thread_list) {
+        blocked_thread_list = thread;
+    } else {
+        thread_t* current = blocked_thread_list;
+        while (current->next_blocked) {
+            current = current->next_blocked;
+        }
+        current->next_blocked = thread;
+    }
+
+    irqoff_trace_end(flags);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/*
+ * ブロックされたスレッドをブロックリストから外してREADYリングへ戻す
+ * 【役割】所属CPUのリングに入れ、他CPUなら再スケジュールIPIで知らせる
+ * 【備考】所属CPUでまだ実行中（ブロック直後で schedule() 前）なら
+ * RUNNING に戻し、そのまま実行を続けさせる
+ * 【前提】sched_lock を保持していること
+ */
+static void unblock_and_requeue_thread(thread_t* thread, thread_t* prev) {
+    // blocked_listから削除
+    if (prev) {
+        prev->next_blocked = thread->next_blocked;
+    } else {
+        blocked_thread_list = thread->next_blocked;
+    }
+
+    // READYリストに追加
+    edf_wakeup(thread);
+    bool still_running = get_cpu_context(thread->cpu)->current_thread == thread;
+    thread->state = still_running ? THREAD_RUNNING : THREAD_READY;
+    thread->block_reason = BLOCK_REASON_NONE;
+    thread->wait_object = NULL;
+    thread->next_blocked = NULL;
+    add_thread_to_ready_list(thread);
+    smp_kick_cpu(thread->cpu);
+}
+
+/*
+ * 指定スレッドをブロックリストから探して起床させる
+ * 【前提】sched_lock を保持していること。スレッドがブロック中であること
+ */
+static void unblock_thread_locked(thread_t* thread) {
+    thread_t* prev = NULL;
+    thread_t* current = blocked_thread_list;
+    while (current && current != thread) {
+        prev = current;
+        current = current->next_blocked;
+    }
+    if (current) {
+        unblock_and_requeue_thread(thread, prev);
+    }
+}
+
+/*
+ * 現在のスレッドのブロックを取り消す
+ * 【役割】block_current_thread() 後の再確認で待ち条件が既に満たされていた場合に、
+ * schedule() を呼ばずに実行を続けられるようにする（既に起床済みなら何もしない）
+ */
+void cancel_block_current_thread(void) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    thread_t* thread = get_current_thread();
+
+    if (thread && thread->state == THREAD_BLOCKED) {
+        unblock_thread_locked(thread);
+    }
+
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/*
+ * スリープ用 hrtimer のコールバック
+ * 【役割】期限に達したスレッドを起床させる（スレッドを開始したCPUの割り込み内）
+ */
+static void sleep_timer_expired(hrtimer_t* timer) {
+    thread_t* thread = (thread_t*)timer->data;
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    if (thread->state == THREAD_BLOCKED &&
+        thread->block_reason == BLOCK_REASON_TIMER) {
+        unblock_thread_locked(thread);
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/*
+ * キーボード入力待ちでブロックされた全スレッドを起床させる
+ * 【役割】キーボード入力があった時に、ブロック状態の全スレッドをREADYに戻す
+ */
+void unblock_keyboard_threads(void) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    irqoff_trace_begin(IRQOFF_SITE_WAKEUP, flags);
+    thread_t* current = blocked_thread_list;
+    thread_t* prev = NULL;
+    while (current) {
+        thread_t* next = current->next_blocked;
+        if (current->block_reason == BLOCK_REASON_KEYBOARD) {
+            unblock_and_requeue_thread(current, prev);
+        } else {
+            prev = current;
+        }
+        current = next;
+    }
+    irqoff_trace_end(flags);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/*
+ * 同期オブジェクトで待っているスレッドを1つ起床させる
+ * 【役割】実効優先度が最も高い待ちスレッドをREADYに戻す
+ * （同じ優先度なら最も早くブロックしたスレッド＝FIFO）
+ * 【戻り値】起床させたスレッド（待ちがなければNULL）
+ */
+thread_t* wake_one_waiter(const void* wait_object) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    irqoff_trace_begin(IRQOFF_SITE_WAKEUP, flags);
+    thread_t* best = NULL;
+    thread_t* best_prev = NULL;
+    thread_t* prev = NULL;
+    for (thread_t* current = blocked_thread_list; current;
+         current = current->next_blocked) {
+        if (current->block_reason == BLOCK_REASON_SYNC &&
+            current->wait_object == wait_object &&
+            (!best || current->priority > best->priority)) {
+            best = current;
+            best_prev = prev;
+        }
+        prev = current;
+    }
+    if (best) {
+        unblock_and_requeue_thread(best, best_prev);
+    }
+    irqoff_trace_end(flags);
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return best;
+}
+
+/*
+ * 同期オブジェクトの待ちスレッド中で最も高い実効優先度
+ * 【戻り値】待ちがなければ THREAD_PRIORITY_IDLE
+ * 【前提】sched_lock を保持していること
+ */
+uint8_t highest_waiter_priority(const void* wait_object) {
+    uint8_t highest = THREAD_PRIORITY_IDLE;
+    for (thread_t* current = blocked_thread_list; current;
+         current = current->next_blocked) {
+        if (current->block_reason == BLOCK_REASON_SYNC &&
+            current->wait_object == wait_object &&
+            current->priority > highest) {
+            highest = current->priority;
+        }
+    }
+    return highest;
+}
+
+/*
+ * 同期オブジェクトで待っている全スレッドを起床させる
+ * 【戻り値】起床させたスレッド数
+ */
+uint32_t wake_all_waiters(const void* wait_object) {
+    uint32_t woken = 0;
+    while (wake_one_waiter(wait_object)) {
+        woken++;
+    }
+    return woken;
+}
+
+/*
+ * スケジューラ関数
+ * 【役割】次に実行するスレッドを決定し、コンテキストスイッチを実行する
+ * 【重要】タイマー割り込みから呼び出されるOSの心臓部
+ */
+/*
+ * スケジューラのロック状態を管理する関数群
+ * 【前提】schedule() 全体が irq_save 済みの割り込み禁止区間で実行されるため、
+ * ここで cli/sti を行う必要はない（sti するとスイッチ途中で割り込まれる）
+ * 【備考】これは同一CPU内の再入防止用カウンタ。CPU間の排他は sched_lock が担う
+ */
+static inline void acquire_scheduler_lock(void) {
+    get_kernel_context()->scheduler_lock_count++;
+}
+
+static inline void release_scheduler_lock(void) {
+    get_kernel_context()->scheduler_lock_count--;
+}
+
+static inline bool is_scheduler_locked(void) {
+    return get_kernel_context()->scheduler_lock_count > 0;
+}
+
+/*
+ * 初回スレッド選択とコンテキストスイッチ
+ * 【役割】システム起動後の最初のスレッド実行を開始
+ */
+static void handle_initial_thread_selection(void) {
+    kernel_context_t* ctx = get_kernel_context();
+
+    ctx->current_thread = ctx->ready_thread_list;
+    ctx->current_thread->state = THREAD_RUNNING;
+    account_thread_switch(NULL, ctx->current_thread);
 
     debug_print("SCHEDULER: First thread selected, starting multithreading");
 
     release_scheduler_lock();
+    fpu_switch_to(ctx->current_thread);
     initial_context_switch(ctx->current_thread->esp);
     // この後には到達しない
 }
 
 /*
- * ラウンドロビンスケジューリングによるスレッド切り替え
- * 【役割】現在のスレッドから次の実行可能スレッドへ切り替え
+ * スレッドが実行できるか（予算切れの EDF スレッドは READY でも実行しない）
  */
-static void perform_thread_switch(void) {
-    kernel_context_t* ctx = get_kernel_context();
+static inline bool thread_can_run(const thread_t* thread) {
+    return !(thread_is_edf(thread) && thread->edf.throttled);
+}
 
-    thread_t* old_thread = ctx->current_thread;
-    thread_t* next_thread = ctx->current_thread->next_ready;
-
-    // 実行可能な次のスレッドを見つける（BLOCKED状態をスキップ）
-    thread_t* search_start = next_thread;
-    while (next_thread && next_thread != old_thread) {
-        // THREAD_READYの場合のみスレッドスイッチを実行
-        if (next_thread->state == THREAD_READY) {
-            asm volatile("cli");
-            old_thread->state = THREAD_READY;
-            next_thread->state = THREAD_RUNNING;
-            ctx->current_thread = next_thread;
-            asm volatile("sti");
-
-            release_scheduler_lock();
-            context_switch(&old_thread->esp, next_thread->esp);
-            return;
+/*
+ * クラス間の実行順（大きいほど先）
+ * 【備考】アイドル優先度の通常クラス（CPUごとのアイドルスレッド）は
+ * 公平クラスより後にする。ミューテックスの待ちから優先度を継承している
+ * 公平クラスのスレッドは、逆転を防ぐため通常クラスと同じ順位で比べる。
+ * MLFQ クラスは通常クラスと同じ順位（段の優先度で比べる）
+ */
+static int thread_class_rank(const thread_t* thread) {
+    if (thread_is_edf(thread)) {
+        return 3;
+    }
+    if (thread_is_fair(thread)) {
+        return thread->priority > thread->base_priority ? 2 : 1;
+    }
+    return thread->priority == THREAD_PRIORITY_IDLE ? 0 : 2;
+}
+
+/*
+ * 実行順の比較
+ * 【戻り値】a を b より先に実行すべきなら正、同等なら0、後なら負
+ * 【備考】クラスが違えば thread_class_rank() の順。EDF 同士はデッドラインの早い順、
+ * 公平クラス同士は vruntime の小さい順、通常クラス同士は実効優先度の高い順
+ */
+static int compare_thread_order(const thread_t* a, const thread_t* b) {
+    int rank_a = thread_class_rank(a);
+    int rank_b = thread_class_rank(b);
+    if (rank_a != rank_b) {
+        return rank_a - rank_b;
+    }
+    if (thread_is_edf(a)) {
+        if (a->edf.deadline_ns == b->edf.deadline_ns) {
+            return 0;
+        }
+        return a->edf.deadline_ns < b->edf.deadline_ns ? 1 : -1;
+    }
+    if (thread_is_fair(a) && thread_is_fair(b)) {
+        if (a->fair.vruntime == b->fair.vruntime) {
+            return 0;
+        }
+        return a->fair.vruntime < b->fair.vruntime ? 1 : -1;
+    }
+    return (int)a->priority - (int)b->priority;
+}
+
+/*
+ * READYリングから最初に実行すべき実行可能スレッドを選ぶ
+ * 【役割】start から一周し、同順位なら start に近い方を選ぶ
+ * （start を現在スレッドの次にすることで同一優先度内はラウンドロビンになる）
+ * 【戻り値】見つからなければNULL
+ */
+static thread_t* pick_ready_thread(thread_t* start) {
+    thread_t* best = NULL;
+    thread_t* candidate = start;
+    int visited = 0;
+
+    while (candidate && visited < MAX_THREADS) {
+        if (candidate->state == THREAD_READY && thread_can_run(candidate) &&
+            (!best || compare_thread_order(candidate, best) > 0)) {
+            best = candidate;
         }
 
-        // 次のスレッドを試す
-        next_thread = next_thread->next_ready;
+        candidate = candidate->next_ready;
+        visited++;
 
-        // 一周してしまった場合（全スレッドが非READY状態）は終了
-        if (next_thread == search_start) {
+        // 一周したら終了
+        if (candidate == start) {
             break;
         }
     }
+    return best;
+}
+
+/*
+ * リングと公平実行キューから最初に実行すべきREADYスレッドを選ぶ
+ * 【最適化】公平クラスはヒープの先頭を見るだけ（スレッド数によらず O(1)）
+ */
+static thread_t* pick_next_thread(kernel_context_t* ctx, thread_t* start) {
+    thread_t* best = pick_ready_thread(start);
+    thread_t* fair = fair_pick_first(ctx);
+
+    if (fair && fair->state == THREAD_READY &&
+        (!best || compare_thread_order(fair, best) > 0)) {
+        best = fair;
+    }
+    return best;
+}
+
+/*
+ * 現在スレッドの次に実行すべきスレッドを探す
+ * 【戻り値】現在スレッドより順位が上のREADYスレッド、またはクォンタム満了後
+ * （allow_equal）なら同順位のスレッド（現在スレッドが予算切れなら順位を問わない）。
+ * 公平クラス同士はさらに vruntime の差が最小粒度を超えた場合だけ。
+ * なければNULL（現在スレッドを継続）
+ * 【備考】公平クラスのスレッドはリングにいないため、リングの先頭から探す
+ */
+static thread_t* find_next_ready_thread(thread_t* current, bool allow_equal) {
+    kernel_context_t* ctx = get_kernel_context();
+    thread_t* start =
+        thread_is_fair(current) ? ctx->ready_thread_list : current->next_ready;
+    thread_t* next_thread = pick_next_thread(ctx, start);
+
+    if (!next_thread || next_thread == current) {
+        return NULL;
+    }
+    if (!thread_can_run(current)) {
+        return next_thread;
+    }
+    int order = compare_thread_order(next_thread, current);
+    if (order < 0) {
+        return NULL;
+    }
+    if (thread_is_fair(current) && thread_is_fair(next_thread) &&
+        thread_class_rank(current) == thread_class_rank(next_thread)) {
+        return allow_equal && fair_should_preempt(current, next_thread)
+                   ? next_thread
+                   : NULL;
+    }
+    if (order == 0 && !allow_equal) {
+        return NULL;  // クォンタムが残っている間は同順位に譲らない
+    }
+    return next_thread;
+}
+
+/*
+ * 実行中スレッドから指定スレッドへの切り替え
+ * 【前提】割り込み禁止・sched_lock 保持で呼ぶこと。old_threadは実行可能なまま残る
+ */
+static void switch_to_thread(thread_t* old_thread, thread_t* next_thread) {
+    kernel_context_t* ctx = get_kernel_context();
+
+    account_thread_switch(old_thread, next_thread);
+    old_thread->state = THREAD_READY;
+    next_thread->state = THREAD_RUNNING;
+    ctx->current_thread = next_thread;
+
+    fpu_switch_to(next_thread);
+    context_switch(&old_thread->esp, next_thread->esp);
+}
+
+/*
+ * ラウンドロビンスケジューリングによるスレッド切り替え
+ * 【役割】現在のスレッドから次の実行可能スレッドへ切り替え
+ */
+static void perform_thread_switch(void) {
+    kernel_context_t* ctx = get_kernel_context();
+    thread_t* old_thread = ctx->current_thread;
+    bool expired = quantum_expired(ctx);
+    thread_t* next_thread = find_next_ready_thread(old_thread, expired);
+    if (!next_thread && expired) {
+        quantum_start(ctx, old_thread);  // 譲る相手がいなければ続けて実行する
+    }
 
-    // 実行可能なスレッドが見つからなかった場合
-    // debug_print("SCHEDULER: No ready threads found for switch");
     release_scheduler_lock();
+
+    // 実行可能なスレッドが見つからなかった場合は現在のスレッドを継続
+    if (next_thread) {
+        switch_to_thread(old_thread, next_thread);
+    }
 }
 
+static void schedule_locked(void);
+
 /*
  * ブロックされたスレッドからの強制スケジューリング
  * 【役割】現在のスレッドがBLOCKED/SLEEPINGの場合、強制的に次のREADYスレッドに切り替え
@@ -947,47 +1840,46 @@ static void perform_thread_switch(void) {
 static void handle_blocked_thread_scheduling(void) {
     kernel_context_t* ctx = get_kernel_context();
     thread_t* blocked_thread = ctx->current_thread;
+    thread_t* next_thread = pick_next_thread(ctx, ctx->ready_thread_list);
 
     // 実行可能なスレッドを探す
-    if (ctx->ready_thread_list &&
-        ctx->ready_thread_list->state == THREAD_READY) {
-        asm volatile("cli");
-        ctx->ready_thread_list->state = THREAD_RUNNING;
-        ctx->current_thread = ctx->ready_thread_list;
-        asm volatile("sti");
+    if (next_thread) {
+        account_thread_switch(blocked_thread, next_thread);
+        next_thread->state = THREAD_RUNNING;
+        ctx->current_thread = next_thread;
 
         // debug_print("SCHEDULER: Switched to next ready thread from blocked
         // thread");
         release_scheduler_lock();
         // ブロックされたスレッドのコンテキストを保存してから切り替え
+        fpu_switch_to(ctx->current_thread);
         context_switch(&blocked_thread->esp, ctx->current_thread->esp);
     } else {
         // 実行可能なスレッドがない場合は、システムを一時停止
         debug_print("SCHEDULER: No ready threads available, system idle");
         release_scheduler_lock();
 
-        // CPUを停止してタイマー割り込みを待つ
-        while (!ctx->ready_thread_list ||
-               ctx->ready_thread_list->state != THREAD_READY) {
-            asm volatile("hlt");  // 次の割り込みまでCPU停止
+        // CPUを停止してタイマー割り込み・IPIを待つ
+        // （schedule() は割り込み禁止で動くため、待機中だけ有効化する。
+        // 他CPUが起床処理できるよう sched_lock も手放す）
+        while (!pick_next_thread(ctx, ctx->ready_thread_list)) {
+            spin_unlock(&sched_lock);
+            irqoff_trace_end(EFLAGS_IF);
+            asm volatile("sti; hlt; cli");  // 次の割り込みまでCPU停止
+            irqoff_trace_begin(IRQOFF_SITE_SCHEDULE, EFLAGS_IF);
+            spin_lock(&sched_lock);
         }
 
         // 新しいREADYスレッドが復活したらスケジューラを再実行
-        schedule();
+        schedule_locked();
     }
 }
 
 /*
- * メインスケジューラ関数
- * 【役割】スレッドスケジューリングの統合制御
+ * スケジューリング判断とスイッチ（割り込み禁止・sched_lock 保持で呼ばれる）
  */
-void schedule(void) {
-    if (is_scheduler_locked()) {
-        return;
-    }
-
+static void schedule_locked(void) {
     acquire_scheduler_lock();
-    check_and_wake_timer_threads();
     kernel_context_t* ctx = get_kernel_context();
 
     if (!ctx->ready_thread_list) {
@@ -1000,8 +1892,20 @@ void schedule(void) {
         return;
     }
 
-    // 現在のスレッドがブロック状態の場合、強制的に次のスレッドに切り替え
-    if (ctx->current_thread->state == THREAD_BLOCKED) {
+    // 実行時間を計上（EDF は予算切れならここで止まる）
+    if (thread_is_edf(ctx->current_thread)) {
+        edf_account(ctx->current_thread, clock_get_time_ns());
+    } else if (thread_is_fair(ctx->current_thread) &&
+               ctx->current_thread->state == THREAD_RUNNING) {
+        fair_update_curr(ctx->current_thread);
+    } else if (thread_is_mlfq(ctx->current_thread) &&
+               ctx->current_thread->state == THREAD_RUNNING) {
+        mlfq_update_curr(ctx->current_thread);  // 持ち時間切れならここで下がる
+    }
+
+    // 現在のスレッドがブロック/終了状態の場合、強制的に次のスレッドに切り替え
+    if (ctx->current_thread->state == THREAD_BLOCKED ||
+        ctx->current_thread->state == THREAD_TERMINATED) {
         handle_blocked_thread_scheduling();
         return;
     }
@@ -1010,10 +1914,212 @@ void schedule(void) {
 }
 
 /*
- * カーネルコンテキストへのアクセサ
+ * メインスケジューラ関数
+ * 【役割】スレッドスケジューリングの統合制御
+ * 【重要】判断からcontext_switchまでを割り込み禁止で行う。
+ * スイッチ後は再開したスレッド自身が保存していたフラグを復元する
+ * （タイマー割り込みからなら禁止のまま iret、sleep() からなら有効に戻る）
+ */
+void schedule(void) {
+    uint32_t flags = irq_save();
+    irqoff_trace_begin(IRQOFF_SITE_SCHEDULE, flags);
+
+    if (!is_scheduler_locked()) {
+        spin_lock(&sched_lock);
+        schedule_locked();
+        spin_unlock(&sched_lock);
+    }
+
+    irqoff_trace_end(flags);
+    irq_restore(flags);
+}
+
+/*
+ * 新規スレッドの初回実行時の後処理
+ * 【役割】切り替え元が保持したまま渡した sched_lock を解放する
+ * （thread_entry_trampoline から割り込み有効化の前に呼ばれる）
+ */
+void schedule_tail(void) {
+    spin_unlock(&sched_lock);
+    irqoff_trace_end(EFLAGS_IF);  // この後 sti する
+}
+
+/*
+ * 自発的なCPU譲渡（ファストパス）
+ * 【役割】現在のスレッドをREADYのまま、同じ以上の優先度を持つ次の実行可能スレッドへ
+ * 切り替える
+ * 【最適化】schedule() と違いタイマー起床チェック（ブロックリスト走査）を行わない。
+ * 起床処理は次のタイマー割り込みに任せる
+ * 【戻り値】切り替えた場合true、他に実行可能スレッドがなければfalse
+ */
+bool thread_yield(void) {
+    uint32_t flags = irq_save();
+    irqoff_trace_begin(IRQOFF_SITE_YIELD, flags);
+    thread_t* current = get_current_thread();
+    thread_t* next = NULL;
+
+    if (current && !is_scheduler_locked()) {
+        spin_lock(&sched_lock);
+        next = find_next_ready_thread(current, true);
+        if (next) {
+            switch_to_thread(current, next);
+        }
+        spin_unlock(&sched_lock);
+    }
+
+    irqoff_trace_end(flags);
+    irq_restore(flags);
+    return next != NULL;
+}
+
+/*
+ * 指定スレッドへの直接ハンドオフ（L4方式）
+ * 【役割】スケジューラの選択を経ずに target へ即座に切り替える
+ * 【用途】プロデューサ/コンシューマ間で相手を直接起こして実行権を渡す
+ * 【備考】target は同じCPUのスレッドであること（他CPUのスレッドは実行できない）
+ */
+os_result_t thread_yield_to(thread_t* target) {
+    if (!target) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    uint32_t flags = irq_save();
+    irqoff_trace_begin(IRQOFF_SITE_YIELD, flags);
+    thread_t* current = get_current_thread();
+    os_result_t result = OS_SUCCESS;
+
+    if (!current || is_scheduler_locked()) {
+        result = OS_ERROR_INVALID_STATE;
+    } else if (target != current) {
+        spin_lock(&sched_lock);
+        if (target->state == THREAD_READY && target->cpu == current->cpu) {
+            switch_to_thread(current, target);
+        } else {
+            result = OS_ERROR_INVALID_STATE;  // BLOCKED/終了済み/他CPUには渡せない
+        }
+        spin_unlock(&sched_lock);
+    }
+
+    irqoff_trace_end(flags);
+    irq_restore(flags);
+    return result;
+}
+
+/*
+ * スレッド優先度の設定
+ * 【役割】基本優先度を変更し、保持中ミューテックスの待ちスレッドから
+ * 継承している優先度と合わせて実効優先度を再計算する
+ * 【備考】READYリングは優先度順ではないため、次のスケジューリングから反映される
+ * 【戻り値】MLFQ クラスのスレッドは段で優先度が決まるため OS_ERROR_INVALID_STATE
+ */
+os_result_t thread_set_priority(thread_t* thread, uint8_t priority) {
+    if (!thread) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (priority > THREAD_PRIORITY_MAX) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    if (thread_is_mlfq(thread)) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return OS_ERROR_INVALID_STATE;
+    }
+    thread->base_priority = priority;
+    kmutex_refresh_priority(thread);
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * 優先度継承の再計算（ロック付き）
+ * 【役割】ブロックリストを参照する kmutex_refresh_priority を sched_lock 下で呼ぶ
+ */
+void thread_refresh_priority(thread_t* thread) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    kmutex_refresh_priority(thread);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/*
+ * スレッドを別CPUへ移す
+ * 【役割】READYのスレッドを指定CPUのREADYリングへ移し、そのCPUで実行させる
+ * 【制約】FPU状態は元のCPUのレジスタに残っている可能性があるため、
+ * FPU/SSEを一度でも使ったスレッドは移動できない。
+ * EDF 帯域はCPUごとに受け入れているため、EDF スレッドも移動できない
+ */
+os_result_t thread_set_cpu(thread_t* thread, uint32_t cpu) {
+    if (!thread) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (cpu >= MAX_CPUS || !get_cpu_context(cpu)->online) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    os_result_t result = OS_SUCCESS;
+    if (thread->state != THREAD_READY || thread->fpu_used ||
+        thread_is_edf(thread)) {
+        result = OS_ERROR_INVALID_STATE;
+    } else if (thread->cpu != cpu) {
+        remove_from_ready_list(thread);
+        if (thread_is_fair(thread)) {
+            // vruntime を移動先のキューの基準に付け替える
+            uint64_t old_min = fair_rq_of(thread)->min_vruntime;
+            uint64_t new_min = get_cpu_context(cpu)->fair_rq.min_vruntime;
+            uint64_t lag = thread->fair.vruntime > old_min
+                               ? thread->fair.vruntime - old_min
+                               : 0;
+            thread->fair.vruntime = new_min + lag;
+        }
+        thread->cpu = cpu;
+        add_thread_to_ready_list(thread);
+        smp_kick_cpu(cpu);
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return result;
+}
+
+/*
+ * スレッド終了関数
+ * 【役割】現在のスレッドをREADYリストから外し、スロットを再利用可能にする
+ * 【備考】スレッド関数から戻った場合も thread_entry_trampoline 経由で呼ばれる
+ */
+void thread_exit(void) {
+    uint32_t flags = irq_save();  // 二度と戻らないため復元しない
+    irqoff_trace_begin(IRQOFF_SITE_SCHEDULE, flags);
+    spin_lock(&sched_lock);  // 切り替え先が解放する
+
+    thread_t* thread = get_current_thread();
+    remove_from_ready_list(thread);
+    thread->state = THREAD_TERMINATED;
+    edf_leave_class(thread);
+    fpu_release_thread(thread);
+
+    // ブロック時と同じ経路で次のスレッドへ（この後には到達しない）
+    schedule_locked();
+    while (1) {
+        asm volatile("hlt");
+    }
+}
+
+/*
+ * 実行中CPUのカーネルコンテキストへのアクセサ
+ * 【最適化】GSセグメントのベースが自CPUのコンテキストを指しているため、
+ * 先頭の self を1命令で読むだけで済む（LAPIC ID の読み出しや表引きは不要）
+ * 【備考】スレッドは所属CPUでしか走らないため、関数内で値が変わることはない
  */
 kernel_context_t* get_kernel_context(void) {
-    return &k_context;
+    kernel_context_t* ctx;
+    asm("movl %%gs:0, %0" : "=r"(ctx));
+    return ctx;
+}
+
+/*
+ * 指定CPUのカーネルコンテキスト
+ */
+kernel_context_t* get_cpu_context(uint32_t cpu) {
+    return &cpu_contexts[cpu];
 }
 
 /*
@@ -1029,55 +2135,71 @@ thread_t* get_current_thread(void) {
  * 【備考】スレッドのタイミング制御やsleep機能で使用される
  */
 uint32_t get_system_ticks(void) {
-    return get_kernel_context()->system_ticks;
+    // TSC 較正後は TSC から求める（PIT は Local APIC タイマーへの切り替えで止まる）
+    if (clock_is_calibrated()) {
+        return clock_get_ticks();
+    }
+    return system_ticks;
 }
 
 /*
- * スレッドの共通カウンター更新処理
- * @param last_tick_ptr: 前回更新時のtick値へのポインタ
- * @param interval_ticks: 更新間隔（tick数）
- * スレッドの共通カウンター更新処理
- * @param last_tick_ptr: 前回更新時のtick値へのポインタ
- * @param interval_ticks: 更新間隔（tick数）
+ * スレッドのカウンターを1つ進めて表示する
  * @param thread_name: 表示用スレッド名
  * @param display_row: 画面表示行
- * @return: カウンターが更新された場合は1、そうでなければ0
  */
-int update_thread_counter(uint32_t* last_tick_ptr, uint32_t interval_ticks,
-                          const char* thread_name, int display_row) {
+void increment_thread_counter(const char* thread_name, int display_row) {
     thread_t* self = get_current_thread();
-    uint32_t current_ticks = get_system_ticks();
+    if (!self) {
+        return;
+    }
 
-    if (self && current_ticks - *last_tick_ptr >= interval_ticks) {
-        self->counter++;
+    self->counter++;
 
-        // カウンターが65535を超えたら0にリセット
-        if (self->counter > MAX_COUNTER_VALUE) {
-            self->counter = 0;
-        }
+    // カウンターが65535を超えたら0にリセット
+    if (self->counter > MAX_COUNTER_VALUE) {
+        self->counter = 0;
+    }
 
-        *last_tick_ptr = current_ticks;
+    // 画面に表示
+    char buffer[16];
+    itoa(self->counter, buffer, 10);
 
-        // 画面に表示
-        char buffer[16];
-        itoa(self->counter, buffer, 10);
+    char display[40];
+    int pos = 0;
 
-        char display[40];
-        int pos = 0;
+    // スレッド名をコピー
+    while (*thread_name) display[pos++] = *thread_name++;
 
-        // スレッド名をコピー
-        while (*thread_name) display[pos++] = *thread_name++;
+    // カウンター値をコピー
+    for (int i = 0; buffer[i]; i++) {
+        display[pos++] = buffer[i];
+    }
 
-        // カウンター値をコピー
-        for (int i = 0; buffer[i]; i++) {
-            display[pos++] = buffer[i];
-        }
+    // 残りをスペースで埋める
+    while (pos < DISPLAY_LINE_LENGTH) display[pos++] = ' ';
+    display[pos] = 0;  // null終端
+
+    print_at(display_row, 2, display, VGA_COLOR_WHITE);
+}
 
-        // 残りをスペースで埋める
-        while (pos < DISPLAY_LINE_LENGTH) display[pos++] = ' ';
-        display[pos] = 0;  // null終端
+/*
+ * スレッドの共通カウンター更新処理（ティックのポーリング版）
+ * @param last_tick_ptr: 前回更新時のtick値へのポインタ
+ * @param interval_ticks: 更新間隔（tick数）
+ * @param thread_name: 表示用スレッド名
+ * @param display_row: 画面表示行
+ * @return: カウンターが更新された場合は1、そうでなければ0
+ * 【備考】周期で動く処理は periodic_task_create() で作成する方が、
+ * 空振りの起床がない
+ */
+int update_thread_counter(uint32_t* last_tick_ptr, uint32_t interval_ticks,
+                          const char* thread_name, int display_row) {
+    uint32_t current_ticks = get_system_ticks();
 
-        print_at(display_row, 2, display, VGA_COLOR_WHITE);
+    if (get_current_thread() &&
+        current_ticks - *last_tick_ptr >= interval_ticks) {
+        *last_tick_ptr = current_ticks;
+        increment_thread_counter(thread_name, display_row);
         return 1;  // 更新された
     }
     return 0;  // 更新されなかった
@@ -1095,67 +2217,69 @@ int update_thread_counter(uint32_t* last_tick_ptr, uint32_t interval_ticks,
  * 無限ループでHLT命令を実行し、割り込み待ちする
  */
 void idle_thread(void) {
-    // アイドルスレッド - システム情報表示とメインループ
-    debug_print("KERNEL: System running... Watch the counters update!");
-    debug_print("KERNEL: Each thread runs in 10ms time slices");
-    debug_print("KERNEL: Idle thread running with HLT");
+    // アイドルスレッド - システム情報表示とメインループ（表示はBSPのみ）
+    if (get_kernel_context()->cpu_id == 0) {
+        debug_print("KERNEL: System running... Watch the counters update!");
+        debug_print("KERNEL: Tick %u us, quantum %u us (change with 'tune')",
+                    lapic_timer_is_running() ? lapic_timer_get_tick_us()
+                                             : TICK_US,
+                    sched_get_quantum_us(SCHED_CLASS_NORMAL));
+        debug_print("KERNEL: Idle thread running with HLT");
+    }
 
     while (1) {
-        asm volatile("hlt");  // 割り込み待ち
+        // 他に実行可能なスレッドがあれば譲り、なければ割り込み待ち
+        if (!thread_yield()) {
+            asm volatile("hlt");
+        }
     }
 }
 
 /*
- * スレッド関数1
- * 【役割】1.0秒間隔でカウンターを更新する
+ * 周期ジョブ（スレッド A/B）
+ * 【役割】A は1.0秒、B は1.5秒ごとにカウンターを更新する
+ * 【備考】periodic_task_create() が周期境界ちょうどに起動するため、
+ * 空振りの起床も周期のずれもない。EDF クラスで動くため、
+ * 通常クラスのスレッドが CPU を占有していてもリリース直後に実行される
  */
-static void threadA(void) {
-    uint32_t last_tick = 0;
-
-    while (1) {
-        update_thread_counter(&last_tick, 100, "Thread A: ", 13);
-        sleep(50);  // 500ms
-    }
+static void threadA_job(void) {
+    increment_thread_counter("Thread A: ", 13);
 }
 
-static void threadB(void) {
-    uint32_t last_tick = 0;
-
-    while (1) {
-        update_thread_counter(&last_tick, 150, "Thread B: ", 14);
-        sleep(75);  // 750ms
-    }
+static void threadB_job(void) {
+    increment_thread_counter("Thread B: ", 14);
 }
 
 /*
  * スレッド関数3
  * 【役割】キーボードからの入力を処理し、画面に表示するデモ
+ * 【備考】表示は専用の仮想コンソール（Alt+F2）の上から書く
  */
 static void threadC(void) {
     char input_buffer[64];
     char ch;
 
     // キーボード入力デモンストレーション
-    print_at(15, 2,
+    print_at(0, 2,
              "Thread C: Keyboard Input Demo - Press keys:", VGA_COLOR_WHITE);
-    print_at(16, 3, "Press 'q' to quit, Enter for string input",
+    print_at(1, 3, "Press 'q' to quit, Enter for string input",
              VGA_COLOR_GRAY);
 
     while (1) {
-        print_at(17, 3, "Press a key (or 's' for string): ", VGA_COLOR_WHITE);
+        print_at(3, 3, "Press a key (or 's' for string): ", VGA_COLOR_WHITE);
         ch = getchar();
 
         if (ch == 'q' || ch == 'Q') {
-            print_at(18, 3, "Keyboard demo terminated.         ",
+            print_at(4, 3, "Keyboard demo terminated.         ",
                      VGA_COLOR_RED);
             break;
         } else if (ch == 's' || ch == 'S') {
-            print_at(18, 3, " Enter string: ", VGA_COLOR_YELLOW);
+            print_at(4, 3, " Enter string: ", VGA_COLOR_YELLOW);
             read_line(input_buffer, sizeof(input_buffer));
 
-            clear_line(19);
-            print_at(19, 3, " You entered: ", VGA_COLOR_GREEN);
-            print_at(19, 17, input_buffer, VGA_COLOR_CYAN);
+            clear_line(5);
+            print_at(5, 3, " You entered: ", VGA_COLOR_GREEN);
+            print_at(5, 17, input_buffer, VGA_COLOR_CYAN);
         } else {
             char msg[32];
             msg[0] = 'K';
@@ -1172,8 +2296,9 @@ static void threadC(void) {
             msg[len] = ')';
             msg[len + 1] = 0;
 
-            clear_line(18);
-            print_at(18, 3, msg, VGA_COLOR_MAGENTA);
+            clear_line(4);
+            print_at(4, 3, msg, VGA_COLOR_MAGENTA);
+            keyboard_record_echo();
         }
 
         sleep(5);  // 短い待機
@@ -1185,13 +2310,34 @@ static void threadC(void) {
 
 /*
  * カーネルコンテキスト初期化関数
+ * 【重要】get_kernel_context() が使えるよう、BSPのGDT（GSセグメント）を
+ * 最初に設定する。AP のコンテキストは ap_main で自分の GDT に登録される
  */
 static void init_kernel_context(void) {
-    k_context.current_thread = NULL;
-    k_context.ready_thread_list = NULL;
-    k_context.blocked_thread_list = NULL;
-    k_context.system_ticks = 0;
-    k_context.scheduler_lock_count = 0;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        kernel_context_t* ctx = &cpu_contexts[cpu];
+        ctx->self = ctx;
+        ctx->current_thread = NULL;
+        ctx->ready_thread_list = NULL;
+        ctx->idle_thread = NULL;
+        ctx->cpu_id = cpu;
+        ctx->lapic_id = 0;
+        ctx->online = false;
+        ctx->scheduler_lock_count = 0;
+        ctx->edf_bandwidth_ppm = 0;
+        hrtimer_init(&ctx->edf_budget_timer, edf_budget_timer_expired, ctx);
+        ctx->fair_rq.count = 0;
+        ctx->fair_rq.min_vruntime = 0;
+        ctx->quantum_end_tsc = 0;
+        ctx->context_switches = 0;
+    }
+    hrtimer_init(&mlfq_boost_timer, mlfq_boost_timer_expired, NULL);
+    blocked_thread_list = NULL;
+    system_ticks = 0;
+
+    gdt_init_cpu(0, &cpu_contexts[0], sizeof(kernel_context_t),
+                 KERNEL_STACK_TOP);
+    cpu_contexts[0].online = true;
     debug_print("KERNEL: Context initialized");
 }
 
@@ -1219,6 +2365,9 @@ static void init_interrupt_and_io_systems(void) {
      * 割り込みシステム初期化
      * 【重要】この時点からタイマー割り込みが発生し始める
      */
+    // 割り込みハンドラのボトムハーフ（割り込みの有効化前に準備する）
+    softirq_init();
+
     debug_print("KERNEL: About to initialize interrupts");
     init_interrupts();
     debug_print("KERNEL: Interrupts initialized");
@@ -1230,6 +2379,12 @@ static void init_interrupt_and_io_systems(void) {
     debug_print("KERNEL: About to initialize keyboard");
     init_keyboard();
     debug_print("KERNEL: Keyboard initialized");
+
+    // シリアル受信（キーボードのない環境でのコマンド入力）
+    serial_rx_init();
+
+    // VBE の検出（グラフィックスモードへはベンチマークの時だけ切り替える）
+    vbe_init();
 }
 
 /*
@@ -1246,21 +2401,44 @@ static void init_thread_system(void) {
         debug_print("FATAL: Failed to create kernel thread");
         while (1) asm volatile("hlt");  // システム停止
     }
+    // 他に実行可能なスレッドがない時だけ動くよう最低優先度にする
+    thread_set_priority(kernel_thread, THREAD_PRIORITY_IDLE);
+    get_kernel_context()->idle_thread = kernel_thread;
     debug_print("KERNEL: Kernel thread created");
 
-    thread_t* thread_a;
-    result = create_thread(threadA, 100, 13, &thread_a);
+    // ワークキューを処理する kworker スレッド
+    result = workqueue_start();
+    if (OS_FAILURE_CHECK(result)) {
+        debug_print("ERROR: Failed to create workqueue thread");
+    }
+
+    // バイナリ出力のトレースイベントを送出するスレッド
+    result = trace_start();
+    if (OS_FAILURE_CHECK(result)) {
+        debug_print("ERROR: Failed to create trace thread");
+    }
+
+    // 画面の裏バッファを VGA メモリへ転送するコンポジタ
+    result = vga_compositor_start();
+    if (OS_FAILURE_CHECK(result)) {
+        debug_print("ERROR: Failed to create VGA compositor");
+    }
+
+    periodic_task_t* task_a;
+    result = periodic_task_create(THREAD_A_PERIOD_NS, threadA_job, 13, &task_a);
     if (OS_FAILURE_CHECK(result)) {
         debug_print("ERROR: Failed to create thread A");
     } else {
+        periodic_task_set_runtime(task_a, THREAD_PERIODIC_RUNTIME_NS);
         debug_print("KERNEL: Thread A created");
     }
 
-    thread_t* thread_b;
-    result = create_thread(threadB, 150, 14, &thread_b);
+    periodic_task_t* task_b;
+    result = periodic_task_create(THREAD_B_PERIOD_NS, threadB_job, 14, &task_b);
     if (OS_FAILURE_CHECK(result)) {
         debug_print("ERROR: Failed to create thread B");
     } else {
+        periodic_task_set_runtime(task_b, THREAD_PERIODIC_RUNTIME_NS);
         debug_print("KERNEL: Thread B created");
     }
 
@@ -1269,9 +2447,31 @@ static void init_thread_system(void) {
     if (OS_FAILURE_CHECK(result)) {
         debug_print("ERROR: Failed to create thread C");
     } else {
+        vga_console_bind(thread_c, VGA_CONSOLE_KEYBOARD);
+        // キー入力への応答を優先する（入力待ちでほとんど CPU を使わないため、
+        // MLFQ の最上段に留まり、CPU を使い続けるスレッドより先に動く）
+        thread_set_mlfq(thread_c, true);
         debug_print("KERNEL: Thread C created");
     }
 
+    // シリアルシェル（入力待ちでほとんど CPU を使わないため MLFQ で応答を優先）
+    thread_t* shell;
+    result = create_thread(debug_enter_interactive_mode, 1, 0, &shell);
+    if (OS_FAILURE_CHECK(result)) {
+        debug_print("ERROR: Failed to create serial shell thread");
+    } else {
+        thread_set_mlfq(shell, true);
+    }
+
+#ifdef BENCHMARK_ON_BOOT
+    // ベンチマークスレッド（make BENCH=1 でビルドした場合のみ）
+    thread_t* bench;
+    result = create_thread(benchmark_thread, 1, 0, &bench);
+    if (OS_FAILURE_CHECK(result)) {
+        debug_print("ERROR: Failed to create benchmark thread");
+    }
+#endif
+
     debug_print("KERNEL: Thread system initialized");
     debug_print("KERNEL: Waiting for timer interrupt to start scheduling");
 }
@@ -1302,6 +2502,9 @@ void kernel_main(void) {
     init_kernel_context();
     init_basic_systems();
     init_interrupt_and_io_systems();
+    clock_init();  // PIT を基準に TSC を較正（Local APIC タイマーの較正に使う）
+    smp_init();  // AP は各自のアイドルスレッドで待機を始める
+    init_apic_interrupts();  // PIT/PIC → Local APIC タイマー/I/O APIC
     init_thread_system();
     kernel_main_loop();
 }
@@ -1312,29 +2515,54 @@ void kernel_main(void) {
  * =================================================================================
  */
 
+static void timer_report_work_func(void* data) {
+    (void)data;
+    debug_print("TIMER: Timer interrupt fired 100 times");
+}
+
+static work_t timer_report_work = {.func = timer_report_work_func};
+
 /*
- * タイマー割り込みハンドラ（C言語部分）
- * 【重要】この関数は10ms間隔で自動的に呼ばれる
+ * ティックの動作確認表示（CPU 0 で 100 ティックごと）
  */
-void timer_handler_c(void) {
-    // PIC（Programmable Interrupt Controller）に割り込み処理完了を通知
-    // これがないと次の割り込みが発生しない
-    outb(PIC_MASTER_COMMAND, PIC_EOI);
-
-    // デバッグ: 割り込みハンドラ実行確認（簡略版）
-    static uint32_t interrupt_count = 0;
-    interrupt_count++;
-    if (interrupt_count % 100 == 0) {
-        debug_print("TIMER: Timer interrupt fired 100 times");
+static void timer_tick_report(void) {
+    if (get_kernel_context()->cpu_id == 0) {
+        // デバッグ: 割り込みハンドラ実行確認（簡略版）
+        static uint32_t interrupt_count = 0;
+        interrupt_count++;
+        if (interrupt_count % 100 == 0) {
+            queue_work(&timer_report_work);  // シリアル出力は kworker で行う
+        }
     }
+}
+
+/*
+ * タイマー割り込みハンドラ（PIT, IRQ0）
+ * 【重要】この関数は10ms間隔で自動的に呼ばれる
+ * 【備考】EOI とスケジューラの実行は振り分け側（interrupt_dispatch_c）が行う。
+ * Local APIC タイマーへ切り替えた後は PIT がマスクされ、呼ばれなくなる
+ */
+static bool pit_timer_irq_handler(void* ctx) {
+    (void)ctx;
+    system_ticks++;  // システム時刻を更新（TSC 較正前はこれが時刻の基準）
+    hrtimer_run_expired();
+    timer_tick_report();
+    return true;
+}
 
-    get_kernel_context()->system_ticks++;  // システム時刻を更新
+/*
+ * スケジューラティック（Local APIC タイマー）
+ * 【役割】ティックごとに呼ばれ、全CPUでスケジューラを動かす
+ * （クォンタムを使い切ったスレッドはここで同順位のスレッドへ切り替わる）
+ */
+void timer_tick(void) {
+    timer_tick_report();
 
     /*
      * スケジューラ実行
      * 【重要】ここでスレッドの切り替えが発生する可能性
      * 【注意】タイマー割り込みハンドラ内では既に割り込みが無効化されているため
-     * 追加のcliは不要。context_switch内でpopfdによりEFLAGSが復元され割り込み有効化される
+     * 追加のcliは不要。iretでEFLAGSが復元され割り込みが再び有効化される
      */
     schedule();
 }
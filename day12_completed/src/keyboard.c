@@ -1,10 +1,43 @@
 #include "keyboard.h"
 
+#include "clock.h"
+#include "irq.h"
 #include "kernel.h"
+#include "softirq.h"
+#include "vga.h"
 
 // キーボード関連の静的変数
 static keyboard_buffer_t kbd_buffer;         // キーボード入力バッファ
 static volatile bool shift_pressed = false;  // Shiftキーの状態
+static bool extended_pending = false;        // 直前が 0xE0（拡張キー）
+static bool alt_pressed = false;             // Altキーの状態（左右どちらか）
+
+// エコー遅延の計測（スロットごとの格納時刻と、最後に読み出したキーの時刻）
+static uint64_t kbd_stamp_ns[KEYBOARD_BUFFER_SIZE];
+static uint64_t last_key_ns;  // 0 なら計測対象のキーなし
+static keyboard_latency_t kbd_latency;
+
+// トップハーフ → タスクレットのスキャンコード（SPSC）
+static struct {
+    uint8_t codes[KEYBOARD_SCANCODE_RING_SIZE];
+    volatile int head;  // 割り込みハンドラが書く
+    volatile int tail;  // タスクレットが読む
+} kbd_scancodes;
+
+// タスクレット → kworker のデバッグ出力用の記録（SPSC）
+static struct {
+    char ascii[KEYBOARD_KEY_LOG_SIZE];
+    uint8_t scancode[KEYBOARD_KEY_LOG_SIZE];
+    volatile int head;
+    volatile int tail;
+} kbd_key_log;
+
+static bool keyboard_irq_handler(void* ctx);
+static void keyboard_tasklet_func(void* data);
+static void keyboard_log_work_func(void* data);
+// 割り込みの有効化直後から使えるよう静的に初期化する
+static tasklet_t kbd_tasklet = {.func = keyboard_tasklet_func};
+static work_t kbd_log_work = {.func = keyboard_log_work_func};
 
 // スキャンコード→ASCII変換テーブル（US配列）
 static const char scancode_to_ascii[] = {
@@ -43,6 +76,7 @@ void keyboard_buffer_put(char c) {
 
     // 先にデータを書き込み、その後headを公開（SPSC）
     kbd_buffer.buffer[kbd_buffer.head] = c;
+    kbd_stamp_ns[kbd_buffer.head] = clock_get_time_ns();
     kbd_buffer.head = next_head;
 }
 
@@ -56,6 +90,7 @@ char keyboard_buffer_get(void) {
     }
 
     char c = kbd_buffer.buffer[kbd_buffer.tail];
+    last_key_ns = kbd_stamp_ns[kbd_buffer.tail];
     kbd_buffer.tail = (kbd_buffer.tail + 1) % KEYBOARD_BUFFER_SIZE;
     return c;
 }
@@ -75,6 +110,55 @@ bool keyboard_buffer_is_full(void) {
     return next_head == kbd_buffer.tail;
 }
 
+/*
+ * 文字の配送
+ * 【役割】バッファに格納し、キーボード入力待ちのスレッドを起床させる
+ * 【備考】割り込みハンドラのほか、キー入力を模擬するベンチマークからも呼ばれる
+ */
+void keyboard_deliver_char(char c) {
+    // タスクレットとベンチマークのタイマーが同じCPUで書き込むため、
+    // 格納中は割り込みを禁止して SPSC の前提を保つ
+    uint32_t flags = irq_save();
+    irqoff_trace_begin(IRQOFF_SITE_KEYBOARD, flags);
+    keyboard_buffer_put(c);
+    irqoff_trace_end(flags);
+    irq_restore(flags);
+    unblock_keyboard_threads();
+}
+
+/*
+ * エコー完了の記録
+ * 【役割】直前に読み出したキーの格納時刻からの経過時間を統計に加える
+ * 【前提】キーを読み出したスレッド（コンシューマー）が表示後に呼ぶ
+ */
+void keyboard_record_echo(void) {
+    if (!last_key_ns) {
+        return;
+    }
+    uint64_t latency = clock_get_time_ns() - last_key_ns;
+    last_key_ns = 0;
+
+    kbd_latency.count++;
+    kbd_latency.total_ns += latency;
+    if (latency > kbd_latency.max_ns) {
+        kbd_latency.max_ns = latency;
+    }
+}
+
+void keyboard_latency_reset(void) {
+    kbd_latency.count = 0;
+    kbd_latency.total_ns = 0;
+    kbd_latency.max_ns = 0;
+}
+
+/*
+ * エコー遅延の統計の取得
+ * 【備考】コンシューマーが更新中の値を読む場合があるため、表示用の近似値
+ */
+void keyboard_get_latency(keyboard_latency_t* out) {
+    *out = kbd_latency;
+}
+
 /*
  * キーボードコントローラ初期化関数（分割関数）
  * 【役割】PS/2キーボードコントローラの初期化
@@ -124,73 +208,146 @@ char convert_scancode_to_ascii(uint8_t scancode, bool shift_pressed) {
 void init_keyboard(void) {
     init_keyboard_controller();
     init_keyboard_buffer();
+    irq_register(IRQ_KEYBOARD, keyboard_irq_handler, NULL);
     debug_print("KEYBOARD: Complete initialization");
 }
 
 /*
- * キーボード割り込みハンドラ（C言語部分）
- * 【役割】キーボード割り込み発生時の処理
- * 【重要】interrupt.sのkeyboard_interrupt_handlerから呼び出される
+ * 拡張キー（0xE0 の後のコード）の処理
+ * 【役割】Shift+PageUp / Shift+PageDown で画面のスクロールバックを動かす
  */
-void keyboard_handler_c(void) {
-    // PICに割り込み処理完了を通知
-    outb(PIC_MASTER_COMMAND, 0x20);
-
-    // キーボードデータの読み取り可能性をチェック
-    uint8_t status = read_keyboard_status();
-    if (!(status & KEYBOARD_STATUS_OUTPUT_FULL)) {
-        debug_print("KEYBOARD: Interrupt fired but no data available");
+static void keyboard_handle_extended(uint8_t scancode) {
+    if (!shift_pressed) {
         return;
     }
+    if (scancode == SCANCODE_PAGE_UP) {
+        vga_scroll_view(VGA_SCROLLBACK_STEP);
+    } else if (scancode == SCANCODE_PAGE_DOWN) {
+        vga_scroll_view(-VGA_SCROLLBACK_STEP);
+    }
+}
 
-    // スキャンコードを読み取り
-    uint8_t scancode = read_keyboard_data();
+/*
+ * キーボード割り込みのボトムハーフ（タスクレット）
+ * 【役割】トップハーフが積んだスキャンコードを取り出し、Shift の状態を反映して
+ * ASCII に変換し、入力待ちのスレッドへ配送する。表示用の記録は
+ * ワークキューへ回す（シリアル出力を割り込みの出口で行わないため）
+ * 【備考】文字キーを押すとスクロールバックをやめて最新の画面に戻る。
+ * Alt+F1〜F4 は文字として配送せず、表示する仮想コンソールを切り替える
+ */
+static void keyboard_tasklet_func(void* data) {
+    (void)data;
+    while (kbd_scancodes.head != kbd_scancodes.tail) {
+        uint8_t scancode = kbd_scancodes.codes[kbd_scancodes.tail];
+        kbd_scancodes.tail =
+            (kbd_scancodes.tail + 1) % KEYBOARD_SCANCODE_RING_SIZE;
+
+        // 拡張キーは前置コードの次の1バイトで判定する
+        if (scancode == SCANCODE_EXTENDED) {
+            extended_pending = true;
+            continue;
+        }
+        bool extended = extended_pending;
+        extended_pending = false;
+
+        // キー離す操作は無視
+        if (scancode & SCANCODE_RELEASE_MASK) {
+            uint8_t key_code = scancode & 0x7F;
+
+            // Shiftキーの離す処理
+            if (key_code == SCANCODE_LEFT_SHIFT ||
+                key_code == SCANCODE_RIGHT_SHIFT) {
+                shift_pressed = false;
+            } else if (key_code == SCANCODE_ALT) {
+                alt_pressed = false;
+            }
+            continue;
+        }
 
-    // キー離す操作は無視
-    if (scancode & SCANCODE_RELEASE_MASK) {
-        uint8_t key_code = scancode & 0x7F;
+        // Altキーの押下処理（右Alt は 0xE0 0x38）
+        if (scancode == SCANCODE_ALT) {
+            alt_pressed = true;
+            continue;
+        }
 
-        // Shiftキーの離す処理
-        if (key_code == SCANCODE_LEFT_SHIFT ||
-            key_code == SCANCODE_RIGHT_SHIFT) {
-            shift_pressed = false;
+        // Shiftキーの押下処理
+        if (scancode == SCANCODE_LEFT_SHIFT ||
+            scancode == SCANCODE_RIGHT_SHIFT) {
+            shift_pressed = true;
+            continue;
+        }
+
+        if (extended) {
+            keyboard_handle_extended(scancode);
+            continue;
+        }
+
+        // Alt+F1〜F4：仮想コンソールの切り替え
+        if (alt_pressed && scancode >= SCANCODE_F1 &&
+            scancode < SCANCODE_F1 + VGA_CONSOLES) {
+            vga_console_switch(scancode - SCANCODE_F1);
+            continue;
+        }
+
+        // スキャンコードをASCII文字に変換
+        char ascii = convert_scancode_to_ascii(scancode, shift_pressed);
+        if (ascii == 0) {
+            continue;
+        }
+
+        // 有効なASCII文字をバッファに格納し、入力待ちのスレッドを起床させる
+        vga_scroll_view_reset();
+        keyboard_deliver_char(ascii);
+
+        // デバッグ出力用の記録（溢れた分は表示しない）
+        int next_head = (kbd_key_log.head + 1) % KEYBOARD_KEY_LOG_SIZE;
+        if (next_head != kbd_key_log.tail) {
+            kbd_key_log.ascii[kbd_key_log.head] = ascii;
+            kbd_key_log.scancode[kbd_key_log.head] = scancode;
+            kbd_key_log.head = next_head;
         }
-        return;
     }
+    queue_work(&kbd_log_work);
+}
 
-    // Shiftキーの押下処理
-    if (scancode == SCANCODE_LEFT_SHIFT || scancode == SCANCODE_RIGHT_SHIFT) {
-        shift_pressed = true;
-        return;
+/*
+ * キー入力のデバッグ出力（kworker スレッド）
+ */
+static void keyboard_log_work_func(void* data) {
+    (void)data;
+    while (kbd_key_log.head != kbd_key_log.tail) {
+        char key[2] = {kbd_key_log.ascii[kbd_key_log.tail], 0};
+        uint8_t scancode = kbd_key_log.scancode[kbd_key_log.tail];
+        kbd_key_log.tail = (kbd_key_log.tail + 1) % KEYBOARD_KEY_LOG_SIZE;
+        debug_print("KEY: %s (%u)", key, scancode);
+    }
+}
+
+/*
+ * キーボード割り込みハンドラ（IRQ1・トップハーフ）
+ * 【役割】スキャンコードを読み出して積み、タスクレットを登録するだけにする。
+ * 変換・配送・表示は irq_exit() 以降（割り込み許可）で行う
+ * 【備考】EOI・irq_exit()・再スケジュールは振り分け側（interrupt_dispatch_c）が行う
+ * 【戻り値】データがなければ false（共有IRQの他のデバイス向け）
+ */
+static bool keyboard_irq_handler(void* ctx) {
+    (void)ctx;
+
+    // キーボードデータの読み取り可能性をチェック
+    uint8_t status = read_keyboard_status();
+    if (!(status & KEYBOARD_STATUS_OUTPUT_FULL)) {
+        return false;
     }
 
-    // スキャンコードをASCII文字に変換
-    char ascii = convert_scancode_to_ascii(scancode, shift_pressed);
-
-    if (ascii != 0) {
-        // 有効なASCII文字をバッファに格納
-        keyboard_buffer_put(ascii);
-
-        // キーボード入力待ちでブロックされているスレッドを起床させる
-        unblock_keyboard_threads();
-
-        // デバッグ出力
-        char debug_msg[32];
-        debug_msg[0] = 'K';
-        debug_msg[1] = 'E';
-        debug_msg[2] = 'Y';
-        debug_msg[3] = ':';
-        debug_msg[4] = ' ';
-        debug_msg[5] = ascii;
-        debug_msg[6] = ' ';
-        debug_msg[7] = '(';
-        itoa((uint32_t)scancode, &debug_msg[8], 10);
-        int len = 8;
-        while (debug_msg[len] != 0) len++;
-        debug_msg[len] = ')';
-        debug_msg[len + 1] = 0;
-        debug_print(debug_msg);
+    // スキャンコードを読み取り（溢れた分は捨てる）
+    uint8_t scancode = read_keyboard_data();
+    int next_head = (kbd_scancodes.head + 1) % KEYBOARD_SCANCODE_RING_SIZE;
+    if (next_head != kbd_scancodes.tail) {
+        kbd_scancodes.codes[kbd_scancodes.head] = scancode;
+        kbd_scancodes.head = next_head;
     }
+    tasklet_schedule(&kbd_tasklet);
+    return true;
 }
 
 /*
@@ -201,13 +358,24 @@ void keyboard_handler_c(void) {
 char getchar(void) {
     char c;
 
+    // 空チェックからブロックまでの間に届いたキーで起床を取りこぼさないよう、
+    // 割り込み禁止のまま判定とブロックを行う
+    uint32_t flags = irq_save();
+
     // キーボードバッファから文字が取得できるまで待機
     while ((c = keyboard_buffer_get()) == 0) {
         // 汎用ブロック関数を呼び出し、キーボード入力を待つ
         // このスレッドは BLOCK_REASON_KEYBOARD でブロックされる
         block_current_thread(BLOCK_REASON_KEYBOARD, 0);
-        schedule();
+
+        // 割り込みが別CPUに届く構成では、登録前に入力が来ていることがある
+        if (keyboard_buffer_is_empty()) {
+            schedule();
+        } else {
+            cancel_block_current_thread();
+        }
     }
+    irq_restore(flags);
     return c;
 }
 
@@ -0,0 +1,278 @@
+#include "lapic.h"
+
+#include "clock.h"
+#include "hrtimer.h"
+#include "irq.h"
+#include "kernel.h"
+#include "softirq.h"
+
+/*
+ * Local APIC ドライバ
+ * 【備考】BSP の LINT0 は BIOS が ExtINT（8259 PIC のパススルー）に設定しているため
+ * 触らない。AP は LINT0/LINT1 をマスクして PIC の割り込みを受けないようにする
+ */
+
+static volatile uint32_t* lapic_base = NULL;
+
+/*
+ * タイマー状態
+ * 【備考】較正値とティック周期は全CPU共通、次のティック時刻はCPUごと
+ */
+typedef struct {
+    bool running;            // このCPUでタイマーを開始したか
+    uint64_t tick_deadline;  // 次のスケジューラティック（TSC）
+    uint64_t armed_tsc;      // 実際に設定した割り込み時刻（遅れの計測用）
+} lapic_timer_cpu_t;
+
+static lapic_timer_cpu_t lapic_timer_cpus[MAX_CPUS];
+static uint32_t lapic_counts_per_ms = 0;  // 0 = 未較正
+static bool tsc_deadline_mode = false;
+static uint32_t tick_us = LAPIC_TIMER_TICK_US;
+static uint64_t tick_tsc;  // tick_us の TSC 換算
+
+static inline lapic_timer_cpu_t* lapic_timer_this_cpu(void) {
+    return &lapic_timer_cpus[get_kernel_context()->cpu_id];
+}
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_base[reg / sizeof(uint32_t)];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_base[reg / sizeof(uint32_t)] = value;
+}
+
+/*
+ * Local APIC のベースアドレスを記録し、BSP の APIC を有効化する
+ */
+void lapic_init(uint32_t base) {
+    lapic_base = (volatile uint32_t*)(base ? base : LAPIC_DEFAULT_BASE);
+    set_idt_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t)spurious_interrupt_handler);
+    set_idt_gate(LAPIC_TIMER_VECTOR, (uint32_t)lapic_timer_interrupt_handler);
+    lapic_enable_cpu(false);
+}
+
+/*
+ * 実行中CPUの Local APIC をソフトウェア有効化
+ * @param mask_lint: LINT0/LINT1 をマスクするか（AP用）
+ */
+void lapic_enable_cpu(bool mask_lint) {
+    if (mask_lint) {
+        lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_MASKED);
+        lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_MASKED);
+    }
+    lapic_write(LAPIC_REG_TPR, 0);  // 全優先度の割り込みを受け付ける
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+bool lapic_is_available(void) {
+    return lapic_base != NULL;
+}
+
+uint32_t lapic_get_id(void) {
+    return lapic_read(LAPIC_REG_ID) >> LAPIC_ID_SHIFT;
+}
+
+/*
+ * 割り込み処理完了の通知
+ * 【最適化】MMIO への1回の書き込みで済み、PIC の outb（仮想化環境では
+ * VM exit を伴うポートI/O）より軽い
+ */
+void lapic_eoi(void) {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/*
+ * Local APIC タイマーの較正
+ * 【役割】TSC を基準に、1ms あたりのタイマーカウント（バスクロック / 16）を求め、
+ * TSC-deadline モードが使えるかを CPUID で調べる
+ * 【前提】BSP で clock_init() の後に呼ぶ（TSC がなければ PIT を使い続ける）
+ */
+void lapic_timer_calibrate(void) {
+    if (!clock_is_calibrated()) {
+        debug_print("LAPIC: no calibrated TSC, timer not used");
+        return;
+    }
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    tsc_deadline_mode = (ecx & CPUID_FEATURE_TSC_DEADLINE) != 0;
+
+    uint32_t flags = irq_save();
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    uint64_t end =
+        rdtsc() + (uint64_t)clock_get_tsc_khz() * LAPIC_TIMER_CALIBRATE_MS;
+    lapic_write(LAPIC_REG_TIMER_INITIAL, LAPIC_TIMER_MAX_COUNT);
+    while (rdtsc() < end) {
+        asm volatile("pause");
+    }
+    uint32_t elapsed =
+        LAPIC_TIMER_MAX_COUNT - lapic_read(LAPIC_REG_TIMER_CURRENT);
+    lapic_write(LAPIC_REG_TIMER_INITIAL, 0);  // 停止
+    irq_restore(flags);
+
+    lapic_counts_per_ms = elapsed / LAPIC_TIMER_CALIBRATE_MS;
+    lapic_timer_set_tick_us(tick_us);
+    debug_print("LAPIC: timer %u counts/ms, %s mode, tick %u us",
+                lapic_counts_per_ms,
+                tsc_deadline_mode ? "TSC-deadline" : "one-shot", tick_us);
+}
+
+/*
+ * 次のタイマー割り込みを設定
+ * 【役割】次のスケジューラティックとこのCPUの hrtimer の最も早い期限のうち、
+ * 早い方の時刻に割り込みを1回だけ発生させる
+ * 【前提】割り込み禁止で呼ぶこと
+ */
+static void lapic_timer_program(lapic_timer_cpu_t* timer) {
+    uint64_t deadline = timer->tick_deadline;
+    uint64_t expiry_ns = hrtimer_next_expiry_ns();
+    if (expiry_ns != CLOCK_TIME_NEVER) {
+        uint64_t expiry_tsc = clock_ns_to_tsc(expiry_ns);
+        if (expiry_tsc < deadline) {
+            deadline = expiry_tsc;
+        }
+    }
+    timer->armed_tsc = deadline;
+
+    if (tsc_deadline_mode) {
+        wrmsr(MSR_IA32_TSC_DEADLINE, deadline);  // 過去の時刻ならすぐに発火する
+        return;
+    }
+
+    uint64_t now = rdtsc();
+    uint64_t count = 1;
+    if (deadline > now) {
+        count = (deadline - now) * lapic_counts_per_ms / clock_get_tsc_khz();
+        if (count == 0) {
+            count = 1;
+        } else if (count > LAPIC_TIMER_MAX_COUNT) {
+            count = LAPIC_TIMER_MAX_COUNT;
+        }
+    }
+    lapic_write(LAPIC_REG_TIMER_INITIAL, (uint32_t)count);
+}
+
+/*
+ * 実行中CPUの Local APIC タイマーを開始
+ * 【備考】周期モードは使わず、毎回次の期限を設定し直す（TSC-deadline または
+ * ワンショット）。これによりティック周期とスリープの精度をµs単位で指定できる
+ * 【戻り値】未較正なら OS_ERROR_INVALID_STATE（PIT を使い続ける）
+ */
+os_result_t lapic_timer_start(void) {
+    if (!lapic_base || lapic_counts_per_ms == 0) {
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    uint32_t flags = irq_save();
+    lapic_timer_cpu_t* timer = lapic_timer_this_cpu();
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER,
+                (tsc_deadline_mode ? LAPIC_TIMER_TSC_DEADLINE
+                                   : LAPIC_TIMER_ONESHOT) |
+                    LAPIC_TIMER_VECTOR);
+    timer->tick_deadline = rdtsc() + tick_tsc;
+    timer->running = true;
+    lapic_timer_program(timer);
+    irq_restore(flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * hrtimer 追加時の期限の再設定
+ * 【役割】現在の期限より早い hrtimer が増えた場合に割り込みを早める
+ * 【前提】割り込み禁止で呼ぶこと（hrtimer_start_abs が呼ぶ）
+ */
+void lapic_timer_update_event(void) {
+    lapic_timer_cpu_t* timer = lapic_timer_this_cpu();
+    if (timer->running) {
+        lapic_timer_program(timer);
+    }
+}
+
+/*
+ * スケジューラティック周期の設定
+ * 【役割】クォンタム満了の判定間隔（ティック）を変える。スレッドを切り替える
+ * 間隔はスケジューリングクラスごとのクォンタム（sched_set_quantum_us()）で決まり、
+ * スリープの精度は hrtimer の期限で決まるため、どちらとも独立に設定できる
+ * 【備考】全CPUの次のティックから反映される
+ * 【戻り値】範囲外なら OS_ERROR_INVALID_PARAMETER
+ */
+os_result_t lapic_timer_set_tick_us(uint32_t us) {
+    if (us < LAPIC_TIMER_TICK_MIN_US || us > LAPIC_TIMER_TICK_MAX_US) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+    tick_us = us;
+    tick_tsc = (uint64_t)us * clock_get_tsc_khz() / 1000;
+    return OS_SUCCESS;
+}
+
+uint32_t lapic_timer_get_tick_us(void) {
+    return tick_us;
+}
+
+bool lapic_timer_is_running(void) {
+    return lapic_base && lapic_timer_this_cpu()->running;
+}
+
+bool lapic_timer_uses_tsc_deadline(void) {
+    return tsc_deadline_mode;
+}
+
+/*
+ * Local APIC タイマー割り込みハンドラ（C言語部分）
+ * 【役割】期限に達した hrtimer を処理し、ティックならスケジューラティック、
+ * それ以外（hrtimer の期限）なら起床したスレッドのためにスケジューラだけを呼ぶ
+ * 【重要】EOI と次の期限の設定を、スレッド切り替えの可能性がある処理より先に行う
+ */
+void lapic_timer_handler_c(void) {
+    uint64_t enter_tsc = irq_enter();
+    lapic_timer_cpu_t* timer = lapic_timer_this_cpu();
+    irq_trace_timer_late(enter_tsc, timer->armed_tsc);
+    lapic_eoi();
+    hrtimer_run_expired();
+
+    uint64_t now = rdtsc();
+    bool tick_expired = now >= timer->tick_deadline;
+    if (tick_expired) {
+        timer->tick_deadline = now + tick_tsc;
+    }
+    lapic_timer_program(timer);
+    irq_exit(LAPIC_TIMER_VECTOR, enter_tsc);
+
+    if (tick_expired) {
+        timer_tick();
+    } else {
+        schedule();
+    }
+}
+
+/*
+ * ICR への書き込み（上位 → 下位の順。下位の書き込みで送信される）
+ */
+static void lapic_send_icr(uint8_t apic_id, uint32_t low) {
+    uint32_t flags = irq_save();
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile("pause");
+    }
+    lapic_write(LAPIC_REG_ICR_HIGH, (uint32_t)apic_id << LAPIC_ICR_DEST_SHIFT);
+    lapic_write(LAPIC_REG_ICR_LOW, low);
+    irq_restore(flags);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector) {
+    lapic_send_icr(apic_id, LAPIC_ICR_FIXED | vector);
+}
+
+void lapic_send_init(uint8_t apic_id) {
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT | LAPIC_ICR_LEVEL);
+}
+
+/*
+ * Startup IPI
+ * @param vector_page: 起動アドレス / 4KB（0x8000 なら 0x08）
+ */
+void lapic_send_startup(uint8_t apic_id, uint8_t vector_page) {
+    lapic_send_icr(apic_id, LAPIC_ICR_STARTUP | vector_page);
+}
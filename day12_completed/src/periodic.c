@@ -0,0 +1,173 @@
+#include "periodic.h"
+
+#include "clock.h"
+#include "sync.h"
+
+/*
+ * 周期タスク
+ * 【構造】固定長のタスク表。各タスクのスレッドは periodic_task_main() を実行し、
+ * 自分のスロットを task->thread で見つける
+ */
+
+static periodic_task_t periodic_tasks[PERIODIC_MAX_TASKS];
+static spinlock_t periodic_lock;  // スロット確保と task->thread の公開の排他
+
+static periodic_task_t* periodic_find_current(void) {
+    thread_t* self = get_current_thread();
+    periodic_task_t* found = NULL;
+    uint32_t flags = spin_lock_irqsave(&periodic_lock);
+    for (int i = 0; i < PERIODIC_MAX_TASKS; i++) {
+        if (periodic_tasks[i].used && periodic_tasks[i].thread == self) {
+            found = &periodic_tasks[i];
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&periodic_lock, flags);
+    return found;
+}
+
+/*
+ * ジョブ開始時の記録
+ * 【役割】リリース時刻からの遅れ（起床遅延 + スケジューリング待ち）を集計する
+ */
+static void periodic_record_release(periodic_task_t* task, uint64_t start_ns) {
+    uint64_t jitter = start_ns - task->next_release_ns;
+    task->releases++;
+    task->jitter_total_ns += jitter;
+    if (jitter > task->jitter_max_ns) {
+        task->jitter_max_ns = jitter;
+    }
+}
+
+/*
+ * ジョブ完了時の記録と次のリリース時刻の決定
+ * 【備考】デッドライン（次のリリース時刻）を過ぎて終わった場合は、
+ * 既に過ぎた周期境界を飛ばして次の未来の境界に合わせる。
+ * 飛ばした周期もデッドライン超過として数える（追いつくための連続起動はしない）
+ */
+static void periodic_record_completion(periodic_task_t* task, uint64_t end_ns) {
+    task->next_release_ns += task->period_ns;
+    while (task->next_release_ns < end_ns) {
+        task->deadline_misses++;
+        task->next_release_ns += task->period_ns;
+    }
+}
+
+/*
+ * 周期タスクのスレッド本体
+ */
+static void periodic_task_main(void) {
+    // 作成側が task->thread を公開するまで待つ（作成直後に走り出した場合）
+    periodic_task_t* task;
+    while (!(task = periodic_find_current())) {
+        thread_yield();
+    }
+
+    while (1) {
+        sleep_until(task->next_release_ns);
+        periodic_record_release(task, clock_get_time_ns());
+        task->job();
+        periodic_record_completion(task, clock_get_time_ns());
+    }
+}
+
+/*
+ * 周期タスクの作成
+ * 【役割】最初のリリースを「作成時刻 + 周期」とし、以後は周期の整数倍で起動する
+ * 【重要】スロットの確保と各フィールドの設定はロックの中、create_thread()
+ * （sched_lock と debug_print を使う）はロックの外で行う。スレッドは
+ * task->thread が公開されるまで periodic_task_main() の先頭で待つ
+ */
+os_result_t periodic_task_create(uint64_t period_ns, periodic_job_t job,
+                                 int display_row, periodic_task_t** out_task) {
+    if (!job || !out_task) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (period_ns == 0) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+    *out_task = NULL;
+
+    uint32_t flags = spin_lock_irqsave(&periodic_lock);
+
+    periodic_task_t* task = NULL;
+    for (int i = 0; i < PERIODIC_MAX_TASKS; i++) {
+        if (!periodic_tasks[i].used) {
+            task = &periodic_tasks[i];
+            break;
+        }
+    }
+    if (!task) {
+        spin_unlock_irqrestore(&periodic_lock, flags);
+        debug_print("PERIODIC: Maximum number of tasks exceeded");
+        return OS_ERROR_OUT_OF_MEMORY;
+    }
+
+    task->used = true;
+    task->thread = NULL;
+    task->job = job;
+    task->period_ns = period_ns;
+    task->next_release_ns = clock_get_time_ns() + period_ns;
+    task->releases = 0;
+    task->deadline_misses = 0;
+    task->jitter_total_ns = 0;
+    task->jitter_max_ns = 0;
+
+    spin_unlock_irqrestore(&periodic_lock, flags);
+
+    // create_thread() の delay_ticks は表示用の目安として周期を渡す
+    uint64_t period_ticks = period_ns / TICK_NS;
+    thread_t* thread;
+    os_result_t result = create_thread(
+        periodic_task_main, period_ticks ? (uint32_t)period_ticks : 1,
+        display_row, &thread);
+
+    flags = spin_lock_irqsave(&periodic_lock);
+    if (OS_FAILURE_CHECK(result)) {
+        task->used = false;
+    } else {
+        task->thread = thread;
+    }
+    spin_unlock_irqrestore(&periodic_lock, flags);
+
+    if (OS_FAILURE_CHECK(result)) {
+        return result;
+    }
+    *out_task = task;
+    return OS_SUCCESS;
+}
+
+/*
+ * 周期タスクを EDF クラスで実行する
+ * 【役割】タスクの周期をそのまま EDF の周期（相対デッドライン）にする。
+ * 各リリースで起床した時点で EDF のデッドラインも周期の境界にそろう
+ * 【戻り値】受け入れ制御で拒否されたら OS_ERROR_RESOURCE_BUSY
+ */
+os_result_t periodic_task_set_runtime(periodic_task_t* task,
+                                      uint64_t runtime_ns) {
+    if (!task) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    return thread_set_edf(task->thread, runtime_ns, task->period_ns);
+}
+
+/*
+ * 全周期タスクの統計表示
+ * 【備考】統計はタスク自身のスレッドが更新するため、表示は近似値
+ */
+void periodic_print_stats(void) {
+    for (int i = 0; i < PERIODIC_MAX_TASKS; i++) {
+        periodic_task_t* task = &periodic_tasks[i];
+        if (!task->used) {
+            continue;
+        }
+        uint32_t releases = task->releases;
+        uint32_t avg_jitter =
+            releases ? (uint32_t)(task->jitter_total_ns / releases) : 0;
+        debug_print(
+            "  周期タスク%d: 周期 %u us, 起動 %u, 超過 %u, "
+            "ジッタ avg %u ns / max %u ns",
+            i, (uint32_t)(task->period_ns / NSEC_PER_USEC), releases,
+            task->deadline_misses, avg_jitter, (uint32_t)task->jitter_max_ns);
+    }
+}
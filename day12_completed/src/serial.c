@@ -0,0 +1,431 @@
+#include "serial.h"
+
+#include "clock.h"
+#include "irq.h"
+#include "kernel.h"
+#include "softirq.h"
+#include "sync.h"
+
+/*
+ * 16550 UART ドライバ
+ * 【構造】
+ * - 送信: serial_tx_lock で UART の送信側を排他し、送信 FIFO の空きを
+ *   tx_room で数える（THRE を見た時点で FIFO は空なので深さ分書ける）。
+ *   ロックは FIFO 1杯ごとに取り直し、THRE は割り込み許可のまま待つ
+ * - 出力単位（行・フレーム）の順序は serial_output_begin/end で守る
+ *   （割り込みは禁止しない）
+ * - 受信: 割り込みハンドラ → リング（SPSC）→ 読み出しスレッド。
+ *   リングの空きはセマフォではなく head/tail で判定し、セマフォは
+ *   「リングに何か積まれた」ことを伝えるだけに使う
+ */
+
+static struct {
+    serial_uart_type_t type;
+    uint32_t fifo_depth;  // 送信 FIFO のバイト数（FIFO なしなら 1）
+    uint32_t baud;
+    uint32_t tx_room;     // 次に THRE を確認するまでに書けるバイト数
+} serial_uart = {SERIAL_UART_NONE, 1, SERIAL_BAUD_DEFAULT, 0};
+
+static spinlock_t serial_tx_lock;  // 送信（FIFO 1杯分ずつ）と速度変更の排他
+static volatile uint32_t serial_output_owner;  // 出力単位を保持するCPU + 1（0 は空き）
+static serial_tx_stats_t serial_tx_stats;
+
+static const char* const serial_uart_names[] = {
+    "none",
+    "8250/16450",
+    "16550 (FIFO disabled)",
+    "16550A",
+};
+
+static struct {
+    char bytes[SERIAL_RX_RING_SIZE];
+    volatile int head;  // 割り込みハンドラが書く
+    volatile int tail;  // 読み出しスレッドが読む
+} serial_rx;
+
+static serial_rx_stats_t serial_rx_stats;
+static ksemaphore_t serial_rx_sem;  // 受信待ちのスレッドを起こす
+
+static bool serial_irq_handler(void* ctx);
+static void serial_rx_tasklet_func(void* data);
+static tasklet_t serial_rx_tasklet = {.func = serial_rx_tasklet_func};
+
+/*
+ * =================================================================================
+ * 送信
+ * =================================================================================
+ */
+
+/*
+ * UART の種類の判定
+ * 【役割】スクラッチレジスタで UART の有無を確かめ、FIFO を有効にしてみて
+ * IIR の上位2ビットで 16550A（FIFO が使える）かどうかを判定する
+ */
+static void serial_detect_uart(void) {
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_SCRATCH, 0x5A);
+    if (inb(SERIAL_PORT_COM1 + SERIAL_REG_SCRATCH) != 0x5A) {
+        serial_uart.type = SERIAL_UART_NONE;
+        return;
+    }
+
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_FCR, SERIAL_FCR_ENABLE);
+    uint8_t fifo = inb(SERIAL_PORT_COM1 + SERIAL_REG_IIR) & SERIAL_IIR_FIFO_MASK;
+    if (fifo == SERIAL_IIR_FIFO_OK) {
+        serial_uart.type = SERIAL_UART_16550A;
+        serial_uart.fifo_depth = SERIAL_FIFO_DEPTH_16550A;
+    } else {
+        // 初期の 16550 は FIFO が正しく動かないため、8250 と同じく1バイトずつ送る
+        serial_uart.type = (fifo == SERIAL_IIR_FIFO_BROKEN) ? SERIAL_UART_16550
+                                                            : SERIAL_UART_8250;
+        serial_uart.fifo_depth = 1;
+        outb(SERIAL_PORT_COM1 + SERIAL_REG_FCR, 0);
+    }
+}
+
+/*
+ * 分周比の設定（8N1 に戻して終わる）
+ */
+static void serial_program_divisor(uint16_t divisor) {
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_LCR, SERIAL_LCR_DLAB);
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_DLL, divisor & 0xFF);
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_DLM, divisor >> 8);
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_LCR, SERIAL_LCR_8N1);
+}
+
+/*
+ * Serial Port (for debugging)
+ * 【役割】COM1 の UART を判定し、SERIAL_BAUD_DEFAULT・8N1 で初期化する
+ * 【備考】受信割り込みは serial_rx_init() で有効にする（MCR の OUT2 はここで立てる）
+ */
+void init_serial(void) {
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_IER, SERIAL_IER_NONE);
+    serial_detect_uart();
+    serial_program_divisor(SERIAL_BASE_BAUD / SERIAL_BAUD_DEFAULT);
+    serial_uart.baud = SERIAL_BAUD_DEFAULT;
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_MCR, SERIAL_MCR_OUT2_RTS_DTR);
+    serial_uart.tx_room = 0;
+    debug_print("SERIAL: %s, TX FIFO %u bytes, %u baud", serial_get_uart_name(),
+                serial_uart.fifo_depth, serial_uart.baud);
+}
+
+/*
+ * 送信 FIFO の空きの確保
+ * 【役割】前回 THRE を確認してから FIFO の深さ分を書き終えていれば、
+ * 送信 FIFO が空になるまで待つ
+ * 【前提】serial_tx_lock を保持していること
+ */
+static void serial_tx_wait_room(void) {
+    if (serial_uart.tx_room) {
+        return;
+    }
+    while (!(inb(SERIAL_PORT_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THR_EMPTY)) {
+        asm volatile("pause");
+    }
+    serial_uart.tx_room = serial_uart.fifo_depth;
+    serial_tx_stats.thre_waits++;
+}
+
+/*
+ * バイト列の送信
+ * 【役割】THRE を1回確認するごとに送信 FIFO の深さ（16550A なら 16 バイト）まで
+ * 続けて書き込む
+ * 【最適化】ロック（割り込み禁止）は FIFO 1杯分の書き込みの間だけ取る。
+ * FIFO が空くまでの待ちはロックの外で行うため、低速なボーレートでも
+ * 割り込み禁止区間は outb 16回程度に収まる
+ * 【備考】割り込みハンドラからも呼べる。他CPUの出力とは FIFO 1杯の単位で
+ * 混ざりうるため、まとまった出力は serial_output_begin/end で囲む
+ */
+void serial_write_buffer(const char* data, uint32_t length) {
+    while (length) {
+        if (!serial_uart.tx_room) {
+            while (!(inb(SERIAL_PORT_COM1 + SERIAL_REG_LSR) &
+                     SERIAL_LSR_THR_EMPTY)) {
+                asm volatile("pause");
+            }
+        }
+
+        uint32_t flags = spin_lock_irqsave(&serial_tx_lock);
+        serial_tx_wait_room();
+        uint32_t burst = length < serial_uart.tx_room ? length
+                                                      : serial_uart.tx_room;
+        serial_uart.tx_room -= burst;
+        serial_tx_stats.bytes += burst;
+        length -= burst;
+        while (burst--) {
+            outb(SERIAL_PORT_COM1 + SERIAL_REG_DATA, (uint8_t)*data++);
+        }
+        spin_unlock_irqrestore(&serial_tx_lock, flags);
+    }
+}
+
+/*
+ * 出力単位（debug_print の1行・トレースの1フレーム）の排他
+ * 【役割】複数回の serial_write_buffer() を他CPUの出力と混ぜずに送る。
+ * 割り込みは禁止しないため、送信を待つ間も割り込みは届く
+ * 【重要】次の場合は待たずに進む（その出力だけ FIFO 1杯の単位で混ざりうる）
+ * - 同じCPUが保持中: 保持者を割り込んだか横取りしており、待つと保持者が再開できない
+ * - 呼び出し側が割り込み禁止: sched_lock などを持ったまま、横取りされた
+ *   保持者の再開を待つことになるため、空いている時だけ取る
+ * 【戻り値】serial_output_end() に渡す値（取れなかったら false）
+ */
+bool serial_output_begin(void) {
+    uint32_t self = get_kernel_context()->cpu_id + 1;
+    uint32_t flags = irq_save();
+    irq_restore(flags);
+    bool can_wait = (flags & EFLAGS_IF) != 0;
+
+    while (1) {
+        uint32_t owner = atomic_cmpxchg(&serial_output_owner, 0, self);
+        if (owner == 0) {
+            return true;
+        }
+        if (owner == self || !can_wait) {
+            return false;
+        }
+        asm volatile("pause");
+    }
+}
+
+void serial_output_end(bool locked) {
+    if (locked) {
+        asm volatile("" : : : "memory");
+        serial_output_owner = 0;
+    }
+}
+
+/*
+ * 1文字をシリアルポートに送信する関数
+ * 【備考】FIFO に空きがあれば THRE を確認せずに書き込む
+ */
+void serial_write_char(char c) {
+    serial_write_buffer(&c, 1);
+}
+
+/*
+ * 文字列をシリアルポートに送信する関数
+ */
+void serial_write_string(const char* str) {
+    uint32_t length = 0;
+    while (str[length]) {
+        length++;
+    }
+    serial_write_buffer(str, length);
+}
+
+/*
+ * ボーレートの変更
+ * 【役割】送信中のバイトを送り終えてから分周比を設定し直す
+ * 【重要】DLAB を立てている間はデータ・IER のアドレスが分周比レジスタになるため、
+ * 受信割り込みを止めてから切り替える
+ * 【戻り値】SERIAL_BASE_BAUD を割り切れない速度・範囲外は OS_ERROR_INVALID_PARAMETER
+ */
+os_result_t serial_set_baud(uint32_t baud) {
+    if (baud == 0 || baud > SERIAL_BASE_BAUD || SERIAL_BASE_BAUD % baud != 0 ||
+        SERIAL_BASE_BAUD / baud > SERIAL_DIVISOR_MAX) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&serial_tx_lock);
+    while (!(inb(SERIAL_PORT_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_TX_IDLE)) {
+        asm volatile("pause");
+    }
+    uint8_t ier = inb(SERIAL_PORT_COM1 + SERIAL_REG_IER);
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_IER, SERIAL_IER_NONE);
+    serial_program_divisor((uint16_t)(SERIAL_BASE_BAUD / baud));
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_IER, ier);
+    serial_uart.baud = baud;
+    serial_uart.tx_room = serial_uart.fifo_depth;  // 送信済みなので FIFO は空
+    spin_unlock_irqrestore(&serial_tx_lock, flags);
+    return OS_SUCCESS;
+}
+
+uint32_t serial_get_baud(void) {
+    return serial_uart.baud;
+}
+
+serial_uart_type_t serial_get_uart_type(void) {
+    return serial_uart.type;
+}
+
+const char* serial_get_uart_name(void) {
+    return serial_uart_names[serial_uart.type];
+}
+
+uint32_t serial_get_fifo_depth(void) {
+    return serial_uart.fifo_depth;
+}
+
+/*
+ * =================================================================================
+ * 受信
+ * =================================================================================
+ */
+
+/*
+ * 受信の初期化
+ * 【役割】FIFO に残っているバイトを捨ててからハンドラを登録し、
+ * UART の受信割り込みを有効にする
+ * 【備考】init_serial() が MCR の OUT2 を立てているため、IER を設定すれば
+ * IRQ4 が PIC / I/O APIC へ届く
+ */
+void serial_rx_init(void) {
+    ksem_init(&serial_rx_sem, 0, "serial_rx");
+    while (inb(SERIAL_PORT_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_DATA_READY) {
+        inb(SERIAL_PORT_COM1 + SERIAL_REG_DATA);
+    }
+    irq_register(IRQ_COM1, serial_irq_handler, NULL);
+    outb(SERIAL_PORT_COM1 + SERIAL_REG_IER, SERIAL_IER_RX_AVAILABLE);
+    debug_print("SERIAL: RX interrupt enabled (IRQ%u)", IRQ_COM1);
+}
+
+/*
+ * シリアル割り込みハンドラ（IRQ4・トップハーフ）
+ * 【役割】受信 FIFO が空になるまで読み出してリングに積み、タスクレットを登録する
+ * 【備考】FIFO の閾値（14バイト）に達した時と、受信が途切れた時（文字タイムアウト）
+ * に割り込みが入るため、1回で複数バイトを読むことが多い
+ * 【戻り値】データがなければ false（共有IRQの他のデバイス向け）
+ */
+static bool serial_irq_handler(void* ctx) {
+    (void)ctx;
+    bool received = false;
+    uint8_t lsr;
+    while ((lsr = inb(SERIAL_PORT_COM1 + SERIAL_REG_LSR)) &
+           SERIAL_LSR_DATA_READY) {
+        if (lsr & SERIAL_LSR_ERRORS) {
+            serial_rx_stats.errors++;
+        }
+        char byte = (char)inb(SERIAL_PORT_COM1 + SERIAL_REG_DATA);
+        received = true;
+
+        // 溢れた分は捨てる
+        int next_head = (serial_rx.head + 1) % SERIAL_RX_RING_SIZE;
+        if (next_head == serial_rx.tail) {
+            serial_rx_stats.dropped++;
+            continue;
+        }
+        serial_rx.bytes[serial_rx.head] = byte;
+        serial_rx.head = next_head;
+        serial_rx_stats.received++;
+    }
+    if (received) {
+        tasklet_schedule(&serial_rx_tasklet);
+    }
+    return received;
+}
+
+/*
+ * シリアル受信のボトムハーフ（タスクレット）
+ * 【役割】受信待ちのスレッドを起床させる（起床処理を割り込み禁止区間から外す）
+ */
+static void serial_rx_tasklet_func(void* data) {
+    (void)data;
+    ksem_post(&serial_rx_sem);
+}
+
+/*
+ * 1バイト受信（ブロッキング）
+ * 【役割】リングが空ならバイトが届くまで眠る
+ * 【前提】読み出すスレッドは1つ（シリアルシェル）
+ * 【備考】セマフォの残りで空振りの起床があっても、リングを見直すだけ
+ */
+char serial_getchar(void) {
+    while (serial_rx.head == serial_rx.tail) {
+        ksem_wait(&serial_rx_sem);
+    }
+    char c = serial_rx.bytes[serial_rx.tail];
+    serial_rx.tail = (serial_rx.tail + 1) % SERIAL_RX_RING_SIZE;
+    return c;
+}
+
+/*
+ * 1行受信（エコー付き）
+ * 【役割】CR・LF・CR LF のいずれかまで読み取る（最大 max_length-1 文字）
+ * 【備考】端末の Backspace（0x08）と DEL（0x7F）の両方で1文字消す
+ */
+void serial_read_line(char* buffer, int max_length) {
+    static bool last_was_cr = false;  // 直前の行が CR で終わった
+    if (!buffer || max_length <= 1) {
+        return;
+    }
+
+    int pos = 0;
+    while (1) {
+        char c = serial_getchar();
+        if (c == '\n' && last_was_cr && pos == 0) {
+            last_was_cr = false;  // CR LF の LF（パイプからの入力）
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            last_was_cr = (c == '\r');
+            break;
+        } else if ((c == 8 || c == 127) && pos > 0) {
+            pos--;
+            serial_write_string("\b \b");
+        } else if (c >= 32 && c <= 126 && pos < max_length - 1) {
+            buffer[pos++] = c;
+            serial_write_char(c);
+        }
+        // それ以外の制御文字と、長すぎる行の残りは無視
+    }
+    buffer[pos] = 0;
+    serial_write_string("\r\n");
+}
+
+/*
+ * =================================================================================
+ * ベンチマーク
+ * =================================================================================
+ * debug_print の行をまとめて出力し、ボーレートごとの送信スループット（bytes/s）と
+ * THRE の確認回数を計測する。終了後は元の速度に戻す
+ * 【備考】QEMU の UART は設定した速度で送信を遅らせないため、差は主に
+ * THRE のポーリング回数（FIFO の効果）に表れる
+ */
+static const uint32_t serial_bench_bauds[] = {38400, SERIAL_BASE_BAUD};
+
+void serial_benchmark_throughput(void) {
+    char payload[SERIAL_BENCH_LINE_CHARS + 1];
+    for (int i = 0; i < SERIAL_BENCH_LINE_CHARS; i++) {
+        payload[i] = (char)('a' + i % 26);
+    }
+    payload[SERIAL_BENCH_LINE_CHARS] = 0;
+
+    uint32_t saved_baud = serial_get_baud();
+    for (uint32_t b = 0; b < sizeof(serial_bench_bauds) / sizeof(uint32_t);
+         b++) {
+        uint32_t baud = serial_bench_bauds[b];
+        serial_set_baud(baud);
+
+        serial_tx_stats_t before;
+        serial_get_tx_stats(&before);
+        uint64_t start = rdtsc();
+        for (int line = 0; line < SERIAL_BENCH_LINES; line++) {
+            debug_print("%s", payload);
+        }
+        uint64_t ns = clock_cycles_to_ns(rdtsc() - start);
+        serial_tx_stats_t after;
+        serial_get_tx_stats(&after);
+
+        uint32_t bytes = after.bytes - before.bytes;
+        uint32_t waits = after.thre_waits - before.thre_waits;
+        serial_set_baud(saved_baud);  // 結果の行は元の速度で出す
+        debug_print("SERIAL BENCH: %u baud, %u bytes in %u us, %u bytes/s, "
+                    "THRE waits %u",
+                    baud, bytes, (uint32_t)(ns / NSEC_PER_USEC),
+                    ns ? (uint32_t)((uint64_t)bytes * NSEC_PER_SEC / ns) : 0,
+                    waits);
+    }
+}
+
+/*
+ * =================================================================================
+ * 統計（表示用の近似値）
+ * =================================================================================
+ */
+
+void serial_get_tx_stats(serial_tx_stats_t* out) {
+    *out = serial_tx_stats;
+}
+
+void serial_get_rx_stats(serial_rx_stats_t* out) {
+    *out = serial_rx_stats;
+}
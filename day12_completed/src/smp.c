@@ -0,0 +1,260 @@
+#include "smp.h"
+
+#include "acpi.h"
+#include "gdt.h"
+#include "kernel.h"
+#include "lapic.h"
+#include "softirq.h"
+#include "sync.h"
+
+/*
+ * SMP 起動とCPU間通知
+ * 【起動手順】
+ * 1. ACPI MADT（なければ MP テーブル）から Local APIC ID の一覧を得る
+ * 2. トランポリンを 0x8000 にコピーし、AP ごとにスタックと CPU 番号を書き込む
+ * 3. INIT → 10ms → SIPI → SIPI を送り、AP が online になるのを待つ
+ * 4. AP は ap_main で自分の GDT/TSS・IDT・LAPIC・アイドルスレッドを用意し、
+ *    自分のREADYリングでスケジューラを開始する
+ * 【備考】Local APIC タイマーは AP 起動前に BSP で TSC を基準に較正し、
+ * 各 AP は ap_main で同じ較正値を使って自分のタイマーを開始する
+ */
+
+static uint32_t ap_boot_stacks[MAX_CPUS][AP_BOOT_STACK_SIZE];
+static volatile uint32_t online_count = 1;  // BSP は最初から online
+
+/*
+ * 指定ティック数以上待つ（起動シーケンス用）
+ * 【前提】割り込み有効（PITが動作中）であること
+ */
+static void smp_wait_ticks(uint32_t ticks) {
+    uint32_t end = get_system_ticks() + ticks + 1;  // 端数ティック分を補う
+    while ((int32_t)(get_system_ticks() - end) < 0) {
+        asm volatile("hlt");
+    }
+}
+
+/*
+ * トランポリン内の変数の書き換え
+ * 【備考】トランポリンはコピーして実行されるため、シンボルのオフセットで位置を求める
+ */
+static void smp_patch_trampoline(uint8_t* symbol, uint32_t value) {
+    uint32_t offset = (uint32_t)(symbol - ap_trampoline_start);
+    *(volatile uint32_t*)(AP_TRAMPOLINE_ADDR + offset) = value;
+}
+
+static void smp_copy_trampoline(void) {
+    uint8_t* dest = (uint8_t*)AP_TRAMPOLINE_ADDR;
+    uint32_t size = (uint32_t)(ap_trampoline_end - ap_trampoline_start);
+    for (uint32_t i = 0; i < size; i++) {
+        dest[i] = ap_trampoline_start[i];
+    }
+    smp_patch_trampoline(ap_trampoline_entry, (uint32_t)ap_main);
+}
+
+/*
+ * AP を1つ起動する（INIT-SIPI-SIPI）
+ * 【戻り値】タイムアウトまでに online になればtrue
+ */
+static bool smp_start_ap(uint32_t cpu, uint8_t lapic_id) {
+    kernel_context_t* ctx = get_cpu_context(cpu);
+    ctx->lapic_id = lapic_id;
+
+    smp_patch_trampoline(ap_trampoline_stack,
+                         (uint32_t)&ap_boot_stacks[cpu][AP_BOOT_STACK_SIZE]);
+    smp_patch_trampoline(ap_trampoline_cpu, cpu);
+
+    lapic_send_init(lapic_id);
+    smp_wait_ticks(AP_INIT_DELAY_TICKS);
+    for (int i = 0; i < 2 && !ctx->online; i++) {
+        lapic_send_startup(lapic_id, AP_TRAMPOLINE_PAGE);
+        smp_wait_ticks(AP_SIPI_DELAY_TICKS);
+    }
+
+    uint32_t deadline = get_system_ticks() + AP_STARTUP_TIMEOUT_TICKS;
+    while (!ctx->online && (int32_t)(get_system_ticks() - deadline) < 0) {
+        asm volatile("hlt");
+    }
+    return ctx->online;
+}
+
+/*
+ * SMP 初期化（BSP）
+ * 【前提】割り込みシステム初期化後・スレッド作成前に呼ぶ
+ * （起動待ちにタイマーティックを使い、kernel_main はまだスレッドではないため）
+ */
+void smp_init(void) {
+    kernel_context_t* bsp = get_kernel_context();
+    if (OS_FAILURE_CHECK(acpi_detect_platform())) {
+        return;
+    }
+
+    const platform_info_t* info = acpi_get_platform();
+    lapic_init(info->lapic_base);
+    bsp->lapic_id = lapic_get_id();
+    set_idt_gate(RESCHEDULE_IPI_VECTOR, (uint32_t)reschedule_ipi_handler);
+    lapic_timer_calibrate();  // AP がタイマーを開始する前に済ませる
+
+    smp_copy_trampoline();
+
+    uint32_t next_cpu = 1;
+    for (uint32_t i = 0; i < info->cpu_count && next_cpu < MAX_CPUS; i++) {
+        uint8_t lapic_id = info->lapic_ids[i];
+        if (lapic_id == bsp->lapic_id) {
+            continue;
+        }
+        if (!smp_start_ap(next_cpu, lapic_id)) {
+            debug_print("SMP: CPU %u (LAPIC %u) did not respond", next_cpu,
+                        lapic_id);
+        }
+        next_cpu++;  // 応答しなかったCPUのスロットは再利用しない
+    }
+
+    debug_print("SMP: %u of %u CPUs online", online_count, info->cpu_count);
+}
+
+/*
+ * AP の C エントリ
+ * 【役割】CPU固有の状態を初期化し、アイドルスレッドからスケジューリングを始める
+ * 【前提】トランポリンがフラットセグメント・SSE有効化・ブートスタックを設定済み
+ */
+void ap_main(uint32_t cpu) {
+    kernel_context_t* ctx = get_cpu_context(cpu);
+    gdt_init_cpu(cpu, ctx, sizeof(kernel_context_t),
+                 (uint32_t)&ap_boot_stacks[cpu][AP_BOOT_STACK_SIZE]);
+    load_idt();
+    lapic_enable_cpu(true);
+    lapic_timer_start();  // 割り込みはアイドルスレッドで有効になってから届く
+    fpu_init_cpu();
+
+    thread_t* idle = NULL;
+    if (OS_FAILURE_CHECK(create_thread(idle_thread, 1, 0, &idle))) {
+        debug_print("SMP: CPU %u has no idle thread, halting", cpu);
+        while (1) {
+            asm volatile("cli; hlt");
+        }
+    }
+    thread_set_priority(idle, THREAD_PRIORITY_IDLE);
+    ctx->idle_thread = idle;
+
+    atomic_inc(&online_count);
+    ctx->online = true;
+    debug_print("SMP: CPU %u (LAPIC %u) online", cpu, ctx->lapic_id);
+
+    // アイドルスレッドへ切り替える（戻らない）
+    schedule();
+    while (1) {
+        asm volatile("hlt");
+    }
+}
+
+uint32_t smp_get_online_count(void) {
+    return online_count;
+}
+
+/*
+ * 他CPUへの再スケジュール要求
+ * 【役割】他CPUのREADYリングにスレッドを入れた時、そのCPUが hlt 中でも
+ * すぐにスケジューラを走らせる
+ */
+void smp_kick_cpu(uint32_t cpu) {
+    kernel_context_t* target = get_cpu_context(cpu);
+    if (cpu == get_kernel_context()->cpu_id || !target->online ||
+        !lapic_is_available()) {
+        return;
+    }
+    lapic_send_ipi(target->lapic_id, RESCHEDULE_IPI_VECTOR);
+}
+
+/*
+ * 再スケジュールIPIハンドラ（C言語部分）
+ */
+void reschedule_ipi_handler_c(void) {
+    uint64_t enter_tsc = irq_enter();
+    lapic_eoi();
+    irq_exit(RESCHEDULE_IPI_VECTOR, enter_tsc);
+    schedule();
+}
+
+/*
+ * =================================================================================
+ * 集計カウンタスループット ベンチマーク
+ * =================================================================================
+ * CPUごとに1つのCPU占有ワーカーを置き、それぞれ自分専用のカウンタ
+ * （キャッシュラインを分けて偽共有を避ける）を加算する。
+ * 合計値がCPU数にほぼ比例して伸びるかを確認する
+ */
+
+static volatile uint32_t
+    smp_bench_counters[MAX_CPUS * SMP_BENCH_COUNTER_STRIDE];
+static volatile bool smp_bench_running;
+static volatile uint32_t smp_bench_active;
+
+static void smp_bench_worker(void) {
+    volatile uint32_t* counter =
+        &smp_bench_counters[get_kernel_context()->cpu_id *
+                            SMP_BENCH_COUNTER_STRIDE];
+    while (smp_bench_running) {
+        (*counter)++;
+    }
+    atomic_dec(&smp_bench_active);
+}
+
+/*
+ * CPU 0〜cpus-1 にワーカーを1つずつ置いて1秒間計測
+ * 【戻り値】全CPUのカウンタ合計（作成できなければ0）
+ */
+static uint32_t smp_bench_run(uint32_t cpus) {
+    for (uint32_t i = 0; i < MAX_CPUS * SMP_BENCH_COUNTER_STRIDE; i++) {
+        smp_bench_counters[i] = 0;
+    }
+    smp_bench_running = true;
+    smp_bench_active = 0;
+
+    // CPUへの配置を終えるまでワーカーが走らないようにする
+    uint32_t flags = irq_save();
+    for (uint32_t cpu = 0; cpu < cpus; cpu++) {
+        thread_t* worker = NULL;
+        if (OS_FAILURE_CHECK(create_thread(smp_bench_worker, 1, 0, &worker))) {
+            break;
+        }
+        if (cpu != 0) {
+            thread_set_cpu(worker, cpu);
+        }
+        smp_bench_active++;
+    }
+    irq_restore(flags);
+
+    sleep(SMP_BENCH_MEASURE_TICKS);
+    smp_bench_running = false;
+
+    uint32_t total = 0;
+    for (uint32_t cpu = 0; cpu < cpus; cpu++) {
+        total += smp_bench_counters[cpu * SMP_BENCH_COUNTER_STRIDE];
+    }
+    while (smp_bench_active) {
+        sleep(1);
+    }
+    return total;
+}
+
+void smp_benchmark_throughput(void) {
+    static const uint32_t cpu_steps[] = {1, 2, 4};
+    uint32_t base = 0;
+
+    for (uint32_t i = 0; i < sizeof(cpu_steps) / sizeof(cpu_steps[0]); i++) {
+        uint32_t cpus = cpu_steps[i];
+        if (cpus > online_count) {
+            debug_print("SMP BENCH: %u CPUs: skipped (%u online)", cpus,
+                        online_count);
+            continue;
+        }
+
+        uint32_t total = smp_bench_run(cpus);
+        if (cpus == 1) {
+            base = total;
+        }
+        debug_print("SMP BENCH: %u CPUs: %u increments/sec (%u%% of 1 CPU)",
+                    cpus, total,
+                    base ? (uint32_t)((uint64_t)total * 100 / base) : 0);
+    }
+}
@@ -0,0 +1,253 @@
+#include "softirq.h"
+
+#include "irq.h"
+#include "kernel.h"
+#include "sync.h"
+
+/*
+ * 割り込みの後半処理
+ * 【構造】タスクレットの待ちリストは CPU ごとに持つ
+ * （割り込みを受けたCPUだけが触るためロック不要）。
+ * ワークキューは全CPU共通で1本の kworker スレッドが処理する
+ */
+
+typedef struct {
+    tasklet_t* head;        // 待ちリストの先頭
+    tasklet_t* tail;        // 待ちリストの末尾
+    bool in_softirq;        // タスクレットを実行中（入れ子の irq_exit は何もしない）
+    uint32_t tasklets_run;  // 実行したタスクレット数
+} softirq_cpu_t;
+
+static softirq_cpu_t softirq_cpus[MAX_CPUS];
+
+static spinlock_t workqueue_lock;  // ワークキューのリストの排他
+static work_t* workqueue_head;
+static work_t* workqueue_tail;
+static ksemaphore_t workqueue_sem;  // キューに入れた回数（kworker を起こす）
+static volatile uint32_t works_run;
+static thread_t* workqueue_thread;
+
+static inline softirq_cpu_t* softirq_this_cpu(void) {
+    return &softirq_cpus[get_kernel_context()->cpu_id];
+}
+
+/*
+ * =================================================================================
+ * 割り込みの入口・出口
+ * =================================================================================
+ */
+
+/*
+ * 割り込みハンドラの入口
+ * 【戻り値】トップハーフの計測開始時刻（irq_exit() に渡す）
+ * 【備考】割り込みは有効な状態でしか入らないため、ここから割り込み禁止区間が始まる
+ */
+uint64_t irq_enter(void) {
+    irqoff_trace_begin(IRQOFF_SITE_IRQ, EFLAGS_IF);
+    return rdtsc();
+}
+
+/*
+ * 待ちのタスクレットを実行する
+ * 【役割】リストを丸ごと取り出し、割り込みを許可して順に呼ぶ。
+ * 実行中に登録されたものは次の回に回し、SOFTIRQ_MAX_RESTART 回で打ち切る
+ * （残りは次の割り込みの出口で実行される）
+ * 【前提】割り込み禁止で呼ぶ。戻る時も割り込み禁止
+ */
+static void softirq_run_tasklets(softirq_cpu_t* cpu) {
+    for (int round = 0; round < SOFTIRQ_MAX_RESTART && cpu->head; round++) {
+        tasklet_t* list = cpu->head;
+        cpu->head = NULL;
+        cpu->tail = NULL;
+
+        irqoff_trace_end(EFLAGS_IF);
+        asm volatile("sti");
+        while (list) {
+            tasklet_t* tasklet = list;
+            list = list->next;
+
+            // 他CPUで実行中なら、終わってから実行されるよう登録し直す
+            if (atomic_xchg(&tasklet->running, 1)) {
+                tasklet->scheduled = 0;
+                tasklet_schedule(tasklet);
+                continue;
+            }
+            tasklet->scheduled = 0;  // 実行中の再登録を受け付ける
+            tasklet->func(tasklet->data);
+            tasklet->running = 0;
+            cpu->tasklets_run++;
+        }
+        asm volatile("cli");
+        irqoff_trace_begin(IRQOFF_SITE_IRQ, EFLAGS_IF);
+    }
+}
+
+/*
+ * 割り込みハンドラの出口
+ * 【役割】トップハーフの時間をベクタごとに記録し、待ちのタスクレットを
+ * 割り込み許可の状態で実行する
+ * 【重要】タスクレットの実行中はスケジューラを止める（入れ子の割り込みの
+ * schedule() は何もしない）。この割り込みのスタック上で別スレッドへ
+ * 切り替わらないようにするため。切り替えは呼び出し元の schedule() で行う
+ * 【前提】割り込み禁止で呼ぶこと（割り込みハンドラの C 部分から）
+ */
+void irq_exit(uint8_t vector, uint64_t enter_tsc) {
+    softirq_cpu_t* cpu = softirq_this_cpu();
+    irq_account(vector, enter_tsc);
+
+    if (!cpu->head || cpu->in_softirq) {
+        return;
+    }
+
+    kernel_context_t* ctx = get_kernel_context();
+    cpu->in_softirq = true;
+    ctx->scheduler_lock_count++;
+    softirq_run_tasklets(cpu);
+    ctx->scheduler_lock_count--;
+    cpu->in_softirq = false;
+}
+
+/*
+ * =================================================================================
+ * タスクレット
+ * =================================================================================
+ */
+
+void tasklet_init(tasklet_t* tasklet, void (*func)(void* data), void* data) {
+    tasklet->next = NULL;
+    tasklet->func = func;
+    tasklet->data = data;
+    tasklet->scheduled = 0;
+    tasklet->running = 0;
+}
+
+/*
+ * タスクレットの登録
+ * 【役割】実行中CPUの待ちリストに入れ、次の irq_exit() で実行させる
+ * （既に登録済みなら何もしない）
+ * 【備考】割り込みハンドラからもスレッドからも呼べる。スレッドから登録した
+ * 場合は、そのCPUの次の割り込み（遅くとも次のティック）の出口で実行される
+ */
+void tasklet_schedule(tasklet_t* tasklet) {
+    if (atomic_xchg(&tasklet->scheduled, 1)) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    softirq_cpu_t* cpu = softirq_this_cpu();
+    tasklet->next = NULL;
+    if (cpu->tail) {
+        cpu->tail->next = tasklet;
+    } else {
+        cpu->head = tasklet;
+    }
+    cpu->tail = tasklet;
+    irq_restore(flags);
+}
+
+/*
+ * =================================================================================
+ * ワークキュー
+ * =================================================================================
+ */
+
+void work_init(work_t* work, void (*func)(void* data), void* data) {
+    work->next = NULL;
+    work->func = func;
+    work->data = data;
+    work->pending = false;
+}
+
+/*
+ * 作業項目をキューに入れる
+ * 【役割】kworker スレッドを起こして func を実行させる
+ * 【戻り値】入れた場合 true、既にキューにあれば false（実行は1回にまとまる）
+ * 【備考】割り込みハンドラ・タスクレットからも呼べる
+ */
+bool queue_work(work_t* work) {
+    uint32_t flags = spin_lock_irqsave(&workqueue_lock);
+    if (work->pending) {
+        spin_unlock_irqrestore(&workqueue_lock, flags);
+        return false;
+    }
+    work->pending = true;
+    work->next = NULL;
+    if (workqueue_tail) {
+        workqueue_tail->next = work;
+    } else {
+        workqueue_head = work;
+    }
+    workqueue_tail = work;
+    spin_unlock_irqrestore(&workqueue_lock, flags);
+
+    ksem_post(&workqueue_sem);
+    return true;
+}
+
+/*
+ * キューの先頭を取り出す
+ * 【備考】取り出した時点で pending を下ろすため、実行中の再登録は次の実行になる
+ */
+static work_t* workqueue_pop(void) {
+    uint32_t flags = spin_lock_irqsave(&workqueue_lock);
+    work_t* work = workqueue_head;
+    if (work) {
+        workqueue_head = work->next;
+        if (!workqueue_head) {
+            workqueue_tail = NULL;
+        }
+        work->pending = false;
+    }
+    spin_unlock_irqrestore(&workqueue_lock, flags);
+    return work;
+}
+
+/*
+ * kworker スレッド本体
+ * 【備考】起こされるたびにキューを空になるまで処理する
+ * （セマフォの残りで空振りの起床があっても問題ない）
+ */
+static void workqueue_thread_main(void) {
+    while (1) {
+        ksem_wait(&workqueue_sem);
+
+        work_t* work;
+        while ((work = workqueue_pop()) != NULL) {
+            work->func(work->data);
+            works_run++;
+        }
+    }
+}
+
+/*
+ * 初期化（割り込みを有効にする前に呼ぶ）
+ * 【備考】kworker の開始前にキューに入れた項目は、開始後に処理される
+ */
+void softirq_init(void) {
+    ksem_init(&workqueue_sem, 0, "workqueue");
+    debug_print("SOFTIRQ: tasklets and workqueue initialized");
+}
+
+/*
+ * kworker スレッドの作成
+ */
+os_result_t workqueue_start(void) {
+    return create_thread(workqueue_thread_main, 1, 0, &workqueue_thread);
+}
+
+/*
+ * =================================================================================
+ * 統計
+ * =================================================================================
+ */
+
+/*
+ * 統計の表示（debug_command_interrupts から呼ばれる）
+ */
+void softirq_print_stats(void) {
+    uint32_t tasklets = 0;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        tasklets += softirq_cpus[cpu].tasklets_run;
+    }
+    debug_print("タスクレット実行: %u, ワーク実行: %u", tasklets, works_run);
+}
@@ -0,0 +1,599 @@
+#include "sync.h"
+
+/*
+ * カーネル同期プリミティブ
+ * 【方針】待ちは全てスケジューラのブロックリスト経由（BLOCK_REASON_SYNC）。
+ * 競合がない場合は lock cmpxchg だけで完了する
+ * 【SMP】他CPUの解放と競合しても起床を取りこぼさないよう、待ち側は
+ * 「waiters++ → ブロックリストへ登録 → 条件の再確認 → schedule()」の順に行い、
+ * 再確認で条件が満たされていればブロックを取り消す。解放側は
+ * 「状態の更新 → waiters の確認 → 起床」の順なので、どちらかが必ず相手を見る
+ */
+
+// 統計表示用に登録された同期オブジェクト
+typedef struct {
+    const char* kind;     // "mutex" / "sem" / "cond"
+    const char* name;     // オブジェクト名
+    sync_stats_t* stats;  // オブジェクト内の統計
+} sync_tracked_t;
+
+static sync_tracked_t sync_tracked[SYNC_MAX_TRACKED];
+static uint32_t sync_tracked_count = 0;
+static spinlock_t sync_tracked_lock;
+
+/*
+ * 統計の初期化と登録
+ * 【役割】名前付きオブジェクトを debug_command_locks の表示対象に加える
+ */
+static void sync_stats_init(sync_stats_t* stats, const char* kind,
+                            const char* name) {
+    stats->acquire_count = 0;
+    stats->contended_count = 0;
+    stats->wait_cycles = 0;
+    stats->max_wait_cycles = 0;
+
+    if (!name || sync_tracked_count >= SYNC_MAX_TRACKED) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_tracked_lock);
+    for (uint32_t i = 0; i < sync_tracked_count; i++) {
+        if (sync_tracked[i].stats == stats) {  // 再初期化時は登録済み
+            spin_unlock_irqrestore(&sync_tracked_lock, flags);
+            return;
+        }
+    }
+    if (sync_tracked_count < SYNC_MAX_TRACKED) {
+        sync_tracked[sync_tracked_count].kind = kind;
+        sync_tracked[sync_tracked_count].name = name;
+        sync_tracked[sync_tracked_count].stats = stats;
+        sync_tracked_count++;
+    }
+    spin_unlock_irqrestore(&sync_tracked_lock, flags);
+}
+
+/*
+ * ブロックを伴った取得の記録
+ */
+static void sync_stats_record_wait(sync_stats_t* stats, uint64_t start) {
+    uint32_t waited = (uint32_t)(rdtsc() - start);
+    stats->contended_count++;
+    stats->wait_cycles += waited;
+    if (waited > stats->max_wait_cycles) {
+        stats->max_wait_cycles = waited;
+    }
+}
+
+/*
+ * ブロック登録後の再確認に応じて切り替えるか取り消す
+ * 【役割】still_blocked が false なら（他CPUが登録前に解放していた）
+ * ブロックを取り消して即座に戻る
+ * 【前提】waiters++ → block_current_thread() の後に呼ぶこと
+ */
+static void sync_wait_if(bool still_blocked) {
+    if (still_blocked) {
+        schedule();
+    } else {
+        cancel_block_current_thread();
+    }
+}
+
+/*
+ * =================================================================================
+ * ミューテックス
+ * =================================================================================
+ */
+
+void kmutex_init(kmutex_t* mutex, const char* name) {
+    mutex->locked = 0;
+    mutex->owner = NULL;
+    mutex->waiters = 0;
+    mutex->priority_inherit = true;
+    mutex->next_held = NULL;
+    mutex->name = name;
+    sync_stats_init(&mutex->stats, "mutex", name);
+}
+
+/*
+ * 保持スレッドの held_mutexes リストへの登録・削除
+ * 【備考】リストを書き換えるのは保持スレッド自身だけで、
+ * 先頭ポインタの1回の書き込みで公開されるため割り込み禁止は不要
+ */
+static void kmutex_set_owner(kmutex_t* mutex, thread_t* owner) {
+    mutex->owner = owner;
+    if (owner) {
+        mutex->next_held = owner->held_mutexes;
+        owner->held_mutexes = mutex;
+    }
+}
+
+static void kmutex_clear_owner(kmutex_t* mutex, thread_t* owner) {
+    mutex->owner = NULL;
+    if (!owner) {
+        return;
+    }
+
+    struct kmutex** link = &owner->held_mutexes;
+    while (*link && *link != mutex) {
+        link = &(*link)->next_held;
+    }
+    if (*link) {
+        *link = mutex->next_held;
+    }
+    mutex->next_held = NULL;
+}
+
+/*
+ * 実効優先度の再計算（優先度継承）
+ * 【役割】基本優先度と、保持中ミューテックスの待ちスレッドの最高優先度から
+ * 実効優先度を決め、変化があればブロックチェーンの上流（自分が待つ
+ * ミューテックスの保持スレッド）へ伝播させる
+ * 【前提】スケジューラロックを保持していること（ロックなしで呼ぶ場合は
+ * thread_refresh_priority を使う）
+ */
+void kmutex_refresh_priority(thread_t* thread) {
+    for (int depth = 0; thread && depth < MAX_THREADS; depth++) {
+        uint8_t priority = thread->base_priority;
+        for (kmutex_t* held = thread->held_mutexes; held;
+             held = held->next_held) {
+            if (held->priority_inherit) {
+                uint8_t waiter = highest_waiter_priority(held);
+                if (waiter > priority) {
+                    priority = waiter;
+                }
+            }
+        }
+
+        if (priority == thread->priority) {
+            break;  // 変化がなければ上流も変わらない
+        }
+        thread->priority = priority;
+        thread = thread->blocked_on ? thread->blocked_on->owner : NULL;
+    }
+}
+
+/*
+ * ミューテックス取得（低速パス）
+ * 【役割】解放されるまでブロックし、起床のたびに取得を再試行する
+ * 【備考】起床後に別スレッドが先に取得していれば再びブロックする
+ */
+static os_result_t kmutex_lock_slow(kmutex_t* mutex, thread_t* self) {
+    if (!self) {
+        return OS_ERROR_RESOURCE_BUSY;  // スケジューラ起動前はブロックできない
+    }
+
+    uint64_t start = rdtsc();
+    uint32_t flags = irq_save();
+
+    while (atomic_cmpxchg(&mutex->locked, 0, 1) != 0) {
+        atomic_inc(&mutex->waiters);
+        self->blocked_on = mutex;
+        block_current_thread(BLOCK_REASON_SYNC, (uint32_t)mutex);
+
+        // 自分の優先度を保持スレッドへ継承させてから切り替える
+        thread_t* owner = mutex->owner;
+        if (mutex->priority_inherit && owner) {
+            thread_refresh_priority(owner);
+        }
+        sync_wait_if(mutex->locked != 0);
+
+        self->blocked_on = NULL;
+        atomic_dec(&mutex->waiters);
+    }
+    kmutex_set_owner(mutex, self);
+    mutex->stats.acquire_count++;
+    sync_stats_record_wait(&mutex->stats, start);
+
+    irq_restore(flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * ミューテックス取得
+ * 【高速パス】空いていれば lock cmpxchg で取得して即座に戻る
+ */
+os_result_t kmutex_lock(kmutex_t* mutex) {
+    if (!mutex) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    thread_t* self = get_current_thread();
+    if (self && mutex->owner == self) {
+        return OS_ERROR_INVALID_STATE;  // 再帰ロックはデッドロックになる
+    }
+
+    if (atomic_cmpxchg(&mutex->locked, 0, 1) == 0) {
+        kmutex_set_owner(mutex, self);
+        mutex->stats.acquire_count++;
+        return OS_SUCCESS;
+    }
+    return kmutex_lock_slow(mutex, self);
+}
+
+bool kmutex_trylock(kmutex_t* mutex) {
+    if (!mutex || atomic_cmpxchg(&mutex->locked, 0, 1) != 0) {
+        return false;
+    }
+    kmutex_set_owner(mutex, get_current_thread());
+    mutex->stats.acquire_count++;
+    return true;
+}
+
+/*
+ * ミューテックス解放（低速パス）
+ * 【役割】待ちスレッドを起床させ、継承していた優先度を元に戻す。
+ * 起床したスレッドの方が優先度が高ければ即座に切り替える
+ */
+static void kmutex_unlock_slow(kmutex_t* mutex, thread_t* self) {
+    uint32_t flags = irq_save();
+
+    thread_t* woken = mutex->waiters ? wake_one_waiter(mutex) : NULL;
+    if (self) {
+        thread_refresh_priority(self);
+    }
+    if (woken && self && woken->cpu == self->cpu &&
+        woken->priority > self->priority) {
+        schedule();  // 他CPUのスレッドは smp_kick_cpu で起こされる
+    }
+
+    irq_restore(flags);
+}
+
+/*
+ * ミューテックス解放
+ * 【重要】先に locked を解放してから waiters を確認する。
+ * 待ち側は「waiters++ → ブロック → locked の再確認」の順なので、
+ * この順序なら他CPUの待ちスレッドに対しても起床の取りこぼしは起きない
+ */
+os_result_t kmutex_unlock(kmutex_t* mutex) {
+    if (!mutex) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (!mutex->locked || mutex->owner != get_current_thread()) {
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    thread_t* self = mutex->owner;
+    kmutex_clear_owner(mutex, self);
+    atomic_xchg(&mutex->locked, 0);
+
+    if (mutex->waiters || (self && self->priority != self->base_priority)) {
+        kmutex_unlock_slow(mutex, self);
+    }
+    return OS_SUCCESS;
+}
+
+/*
+ * =================================================================================
+ * セマフォ
+ * =================================================================================
+ */
+
+void ksem_init(ksemaphore_t* sem, uint32_t initial_count, const char* name) {
+    sem->count = initial_count;
+    sem->waiters = 0;
+    sem->name = name;
+    sync_stats_init(&sem->stats, "sem", name);
+}
+
+/*
+ * 資源を1つ減らす（ブロックなし）
+ * 【戻り値】減らせた場合true
+ */
+static bool ksem_try_decrement(ksemaphore_t* sem) {
+    uint32_t count = sem->count;
+    while (count > 0) {
+        uint32_t prev = atomic_cmpxchg(&sem->count, count, count - 1);
+        if (prev == count) {
+            return true;
+        }
+        count = prev;
+    }
+    return false;
+}
+
+os_result_t ksem_wait(ksemaphore_t* sem) {
+    if (!sem) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    if (ksem_try_decrement(sem)) {
+        sem->stats.acquire_count++;
+        return OS_SUCCESS;
+    }
+
+    if (!get_current_thread()) {
+        return OS_ERROR_RESOURCE_BUSY;
+    }
+
+    uint64_t start = rdtsc();
+    uint32_t flags = irq_save();
+
+    while (!ksem_try_decrement(sem)) {
+        atomic_inc(&sem->waiters);
+        block_current_thread(BLOCK_REASON_SYNC, (uint32_t)sem);
+        sync_wait_if(sem->count == 0);
+        atomic_dec(&sem->waiters);
+    }
+    sem->stats.acquire_count++;
+    sync_stats_record_wait(&sem->stats, start);
+
+    irq_restore(flags);
+    return OS_SUCCESS;
+}
+
+bool ksem_trywait(ksemaphore_t* sem) {
+    if (!sem || !ksem_try_decrement(sem)) {
+        return false;
+    }
+    sem->stats.acquire_count++;
+    return true;
+}
+
+/*
+ * 資源を1つ戻す
+ * 【備考】割り込みハンドラからも呼べる（ブロックしない）
+ */
+os_result_t ksem_post(ksemaphore_t* sem) {
+    if (!sem) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    atomic_inc(&sem->count);
+    if (sem->waiters) {
+        wake_one_waiter(sem);
+    }
+    return OS_SUCCESS;
+}
+
+/*
+ * =================================================================================
+ * 条件変数
+ * =================================================================================
+ */
+
+void kcond_init(kcondvar_t* cond, const char* name) {
+    cond->waiters = 0;
+    cond->name = name;
+    sync_stats_init(&cond->stats, "cond", name);
+}
+
+/*
+ * 条件変数で待つ
+ * 【重要】先に条件変数上でブロック状態になってから mutex を解放するため、
+ * 解放直後（優先度の高い待ちスレッドへ切り替わった場合も含む）の
+ * signal を取りこぼさない。戻る前に mutex を再取得する
+ */
+os_result_t kcond_wait(kcondvar_t* cond, kmutex_t* mutex) {
+    if (!cond || !mutex) {
+        return OS_ERROR_NULL_POINTER;
+    }
+
+    thread_t* self = get_current_thread();
+    if (!self || mutex->owner != self) {
+        return OS_ERROR_INVALID_STATE;  // mutex を保持していない
+    }
+
+    uint64_t start = rdtsc();
+    uint32_t flags = irq_save();
+
+    atomic_inc(&cond->waiters);
+    block_current_thread(BLOCK_REASON_SYNC, (uint32_t)cond);
+    kmutex_unlock(mutex);  // 起床した高優先度スレッドへここで切り替わることがある
+    if (self->state == THREAD_BLOCKED) {
+        schedule();  // その間に他CPUから signal されていれば切り替わらない
+    }
+    atomic_dec(&cond->waiters);
+
+    cond->stats.acquire_count++;
+    sync_stats_record_wait(&cond->stats, start);
+    irq_restore(flags);
+
+    return kmutex_lock(mutex);
+}
+
+os_result_t kcond_signal(kcondvar_t* cond) {
+    if (!cond) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (cond->waiters) {
+        wake_one_waiter(cond);
+    }
+    return OS_SUCCESS;
+}
+
+os_result_t kcond_broadcast(kcondvar_t* cond) {
+    if (!cond) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (cond->waiters) {
+        wake_all_waiters(cond);
+    }
+    return OS_SUCCESS;
+}
+
+/*
+ * =================================================================================
+ * 統計表示・ベンチマーク
+ * =================================================================================
+ */
+
+/*
+ * 登録済み同期オブジェクトの競合統計を表示
+ */
+void sync_print_stats(void) {
+    debug_print("=== Lock Statistics (%u objects) ===", sync_tracked_count);
+    for (uint32_t i = 0; i < sync_tracked_count; i++) {
+        const sync_stats_t* stats = sync_tracked[i].stats;
+        uint32_t avg_wait = stats->contended_count
+                                ? (uint32_t)(stats->wait_cycles /
+                                             stats->contended_count)
+                                : 0;
+        debug_print("%s %s: acquired %u, contended %u", sync_tracked[i].kind,
+                    sync_tracked[i].name, stats->acquire_count,
+                    stats->contended_count);
+        debug_print("  wait cycles: avg %u, max %u", avg_wait,
+                    stats->max_wait_cycles);
+    }
+}
+
+// セマフォ往復ベンチマーク用
+static ksemaphore_t sync_bench_ping;
+static ksemaphore_t sync_bench_pong;
+
+/*
+ * セマフォ往復ベンチマークの相手側スレッド
+ */
+static void sync_bench_peer(void) {
+    for (int i = 0; i < SYNC_BENCH_ITERATIONS; i++) {
+        ksem_wait(&sync_bench_ping);
+        ksem_post(&sync_bench_pong);
+    }
+}
+
+/*
+ * 同期プリミティブのベンチマーク
+ * 1. 競合なし kmutex_lock + kmutex_unlock（lock cmpxchg の高速パス）
+ * 2. 2スレッド間のセマフォ往復（ブロック → スケジューラ → 起床の経路）
+ */
+void sync_benchmark(void) {
+    static kmutex_t bench_mutex;
+    kmutex_init(&bench_mutex, NULL);
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < SYNC_BENCH_ITERATIONS; i++) {
+        kmutex_lock(&bench_mutex);
+        kmutex_unlock(&bench_mutex);
+    }
+    uint32_t mutex_cycles = (uint32_t)(rdtsc() - start);
+    debug_print("SYNC BENCH: uncontended lock+unlock %u cycles",
+                mutex_cycles / SYNC_BENCH_ITERATIONS);
+
+    ksem_init(&sync_bench_ping, 0, "bench_ping");
+    ksem_init(&sync_bench_pong, 0, "bench_pong");
+
+    thread_t* peer = NULL;
+    if (OS_FAILURE_CHECK(create_thread(sync_bench_peer, 1, 0, &peer))) {
+        debug_print("SYNC BENCH: skipped semaphore ping-pong (no thread)");
+        return;
+    }
+
+    start = rdtsc();
+    for (int i = 0; i < SYNC_BENCH_ITERATIONS; i++) {
+        ksem_post(&sync_bench_ping);
+        ksem_wait(&sync_bench_pong);
+    }
+    uint32_t sem_cycles = (uint32_t)(rdtsc() - start);
+    debug_print("SYNC BENCH: semaphore round trip %u cycles",
+                sem_cycles / SYNC_BENCH_ITERATIONS);
+}
+
+/*
+ * =================================================================================
+ * 優先度継承テスト（3スレッド）
+ * =================================================================================
+ * L（低）が mutex を保持中に H（高）が待ち、M（中）がCPUを占有し続ける古典的な
+ * 優先度逆転シナリオ。継承なしでは H の待ちが M の占有時間まで伸びるが、
+ * 継承ありでは L が H の優先度で走るため L の保持時間で抑えられる
+ */
+
+static kmutex_t pi_test_mutex;
+static ksemaphore_t pi_test_locked;  // L がロックを取得したら H/M を起動
+static ksemaphore_t pi_test_done;    // 3スレッドの終了通知
+static uint32_t pi_test_wait_ticks;
+static uint32_t pi_test_wait_cycles;
+
+/*
+ * 指定ティック数だけCPUを使い続ける（ブロックしない）
+ */
+static void pi_test_busy_ticks(uint32_t ticks) {
+    uint32_t end = get_system_ticks() + ticks;
+    while ((int32_t)(get_system_ticks() - end) < 0) {
+        asm volatile("pause");
+    }
+}
+
+static void pi_test_low(void) {
+    kmutex_lock(&pi_test_mutex);
+    ksem_post(&pi_test_locked);  // H 用
+    ksem_post(&pi_test_locked);  // M 用
+    pi_test_busy_ticks(PI_TEST_HOLD_TICKS);
+    kmutex_unlock(&pi_test_mutex);
+    ksem_post(&pi_test_done);
+}
+
+static void pi_test_medium(void) {
+    ksem_wait(&pi_test_locked);
+    pi_test_busy_ticks(PI_TEST_HOG_TICKS);
+    ksem_post(&pi_test_done);
+}
+
+static void pi_test_high(void) {
+    ksem_wait(&pi_test_locked);
+
+    uint32_t start_tick = get_system_ticks();
+    uint64_t start = rdtsc();
+    kmutex_lock(&pi_test_mutex);
+    pi_test_wait_cycles = (uint32_t)(rdtsc() - start);
+    pi_test_wait_ticks = get_system_ticks() - start_tick;
+    kmutex_unlock(&pi_test_mutex);
+
+    ksem_post(&pi_test_done);
+}
+
+/*
+ * シナリオを1回実行し、H の待ち時間を pi_test_wait_ticks に記録する
+ * 【戻り値】スレッドを作成できずに中止した場合false
+ */
+static bool pi_test_run(bool inherit) {
+    kmutex_init(&pi_test_mutex, NULL);
+    pi_test_mutex.priority_inherit = inherit;
+    ksem_init(&pi_test_locked, 0, NULL);
+    ksem_init(&pi_test_done, 0, NULL);
+
+    static void (*const funcs[3])(void) = {pi_test_low, pi_test_medium,
+                                           pi_test_high};
+    static const uint8_t priorities[3] = {
+        THREAD_PRIORITY_LOW, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_HIGH};
+
+    // 優先度を設定し終えるまで新スレッドが走らないようにする
+    uint32_t flags = irq_save();
+    for (int i = 0; i < 3; i++) {
+        thread_t* thread = NULL;
+        if (OS_FAILURE_CHECK(create_thread(funcs[i], 1, 0, &thread))) {
+            irq_restore(flags);
+            debug_print("PI TEST: skipped (cannot create thread %d)", i);
+            return false;  // 作成済みスレッドは終了通知なしで走り切る
+        }
+        thread_set_priority(thread, priorities[i]);
+    }
+    irq_restore(flags);
+
+    for (int i = 0; i < 3; i++) {
+        ksem_wait(&pi_test_done);
+    }
+
+    debug_print("PI TEST (inherit %s): high-priority wait %u ticks (%u cycles)",
+                inherit ? "on" : "off", pi_test_wait_ticks,
+                pi_test_wait_cycles);
+    return true;
+}
+
+/*
+ * 優先度継承テスト
+ * 【期待値】継承あり: 待ち <= PI_TEST_HOLD_TICKS、継承なし: 約 PI_TEST_HOG_TICKS
+ */
+void sync_priority_inheritance_test(void) {
+    if (!pi_test_run(false)) {
+        return;
+    }
+    uint32_t unbounded = pi_test_wait_ticks;
+
+    if (!pi_test_run(true)) {
+        return;
+    }
+    debug_print("PI TEST: bound %u ticks -> %s (without inheritance: %u ticks)",
+                PI_TEST_HOLD_TICKS,
+                pi_test_wait_ticks <= PI_TEST_HOLD_TICKS ? "PASS" : "FAIL",
+                unbounded);
+}
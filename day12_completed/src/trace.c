@@ -0,0 +1,211 @@
+#include "trace.h"
+
+#include "clock.h"
+#include "kernel.h"
+#include "serial.h"
+#include "smp.h"
+#include "sync.h"
+
+/*
+ * バイナリのトレース出力
+ * 【構造】
+ * - フレームはスタック上で組み立て、serial_output_begin() の中で
+ *   serial_write_buffer() 1回で送る（他の出力がフレームの途中に割り込まない。
+ *   送信中も割り込みは禁止しない）
+ * - トレースイベントは CPU ごとのリング（SPSC）に記録だけして、送出スレッドが
+ *   TRACE_FLUSH_INTERVAL_NS ごとにまとめて送る。記録側は sched_lock の内側
+ *   （スレッド切り替え）や割り込みの出口から呼ばれるため、UART を待たない
+ */
+
+typedef struct {
+    uint64_t tsc;
+    trace_event_t event;
+} trace_ring_entry_t;
+
+typedef struct {
+    trace_ring_entry_t entries[TRACE_EVENT_RING_SIZE];
+    volatile uint32_t head;     // 記録するCPUが書く
+    volatile uint32_t tail;     // 送出スレッドが書く
+    volatile uint32_t dropped;  // リングが満杯で捨てた数（送出時に DROPPED で報告）
+} trace_ring_t;
+
+static trace_ring_t trace_rings[MAX_CPUS];
+static volatile bool trace_binary;
+static spinlock_t trace_lock;  // seq の採番と統計（送出順は serial_output_begin）
+static uint8_t trace_seq;
+static uint32_t trace_frames;
+static uint32_t trace_bytes;
+static volatile uint32_t trace_flushing;  // 送出中（リングの読み出しは1か所ずつ）
+static thread_t* trace_thread;
+
+/*
+ * フレームの組み立てと送出
+ * 【備考】payload は TRACE_PAYLOAD_MAX で切り詰める
+ */
+static void trace_emit_frame(uint8_t type, uint8_t cpu, uint64_t tsc,
+                             const void* payload, uint32_t length) {
+    if (length > TRACE_PAYLOAD_MAX) {
+        length = TRACE_PAYLOAD_MAX;
+    }
+
+    uint8_t frame[TRACE_FRAME_MAX];
+    trace_header_t* header = (trace_header_t*)frame;
+    header->sync[0] = TRACE_SYNC0;
+    header->sync[1] = TRACE_SYNC1;
+    header->type = type;
+    header->length = (uint8_t)length;
+    header->cpu = cpu;
+    header->tsc = tsc;
+
+    const uint8_t* src = (const uint8_t*)payload;
+    for (uint32_t i = 0; i < length; i++) {
+        frame[TRACE_HEADER_SIZE + i] = src[i];
+    }
+    uint32_t size = TRACE_HEADER_SIZE + length;
+
+    // seq は送出の順序を取ってから振る（デコーダが欠落を数えられる順に並ぶ）
+    bool locked = serial_output_begin();
+    uint32_t flags = spin_lock_irqsave(&trace_lock);
+    header->seq = trace_seq++;
+    trace_frames++;
+    trace_bytes += size + TRACE_CHECKSUM_SIZE;
+    spin_unlock_irqrestore(&trace_lock, flags);
+
+    // チェックサムは sync を除いた type から payload の末尾まで
+    uint16_t sum = trace_checksum(frame + 2, size - 2);
+    frame[size] = sum & 0xFF;
+    frame[size + 1] = sum >> 8;
+    size += TRACE_CHECKSUM_SIZE;
+    serial_write_buffer((const char*)frame, size);
+    serial_output_end(locked);
+}
+
+/*
+ * レコードの送出（実行中CPU・現在時刻で送る）
+ */
+void trace_emit(uint8_t type, const void* payload, uint32_t length) {
+    trace_emit_frame(type, (uint8_t)get_kernel_context()->cpu_id, rdtsc(),
+                     payload, length);
+}
+
+void trace_emit_text(const char* text) {
+    uint32_t length = 0;
+    while (text[length] && length < TRACE_PAYLOAD_MAX) {
+        length++;
+    }
+    trace_emit(TRACE_REC_TEXT, text, length);
+}
+
+/*
+ * 出力形式の切り替え
+ * 【役割】有効にした時点で HELLO（TSC 周波数）を送り、デコーダが時刻を換算できる
+ * ようにする。無効にする前に記録済みのイベントを送り切る
+ */
+void trace_set_binary(bool enable) {
+    if (enable == trace_binary) {
+        return;
+    }
+    if (enable) {
+        for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+            trace_rings[cpu].tail = trace_rings[cpu].head;  // 古いイベントは捨てる
+            trace_rings[cpu].dropped = 0;
+        }
+        trace_binary = true;
+        trace_hello_t hello = {TRACE_PROTOCOL_VERSION,
+                               (uint16_t)smp_get_online_count(),
+                               clock_get_tsc_khz()};
+        trace_emit(TRACE_REC_HELLO, &hello, sizeof(hello));
+    } else {
+        trace_flush_events();
+        trace_binary = false;
+    }
+}
+
+bool trace_binary_enabled(void) {
+    return trace_binary;
+}
+
+/*
+ * トレースイベントの記録
+ * 【役割】実行中CPUのリングに入れるだけ（バイナリ出力が無効なら何もしない）
+ * 【備考】割り込みハンドラ・sched_lock の保持中からも呼べる
+ */
+void trace_event(uint16_t id, uint32_t arg0, uint32_t arg1) {
+    if (!trace_binary) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    trace_ring_t* ring = &trace_rings[get_kernel_context()->cpu_id];
+    uint32_t head = ring->head;
+    if (head - ring->tail >= TRACE_EVENT_RING_SIZE) {
+        ring->dropped++;
+    } else {
+        trace_ring_entry_t* entry = &ring->entries[head % TRACE_EVENT_RING_SIZE];
+        entry->tsc = rdtsc();
+        entry->event.id = id;
+        entry->event.arg0 = arg0;
+        entry->event.arg1 = arg1;
+        asm volatile("" : : : "memory");  // 内容を書いてから head を公開する
+        ring->head = head + 1;
+    }
+    irq_restore(flags);
+}
+
+/*
+ * 記録済みイベントの送出
+ * 【役割】全CPUのリングに記録済みのイベントを送り、捨てた数があれば DROPPED で報告する
+ * 【前提】スレッドから呼ぶ（UART の送信を待つ）
+ * 【備考】送出スレッドとシェルの binlog flush / off が重なった場合は、
+ * 後から来た方は何もしない（リングの読み出し側を1つに保つ）
+ */
+void trace_flush_events(void) {
+    if (atomic_xchg(&trace_flushing, 1)) {
+        return;
+    }
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        trace_ring_t* ring = &trace_rings[cpu];
+        uint32_t head = ring->head;  // 送出中に増えた分は次回に回す
+        while (ring->tail != head) {
+            trace_ring_entry_t entry =
+                ring->entries[ring->tail % TRACE_EVENT_RING_SIZE];
+            asm volatile("" : : : "memory");  // 読み終えてから枠を返す
+            ring->tail++;
+            trace_emit_frame(TRACE_REC_EVENT, (uint8_t)cpu, entry.tsc,
+                             &entry.event, sizeof(entry.event));
+        }
+        if (ring->dropped) {
+            uint32_t dropped = atomic_xchg(&ring->dropped, 0);
+            trace_emit_frame(TRACE_REC_DROPPED, (uint8_t)cpu, rdtsc(), &dropped,
+                             sizeof(dropped));
+        }
+    }
+    trace_flushing = 0;
+}
+
+/*
+ * 送出スレッド本体
+ */
+static void trace_thread_main(void) {
+    while (1) {
+        sleep_ns(TRACE_FLUSH_INTERVAL_NS);
+        if (trace_binary) {
+            trace_flush_events();
+        }
+    }
+}
+
+/*
+ * 送出スレッドの作成
+ */
+os_result_t trace_start(void) {
+    return create_thread(trace_thread_main, 1, 0, &trace_thread);
+}
+
+/*
+ * 統計の表示（シェルの binlog から）
+ */
+void trace_print_stats(void) {
+    debug_print("バイナリ出力: %s, フレーム %u, %u バイト",
+                trace_binary ? "有効" : "無効", trace_frames, trace_bytes);
+}
@@ -0,0 +1,595 @@
+#include "vbe.h"
+
+#include "clock.h"
+#include "fpu.h"
+#include "kernel.h"
+#include "sync.h"
+#include "vga.h"
+
+/*
+ * Bochs/QEMU VBE のグラフィックスモード
+ * 【構造】描画は全て行単位のスパン（vbe_span_*）に分けて行う。SSE のカーネルは
+ * kernel_fpu_begin() の区間（割り込み禁止）で使うため、区間は 1 行（最大 4KB）
+ * または 1 文字（512 バイト）ごとに区切る。ノンテンポラルストアの後は区間の
+ * 終わりで sfence を1回だけ発行する
+ * 【備考】カーネルは -mno-sse -mno-sse2（Makefile の CFLAGS）でコンパイルするため、
+ * コンパイラは xmm を使わない。asm の xmm0/xmm1 は clobber に書けないが、
+ * 区間の中なので壊してよい
+ */
+
+/*
+ * 展開済みの文字（文字・前景色・背景色ごと）
+ */
+typedef struct {
+    uint32_t pixels[VBE_GLYPH_HEIGHT][VBE_GLYPH_WIDTH];  // 先頭に置いて 16 バイト境界
+    uint32_t fg;
+    uint32_t bg;
+    uint8_t ch;
+    bool valid;
+} __attribute__((aligned(16))) vbe_glyph_t;
+
+static bool vbe_available;
+static bool vbe_active;  // グラフィックスモード中
+static uint16_t vbe_id;
+static uint32_t vbe_lfb_phys;
+static uint32_t* vbe_fb;
+static vbe_blit_kernel_t vbe_kernel = VBE_BLIT_REP;
+static uint8_t vbe_font[VGA_FONT_GLYPHS][VGA_FONT_HEIGHT];
+static vbe_glyph_t vbe_glyph_cache[VBE_GLYPH_CACHE_SIZE];
+static vbe_glyph_t vbe_glyph_scratch;  // キャッシュを使わない時の展開先
+static bool vbe_glyph_cache_enabled = true;
+static vbe_stats_t vbe_stats;
+static spinlock_t vbe_glyph_lock;  // 上の4つ（キャッシュ・展開先・設定・統計）の排他
+static uint32_t vbe_tile[VBE_TILE_SIZE * VBE_TILE_SIZE] __attribute__((aligned(16)));
+
+/*
+ * =================================================================================
+ * 検出とモード設定
+ * =================================================================================
+ */
+
+static uint32_t pci_config_read(uint8_t bus, uint8_t device, uint8_t function,
+                                uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, PCI_CONFIG_ENABLE | ((uint32_t)bus << 16) |
+                                 ((uint32_t)device << 11) |
+                                 ((uint32_t)function << 8) | (offset & 0xFC));
+    return inl(PCI_CONFIG_DATA);
+}
+
+/*
+ * フレームバッファの物理アドレス
+ * 【役割】バス0 から標準 VGA（1234:1111）を探し、BAR0 のメモリアドレスを返す
+ * 【戻り値】見つからなければ 0
+ */
+static uint32_t vbe_find_lfb(void) {
+    for (uint8_t device = 0; device < PCI_DEVICES_PER_BUS; device++) {
+        uint32_t id = pci_config_read(0, device, 0, PCI_REG_ID);
+        if ((id & 0xFFFF) != VBE_PCI_VENDOR || (id >> 16) != VBE_PCI_DEVICE) {
+            continue;
+        }
+        uint32_t bar = pci_config_read(0, device, 0, PCI_REG_BAR0);
+        if (!(bar & PCI_BAR_IO)) {
+            return bar & PCI_BAR_MEM_MASK;
+        }
+    }
+    return 0;
+}
+
+static void vbe_dispi_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    outw(VBE_DISPI_IOPORT_DATA, value);
+}
+
+static uint16_t vbe_dispi_read(uint16_t index) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    return inw(VBE_DISPI_IOPORT_DATA);
+}
+
+/*
+ * 検出
+ * 【役割】DISPI の版とフレームバッファのアドレスを調べる（モードは変えない）。
+ * SSE が使えれば描画カーネルの既定を SSE にする
+ * 【戻り値】DISPI（ID2 以降）か PCI の標準 VGA がなければ OS_ERROR_NOT_FOUND
+ */
+os_result_t vbe_init(void) {
+    vbe_id = vbe_dispi_read(VBE_DISPI_INDEX_ID);
+    if ((vbe_id & VBE_DISPI_ID_MASK) != VBE_DISPI_ID0 ||
+        vbe_id < VBE_DISPI_ID2) {
+        debug_print("VBE: DISPI not found (ID 0x%x)", vbe_id);
+        return OS_ERROR_NOT_FOUND;
+    }
+    vbe_lfb_phys = vbe_find_lfb();
+    if (!vbe_lfb_phys) {
+        debug_print("VBE: PCI display 1234:1111 not found");
+        return OS_ERROR_NOT_FOUND;
+    }
+    vbe_available = true;
+    vbe_kernel = fpu_is_available() ? VBE_BLIT_SSE : VBE_BLIT_REP;
+    debug_print("VBE: DISPI ID 0x%x, LFB 0x%x", vbe_id, vbe_lfb_phys);
+    return OS_SUCCESS;
+}
+
+bool vbe_is_available(void) {
+    return vbe_available;
+}
+
+/*
+ * 展開済みの文字を全て捨てる（フォントを写し直した時・ベンチマークの各回の前）
+ * @param enabled: 以後キャッシュを使うか（false なら毎回展開する）
+ */
+static void vbe_glyph_cache_reset(bool enabled) {
+    uint32_t flags = spin_lock_irqsave(&vbe_glyph_lock);
+    for (uint32_t i = 0; i < VBE_GLYPH_CACHE_SIZE; i++) {
+        vbe_glyph_cache[i].valid = false;
+    }
+    vbe_glyph_cache_enabled = enabled;
+    spin_unlock_irqrestore(&vbe_glyph_lock, flags);
+}
+
+/*
+ * グラフィックスモードへの切り替え
+ * 【役割】テキストモードを止めて（フォントはこの時に写す）、VBE_WIDTH x
+ * VBE_HEIGHT x VBE_BPP に設定する。設定が読み返した値と合わなければ元に戻す
+ * 【戻り値】未検出なら OS_ERROR_NOT_FOUND、切り替え済みなら OS_ERROR_INVALID_STATE
+ */
+os_result_t vbe_enter(void) {
+    if (!vbe_available) {
+        return OS_ERROR_NOT_FOUND;
+    }
+    if (vbe_active) {
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    vga_text_suspend(vbe_font);
+    vbe_dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    vbe_dispi_write(VBE_DISPI_INDEX_XRES, VBE_WIDTH);
+    vbe_dispi_write(VBE_DISPI_INDEX_YRES, VBE_HEIGHT);
+    vbe_dispi_write(VBE_DISPI_INDEX_BPP, VBE_BPP);
+    vbe_dispi_write(VBE_DISPI_INDEX_VIRT_WIDTH, VBE_WIDTH);
+    vbe_dispi_write(VBE_DISPI_INDEX_X_OFFSET, 0);
+    vbe_dispi_write(VBE_DISPI_INDEX_Y_OFFSET, 0);
+    vbe_dispi_write(VBE_DISPI_INDEX_ENABLE,
+                    VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
+
+    if (vbe_dispi_read(VBE_DISPI_INDEX_XRES) != VBE_WIDTH ||
+        vbe_dispi_read(VBE_DISPI_INDEX_YRES) != VBE_HEIGHT ||
+        vbe_dispi_read(VBE_DISPI_INDEX_BPP) != VBE_BPP) {
+        vbe_dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+        vga_text_resume();
+        debug_print("VBE: mode %ux%ux%u rejected", VBE_WIDTH, VBE_HEIGHT,
+                    VBE_BPP);
+        return OS_ERROR_HARDWARE_FAILURE;
+    }
+
+    // ページングを使っていないため、物理アドレスをそのまま使う
+    vbe_fb = (uint32_t*)vbe_lfb_phys;
+    vbe_glyph_cache_reset(true);
+    vbe_active = true;
+    return OS_SUCCESS;
+}
+
+/*
+ * テキストモードへの復帰
+ */
+void vbe_leave(void) {
+    if (!vbe_active) {
+        return;
+    }
+    vbe_dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    vbe_active = false;
+    vga_text_resume();
+}
+
+/*
+ * =================================================================================
+ * スパンのカーネル
+ * =================================================================================
+ */
+
+static inline void vbe_span_fill_rep(uint32_t* dst, uint32_t color,
+                                     uint32_t count) {
+    asm volatile("rep stosl" : "+D"(dst), "+c"(count) : "a"(color) : "memory");
+}
+
+static inline void vbe_span_copy_rep(uint32_t* dst, const uint32_t* src,
+                                     uint32_t count) {
+    asm volatile("rep movsl"
+                 : "+D"(dst), "+S"(src), "+c"(count)
+                 :
+                 : "memory");
+}
+
+/*
+ * SSE の塗りつぶし
+ * 【役割】16 バイト境界までと端数は rep stosd、間は 64 バイトずつ movntps で書く
+ * （キャッシュを汚さず、書き込み結合でフレームバッファへまとめて送る）
+ * 【前提】kernel_fpu_begin() の区間で呼ぶ（sfence は区間の終わりで発行する）
+ */
+static void vbe_span_fill_sse(uint32_t* dst, uint32_t color, uint32_t count) {
+    uint32_t head = ((16 - ((uintptr_t)dst & 15)) & 15) / 4;
+    if (head > count) {
+        head = count;
+    }
+    vbe_span_fill_rep(dst, color, head);
+    dst += head;
+    count -= head;
+
+    uint32_t blocks = count / 16;  // 64 バイト = 16 ピクセル
+    uint32_t rest = count % 16;
+    if (blocks) {
+        uint32_t pattern[4] __attribute__((aligned(16))) = {color, color, color,
+                                                            color};
+        asm volatile(
+            "movaps (%2), %%xmm0\n\t"
+            "1:\n\t"
+            "movntps %%xmm0, (%0)\n\t"
+            "movntps %%xmm0, 16(%0)\n\t"
+            "movntps %%xmm0, 32(%0)\n\t"
+            "movntps %%xmm0, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b"
+            : "+r"(dst), "+r"(blocks)
+            : "r"(pattern)
+            : "memory", "cc");
+    }
+    vbe_span_fill_rep(dst, color, rest);
+}
+
+/*
+ * SSE の転送
+ * 【役割】書き込み先を 16 バイト境界にそろえ、32 バイトずつ movups で読んで
+ * movntps で書く（転送元の境界は問わない）。1 文字の 1 行（8 ピクセル）も
+ * 1 回のループで済む
+ * 【前提】kernel_fpu_begin() の区間で呼ぶ（sfence は区間の終わりで発行する）
+ */
+static void vbe_span_copy_sse(uint32_t* dst, const uint32_t* src,
+                              uint32_t count) {
+    uint32_t head = ((16 - ((uintptr_t)dst & 15)) & 15) / 4;
+    if (head > count) {
+        head = count;
+    }
+    vbe_span_copy_rep(dst, src, head);
+    dst += head;
+    src += head;
+    count -= head;
+
+    uint32_t blocks = count / 8;  // 32 バイト = 8 ピクセル
+    uint32_t rest = count % 8;
+    if (blocks) {
+        asm volatile(
+            "1:\n\t"
+            "movups (%1), %%xmm0\n\t"
+            "movups 16(%1), %%xmm1\n\t"
+            "movntps %%xmm0, (%0)\n\t"
+            "movntps %%xmm1, 16(%0)\n\t"
+            "add $32, %0\n\t"
+            "add $32, %1\n\t"
+            "dec %2\n\t"
+            "jnz 1b"
+            : "+r"(dst), "+r"(src), "+r"(blocks)
+            :
+            : "memory", "cc");
+    }
+    vbe_span_copy_rep(dst, src, rest);
+}
+
+static inline uint32_t vbe_sse_begin(void) {
+    return kernel_fpu_begin();
+}
+
+static inline void vbe_sse_end(uint32_t flags) {
+    asm volatile("sfence" : : : "memory");  // ノンテンポラルストアを確定させる
+    kernel_fpu_end(flags);
+}
+
+/*
+ * =================================================================================
+ * 描画
+ * =================================================================================
+ */
+
+void vbe_set_blit_kernel(vbe_blit_kernel_t kernel) {
+    if (kernel == VBE_BLIT_SSE && !fpu_is_available()) {
+        kernel = VBE_BLIT_REP;
+    }
+    vbe_kernel = kernel;
+}
+
+/*
+ * 矩形を画面内に切り詰める
+ * 【戻り値】描く部分が残らなければ false。sx/sy には切り詰めた分を足す
+ */
+static bool vbe_clip(int* x, int* y, int* width, int* height, int* sx,
+                     int* sy) {
+    if (*x < 0) {
+        *sx -= *x;
+        *width += *x;
+        *x = 0;
+    }
+    if (*y < 0) {
+        *sy -= *y;
+        *height += *y;
+        *y = 0;
+    }
+    if (*x + *width > VBE_WIDTH) {
+        *width = VBE_WIDTH - *x;
+    }
+    if (*y + *height > VBE_HEIGHT) {
+        *height = VBE_HEIGHT - *y;
+    }
+    return vbe_active && *width > 0 && *height > 0;
+}
+
+void vbe_fill_rect(int x, int y, int width, int height, uint32_t color) {
+    int sx = 0;
+    int sy = 0;
+    if (!vbe_clip(&x, &y, &width, &height, &sx, &sy)) {
+        return;
+    }
+    uint32_t* dst = vbe_fb + y * VBE_WIDTH + x;
+    for (int row = 0; row < height; row++, dst += VBE_WIDTH) {
+        if (vbe_kernel == VBE_BLIT_SSE) {
+            uint32_t flags = vbe_sse_begin();
+            vbe_span_fill_sse(dst, color, (uint32_t)width);
+            vbe_sse_end(flags);
+        } else {
+            vbe_span_fill_rep(dst, color, (uint32_t)width);
+        }
+    }
+}
+
+/*
+ * RAM 上の画像の転送
+ * @param src_pitch: 転送元の1行のピクセル数
+ */
+void vbe_blit(int x, int y, const uint32_t* src, uint32_t src_pitch, int width,
+              int height) {
+    int sx = 0;
+    int sy = 0;
+    if (!vbe_clip(&x, &y, &width, &height, &sx, &sy)) {
+        return;
+    }
+    uint32_t* dst = vbe_fb + y * VBE_WIDTH + x;
+    src += sy * src_pitch + sx;
+    for (int row = 0; row < height; row++, dst += VBE_WIDTH, src += src_pitch) {
+        if (vbe_kernel == VBE_BLIT_SSE) {
+            uint32_t flags = vbe_sse_begin();
+            vbe_span_copy_sse(dst, src, (uint32_t)width);
+            vbe_sse_end(flags);
+        } else {
+            vbe_span_copy_rep(dst, src, (uint32_t)width);
+        }
+    }
+}
+
+/*
+ * =================================================================================
+ * 文字
+ * =================================================================================
+ */
+
+static void vbe_glyph_expand(vbe_glyph_t* glyph, uint8_t ch, uint32_t fg,
+                             uint32_t bg) {
+    for (uint32_t y = 0; y < VBE_GLYPH_HEIGHT; y++) {
+        uint8_t bits = vbe_font[ch][y];
+        for (uint32_t x = 0; x < VBE_GLYPH_WIDTH; x++) {
+            glyph->pixels[y][x] = (bits & (0x80 >> x)) ? fg : bg;
+        }
+    }
+    glyph->ch = ch;
+    glyph->fg = fg;
+    glyph->bg = bg;
+    glyph->valid = true;
+    vbe_stats.cache_misses++;
+}
+
+/*
+ * 展開済みの文字の取得
+ * 【構造】ダイレクトマップ。色の組から作った 7bit の値と文字コードの XOR で
+ * 枠を選ぶため、同じ色の ASCII（0〜127）は互いに追い出し合わない
+ * 【前提】vbe_glyph_lock を保持していること（返した枠は解放まで有効）
+ */
+static const vbe_glyph_t* vbe_glyph_get(uint8_t ch, uint32_t fg, uint32_t bg) {
+    if (!vbe_glyph_cache_enabled) {
+        vbe_glyph_expand(&vbe_glyph_scratch, ch, fg, bg);
+        return &vbe_glyph_scratch;
+    }
+    uint32_t color_hash = ((fg ^ (bg * 0x9E3779B1u)) * 0x85EBCA6Bu) >> 25;
+    vbe_glyph_t* glyph =
+        &vbe_glyph_cache[(ch ^ color_hash) % VBE_GLYPH_CACHE_SIZE];
+    if (glyph->valid && glyph->ch == ch && glyph->fg == fg && glyph->bg == bg) {
+        vbe_stats.cache_hits++;
+        return glyph;
+    }
+    vbe_glyph_expand(glyph, ch, fg, bg);
+    return glyph;
+}
+
+/*
+ * 文字列の描画
+ * @param column, row: 文字単位の位置（VBE_TEXT_COLS x VBE_TEXT_ROWS）
+ * 【役割】行末で切り詰める
+ * 【構造】1文字ごとに vbe_glyph_lock を取り、展開（キャッシュにない時）を
+ * 済ませてから SSE の区間に入る。割り込み禁止は 1 文字の展開と転送
+ * （512 バイト）までで、文字列の長さやキャッシュの状態によらない
+ */
+void vbe_draw_text(int column, int row, const char* text, uint32_t fg,
+                   uint32_t bg) {
+    if (!vbe_active || row < 0 || row >= VBE_TEXT_ROWS || column < 0) {
+        return;
+    }
+
+    bool sse = vbe_kernel == VBE_BLIT_SSE;
+    uint32_t* line = vbe_fb + row * VBE_GLYPH_HEIGHT * VBE_WIDTH;
+    for (; *text && column < VBE_TEXT_COLS; text++, column++) {
+        uint32_t flags = spin_lock_irqsave(&vbe_glyph_lock);
+        const vbe_glyph_t* glyph = vbe_glyph_get((uint8_t)*text, fg, bg);
+        uint32_t* dst = line + column * VBE_GLYPH_WIDTH;
+        if (sse) {
+            uint32_t fpu_flags = vbe_sse_begin();
+            for (uint32_t y = 0; y < VBE_GLYPH_HEIGHT; y++, dst += VBE_WIDTH) {
+                vbe_span_copy_sse(dst, glyph->pixels[y], VBE_GLYPH_WIDTH);
+            }
+            vbe_sse_end(fpu_flags);
+        } else {
+            for (uint32_t y = 0; y < VBE_GLYPH_HEIGHT; y++, dst += VBE_WIDTH) {
+                vbe_span_copy_rep(dst, glyph->pixels[y], VBE_GLYPH_WIDTH);
+            }
+        }
+        vbe_stats.glyphs_drawn++;
+        spin_unlock_irqrestore(&vbe_glyph_lock, flags);
+    }
+}
+
+/*
+ * =================================================================================
+ * ベンチマーク
+ * =================================================================================
+ * - fill: 全画面の塗りつぶしと、RAM 上のタイル（VBE_TILE_SIZE 四方）を敷き詰める
+ *   転送を VBE_BENCH_FILLS 回ずつ。カーネルごとのフレーム/秒と MB/s
+ * - text: 全画面（VBE_TEXT_COLS x VBE_TEXT_ROWS）の文字描画を
+ *   VBE_BENCH_TEXT_SCREENS 回。キャッシュなし/ありと カーネルごとの文字/秒
+ * 計測中はグラフィックスモードに切り替え、終わったらテキストモードに戻す
+ */
+static const char* const vbe_kernel_names[] = {"rep", "sse"};
+
+static void vbe_benchmark_report(const char* what, const char* kernel,
+                                 uint32_t frames, uint64_t ns) {
+    uint64_t bytes = (uint64_t)frames * VBE_WIDTH * VBE_HEIGHT * 4;
+    debug_print("VBE BENCH: %s %s, %u frames in %u us, %u frames/s, %u MB/s",
+                what, kernel, frames, (uint32_t)(ns / NSEC_PER_USEC),
+                ns ? (uint32_t)((uint64_t)frames * NSEC_PER_SEC / ns) : 0,
+                ns ? (uint32_t)(bytes * 1000 / ns) : 0);
+}
+
+static bool vbe_benchmark_enter(void) {
+    if (!vbe_available) {
+        debug_print("VBE BENCH: skipped (no Bochs VBE display)");
+        return false;
+    }
+    if (OS_FAILURE_CHECK(vbe_enter())) {
+        debug_print("VBE BENCH: skipped (mode set failed)");
+        return false;
+    }
+    return true;
+}
+
+void vbe_benchmark_fill(void) {
+    if (!vbe_benchmark_enter()) {
+        return;
+    }
+    for (uint32_t y = 0; y < VBE_TILE_SIZE; y++) {
+        for (uint32_t x = 0; x < VBE_TILE_SIZE; x++) {
+            vbe_tile[y * VBE_TILE_SIZE + x] = (x * 2) << 16 | (y * 2) << 8 | 0x40;
+        }
+    }
+
+    vbe_blit_kernel_t saved = vbe_kernel;
+    uint32_t kernels = fpu_is_available() ? 2 : 1;
+    for (uint32_t k = 0; k < kernels; k++) {
+        vbe_set_blit_kernel((vbe_blit_kernel_t)k);
+
+        uint64_t start = rdtsc();
+        for (uint32_t i = 0; i < VBE_BENCH_FILLS; i++) {
+            vbe_fill_rect(0, 0, VBE_WIDTH, VBE_HEIGHT,
+                          (i & 1) ? 0x00203040 : 0x00000000);
+        }
+        uint64_t ns = clock_cycles_to_ns(rdtsc() - start);
+        vbe_benchmark_report("fill", vbe_kernel_names[k], VBE_BENCH_FILLS, ns);
+
+        start = rdtsc();
+        for (uint32_t i = 0; i < VBE_BENCH_FILLS; i++) {
+            for (int y = 0; y < VBE_HEIGHT; y += VBE_TILE_SIZE) {
+                for (int x = 0; x < VBE_WIDTH; x += VBE_TILE_SIZE) {
+                    vbe_blit(x, y, vbe_tile, VBE_TILE_SIZE, VBE_TILE_SIZE,
+                             VBE_TILE_SIZE);
+                }
+            }
+        }
+        ns = clock_cycles_to_ns(rdtsc() - start);
+        vbe_benchmark_report("blit", vbe_kernel_names[k], VBE_BENCH_FILLS, ns);
+    }
+    vbe_kernel = saved;
+    vbe_leave();
+}
+
+void vbe_benchmark_text(void) {
+    static const struct {
+        const char* name;
+        vbe_blit_kernel_t kernel;
+        bool cached;
+    } cases[] = {
+        {"rep, uncached", VBE_BLIT_REP, false},
+        {"rep, cached", VBE_BLIT_REP, true},
+        {"sse, cached", VBE_BLIT_SSE, true},
+    };
+    // 行ごとに開始位置をずらして使う（表示できる ASCII を一巡させる）
+    static char text[VBE_TEXT_COLS + VBE_TEXT_ROWS + 1];
+
+    if (!vbe_benchmark_enter()) {
+        return;
+    }
+    for (uint32_t i = 0; i < VBE_TEXT_COLS + VBE_TEXT_ROWS; i++) {
+        text[i] = (char)(' ' + i % 95);
+    }
+
+    vbe_blit_kernel_t saved = vbe_kernel;
+    const uint32_t glyphs = VBE_BENCH_TEXT_SCREENS * VBE_TEXT_ROWS * VBE_TEXT_COLS;
+    for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        if (cases[c].kernel == VBE_BLIT_SSE && !fpu_is_available()) {
+            continue;
+        }
+        vbe_set_blit_kernel(cases[c].kernel);
+        vbe_glyph_cache_reset(cases[c].cached);
+
+        vbe_stats_t before;
+        vbe_get_stats(&before);
+        uint64_t start = rdtsc();
+        for (uint32_t s = 0; s < VBE_BENCH_TEXT_SCREENS; s++) {
+            for (int row = 0; row < VBE_TEXT_ROWS; row++) {
+                vbe_draw_text(0, row, text + row, 0x00E0E0E0, 0x00102030);
+            }
+        }
+        uint64_t ns = clock_cycles_to_ns(rdtsc() - start);
+        vbe_stats_t after;
+        vbe_get_stats(&after);
+        uint32_t misses = after.cache_misses - before.cache_misses;
+
+        debug_print("VBE BENCH: text %s, %u glyphs in %u us, %u glyphs/s, "
+                    "%u us/screen, glyph expansions %u",
+                    cases[c].name, glyphs, (uint32_t)(ns / NSEC_PER_USEC),
+                    ns ? (uint32_t)((uint64_t)glyphs * NSEC_PER_SEC / ns) : 0,
+                    (uint32_t)(ns / NSEC_PER_USEC / VBE_BENCH_TEXT_SCREENS),
+                    misses);
+    }
+    vbe_glyph_cache_reset(true);
+    vbe_kernel = saved;
+    vbe_leave();
+}
+
+/*
+ * =================================================================================
+ * 統計
+ * =================================================================================
+ */
+
+void vbe_get_stats(vbe_stats_t* out) {
+    uint32_t flags = spin_lock_irqsave(&vbe_glyph_lock);
+    *out = vbe_stats;
+    spin_unlock_irqrestore(&vbe_glyph_lock, flags);
+}
+
+void vbe_print_info(void) {
+    if (!vbe_available) {
+        debug_print("VBE: not available");
+        return;
+    }
+    debug_print("VBE: DISPI ID 0x%x, LFB 0x%x, %ux%ux%u, kernel %s%s",
+                vbe_id, vbe_lfb_phys, VBE_WIDTH, VBE_HEIGHT, VBE_BPP,
+                vbe_kernel_names[vbe_kernel], vbe_active ? ", active" : "");
+    vbe_stats_t stats;
+    vbe_get_stats(&stats);
+    debug_print("VBE: glyphs %u, cache hits %u, expansions %u",
+                stats.glyphs_drawn, stats.cache_hits, stats.cache_misses);
+}
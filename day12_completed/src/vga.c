@@ -0,0 +1,877 @@
+#include "vga.h"
+
+#include "clock.h"
+#include "kernel.h"
+#include "periodic.h"
+#include "sync.h"
+
+/*
+ * VGA テキスト画面
+ * 【構造】画面出力の API はすべて呼び出したスレッドの仮想コンソール（vga_cells）に
+ * 書く。表示中のコンソール（vga_active）への書き込みだけ変更ビットを立て、
+ * VGA メモリへの書き込みと CRTC の更新は vga_flush() だけが行う。
+ * コンソールの画面の行 r は vga_cells の行 origin + r に当たり、表示中の
+ * コンソールの行 n は常にテキストメモリの行 n に転送される
+ */
+
+static uint16_t* const vga_memory = (uint16_t*)VGA_MEMORY;
+
+/*
+ * 仮想コンソール
+ * 【備考】内容（vga_cells）はテキストメモリ全体と同じ大きさで、裏のコンソールも
+ * 表示中と同じようにスクロールし、スクロールバックの履歴を持つ
+ */
+typedef struct {
+    uint32_t origin;     // 画面の行0 に当たる行（上の行はスクロールバック）
+    uint32_t view_back;  // スクロールバックで遡っている行数（0 = 最新）
+    uint16_t cx, cy;     // カーソル位置（CRTC への反映は表示中のみ・転送時）
+    uint8_t col;         // vga_putc() の文字色
+    bool ready;          // 全行を空白で埋めた（最初の使用時）
+} vga_console_t;
+
+static uint16_t vga_cells[VGA_CONSOLES][VGA_TEXT_ROWS][VGA_WIDTH];
+static vga_console_t vga_consoles[VGA_CONSOLES];
+static uint32_t vga_active;  // 表示中のコンソール（VGA メモリの内容の元）
+static uint32_t vga_dirty[VGA_TEXT_ROWS][VGA_DIRTY_WORDS];  // 転送待ちのセル
+static uint32_t vga_dirty_rows[VGA_DIRTY_ROW_WORDS];  // 転送待ちのセルがある行
+static uint16_t vga_crtc_start;  // CRTC に書いた表示開始アドレス（転送側だけが触る）
+static uint16_t vga_crtc_cursor;  // CRTC に書いたカーソル位置
+static bool vga_crtc_cursor_valid;  // vga_crtc_cursor が実際の値と一致している
+static spinlock_t vga_lock;  // コンソール・変更ビット・表示中のコンソールの排他
+static volatile uint32_t vga_flushing;  // 転送中（VGA メモリへ書くのは1か所ずつ）
+static bool vga_compositor_running;
+static bool vga_text_suspended;  // グラフィックスモード中（VGA メモリに書かない）
+static periodic_task_t* vga_compositor;
+static vga_stats_t vga_stats;
+
+/*
+ * =================================================================================
+ * 仮想コンソール
+ * =================================================================================
+ */
+
+// VGAエントリ作成：文字と属性を16bitに合成
+static inline uint16_t ve(char c, uint8_t a) {
+    return (uint16_t)(uint8_t)c | ((uint16_t)a << 8);
+}
+
+// 1行分の変更ビットマップの word 番目で、行内のセルに当たるビット
+static inline uint32_t vga_row_mask(uint32_t word) {
+    uint32_t cells = VGA_WIDTH - word * 32;
+    return cells >= 32 ? 0xFFFFFFFF : (1u << cells) - 1;
+}
+
+static inline void vga_mark_row(uint32_t line) {
+    vga_dirty_rows[line / 32] |= 1u << (line % 32);
+}
+
+/*
+ * コンソールの取得
+ * 【役割】最初の使用時に全行を空白で埋める。表示中のコンソールなら全行を
+ * 転送待ちにする（起動直後の VGA メモリに残っている BIOS の表示を消す）
+ * 【前提】vga_lock を保持して呼ぶ
+ */
+static vga_console_t* vga_console_locked(uint32_t console) {
+    vga_console_t* con = &vga_consoles[console];
+    if (!con->ready) {
+        for (uint32_t line = 0; line < VGA_TEXT_ROWS; line++) {
+            for (uint32_t column = 0; column < VGA_WIDTH; column++) {
+                vga_cells[console][line][column] = VGA_WHITE_ON_BLACK;
+            }
+            if (console == vga_active) {
+                for (uint32_t word = 0; word < VGA_DIRTY_WORDS; word++) {
+                    vga_dirty[line][word] = vga_row_mask(word);
+                }
+                vga_mark_row(line);
+            }
+        }
+        con->col = VGA_COLOR_WHITE;
+        con->ready = true;
+    }
+    return con;
+}
+
+/*
+ * 呼び出したスレッドのコンソール（スレッドの実行前は VGA_CONSOLE_MAIN）
+ */
+static uint32_t vga_current_console(void) {
+    thread_t* self = get_current_thread();
+    return self ? self->console : VGA_CONSOLE_MAIN;
+}
+
+/*
+ * 1セルの書き込み（row はコンソールの画面の行）
+ * 【前提】vga_lock を保持し、vga_console_locked() でコンソールを取得してから呼ぶ
+ * 【最適化】内容が変わらなければ変更ビットを立てない（転送されない）。
+ * 裏のコンソールは RAM に書くだけで、変更ビットも立てない
+ */
+static inline void vga_cell_put(uint32_t console, uint32_t row,
+                                uint32_t column, uint16_t value) {
+    uint32_t line = vga_consoles[console].origin + row;
+    vga_stats.cells_written++;
+    if (vga_cells[console][line][column] == value) {
+        return;
+    }
+    vga_cells[console][line][column] = value;
+    vga_stats.cells_changed++;
+    if (console != vga_active) {
+        vga_stats.background_cells++;
+        return;
+    }
+    vga_dirty[line][column / 32] |= 1u << (column % 32);
+    vga_mark_row(line);
+}
+
+/*
+ * テキストメモリの先頭へ移す
+ * 【役割】直前の VGA_SCROLLBACK_KEEP_ROWS 行と画面をコンソールの先頭へ写す。
+ * 表示中なら残す行の全セルを転送待ちにする。それより古い履歴は捨てる
+ * 【前提】vga_lock を保持して呼ぶ
+ */
+static void vga_rebase_locked(uint32_t console) {
+    vga_console_t* con = &vga_consoles[console];
+    uint32_t keep = VGA_SCROLLBACK_KEEP_ROWS + VGA_HEIGHT;
+    uint32_t from = con->origin + VGA_HEIGHT - keep;
+    for (uint32_t line = 0; line < keep; line++) {
+        for (uint32_t column = 0; column < VGA_WIDTH; column++) {
+            vga_cells[console][line][column] =
+                vga_cells[console][from + line][column];
+        }
+    }
+    if (console == vga_active) {
+        // 残す行は全セル、それ以外（画面にも履歴にも出ない）は転送しない
+        for (uint32_t line = 0; line < VGA_TEXT_ROWS; line++) {
+            for (uint32_t word = 0; word < VGA_DIRTY_WORDS; word++) {
+                vga_dirty[line][word] = line < keep ? vga_row_mask(word) : 0;
+            }
+        }
+        for (uint32_t word = 0; word < VGA_DIRTY_ROW_WORDS; word++) {
+            vga_dirty_rows[word] = 0;
+        }
+        for (uint32_t line = 0; line < keep; line++) {
+            vga_mark_row(line);
+        }
+    }
+    con->origin = VGA_SCROLLBACK_KEEP_ROWS;
+    if (con->view_back > con->origin) {
+        con->view_back = con->origin;
+    }
+    vga_stats.rebases++;
+}
+
+/*
+ * 1行スクロール
+ * 【役割】origin を1行進め、新しい最下行を消す。画面の内容は動かさない
+ * （表示はコンポジタが CRTC のスタートアドレスを書き換えて切り替える）
+ * 【前提】vga_lock を保持して呼ぶ
+ */
+static void vga_scroll_locked(uint32_t console) {
+    vga_console_t* con = &vga_consoles[console];
+    if (con->origin + VGA_HEIGHT >= VGA_TEXT_ROWS) {
+        vga_rebase_locked(console);
+    }
+    con->origin++;
+    for (uint32_t column = 0; column < VGA_WIDTH; column++) {
+        vga_cell_put(console, VGA_HEIGHT - 1, column, ve(' ', con->col));
+    }
+    vga_stats.scrolls++;
+}
+
+/*
+ * 書き込みの終わり
+ * 【役割】ロックを外し、コンポジタの開始前ならその場で転送する
+ */
+static void vga_unlock(uint32_t flags) {
+    spin_unlock_irqrestore(&vga_lock, flags);
+    if (!vga_compositor_running) {
+        vga_flush();
+    }
+}
+
+/*
+ * 表示するコンソールの切り替え
+ * 【役割】切り替え先と切り替え前の内容を比べ、違うセルだけを転送待ちにする。
+ * VGA メモリには切り替え前の内容（と転送待ちの変更）が入っているため、
+ * 同じ文字のセル（空白など）は書き直さない
+ * 【戻り値】console が範囲外なら OS_ERROR_INVALID_PARAMETER
+ * 【備考】キーボードのボトムハーフ（Alt+F1〜F4）から呼ばれる
+ */
+os_result_t vga_console_switch(uint32_t console) {
+    if (console >= VGA_CONSOLES) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_console_locked(vga_active);
+    vga_console_locked(console);
+    if (console != vga_active) {
+        uint16_t(*from)[VGA_WIDTH] = vga_cells[vga_active];
+        uint16_t(*to)[VGA_WIDTH] = vga_cells[console];
+        for (uint32_t line = 0; line < VGA_TEXT_ROWS; line++) {
+            bool changed = false;
+            for (uint32_t column = 0; column < VGA_WIDTH; column++) {
+                if (to[line][column] != from[line][column]) {
+                    vga_dirty[line][column / 32] |= 1u << (column % 32);
+                    changed = true;
+                }
+            }
+            if (changed) {
+                vga_mark_row(line);
+            }
+        }
+        vga_active = console;
+        vga_stats.switches++;
+    }
+    vga_unlock(flags);
+    return OS_SUCCESS;
+}
+
+/*
+ * スレッドの出力先コンソールの設定
+ * 【役割】以降そのスレッドの print_at()・vga_putc() などは console に書かれる
+ */
+os_result_t vga_console_bind(thread_t* thread, uint32_t console) {
+    if (!thread) {
+        return OS_ERROR_NULL_POINTER;
+    }
+    if (console >= VGA_CONSOLES) {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+    thread->console = (uint8_t)console;
+    return OS_SUCCESS;
+}
+
+uint32_t vga_console_active(void) {
+    return vga_active;
+}
+
+/*
+ * =================================================================================
+ * 転送（コンポジタ）
+ * =================================================================================
+ */
+
+/*
+ * 1行の転送
+ * 【役割】変更ビットの立っているセルだけを VGA メモリに書く
+ * 【戻り値】書いたセル数
+ */
+static uint32_t vga_flush_row(uint32_t row, const uint16_t* line,
+                              const uint32_t* dirty) {
+    volatile uint16_t* dst = vga_memory + row * VGA_WIDTH;
+    uint32_t cells = 0;
+    for (uint32_t word = 0; word < VGA_DIRTY_WORDS; word++) {
+        uint32_t bits = dirty[word];
+        while (bits) {
+            uint32_t column = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            dst[column] = line[column];
+            cells++;
+        }
+    }
+    return cells;
+}
+
+/*
+ * カーソル位置（表示中のコンソール。テキストメモリの先頭からのセル数）
+ * 【前提】vga_lock を保持して呼ぶ
+ */
+static uint16_t vga_cursor_locked(void) {
+    const vga_console_t* con = &vga_consoles[vga_active];
+    uint32_t y = con->cy < VGA_HEIGHT ? con->cy : VGA_HEIGHT - 1;
+    return (uint16_t)((con->origin + y) * VGA_WIDTH + con->cx);
+}
+
+/*
+ * カーソルの更新
+ * 【役割】最後に書いた位置から変わったバイトだけを CRTC に書く
+ * （同じ行の中の移動なら下位バイトの2回だけ）
+ * 【最適化】vga_putc() ごとではなく転送のたびに1回だけ呼ぶため、
+ * 1行書いてもポート I/O は最大4回
+ */
+static void vga_update_cursor(uint16_t pos) {
+    if (!vga_crtc_cursor_valid || (pos >> 8) != (vga_crtc_cursor >> 8)) {
+        outb(VGA_CRTC_INDEX, VGA_CRTC_CURSOR_HIGH);
+        outb(VGA_CRTC_DATA, pos >> 8);
+        vga_stats.cursor_port_writes += 2;
+    }
+    if (!vga_crtc_cursor_valid || (pos & 0xFF) != (vga_crtc_cursor & 0xFF)) {
+        outb(VGA_CRTC_INDEX, VGA_CRTC_CURSOR_LOW);
+        outb(VGA_CRTC_DATA, pos & 0xFF);
+        vga_stats.cursor_port_writes += 2;
+    }
+    vga_crtc_cursor = pos;
+    vga_crtc_cursor_valid = true;
+}
+
+/*
+ * 表示開始アドレスの更新
+ * 【役割】最新の画面、またはスクロールバックで遡った位置を CRTC に書く
+ * （変わった時だけ。1回のスクロールのコストはこのレジスタ書き込み4回）
+ */
+static void vga_update_start(uint16_t start) {
+    if (start != vga_crtc_start) {
+        outb(VGA_CRTC_INDEX, VGA_CRTC_START_HIGH);
+        outb(VGA_CRTC_DATA, start >> 8);
+        outb(VGA_CRTC_INDEX, VGA_CRTC_START_LOW);
+        outb(VGA_CRTC_DATA, start & 0xFF);
+        vga_crtc_start = start;
+    }
+}
+
+/*
+ * 変更のあったセルの転送
+ * 【役割】変更のある行ごとに、ロックの中で表示中のコンソールの行と変更ビットを
+ * 写し取り、ロックの外で VGA メモリに書く（遅い MMIO の間も他CPUは書き込みを
+ * 続けられる）。最後に表示開始アドレスとカーソルを合わせる
+ * （新しい行を書いてから表示を切り替える）
+ * 【備考】転送は1か所ずつ。他の転送中に呼ばれたら何もしない
+ * （残った変更は次の周期で転送される）。転送の途中でコンソールが切り替わった
+ * 場合、表示開始アドレスとカーソルは次の転送で切り替え先に合う
+ */
+void vga_flush(void) {
+    if (atomic_xchg(&vga_flushing, 1)) {
+        return;
+    }
+    if (vga_text_suspended) {
+        vga_flushing = 0;  // 変更は resume 時にまとめて描き直す
+        return;
+    }
+
+    // 表示する位置は転送の前に決める。この時点で転送待ちの行は下のループで
+    // 必ず書かれるため、切り替えた直後の画面に古い行が出ない
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    const vga_console_t* con = &vga_consoles[vga_active];
+    uint16_t view = (uint16_t)((con->origin - con->view_back) * VGA_WIDTH);
+    uint16_t cursor = vga_cursor_locked();
+    spin_unlock_irqrestore(&vga_lock, flags);
+
+    uint64_t start = rdtsc();
+    uint32_t cells = 0;
+    for (uint32_t word = 0; word < VGA_DIRTY_ROW_WORDS; word++) {
+        uint32_t rows = vga_dirty_rows[word];
+        while (rows) {
+            uint32_t row = word * 32 + __builtin_ctz(rows);
+            rows &= rows - 1;
+
+            uint16_t line[VGA_WIDTH];
+            uint32_t dirty[VGA_DIRTY_WORDS];
+            flags = spin_lock_irqsave(&vga_lock);
+            vga_dirty_rows[word] &= ~(1u << (row % 32));
+            for (uint32_t i = 0; i < VGA_DIRTY_WORDS; i++) {
+                dirty[i] = vga_dirty[row][i];
+                vga_dirty[row][i] = 0;
+            }
+            for (uint32_t column = 0; column < VGA_WIDTH; column++) {
+                line[column] = vga_cells[vga_active][row][column];
+            }
+            spin_unlock_irqrestore(&vga_lock, flags);
+
+            cells += vga_flush_row(row, line, dirty);
+        }
+    }
+    vga_update_start(view);
+    vga_update_cursor(cursor);
+
+    if (cells) {
+        uint32_t cycles = (uint32_t)(rdtsc() - start);
+        vga_stats.flushes++;
+        vga_stats.cells_flushed += cells;
+        if (cycles > vga_stats.flush_max_cycles) {
+            vga_stats.flush_max_cycles = cycles;
+        }
+    }
+    vga_flushing = 0;
+}
+
+static void vga_compositor_job(void) {
+    vga_flush();
+}
+
+/*
+ * コンポジタの開始
+ * 【役割】VGA_REFRESH_HZ の周期タスクを作り、以降の転送をそこにまとめる
+ */
+os_result_t vga_compositor_start(void) {
+    os_result_t result = periodic_task_create(
+        VGA_REFRESH_PERIOD_NS, vga_compositor_job, 0, &vga_compositor);
+    if (OS_SUCCESS_CHECK(result)) {
+        vga_compositor_running = true;
+    }
+    return result;
+}
+
+/*
+ * =================================================================================
+ * テキストモードの一時停止（グラフィックスモードの間）
+ * =================================================================================
+ * VBE の DISPI を有効にすると、シーケンサ・CRTC・グラフィックスコントローラの
+ * 一部がグラフィックス用に書き換えられ、無効にしても元に戻らない。また
+ * フレームバッファへの描画で VGA メモリ（文字・属性・フォントのプレーン）が
+ * 上書きされる。そこで切り替え前にレジスタとフォントを保存し、戻す時に
+ * 書き戻してから表示中のコンソールを全て転送し直す
+ */
+
+typedef struct {
+    uint8_t seq[VGA_SEQ_REGS];
+    uint8_t crtc[VGA_CRTC_REGS];
+    uint8_t gc[VGA_GC_REGS];
+} vga_regs_t;
+
+static vga_regs_t vga_saved_regs;
+static uint8_t vga_saved_font[VGA_FONT_GLYPHS][VGA_FONT_HEIGHT];
+
+static uint8_t vga_reg_read(uint16_t index_port, uint8_t index) {
+    outb(index_port, index);
+    return inb(index_port + 1);
+}
+
+static void vga_reg_write(uint16_t index_port, uint8_t index, uint8_t value) {
+    outb(index_port, index);
+    outb(index_port + 1, value);
+}
+
+static void vga_regs_save(vga_regs_t* regs) {
+    for (uint8_t i = 0; i < VGA_SEQ_REGS; i++) {
+        regs->seq[i] = vga_reg_read(VGA_SEQ_INDEX, i);
+    }
+    for (uint8_t i = 0; i < VGA_CRTC_REGS; i++) {
+        regs->crtc[i] = vga_reg_read(VGA_CRTC_INDEX, i);
+    }
+    for (uint8_t i = 0; i < VGA_GC_REGS; i++) {
+        regs->gc[i] = vga_reg_read(VGA_GC_INDEX, i);
+    }
+}
+
+/*
+ * レジスタの書き戻し
+ * 【備考】CRTC の 0x00〜0x07 は 0x11 の bit7 で保護されているため、
+ * 保護を外して書いてから 0x11 を最後に戻す（シーケンサの 0 はリセット
+ * レジスタのため書かない）
+ */
+static void vga_regs_restore(const vga_regs_t* regs) {
+    for (uint8_t i = 1; i < VGA_SEQ_REGS; i++) {
+        vga_reg_write(VGA_SEQ_INDEX, i, regs->seq[i]);
+    }
+    vga_reg_write(VGA_CRTC_INDEX, VGA_CRTC_VSYNC_END,
+                  regs->crtc[VGA_CRTC_VSYNC_END] & ~VGA_CRTC_PROTECT);
+    for (uint8_t i = 0; i < VGA_CRTC_REGS; i++) {
+        if (i != VGA_CRTC_VSYNC_END) {
+            vga_reg_write(VGA_CRTC_INDEX, i, regs->crtc[i]);
+        }
+    }
+    vga_reg_write(VGA_CRTC_INDEX, VGA_CRTC_VSYNC_END,
+                  regs->crtc[VGA_CRTC_VSYNC_END]);
+    for (uint8_t i = 0; i < VGA_GC_REGS; i++) {
+        vga_reg_write(VGA_GC_INDEX, i, regs->gc[i]);
+    }
+}
+
+/*
+ * フォントのプレーン（2）を 0xA0000 から直接読み書きできるようにする
+ * （奇数・偶数アドレスの振り分けをやめ、プレーン2 だけを選ぶ）。
+ * 終わったら vga_regs_restore() で元に戻す
+ */
+static void vga_font_plane_open(void) {
+    vga_reg_write(VGA_SEQ_INDEX, VGA_SEQ_MAP_MASK, 0x04);
+    vga_reg_write(VGA_SEQ_INDEX, VGA_SEQ_MEMORY_MODE, 0x06);
+    vga_reg_write(VGA_GC_INDEX, VGA_GC_READ_MAP, 0x02);
+    vga_reg_write(VGA_GC_INDEX, VGA_GC_MODE, 0x00);
+    vga_reg_write(VGA_GC_INDEX, VGA_GC_MISC, 0x04);  // 0xA0000〜0xAFFFF
+}
+
+/*
+ * 転送の権利を取る（コンポジタの転送が終わるまで譲って待つ）
+ * 【前提】スレッドから呼ぶ
+ */
+static void vga_flush_acquire(void) {
+    while (atomic_xchg(&vga_flushing, 1)) {
+        thread_yield();
+    }
+}
+
+/*
+ * テキストモードの一時停止
+ * 【役割】転送を止め、レジスタを保存し、フォント（8x16）を font に写す
+ * 【備考】停止中も画面出力の API は使える（コンソールの RAM に書かれる）
+ */
+void vga_text_suspend(uint8_t font[VGA_FONT_GLYPHS][VGA_FONT_HEIGHT]) {
+    vga_flush_acquire();
+    vga_text_suspended = true;
+
+    uint32_t flags = irq_save();
+    vga_regs_save(&vga_saved_regs);
+    vga_font_plane_open();
+    const volatile uint8_t* plane = (const volatile uint8_t*)VGA_FONT_PLANE_WINDOW;
+    for (uint32_t glyph = 0; glyph < VGA_FONT_GLYPHS; glyph++) {
+        for (uint32_t y = 0; y < VGA_FONT_HEIGHT; y++) {
+            vga_saved_font[glyph][y] = plane[glyph * VGA_FONT_STRIDE + y];
+            font[glyph][y] = vga_saved_font[glyph][y];
+        }
+    }
+    vga_regs_restore(&vga_saved_regs);
+    irq_restore(flags);
+
+    vga_flushing = 0;
+}
+
+/*
+ * テキストモードへの復帰
+ * 【役割】レジスタとフォントを書き戻し、表示中のコンソールの全行を転送待ちにする。
+ * CRTC の表示開始アドレス・カーソルは保存した値に戻るため、転送側の記録も合わせる
+ * 【前提】DISPI を無効にしてから呼ぶ
+ */
+void vga_text_resume(void) {
+    vga_flush_acquire();
+
+    uint32_t flags = irq_save();
+    vga_font_plane_open();
+    volatile uint8_t* plane = (volatile uint8_t*)VGA_FONT_PLANE_WINDOW;
+    for (uint32_t glyph = 0; glyph < VGA_FONT_GLYPHS; glyph++) {
+        for (uint32_t y = 0; y < VGA_FONT_STRIDE; y++) {
+            plane[glyph * VGA_FONT_STRIDE + y] =
+                y < VGA_FONT_HEIGHT ? vga_saved_font[glyph][y] : 0;
+        }
+    }
+    vga_regs_restore(&vga_saved_regs);
+    irq_restore(flags);
+
+    flags = spin_lock_irqsave(&vga_lock);
+    for (uint32_t line = 0; line < VGA_TEXT_ROWS; line++) {
+        for (uint32_t word = 0; word < VGA_DIRTY_WORDS; word++) {
+            vga_dirty[line][word] = vga_row_mask(word);
+        }
+        vga_mark_row(line);
+    }
+    vga_crtc_start = (uint16_t)((vga_saved_regs.crtc[VGA_CRTC_START_HIGH] << 8) |
+                                vga_saved_regs.crtc[VGA_CRTC_START_LOW]);
+    vga_crtc_cursor =
+        (uint16_t)((vga_saved_regs.crtc[VGA_CRTC_CURSOR_HIGH] << 8) |
+                   vga_saved_regs.crtc[VGA_CRTC_CURSOR_LOW]);
+    vga_text_suspended = false;
+    spin_unlock_irqrestore(&vga_lock, flags);
+
+    vga_flushing = 0;
+    vga_flush();
+}
+
+/*
+ * =================================================================================
+ * ベンチマーク
+ * =================================================================================
+ * 最下行に VGA_BENCH_LINES 行 × VGA_BENCH_LINE_CHARS 文字を書き、文字数/秒と
+ * カーソルのポート書き込み回数を比べる（最後の vga_flush() までを計測に含める）
+ * - immediate: 1文字ごとに vga_putc() の後でカーソルを CRTC へ書く（以前の方式）
+ * - deferred : vga_puts() で1行まとめて書き、カーソルは転送時に反映する
+ * 【備考】行の先頭へカーソルを戻して書くため、スクロールは起きない。
+ * 計測中は表示中のコンソールに書く（裏のコンソールの出力は MMIO に届かない）
+ */
+static void vga_cursor_write(uint16_t pos) {
+    outb(VGA_CRTC_INDEX, VGA_CRTC_CURSOR_HIGH);
+    outb(VGA_CRTC_DATA, pos >> 8);
+    outb(VGA_CRTC_INDEX, VGA_CRTC_CURSOR_LOW);
+    outb(VGA_CRTC_DATA, pos & 0xFF);
+    vga_stats.cursor_port_writes += 4;
+}
+
+static void vga_benchmark_report(const char* mode, uint32_t chars, uint64_t ns,
+                                 uint32_t port_writes) {
+    debug_print("VGA BENCH: %s, %u chars in %u us, %u chars/s, "
+                "cursor port writes %u",
+                mode, chars, (uint32_t)(ns / NSEC_PER_USEC),
+                ns ? (uint32_t)((uint64_t)chars * NSEC_PER_SEC / ns) : 0,
+                port_writes);
+}
+
+void vga_benchmark_puts(void) {
+    const uint16_t row = VGA_HEIGHT - 1;
+    const uint32_t chars = VGA_BENCH_LINES * VGA_BENCH_LINE_CHARS;
+    char line[VGA_BENCH_LINE_CHARS + 1];
+
+    thread_t* self = get_current_thread();
+    uint8_t saved_console = self->console;
+    uint32_t console = vga_active;
+    vga_console_bind(self, console);
+
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_console_t* con = vga_console_locked(console);
+    uint16_t saved_x = con->cx;
+    uint16_t saved_y = con->cy;
+    spin_unlock_irqrestore(&vga_lock, flags);
+
+    // immediate（1文字ごとにカーソルを書く）
+    for (int i = 0; i < VGA_BENCH_LINE_CHARS; i++) {
+        line[i] = (char)('a' + i % 26);
+    }
+    line[VGA_BENCH_LINE_CHARS] = 0;
+    vga_stats_t before;
+    vga_get_stats(&before);
+    uint64_t start = rdtsc();
+    for (int n = 0; n < VGA_BENCH_LINES; n++) {
+        vga_move_cursor(0, row);
+        for (int i = 0; i < VGA_BENCH_LINE_CHARS; i++) {
+            vga_putc(line[i]);
+            vga_cursor_write((uint16_t)((con->origin + row) * VGA_WIDTH + i + 1));
+        }
+    }
+    vga_crtc_cursor_valid = false;  // 次の転送で CRTC のカーソルを書き直す
+    vga_flush();
+    uint64_t ns = clock_cycles_to_ns(rdtsc() - start);
+    vga_stats_t after;
+    vga_get_stats(&after);
+    vga_benchmark_report("immediate", chars, ns,
+                         after.cursor_port_writes - before.cursor_port_writes);
+
+    // deferred（1行ずつ vga_puts、カーソルは転送時）
+    for (int i = 0; i < VGA_BENCH_LINE_CHARS; i++) {
+        line[i] = (char)('A' + i % 26);
+    }
+    vga_get_stats(&before);
+    start = rdtsc();
+    for (int n = 0; n < VGA_BENCH_LINES; n++) {
+        vga_move_cursor(0, row);
+        vga_puts(line);
+    }
+    vga_flush();
+    ns = clock_cycles_to_ns(rdtsc() - start);
+    vga_get_stats(&after);
+    vga_benchmark_report("deferred", chars, ns,
+                         after.cursor_port_writes - before.cursor_port_writes);
+
+    clear_line(row);
+    vga_move_cursor(saved_x, saved_y);
+    vga_console_bind(self, saved_console);
+}
+
+/*
+ * スクロールバック（表示中のコンソール）
+ * 【役割】表示位置を rows 行だけ過去（負なら最新の方）へ動かす。
+ * 遡れるのは origin より上に残っている行まで
+ * 【備考】書き込み先（画面の行0〜24）は変わらない。表示は次の転送で切り替わる
+ */
+void vga_scroll_view(int rows) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_console_t* con = &vga_consoles[vga_active];
+    int back = (int)con->view_back + rows;
+    if (back < 0) {
+        back = 0;
+    } else if (back > (int)con->origin) {
+        back = (int)con->origin;
+    }
+    con->view_back = (uint32_t)back;
+    vga_unlock(flags);
+}
+
+void vga_scroll_view_reset(void) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_consoles[vga_active].view_back = 0;
+    vga_unlock(flags);
+}
+
+/*
+ * 統計
+ */
+void vga_get_stats(vga_stats_t* out) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    *out = vga_stats;
+    spin_unlock_irqrestore(&vga_lock, flags);
+}
+
+void vga_print_stats(void) {
+    vga_stats_t stats;
+    vga_get_stats(&stats);
+    debug_print("VGA: 書き込み %u セル（変更 %u）, 転送 %u セル / %u 回",
+                stats.cells_written, stats.cells_changed, stats.cells_flushed,
+                stats.flushes);
+    debug_print("VGA: 転送 1回の最大 %u サイクル, 更新 %u Hz%s",
+                stats.flush_max_cycles, VGA_REFRESH_HZ,
+                vga_compositor_running ? "" : "（コンポジタ停止中）");
+    debug_print("VGA: スクロール %u 行, 先頭へ移した回数 %u, 履歴 %u 行",
+                stats.scrolls, stats.rebases, vga_consoles[vga_active].origin);
+    debug_print("VGA: カーソルのポート書き込み %u 回", stats.cursor_port_writes);
+    debug_print("VGA: コンソール %u/%u を表示中, 切り替え %u 回, "
+                "裏のコンソールだけに書いたセル %u",
+                vga_active + 1, VGA_CONSOLES, stats.switches,
+                stats.background_cells);
+}
+
+/*
+ * =================================================================================
+ * 画面出力の API（kernel.h）
+ * =================================================================================
+ * 呼び出したスレッドのコンソール（thread_t の console）に書く
+ */
+
+// ━━━ VGA テキストモード表示管理（Day12互換） ━━━
+
+// VGA文字色設定：前景色と背景色を指定
+void vga_set_color(vga_color_t f, vga_color_t b) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_console_locked(vga_current_console())->col =
+        (uint8_t)f | ((uint8_t)b << 4);
+    spin_unlock_irqrestore(&vga_lock, flags);
+}
+
+// VGAカーソル移動：画面上の指定位置にカーソルを移動（CRTC へは次の転送で反映）
+void vga_move_cursor(uint16_t x, uint16_t y) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_console_t* con = vga_console_locked(vga_current_console());
+    con->cx = x < VGA_WIDTH ? x : VGA_WIDTH - 1;
+    con->cy = y;
+    vga_unlock(flags);
+}
+
+// VGA画面クリア：全画面を空白文字で埋めカーソルを左上に
+void vga_clear(void) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_t* con = vga_console_locked(console);
+    for (uint16_t y = 0; y < VGA_HEIGHT; y++)
+        for (uint16_t x = 0; x < VGA_WIDTH; x++)
+            vga_cell_put(console, y, x, ve(' ', con->col));
+    con->cx = 0;
+    con->cy = 0;
+    vga_unlock(flags);
+}
+
+// 次の行へ（最下行ならスクロール）
+static void vga_newline_locked(uint32_t console) {
+    vga_console_t* con = &vga_consoles[console];
+    con->cx = 0;
+    if (++con->cy >= VGA_HEIGHT) {
+        vga_scroll_locked(console);
+        con->cy = VGA_HEIGHT - 1;
+    }
+}
+
+// 1文字の書き込み（vga_lock を保持し、コンソールを取得してから呼ぶ）
+static void vga_putc_locked(uint32_t console, char c) {
+    vga_console_t* con = &vga_consoles[console];
+    if (c == '\n') {
+        // 改行文字の場合、次の行の先頭に移動
+        vga_newline_locked(console);
+        return;
+    }
+    // vga_move_cursor() で画面外を指定された場合は最下行に書く
+    if (con->cy >= VGA_HEIGHT) {
+        con->cy = VGA_HEIGHT - 1;
+    }
+    // 指定位置に文字を書き込み
+    vga_cell_put(console, con->cy, con->cx, ve(c, con->col));
+    // カーソルを次の位置に進める（行末で改行）
+    if (++con->cx >= VGA_WIDTH) {
+        vga_newline_locked(console);
+    }
+}
+
+// VGA文字出力：1文字を現在のカーソル位置に表示
+void vga_putc(char c) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_locked(console);
+    vga_putc_locked(console, c);
+    vga_unlock(flags);
+}
+
+// VGA文字列出力：NULL終端文字列を1回のロックでまとめて表示
+void vga_puts(const char* s) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_locked(console);
+    while (*s) vga_putc_locked(console, *s++);
+    vga_unlock(flags);
+}
+
+// VGA数値出力：32bit整数を十進数文字列で表示
+void vga_putnum(uint32_t n) {
+    int i = 0;
+    if (n == 0) {
+        vga_putc('0');
+        return;
+    }
+    uint32_t x = n;
+    char r[10];  // 数字文字一時格納用配列
+    // 下位桁から分離して配列に格納
+    while (x) {
+        r[i++] = '0' + (x % 10);
+        x /= 10;
+    }
+    // 逆順で出力（上位桁から）
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_locked(console);
+    while (i--) vga_putc_locked(console, r[i]);
+    vga_unlock(flags);
+}
+
+/*
+ * ログの1行（debug_print から）
+ * 【役割】VGA_CONSOLE_LOG の末尾に1行追加する。表示していない間は RAM に
+ * 書くだけで、Alt+F3 で切り替えるとスクロールバックも含めて見られる
+ */
+void vga_console_log(const char* line) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    vga_console_locked(VGA_CONSOLE_LOG);
+    while (*line) vga_putc_locked(VGA_CONSOLE_LOG, *line++);
+    vga_putc_locked(VGA_CONSOLE_LOG, '\n');
+    vga_unlock(flags);
+}
+
+// VGA初期化：白文字・黒背景で画面クリア
+void vga_init(void) {
+    vga_set_color(15, 0);  // VGA_WHITE, VGA_BLACK
+    vga_clear();
+}
+
+/*
+ * 画面クリア関数
+ * 【役割】VGAテキストモードの画面を黒背景・白文字のスペースで埋める
+ */
+void clear_screen(void) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_locked(console);
+    for (uint32_t row = 0; row < VGA_HEIGHT; row++) {
+        for (uint32_t column = 0; column < VGA_WIDTH; column++) {
+            vga_cell_put(console, row, column, VGA_WHITE_ON_BLACK);
+        }
+    }
+    vga_unlock(flags);
+}
+
+/*
+ * 指定行クリア関数
+ * 【役割】指定された行をスペースで埋めてクリアする
+ */
+void clear_line(int row) {
+    if (row < 0 || row >= VGA_HEIGHT)
+        return;
+
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_locked(console);
+    for (int col = 0; col < VGA_WIDTH; col++) {
+        vga_cell_put(console, row, col, VGA_WHITE_ON_BLACK);
+    }
+    vga_unlock(flags);
+}
+
+/*
+ * 指定位置への文字列表示関数
+ * 【役割】指定された行・列に指定色で文字列を表示する
+ * 【備考】文字列全体を1回のロックで書くため、途中まで書かれた状態は転送されない
+ */
+void print_at(int row, int col, const char* str, uint8_t color) {
+    if (row < 0 || row >= VGA_HEIGHT || col < 0 || col >= VGA_WIDTH) {
+        return;  // 範囲外は無視
+    }
+
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
+    uint32_t console = vga_current_console();
+    vga_console_locked(console);
+    while (*str && col < VGA_WIDTH) {
+        vga_cell_put(console, row, col, ve(*str++, color));
+        col++;
+    }
+    vga_unlock(flags);
+}
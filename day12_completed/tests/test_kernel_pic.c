@@ -6,6 +6,8 @@
 // Constants from kernel.h
 #define PIC_MASTER_COMMAND 0x20
 #define PIC_MASTER_DATA 0x21
+#define PIC_SLAVE_COMMAND 0xA0
+#define PIC_SLAVE_DATA 0xA1
 
 // Simple debug function for tests
 void debug_print(const char* message) {
@@ -31,7 +33,7 @@ void print_at(int row, int col, const char* str, uint8_t color) {
 void remap_pic(void) {
     debug_print("PIC: Starting PIC remapping");
 
-    // PICを再マップ（IRQ0-7を割り込み32-39に移動）
+    // PICを再マップ（IRQ0-7を割り込み32-39、IRQ8-15を割り込み40-47に移動）
     // 【重要】デフォルトではIRQ0-7は割り込み8-15にマップされ、CPU例外と衝突する
 
     // マスター PIC 初期化
@@ -40,7 +42,13 @@ void remap_pic(void) {
     outb(PIC_MASTER_DATA, 0x04);     // スレーブPICはIRQ2に接続 (ICW3)
     outb(PIC_MASTER_DATA, 0x01);     // 8086モード (ICW4)
 
-    debug_print("PIC: Master PIC remapped to interrupts 32-39");
+    // スレーブ PIC 初期化
+    outb(PIC_SLAVE_COMMAND, 0x11);  // 初期化コマンド (ICW1)
+    outb(PIC_SLAVE_DATA, 0x28);     // 割り込みベクター0x28(40)から開始 (ICW2)
+    outb(PIC_SLAVE_DATA, 0x02);     // カスケードID=2 (ICW3)
+    outb(PIC_SLAVE_DATA, 0x01);     // 8086モード (ICW4)
+
+    debug_print("PIC: Master/slave PIC remapped to interrupts 32-47");
 }
 
 /*
@@ -52,6 +60,7 @@ void configure_interrupt_masks(void) {
 
     // 全割り込みをマスク（無効化）
     outb(PIC_MASTER_DATA, 0xFF);  // 全割り込み無効化
+    outb(PIC_SLAVE_DATA, 0xFF);
 
     debug_print("PIC: All interrupts masked");
 }
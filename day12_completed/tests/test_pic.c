@@ -63,6 +63,16 @@ void test_remap_pic(void) {
     // the sequence
     TEST_ASSERT(mock_get_outb_call_count(0x21) == 3,
                 "PIC master data configured with 3 writes");
+
+    // Verify PIC slave initialization sequence (IRQ8-15 -> INT40-47)
+    TEST_ASSERT_EQ(1, mock_get_outb_call_count(0xA0),
+                   "PIC slave command port called once");
+    TEST_ASSERT_EQ(0x11, mock_get_last_outb_value(0xA0),
+                   "PIC slave command value correct");
+    TEST_ASSERT_EQ(3, mock_get_outb_call_count(0xA1),
+                   "PIC slave data port called 3 times");
+    TEST_ASSERT_EQ(0x01, mock_get_last_outb_value(0xA1),
+                   "PIC slave ends with 8086 mode (ICW4)");
 }
 
 // Test interrupt mask configuration
@@ -76,6 +86,8 @@ void test_configure_interrupt_masks(void) {
                    "Interrupt mask register written once");
     TEST_ASSERT_EQ(0xFF, mock_get_last_outb_value(0x21),
                    "All interrupts masked (0xFF)");
+    TEST_ASSERT_EQ(0xFF, mock_get_last_outb_value(0xA1),
+                   "All slave interrupts masked (0xFF)");
 }
 
 // Test timer interrupt enablement
@@ -0,0 +1,414 @@
+/*
+ * バイナリトレースのデコーダ（ホスト側のツール）
+ * 【役割】カーネルのシリアル出力（binlog on の後）を読み、フレームを解読して
+ * テキスト、または CSV（-c）で表示する
+ * 【使い方】
+ *   make trace-decode
+ *   make run-nogui | tools/trace_decode
+ *   tools/trace_decode -c serial.log > trace.csv
+ * 【備考】フレームの外のバイト（シェルのプロンプト・エコー・binlog on 以前の
+ * テキスト出力）はテキスト表示ではそのまま出し、CSV では捨てる。
+ * ホストはリトルエンディアンを前提とする（x86・ARM のどちらでもよい）
+ */
+
+#define TRACE_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+typedef struct {
+    uint8_t buffer[TRACE_FRAME_MAX];  // 組み立て中のフレーム
+    size_t length;
+    int csv;             // -c: CSV で出力
+    int has_hello;       // HELLO を受け取った（時刻を秒に換算できる）
+    uint64_t base_tsc;   // HELLO の時刻（0 秒）
+    uint32_t tsc_khz;
+    int has_seq;
+    uint8_t next_seq;    // 次に来るはずの seq
+    uint32_t frames;     // 解読したフレーム数
+    uint32_t bad_sums;   // チェックサムの不一致
+    uint32_t lost;       // seq の抜けから数えた失われたフレーム数
+    uint32_t raw_bytes;  // フレームの外のバイト数
+} decoder_t;
+
+static const char* const metric_names[] = {
+    "total_interrupts", "context_switches", "threads_created",
+    "memory_usage_bytes", "system_uptime_ticks", "keyboard_inputs",
+    "serial_writes", "timer_interrupts", "scheduler_calls",
+};
+
+static const char* const thread_field_names[] = {
+    "thread_id", "state", "stack_usage", "execution_time",
+    "sleep_count", "context_switch_count", "priority", "cpu_usage_percent",
+};
+
+static const char* record_name(uint8_t type) {
+    switch (type) {
+    case TRACE_REC_HELLO:
+        return "hello";
+    case TRACE_REC_TEXT:
+        return "text";
+    case TRACE_REC_METRICS:
+        return "metrics";
+    case TRACE_REC_THREAD:
+        return "thread";
+    case TRACE_REC_HEXDUMP:
+        return "hexdump";
+    case TRACE_REC_EVENT:
+        return "event";
+    case TRACE_REC_DROPPED:
+        return "dropped";
+    default:
+        return "unknown";
+    }
+}
+
+static const char* event_name(uint16_t id) {
+    switch (id) {
+    case TRACE_EV_SWITCH:
+        return "switch";
+    case TRACE_EV_IRQ:
+        return "irq";
+    default:
+        return "unknown";
+    }
+}
+
+/*
+ * 時刻（HELLO からの秒）
+ * 【備考】HELLO より前のフレームは時刻を換算できないため 0 とする
+ */
+static double frame_time(const decoder_t* d, uint64_t tsc) {
+    if (!d->has_hello || d->tsc_khz == 0) {
+        return 0.0;
+    }
+    return (double)(int64_t)(tsc - d->base_tsc) / ((double)d->tsc_khz * 1000.0);
+}
+
+/*
+ * =================================================================================
+ * 出力
+ * =================================================================================
+ */
+
+static void print_prefix(const decoder_t* d, const trace_header_t* h) {
+    printf("[%12.6f] cpu%u #%-3u %-8s", frame_time(d, h->tsc), h->cpu, h->seq,
+           record_name(h->type));
+}
+
+static void csv_row(const decoder_t* d, const trace_header_t* h,
+                    const char* name, const char* value0,
+                    const char* value1) {
+    printf("%.6f,%u,%u,%s,%s,%s,%s\n", frame_time(d, h->tsc), h->cpu, h->seq,
+           record_name(h->type), name, value0, value1);
+}
+
+static void csv_row_u32(const decoder_t* d, const trace_header_t* h,
+                        const char* name, uint32_t value0, uint32_t value1) {
+    char v0[16];
+    char v1[16];
+    snprintf(v0, sizeof(v0), "%u", value0);
+    snprintf(v1, sizeof(v1), "%u", value1);
+    csv_row(d, h, name, v0, v1);
+}
+
+// TEXT は CSV の name 列に引用符付きで入れる（" は "" にする）
+static void csv_text(const decoder_t* d, const trace_header_t* h,
+                     const uint8_t* text, size_t length) {
+    char quoted[TRACE_PAYLOAD_MAX * 2 + 3];
+    size_t pos = 0;
+    quoted[pos++] = '"';
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '"') {
+            quoted[pos++] = '"';
+        }
+        quoted[pos++] = (char)text[i];
+    }
+    quoted[pos++] = '"';
+    quoted[pos] = 0;
+    csv_row(d, h, quoted, "", "");
+}
+
+static void hex_string(const uint8_t* data, size_t length, char* out) {
+    for (size_t i = 0; i < length; i++) {
+        sprintf(out + i * 2, "%02X", data[i]);
+    }
+    out[length * 2] = 0;
+}
+
+/*
+ * =================================================================================
+ * レコードの解読
+ * =================================================================================
+ */
+
+static void decode_hello(decoder_t* d, const trace_header_t* h,
+                         const uint8_t* payload, size_t length) {
+    trace_hello_t hello = {0};
+    memcpy(&hello, payload,
+           length < sizeof(hello) ? length : sizeof(hello));
+    d->has_hello = 1;
+    d->base_tsc = h->tsc;
+    d->tsc_khz = hello.tsc_khz;
+    if (d->csv) {
+        csv_row_u32(d, h, "tsc_khz", hello.tsc_khz, hello.cpus);
+    } else {
+        print_prefix(d, h);
+        printf(" version=%u cpus=%u tsc=%u kHz\n", hello.version, hello.cpus,
+               hello.tsc_khz);
+    }
+}
+
+static void decode_u32_fields(decoder_t* d, const trace_header_t* h,
+                              const uint8_t* payload, size_t length,
+                              const char* const* names, size_t count,
+                              uint32_t key) {
+    if (!d->csv) {
+        print_prefix(d, h);
+        printf("\n");
+    }
+    for (size_t i = 0; i < count && (i + 1) * 4 <= length; i++) {
+        uint32_t value;
+        memcpy(&value, payload + i * 4, 4);
+        if (d->csv) {
+            csv_row_u32(d, h, names[i], value, key);
+        } else {
+            printf("    %-22s %u\n", names[i], value);
+        }
+    }
+}
+
+static void decode_hexdump(decoder_t* d, const trace_header_t* h,
+                           const uint8_t* payload, size_t length) {
+    if (length < sizeof(trace_hexdump_t)) {
+        return;
+    }
+    trace_hexdump_t dump;
+    memcpy(&dump, payload, sizeof(dump));
+    const uint8_t* data = payload + sizeof(dump);
+    size_t count = length - sizeof(dump);
+
+    if (d->csv) {
+        char address[16];
+        char hex[TRACE_PAYLOAD_MAX * 2 + 1];
+        char size[16];
+        snprintf(address, sizeof(address), "0x%08X", dump.address);
+        hex_string(data, count, hex);
+        snprintf(size, sizeof(size), "%zu", count);
+        csv_row(d, h, address, hex, size);
+        return;
+    }
+    print_prefix(d, h);
+    printf(" 0x%08X (%zu bytes)\n", dump.address, count);
+    for (size_t i = 0; i < count; i += 16) {
+        printf("    %08X ", (unsigned)(dump.address + i));
+        for (size_t j = i; j < i + 16 && j < count; j++) {
+            printf(" %02X", data[j]);
+        }
+        printf("\n");
+    }
+}
+
+static void decode_event(decoder_t* d, const trace_header_t* h,
+                         const uint8_t* payload, size_t length) {
+    trace_event_t event = {0};
+    memcpy(&event, payload,
+           length < sizeof(event) ? length : sizeof(event));
+    if (d->csv) {
+        csv_row_u32(d, h, event_name(event.id), event.arg0, event.arg1);
+        return;
+    }
+    print_prefix(d, h);
+    if (event.id == TRACE_EV_SWITCH) {
+        printf(" switch 0x%08X -> 0x%08X\n", event.arg0, event.arg1);
+    } else if (event.id == TRACE_EV_IRQ && d->tsc_khz) {
+        printf(" irq vector=%u %u cycles (%.2f us)\n", event.arg0, event.arg1,
+               event.arg1 * 1000.0 / d->tsc_khz);
+    } else {
+        printf(" %s %u %u\n", event_name(event.id), event.arg0, event.arg1);
+    }
+}
+
+static void decode_frame(decoder_t* d, const uint8_t* frame) {
+    trace_header_t h;
+    memcpy(&h, frame, sizeof(h));
+    const uint8_t* payload = frame + TRACE_HEADER_SIZE;
+    size_t length = h.length;
+
+    if (d->has_seq && h.seq != d->next_seq) {
+        d->lost += (uint8_t)(h.seq - d->next_seq);
+    }
+    d->has_seq = 1;
+    d->next_seq = (uint8_t)(h.seq + 1);
+    d->frames++;
+
+    switch (h.type) {
+    case TRACE_REC_HELLO:
+        decode_hello(d, &h, payload, length);
+        break;
+    case TRACE_REC_TEXT:
+        if (d->csv) {
+            csv_text(d, &h, payload, length);
+        } else {
+            print_prefix(d, &h);
+            printf(" %.*s\n", (int)length, (const char*)payload);
+        }
+        break;
+    case TRACE_REC_METRICS:
+        decode_u32_fields(d, &h, payload, length, metric_names,
+                          sizeof(metric_names) / sizeof(metric_names[0]), 0);
+        break;
+    case TRACE_REC_THREAD: {
+        uint32_t id = 0;
+        if (length >= 4) {
+            memcpy(&id, payload, 4);
+        }
+        decode_u32_fields(
+            d, &h, payload, length, thread_field_names,
+            sizeof(thread_field_names) / sizeof(thread_field_names[0]), id);
+        break;
+    }
+    case TRACE_REC_HEXDUMP:
+        decode_hexdump(d, &h, payload, length);
+        break;
+    case TRACE_REC_EVENT:
+        decode_event(d, &h, payload, length);
+        break;
+    case TRACE_REC_DROPPED: {
+        uint32_t dropped = 0;
+        memcpy(&dropped, payload, length < 4 ? length : 4);
+        if (d->csv) {
+            csv_row_u32(d, &h, "dropped", dropped, 0);
+        } else {
+            print_prefix(d, &h);
+            printf(" %u events lost (ring full)\n", dropped);
+        }
+        break;
+    }
+    default:
+        if (!d->csv) {
+            print_prefix(d, &h);
+            printf(" type=%u length=%zu\n", h.type, length);
+        }
+        break;
+    }
+}
+
+/*
+ * =================================================================================
+ * フレームの切り出し
+ * =================================================================================
+ */
+
+/*
+ * 先頭の1バイトをフレームの外として扱い、残りを詰める
+ * 【備考】同期バイトの誤検出・チェックサムの不一致では1バイトずつずらして
+ * 次の同期バイトを探す（テキスト中に A5 5A が現れても復帰できる）
+ */
+static void decoder_skip_byte(decoder_t* d) {
+    d->raw_bytes++;
+    if (!d->csv) {
+        putchar(d->buffer[0]);
+    }
+    d->length--;
+    memmove(d->buffer, d->buffer + 1, d->length);
+}
+
+static void decoder_feed(decoder_t* d, uint8_t byte) {
+    d->buffer[d->length++] = byte;
+
+    while (d->length > 0) {
+        if (d->buffer[0] != TRACE_SYNC0) {
+            decoder_skip_byte(d);
+            continue;
+        }
+        if (d->length < 2) {
+            return;
+        }
+        if (d->buffer[1] != TRACE_SYNC1) {
+            decoder_skip_byte(d);
+            continue;
+        }
+        if (d->length < 4) {
+            return;
+        }
+        size_t payload_length = d->buffer[3];
+        if (payload_length > TRACE_PAYLOAD_MAX) {
+            decoder_skip_byte(d);
+            continue;
+        }
+        size_t size = TRACE_HEADER_SIZE + payload_length;
+        if (d->length < size + TRACE_CHECKSUM_SIZE) {
+            return;
+        }
+
+        uint16_t sum = (uint16_t)(d->buffer[size] | (d->buffer[size + 1] << 8));
+        if (trace_checksum(d->buffer + 2, (uint32_t)(size - 2)) != sum) {
+            d->bad_sums++;
+            decoder_skip_byte(d);
+            continue;
+        }
+        decode_frame(d, d->buffer);
+        size += TRACE_CHECKSUM_SIZE;
+        d->length -= size;
+        memmove(d->buffer, d->buffer + size, d->length);
+    }
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [-c] [file]\n", name);
+    fprintf(stderr, "  -c  CSV で出力（time_s,cpu,seq,record,name,value0,value1）\n");
+}
+
+int main(int argc, char** argv) {
+    decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0) {
+            decoder.csv = 1;
+        } else if (argv[i][0] == '-' && argv[i][1]) {
+            usage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE* in = stdin;
+    if (path && strcmp(path, "-") != 0) {
+        in = fopen(path, "rb");
+        if (!in) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    if (decoder.csv) {
+        printf("time_s,cpu,seq,record,name,value0,value1\n");
+    }
+    int c;
+    while ((c = getc(in)) != EOF) {
+        decoder_feed(&decoder, (uint8_t)c);
+        if (!decoder.csv) {
+            fflush(stdout);  // プロンプト（改行なし）もすぐ表示する
+        }
+    }
+    // 途中で切れたフレームはテキストとして出す
+    while (decoder.length > 0) {
+        decoder_skip_byte(&decoder);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    fprintf(stderr,
+            "trace_decode: %u frames, %u checksum errors, %u lost, "
+            "%u raw bytes\n",
+            decoder.frames, decoder.bad_sums, decoder.lost,
+            decoder.raw_bytes);
+    return decoder.bad_sums || decoder.lost ? 1 : 0;
+}